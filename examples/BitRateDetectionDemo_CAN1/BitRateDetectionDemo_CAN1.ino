@@ -0,0 +1,123 @@
+// CAN1 automatic bit rate detection demo for Adafruit Feather M4 CAN Express
+// Connect CAN1 to a bus with traffic, whose bit rates are one of the candidates below.
+// CAN1 is started in bus monitoring mode, then candidates are tried until one of them receives
+// frames without protocol error; the controller is then switched to normal mode, and received
+// frames are displayed.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// Candidates, most likely first: for a given arbitration bit rate, list the most likely data bit
+// rate first, as a bus without frames with bit rate switch does not check it.
+
+static const ACANFD_FeatherM4CAN_Settings CANDIDATES [] = {
+  ACANFD_FeatherM4CAN_Settings (500 * 1000, DataBitRateFactor::x4),
+  ACANFD_FeatherM4CAN_Settings (500 * 1000, DataBitRateFactor::x2),
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x4),
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x1),
+  ACANFD_FeatherM4CAN_Settings (250 * 1000, DataBitRateFactor::x8),
+  ACANFD_FeatherM4CAN_Settings (125 * 1000, DataBitRateFactor::x1)
+} ;
+
+static const uint8_t CANDIDATE_COUNT = sizeof (CANDIDATES) / sizeof (CANDIDATES [0]) ;
+
+//-----------------------------------------------------------------
+// Dwell time per candidate, in ms: should be greater than the period of the most frequent frame
+
+static const uint32_t DWELL_TIME = 100 ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 automatic bit rate detection") ;
+//--- Driver FIFOs and message RAM are allocated once, by beginFD
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::BUS_MONITORING ;
+  const uint32_t errorCode = can1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gReceivedFrameCount = 0 ;
+static uint32_t gDisplayDate = 0 ;
+static bool gDetectionErrorDisplayed = false ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  switch (can1.pollBitRateDetection ()) {
+  case ACANFD_FeatherM4CAN::BIT_RATE_DETECTION_IDLE :
+  case ACANFD_FeatherM4CAN::BIT_RATE_DETECTION_FAILED :
+    { const uint32_t detectionErrorCode = can1.beginBitRateDetection (CANDIDATES, CANDIDATE_COUNT, DWELL_TIME) ;
+      if (0 == detectionErrorCode) {
+        Serial.println ("Detecting...") ;
+      }else if (!gDetectionErrorDisplayed) { // State is unchanged, displayed once
+        Serial.print ("Error bit rate detection: 0x") ;
+        Serial.println (detectionErrorCode, HEX) ;
+        gDetectionErrorDisplayed = true ;
+      }
+    }
+    break ;
+  case ACANFD_FeatherM4CAN::BIT_RATE_DETECTION_RUNNING :
+    break ;
+  case ACANFD_FeatherM4CAN::BIT_RATE_DETECTION_LOCKED :
+    if (gDisplayDate == 0) {
+      const ACANFD_FeatherM4CAN_Settings & locked = CANDIDATES [can1.lockedBitRateCandidateIndex ()] ;
+      Serial.print ("Locked in ") ;
+      Serial.print (can1.bitRateDetectionDuration ()) ;
+      Serial.print (" ms: ") ;
+      Serial.print (locked.actualArbitrationBitRate ()) ;
+      Serial.print (" bit/s, data ") ;
+      Serial.print (locked.actualDataBitRate ()) ;
+      Serial.println (can1.dataBitRateVerified () ? " bit/s" : " bit/s (not verified)") ;
+      gDisplayDate = millis () ;
+    }
+    break ;
+  }
+//--- Received frames
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+    gReceivedFrameCount += 1 ;
+  }
+  if ((gDisplayDate != 0) && ((millis () - gDisplayDate) >= 1000)) {
+    gDisplayDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Received: ") ;
+    Serial.println (gReceivedFrameCount) ;
+  }
+}
+
+//-----------------------------------------------------------------
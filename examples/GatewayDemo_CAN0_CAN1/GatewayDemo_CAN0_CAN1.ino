@@ -0,0 +1,137 @@
+// CAN0 -> CAN1 gateway demo for Adafruit Feather M4 CAN Express
+// No external hardware required: both controllers are in internal loop back mode.
+// Frames sent by CAN0 are received by CAN0, and routed by the CAN0 interrupt service
+// routine to CAN1, that sends (and receives) them.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can0.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (1731)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// Routes of CAN0 received frames (one standard filter, one extended filter):
+//   - standard filter 0 (0x100): forwarded as 0x200;
+//   - extended filter 0 (0x12345600 ... 0x123456FF): forwarded as is, and received by CAN0;
+//   - non matching frames: dropped.
+// The routing table should remain valid while the gateway is set.
+
+static ACANFD_FeatherM4CAN_GatewayRoutes gRoutes (1, 1, ACANFD_FeatherM4CAN_GatewayRoutes::DROP) ;
+
+//-----------------------------------------------------------------
+
+static void printError (const char * inMessage, const uint32_t inErrorCode) {
+  if (0 == inErrorCode) {
+    Serial.print (inMessage) ;
+    Serial.println (" configuration ok") ;
+  }else{
+    Serial.print ("Error ") ;
+    Serial.print (inMessage) ;
+    Serial.print (" configuration: 0x") ;
+    Serial.println (inErrorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN0 -> CAN1 gateway test") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x2) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+//--- CAN1: receives every frame
+  printError ("can1", can1.beginFD (settings)) ;
+//--- CAN0
+  ACANFD_FeatherM4CAN::StandardFilters standardFilters ;
+  standardFilters.addSingle (0x100, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+  ACANFD_FeatherM4CAN::ExtendedFilters extendedFilters ;
+  extendedFilters.addRange (0x12345600, 0x123456FF, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+  printError ("can0", can0.beginFD (settings, standardFilters, extendedFilters)) ;
+//--- Gateway
+  gRoutes.setStandardRoute (0, ACANFD_FeatherM4CAN_GatewayRoutes::FORWARD, 0x7FF, 0x200) ;
+  gRoutes.setExtendedRoute (0, ACANFD_FeatherM4CAN_GatewayRoutes::FORWARD_AND_RECEIVE) ;
+  can0.setGateway (can1, gRoutes) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gCAN0ReceiveCount = 0 ;
+static uint32_t gCAN1ReceiveCount = 0 ;
+static uint32_t gCAN1RewrittenCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Send a frame: 0x100, 0x101, 0x12345600, 0x12345700, ...
+  if (can0.sendBufferNotFullForIndex (0)) {
+    CANFDMessage frame ;
+    switch (gSentCount % 4) {
+    case 0 : frame.id = 0x100 ; break ;
+    case 1 : frame.id = 0x101 ; break ;
+    case 2 : frame.id = 0x12345600 ; frame.ext = true ; break ;
+    default : frame.id = 0x12345700 ; frame.ext = true ; break ;
+    }
+    frame.len = 64 ;
+    for (uint32_t i=0 ; i<64 ; i++) {
+      frame.data [i] = uint8_t (gSentCount + i) ;
+    }
+    if (can0.tryToSendReturnStatusFD (frame) == 0) {
+      gSentCount += 1 ;
+    }
+  }
+//--- Receive frames
+  CANFDMessage frame ;
+  if (can0.receiveFD0 (frame)) {
+    gCAN0ReceiveCount += 1 ;
+  }
+  if (can1.receiveFD0 (frame)) {
+    gCAN1ReceiveCount += 1 ;
+    if (!frame.ext && (frame.id == 0x200)) {
+      gCAN1RewrittenCount += 1 ;
+    }
+  }
+//--- Blink led and display
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", CAN0 received: ") ;
+    Serial.print (gCAN0ReceiveCount) ;
+    Serial.print (", CAN1 received: ") ;
+    Serial.print (gCAN1ReceiveCount) ;
+    Serial.print (" (rewritten ") ;
+    Serial.print (gCAN1RewrittenCount) ;
+    Serial.print ("), forwarded: ") ;
+    Serial.print (can0.gatewayForwardedCount ()) ;
+    Serial.print (", lost: ") ;
+    Serial.println (can0.gatewayLostCount ()) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,99 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express
+// No external hardware required.
+// This sketch sends CANFD frames as fast as possible, and displays every second
+// bus load, frame rate and payload rate computed by the driver.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 bus statistics test") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  settings.mEnableBusStatistics = true ;
+  settings.mBusStatisticsSlotDuration = 125 * 1000 ; // 8 slots of 125 ms: 1 s sliding window
+
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  Serial.print ("Message RAM required minimum size: ") ;
+  Serial.print (can1.messageRamRequiredMinimumSize ()) ;
+  Serial.println (" words") ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    const ACANFD_FeatherM4CAN_BusStatistics::Snapshot statistics = can1.busStatistics () ;
+    Serial.print ("Bus load ") ;
+    Serial.print (statistics.mBusLoad / 100) ;
+    Serial.print (".") ;
+    Serial.print ((statistics.mBusLoad / 10) % 10) ;
+    Serial.print (" %, ") ;
+    Serial.print (statistics.mFramesPerSecond) ;
+    Serial.print (" frames/s, ") ;
+    Serial.print (statistics.mPayloadBytesPerSecond) ;
+    Serial.print (" bytes/s, sent ") ;
+    Serial.print (statistics.mTotalTransmittedFrameCount) ;
+    Serial.print (", received ") ;
+    Serial.println (statistics.mTotalReceivedFrameCount) ;
+  }
+//--- Send frame
+  if (can1.sendBufferNotFullForIndex (0)) {
+    CANFDMessage frame ;
+    frame.id = 0x123 ;
+    frame.len = 64 ;
+    for (uint32_t i=0 ; i<frame.len ; i++) {
+      frame.data [i] = uint8_t (i) ;
+    }
+    can1.tryToSendReturnStatusFD (frame) ;
+  }
+//--- Receive frame
+  CANFDMessage receivedFrame ;
+  can1.receiveFD0 (receivedFrame) ;
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,109 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express
+// No external hardware required.
+// You can observe emitted CAN 2.0B frames on CANH / CANL pins.
+// CANFD operation is disabled: driver FIFOs store CANMessage values.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (384)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 classic CAN 2.0B loopback test") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x1) ;
+
+  Serial.print ("Actual Arbitration Bit Rate: ") ;
+  Serial.print (settings.actualArbitrationBitRate ()) ;
+  Serial.println (" bit/s") ;
+
+  settings.mClassicCAN20BOnly = true ;
+  settings.mHardwareRxFIFO0Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES ;
+  settings.mHardwareTransmitBufferPayload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  Serial.print ("Message RAM required minimum size: ") ;
+  Serial.print (can1.messageRamRequiredMinimumSize ()) ;
+  Serial.println (" words") ;
+
+if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceiveCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANMessage frame ;
+    frame.id = 0x7FF ;
+ //   frame.ext = true ;
+//    frame.rtr = true ;
+    frame.len = 8 ;
+    frame.data [0] = 0x11 ;
+    frame.data [1] = 0x22 ;
+    frame.data [2] = 0x33 ;
+    frame.data [3] = 0x44 ;
+    frame.data [4] = 0x55 ;
+    frame.data [5] = 0x66 ;
+    frame.data [6] = 0x77 ;
+    frame.data [7] = 0x88 ;
+    const uint32_t sendStatus = can1.tryToSendReturnStatus (frame) ;
+    if (sendStatus == 0) {
+      gSentCount += 1 ;
+      Serial.print ("Sent ") ;
+      Serial.println (gSentCount) ;
+    }else{
+      Serial.print ("Sent error 0x") ;
+      Serial.println (sendStatus) ;    
+    }
+  }
+//--- Receive frame
+  CANMessage frame ;
+  if (can1.receive0 (frame)) {
+    gReceiveCount += 1 ;
+    Serial.print ("Received ") ;
+    Serial.println (gReceiveCount) ;
+  }
+}
+
+//-----------------------------------------------------------------
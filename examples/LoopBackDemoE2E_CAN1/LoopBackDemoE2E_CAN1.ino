@@ -0,0 +1,128 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, with end-to-end protection
+// No external hardware required.
+// Frames 0x100 are stamped with an alive counter and a CRC32 by the driver, when written into
+// message RAM; frames 0x101 are sent without protection. Both are received by a filter with an
+// E2E receive profile: 0x101 frames are rejected (CRC error) by the receive interrupt service
+// routine, they never reach driver receive FIFO.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1912)
+
+#include <ACANFD_FeatherM4CAN.h>
+#include <ACANFD_FeatherM4CAN_E2E.h>
+
+//-----------------------------------------------------------------
+//  E2E module: 2 standard filters, 1 transmit profile
+//-----------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_E2E gE2E (2, 0, 1) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, end-to-end protection") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+
+  ACANFD_FeatherM4CAN::StandardFilters standardFilters ;
+  standardFilters.addSingle (0x100, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ; // Filter 0
+  standardFilters.addSingle (0x101, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ; // Filter 1
+
+//--- CRC32 in the last 4 bytes, 4-bit counter in byte 0
+  ACANFD_FeatherM4CAN_E2E::Profile profile ;
+  profile.mCRC = ACANFD_FeatherM4CAN_E2E::CRC32_IEEE ;
+  profile.mCRCOffset = 60 ;
+  profile.mCounterOffset = 0 ;
+  profile.mCounterBitCount = 4 ;
+  profile.mDataID = 0x0ABC ;
+  gE2E.addTransmitProfile (0x100, false, profile) ;
+  gE2E.setStandardReceiveProfile (0, profile) ;
+  gE2E.setStandardReceiveProfile (1, profile) ;
+  can1.setE2E (gE2E) ;
+
+  const uint32_t errorCode = can1.beginFD (settings, standardFilters) ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gSendDate = 0 ;
+static uint32_t gDisplayDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Send a protected frame and an unprotected one every 10 ms
+  if (gSendDate <= millis ()) {
+    gSendDate += 10 ;
+    CANFDMessage frame ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 64 ;
+    frame.data32 [1] = gSentCount ;
+    frame.id = 0x100 ;
+    if (can1.tryToSendReturnStatusFD (frame) == 0) {
+      gSentCount += 1 ;
+    }
+    frame.id = 0x101 ;
+    if (can1.tryToSendReturnStatusFD (frame) == 0) {
+      gSentCount += 1 ;
+    }
+  }
+//--- Only 0x100 frames are received
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+    gReceivedCount += 1 ;
+  }
+//--- Display
+  if (gDisplayDate <= millis ()) {
+    gDisplayDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    const ACANFD_FeatherM4CAN_E2E::Counts counts0 = gE2E.standardReceiveCounts (0) ;
+    const ACANFD_FeatherM4CAN_E2E::Counts counts1 = gE2E.standardReceiveCounts (1) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", 0x100 accepted: ") ;
+    Serial.print (counts0.mFrameCount) ;
+    Serial.print (", rejected: ") ;
+    Serial.print (counts0.rejectedCount ()) ;
+    Serial.print (", 0x101 CRC errors: ") ;
+    Serial.println (counts1.mCRCErrorCount) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,125 @@
+// CAN1 ISO-TP LoopBackDemo for Adafruit Feather M4 CAN Express
+// No external hardware required.
+// Two ISO-TP channels of the same controller talk together: channel 0 sends on 0x7E0 and
+// receives on 0x7E8, channel 1 sends on 0x7E8 and receives on 0x7E0. A 10,000-byte message
+// is transferred with 64-byte consecutive frames; flow control frames are sent and handled
+// from interrupt service routine.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+#include <ACANFD_FeatherM4CAN_ISOTP.h>
+
+//-----------------------------------------------------------------
+
+static const uint32_t MESSAGE_LENGTH = 10 * 1000 ;
+static uint8_t gTransmitBuffer [MESSAGE_LENGTH] ;
+static uint8_t gReceiveBuffer [MESSAGE_LENGTH] ;
+static uint8_t gReplyBuffer [64] ;
+
+static ACANFD_FeatherM4CAN_ISOTP gISOTP (can1, 2) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 ISO-TP loopback test") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  const uint32_t errorCode = can1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+//--- Channel 0: tester
+  ACANFD_FeatherM4CAN_ISOTP::ChannelSettings channelSettings ;
+  channelSettings.mTransmitIdentifier = 0x7E0 ;
+  channelSettings.mReceiveIdentifier = 0x7E8 ;
+  gISOTP.configureChannel (0, channelSettings, gReplyBuffer, sizeof (gReplyBuffer)) ;
+//--- Channel 1: ECU, asks for a flow control frame every 32 consecutive frames
+  channelSettings.mTransmitIdentifier = 0x7E8 ;
+  channelSettings.mReceiveIdentifier = 0x7E0 ;
+  channelSettings.mBlockSize = 32 ;
+  gISOTP.configureChannel (1, channelSettings, gReceiveBuffer, sizeof (gReceiveBuffer)) ;
+  can1.setISOTP (gISOTP) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+static uint32_t gTransferCount = 0 ;
+static uint32_t gErrorCount = 0 ;
+static uint32_t gTransferStartDate = 0 ;
+static uint32_t gLastTransferDuration = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  gISOTP.poll () ;
+//--- Send message
+  if (gISOTP.transmitState (0) != ACANFD_FeatherM4CAN_ISOTP::TRANSMIT_IN_PROGRESS) {
+    for (uint32_t i=0 ; i<MESSAGE_LENGTH ; i++) {
+      gTransmitBuffer [i] = uint8_t (i + gTransferCount) ;
+    }
+    gTransferStartDate = micros () ;
+    gISOTP.send (0, gTransmitBuffer, MESSAGE_LENGTH) ;
+  }
+//--- Receive message, and reply
+  uint32_t length = 0 ;
+  if (gISOTP.receive (1, length)) {
+    gLastTransferDuration = micros () - gTransferStartDate ;
+    if ((length != MESSAGE_LENGTH) || (memcmp (gReceiveBuffer, gTransmitBuffer, MESSAGE_LENGTH) != 0)) {
+      gErrorCount += 1 ;
+    }
+    gTransferCount += 1 ;
+    gISOTP.releaseReceiveBuffer (1) ;
+    const uint8_t reply [2] = { 0x76, uint8_t (gTransferCount) } ;
+    gISOTP.send (1, reply, 2) ;
+  }
+  if (gISOTP.receive (0, length)) {
+    gISOTP.releaseReceiveBuffer (0) ;
+  }
+//--- Blink led and display
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Transfers: ") ;
+    Serial.print (gTransferCount) ;
+    Serial.print (", errors: ") ;
+    Serial.print (gErrorCount) ;
+    Serial.print (", reception errors: ") ;
+    Serial.print (gISOTP.receiveErrorCount (1)) ;
+    Serial.print (", last transfer: ") ;
+    Serial.print (gLastTransferDuration) ;
+    Serial.println (" us") ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,116 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, with separate interrupt lines
+// No external hardware required.
+// Reception interrupts are on EINT0, serviced by the CAN1 interrupt at the highest priority;
+// transmission interrupts are on EINT1, serviced by the AC (analog comparator, unused here)
+// interrupt at the lowest priority: reception preempts driver transmit FIFO refill.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+//  EINT1 interrupts of CAN1 are serviced by the AC interrupt handler
+//-----------------------------------------------------------------
+
+extern "C" void AC_Handler (void) ; // SHOULD HAVE C LINKAGE
+
+void AC_Handler (void) {
+  can1.line1InterruptServiceRoutine () ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, interrupt lines") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  settings.mDriverTransmitFIFOSize = 100 ;
+  settings.mDriverReceiveFIFO0Size = 100 ;
+  settings.mReceptionInterruptLine = ACANFD_FeatherM4CAN_Settings::EINT0 ;
+  settings.mTransmissionInterruptLine = ACANFD_FeatherM4CAN_Settings::EINT1 ;
+  settings.mErrorInterruptLine = ACANFD_FeatherM4CAN_Settings::EINT1 ;
+  settings.mInterruptPriority = 0 ; // Highest
+  settings.mInterruptLine1IRQ = AC_IRQn ;
+  settings.mInterruptLine1Priority = 7 ; // Lowest
+
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static const uint32_t BURST_SIZE = 80 ;
+static uint32_t gBlinkDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+static uint32_t gSequenceErrorCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", sequence errors: ") ;
+    Serial.print (gSequenceErrorCount) ;
+    Serial.print (", hardware Rx FIFO 0 lost: ") ;
+    Serial.println (can1.hardwareRxFIFO0LostCount ()) ;
+  //--- A burst that fills driver transmit FIFO: its refill runs at EINT1 priority
+    CANFDMessage frame ;
+    frame.id = 0x123 ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 64 ;
+    for (uint32_t i = 0 ; i < BURST_SIZE ; i++) {
+      frame.data32 [0] = gSentCount ;
+      if (can1.tryToSendReturnStatusFD (frame) == 0) {
+        gSentCount += 1 ;
+      }
+    }
+  }
+//--- Receive frames: the sequence number is the first data word
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+    if (frame.data32 [0] != gReceivedCount) {
+      gSequenceErrorCount += 1 ;
+    }
+    gReceivedCount = frame.data32 [0] + 1 ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,101 @@
+// CAN0 and CAN1 loopback demo for Adafruit Feather M4 CAN Express, with a merged receive stream
+// No external hardware required: both controllers are in internal loop back mode.
+// Frames received by CAN0 and CAN1 are entered into a single stream, and delivered in arrival
+// order (hardware receive timestamp), with a 1 ms reorder window. Each frame is displayed with
+// its controller, FIFO and receive date; CAN1 sends 8 byte frames, CAN0 64 byte frames.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (1728)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// 32 frames, 1 ms reorder window
+
+ACANFD_FeatherM4CAN_MergedReceiveStream gStream (32, 1000) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN0 and CAN1 loopback test, merged receive stream") ;
+  ACANFD_FeatherM4CAN_Settings settings0 (1000 * 1000, DataBitRateFactor::x4) ;
+  settings0.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  uint32_t errorCode = can0.beginFD (settings0) ;
+  if (0 != errorCode) {
+    Serial.print ("CAN0 configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  ACANFD_FeatherM4CAN_Settings settings1 (500 * 1000, DataBitRateFactor::x2) ;
+  settings1.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  errorCode = can1.beginFD (settings1) ;
+  if (0 != errorCode) {
+    Serial.print ("CAN1 configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  can0.setMergedReceiveStream (gStream) ;
+  can1.setMergedReceiveStream (gStream) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gSendDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANFDMessage frame ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    for (uint32_t i=0 ; i<3 ; i++) {
+      frame.id = 0x100 + i ;
+      frame.len = 64 ;
+      can0.tryToSendReturnStatusFD (frame) ;
+      frame.id = 0x200 + i ;
+      frame.len = 8 ;
+      can1.tryToSendReturnStatusFD (frame) ;
+    }
+    Serial.print ("Lost: ") ;
+    Serial.print (gStream.overflowCount ()) ;
+    Serial.print (", late: ") ;
+    Serial.println (gStream.lateFrameCount ()) ;
+  }
+  ACANFD_FeatherM4CAN_MergedReceiveStream::Frame frame ;
+  while (gStream.receive (frame)) {
+    Serial.print (frame.mDate) ;
+    Serial.print (" us, CAN") ;
+    Serial.print (frame.mController) ;
+    Serial.print (", FIFO ") ;
+    Serial.print (frame.mFIFOIndex) ;
+    Serial.print (": 0x") ;
+    Serial.println (frame.mMessage.id, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
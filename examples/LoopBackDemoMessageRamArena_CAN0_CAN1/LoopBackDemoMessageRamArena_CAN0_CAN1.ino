@@ -0,0 +1,125 @@
+// CAN0 and CAN1 loopback demo for Adafruit Feather M4 CAN Express, with a shared message RAM
+// No external hardware required: both controllers are in internal loop back mode.
+// Both controllers take their message RAM from a single arena, exactly the size their settings
+// require (CAN0: 16 element Rx FIFO 0, CAN1: default 64 element Rx FIFO 0); the message RAM
+// layout of each controller is displayed.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   With CAN_MESSAGE_RAM_ARENA_SIZE, CAN0_MESSAGE_RAM_SIZE and CAN1_MESSAGE_RAM_SIZE only
+//   select configured modules (0: not configured, other value: configured).
+//   The begin method checks if the arena has enough free words for the required size.
+//   Hint: if you do not want to compute required size, print
+//   canX.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (1)
+#define CAN1_MESSAGE_RAM_SIZE (1)
+#define CAN_MESSAGE_RAM_ARENA_SIZE (1728 + 864)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+
+static void printSection (const char * inName,
+                          const uint32_t * inStart,
+                          const ACANFD_FeatherM4CAN::MessageRamSection & inSection) {
+  Serial.print ("  ") ;
+  Serial.print (inName) ;
+  Serial.print (": 0x") ;
+  Serial.print (uint32_t (inStart + inSection.mWordOffset), HEX) ;
+  Serial.print (", ") ;
+  Serial.print (inSection.mWordCount) ;
+  Serial.println (" words") ;
+}
+
+//-----------------------------------------------------------------
+
+static void printLayout (const char * inName, const ACANFD_FeatherM4CAN & inCAN) {
+  const ACANFD_FeatherM4CAN::MessageRamLayout & layout = inCAN.messageRamLayout () ;
+  Serial.print (inName) ;
+  Serial.print (" message RAM, ") ;
+  Serial.print (layout.wordCount ()) ;
+  Serial.println (" words") ;
+  printSection ("Standard filters", layout.mStart, layout.mStandardFilters) ;
+  printSection ("Extended filters", layout.mStart, layout.mExtendedFilters) ;
+  printSection ("Rx FIFO 0", layout.mStart, layout.mRxFIFO0) ;
+  printSection ("Rx FIFO 1", layout.mStart, layout.mRxFIFO1) ;
+  printSection ("Tx buffers", layout.mStart, layout.mTxBuffers) ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN0 and CAN1 loopback test, shared message RAM") ;
+//--- CAN0: 16 element Rx FIFO 0 (864 words)
+  ACANFD_FeatherM4CAN_Settings settings0 (1000 * 1000, DataBitRateFactor::x4) ;
+  settings0.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  settings0.mHardwareRxFIFO0Size = 16 ;
+  uint32_t errorCode = can0.beginFD (settings0) ;
+  if (0 == errorCode) {
+    printLayout ("CAN0", can0) ;
+  }else{
+    Serial.print ("CAN0 configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+//--- CAN1: default settings (1728 words)
+  ACANFD_FeatherM4CAN_Settings settings1 (500 * 1000, DataBitRateFactor::x4) ;
+  settings1.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  errorCode = can1.beginFD (settings1) ;
+  if (0 == errorCode) {
+    printLayout ("CAN1", can1) ;
+  }else{
+    Serial.print ("CAN1 configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  Serial.print ("Arena free words: ") ;
+  Serial.println (gMessageRamArena.freeWordCount ()) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gSendDate = 0 ;
+static uint32_t gReceivedCount0 = 0 ;
+static uint32_t gReceivedCount1 = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANFDMessage frame ;
+    frame.id = 0x123 ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 64 ;
+    can0.tryToSendReturnStatusFD (frame) ;
+    can1.tryToSendReturnStatusFD (frame) ;
+    Serial.print ("CAN0 received: ") ;
+    Serial.print (gReceivedCount0) ;
+    Serial.print (", CAN1 received: ") ;
+    Serial.println (gReceivedCount1) ;
+  }
+  CANFDMessage frame ;
+  while (can0.receiveFD0 (frame)) {
+    gReceivedCount0 += 1 ;
+  }
+  while (can1.receiveFD0 (frame)) {
+    gReceivedCount1 += 1 ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,118 @@
+// LoopBack Demo for Adafruit Feather M4 CAN Express, live reconfiguration
+// Every 2 s, CAN1 switches between an operational and a diagnostic bit rate with reconfigure:
+// frames that are queued in driver transmit FIFO, or not sent yet by hardware Tx FIFO, are kept,
+// so every sent frame is received.
+// No external hardware required.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// Both settings have the same message RAM layout (hardware FIFOs are not changed by reconfigure)
+
+static ACANFD_FeatherM4CAN_Settings gOperationalSettings (1000 * 1000, DataBitRateFactor::x4) ;
+static ACANFD_FeatherM4CAN_Settings gDiagnosticSettings (500 * 1000, DataBitRateFactor::x1) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 live reconfiguration") ;
+  gOperationalSettings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  gOperationalSettings.mDriverTransmitFIFOSize = 32 ;
+  gDiagnosticSettings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  gDiagnosticSettings.mDriverTransmitFIFOSize = 64 ; // Slower bit rate, larger FIFO
+  const uint32_t errorCode = can1.beginFD (gOperationalSettings) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint32_t gReconfigurationDate = 0 ;
+static bool gDiagnostic = false ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+static uint32_t gOutOfOrderCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Send a burst of frames every ms
+  if ((millis () - gSendDate) >= 1) {
+    gSendDate = millis () ;
+    bool ok = true ;
+    for (uint32_t i=0 ; (i<4) && ok ; i++) {
+      CANFDMessage frame ;
+      frame.id = 0x123 ;
+      frame.len = 16 ;
+      frame.data32 [0] = gSentCount ;
+      ok = can1.tryToSendReturnStatusFD (frame) == 0 ;
+      if (ok) {
+        gSentCount += 1 ;
+      }
+    }
+  }
+//--- Receive
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+    if (frame.data32 [0] != gReceivedCount) {
+      gOutOfOrderCount += 1 ;
+    }
+    gReceivedCount += 1 ;
+  }
+//--- Switch bit rate every 2 s
+  if ((millis () - gReconfigurationDate) >= 2000) {
+    gReconfigurationDate = millis () ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    gDiagnostic = !gDiagnostic ;
+    const uint32_t start = micros () ;
+    const uint32_t errorCode = can1.reconfigure (gDiagnostic ? gDiagnosticSettings : gOperationalSettings) ;
+    const uint32_t duration = micros () - start ;
+    Serial.print (gDiagnostic ? "Diagnostic" : "Operational") ;
+    Serial.print (", reconfigured in ") ;
+    Serial.print (duration) ;
+    Serial.print (" us, error 0x") ;
+    Serial.print (errorCode, HEX) ;
+    Serial.print (", sent ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", out of order ") ;
+    Serial.print (gOutOfOrderCount) ;
+    Serial.print (", transmit FIFO overflows ") ;
+    Serial.println (can1.transmitFIFOOverflowCount ()) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,142 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, with DBC-style signals
+// No external hardware required.
+// Every second, a frame is sent, its payload is built from signals (Intel and Motorola byte
+// orders, scaling, multiplexing), and received frame signals are decoded and displayed.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+#include <ACANFD_FeatherM4CAN_Signal.h>
+
+//-----------------------------------------------------------------
+//  Signals of the 0x321 frame (as a DBC file would describe them)
+//-----------------------------------------------------------------
+
+typedef ACANFD_FeatherM4CAN_ByteOrder ByteOrder ;
+
+//--- EngineSpeed : 0|16@1+ (0.25,0) [0|16383.75] "rpm"
+class EngineSpeed : public ACANFD_FeatherM4CAN_Signal <0, 16, ByteOrder::INTEL> {
+  public: static constexpr float factor (void) { return 0.25f ; }
+} ;
+
+//--- CoolantTemperature : 23|8@0+ (1,-40) [-40|215] "degC"
+class CoolantTemperature : public ACANFD_FeatherM4CAN_Signal <23, 8, ByteOrder::MOTOROLA> {
+  public: static constexpr float offset (void) { return -40.0f ; }
+} ;
+
+//--- Page M : 24|2@1+ (1,0) [0|3] ""
+typedef ACANFD_FeatherM4CAN_Signal <24, 2, ByteOrder::INTEL> Page ;
+
+//--- OilPressure m0 : 32|16@1+ (0.01,0) [0|655.35] "bar"
+class OilPressure : public ACANFD_FeatherM4CAN_MultiplexedSignal <Page, 0, ACANFD_FeatherM4CAN_Signal <32, 16, ByteOrder::INTEL>> {
+  public: static constexpr float factor (void) { return 0.01f ; }
+} ;
+
+//--- BatteryCurrent m1 : 32|16@1- (0.1,0) [-3276.8|3276.7] "A"
+class BatteryCurrent : public ACANFD_FeatherM4CAN_MultiplexedSignal <Page, 1, ACANFD_FeatherM4CAN_Signal <32, 16, ByteOrder::INTEL, true>> {
+  public: static constexpr float factor (void) { return 0.1f ; }
+} ;
+
+//--- Odometer : 55|32@0+ (0.1,0) [0|429496729.5] "km", crosses 64-bit words
+class Odometer : public ACANFD_FeatherM4CAN_Signal <55, 32, ByteOrder::MOTOROLA> {
+  public: static constexpr float factor (void) { return 0.1f ; }
+} ;
+
+//--- The multiplexor is listed before the signals it multiplexes
+typedef ACANFD_FeatherM4CAN_SignalFrame <
+  EngineSpeed, CoolantTemperature, Page, OilPressure, BatteryCurrent, Odometer
+> EngineFrame ;
+
+static const char * SIGNAL_NAMES [EngineFrame::SIGNAL_COUNT] = {
+  "EngineSpeed", "CoolantTemperature", "Page", "OilPressure", "BatteryCurrent", "Odometer"
+} ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, signals") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gSendDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANFDMessage frame ;
+    frame.id = 0x321 ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 12 ;
+    const float values [EngineFrame::SIGNAL_COUNT] = {
+      800.0f + 10.0f * float (gSentCount % 100), // EngineSpeed
+      float (gSentCount % 120) - 30.0f,          // CoolantTemperature
+      float (gSentCount % 2),                    // Page
+      3.5f,                                      // OilPressure (page 0)
+      -12.3f,                                    // BatteryCurrent (page 1)
+      12345.6f + float (gSentCount)              // Odometer
+    } ;
+    EngineFrame::encode (frame, values) ;
+    if (can1.tryToSendReturnStatusFD (frame) == 0) {
+      gSentCount += 1 ;
+    }
+  }
+//--- Decode received frames: only present signals are displayed
+  CANFDMessage frame ;
+  if (can1.receiveFD0 (frame) && (frame.id == 0x321)) {
+    float values [EngineFrame::SIGNAL_COUNT] ;
+    const uint64_t decoded = EngineFrame::decode (frame, values) ;
+    for (uint32_t i = 0 ; i < EngineFrame::SIGNAL_COUNT ; i++) {
+      if ((decoded & (uint64_t (1) << i)) != 0) {
+        Serial.print (SIGNAL_NAMES [i]) ;
+        Serial.print (": ") ;
+        Serial.print (values [i]) ;
+        Serial.print ("  ") ;
+      }
+    }
+    Serial.println () ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,86 @@
+// CAN1 binary trace LoopBackDemo for Adafruit Feather M4 CAN Express
+// No external hardware required.
+// Every received frame is recorded in binary format, and written to Serial. Capture the serial
+// output in a file, and decode it with extras/ACANFD_TraceDecoder:
+//   ACANFD_TraceDecoder trace.bin          (candump format)
+//   ACANFD_TraceDecoder -asc trace.bin     (Vector ASC format)
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// Two 4 kB buffers
+
+static ACANFD_FeatherM4CAN_TraceLogger gLogger (4096) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x8) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  const uint32_t errorCode = can1.beginFD (settings) ;
+  if (0 == errorCode) {
+    gLogger.begin (Serial) ; // Serial output is now binary
+    can1.setTraceLogger (gLogger) ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSentCount = 0 ;
+static uint32_t gFlushDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Send frames as fast as possible
+  CANFDMessage frame ;
+  frame.id = gSentCount & 0x7FF ;
+  frame.len = 64 ;
+  for (uint32_t i=0 ; i<64 ; i++) {
+    frame.data [i] = uint8_t (gSentCount + i) ;
+  }
+  if (can1.tryToSendReturnStatusFD (frame) == 0) {
+    gSentCount += 1 ;
+  }
+//--- Received frames are only recorded
+  while (can1.receiveFD0 (frame)) {
+  }
+//--- Write full buffer, and partially filled buffer every 100 ms
+  const bool force = (millis () - gFlushDate) >= 100 ;
+  if (force) {
+    gFlushDate = millis () ;
+  }
+  gLogger.flush (force) ;
+}
+
+//-----------------------------------------------------------------
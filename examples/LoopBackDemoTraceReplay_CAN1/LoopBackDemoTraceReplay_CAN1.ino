@@ -0,0 +1,166 @@
+// CAN1 trace replay LoopBackDemo for Adafruit Feather M4 CAN Express
+// No external hardware required.
+// A trace is first recorded in RAM by ACANFD_FeatherM4CAN_TraceLogger (one second of traffic,
+// with 0x100 every 1 ms, 0x200 every 10 ms, 0x300 every 2.5 ms). It is then replayed twice
+// as fast, without 0x300 frames: every frame transmission is requested by TC2 interrupt service
+// routine at its scheduled date, from dedicated Tx buffers 1 and 2. Timing deviation statistics
+// are printed at the end of replay.
+// A trace stored in a file is replayed in the same way: replay.begin (settings, file).
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define 
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+#include <ACANFD_FeatherM4CAN_TraceReplay.h>
+
+//-----------------------------------------------------------------
+// Trace is recorded into RAM
+
+class MemoryTrace : public Print {
+  public: virtual size_t write (uint8_t inByte) {
+    size_t n = 0 ;
+    if (mLength < sizeof (mBuffer)) {
+      mBuffer [mLength] = inByte ;
+      mLength += 1 ;
+      n = 1 ;
+    }
+    return n ;
+  }
+  public: uint8_t mBuffer [32 * 1024] ;
+  public: uint32_t mLength = 0 ;
+} ;
+
+static MemoryTrace gTrace ;
+
+static ACANFD_FeatherM4CAN_TraceLogger gLogger (1024) ;
+
+//-----------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_TraceReplay gReplay (can1, 16, ACANFD_FeatherM4CAN_TraceReplay::Timer::TC2_TC3) ;
+
+extern "C" void TC2_Handler (void) ; // SHOULD HAVE C LINKAGE
+
+void TC2_Handler (void) {
+  gReplay.timerInterruptServiceRoutine () ;
+}
+
+//-----------------------------------------------------------------
+
+static bool replayedFrame (const CANFDMessage & inFrame) {
+  return inFrame.id != 0x300 ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 trace replay loopback test") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK ;
+  const uint32_t errorCode = can1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+//--- Record one second of traffic
+  gLogger.begin (gTrace) ;
+  can1.setTraceLogger (gLogger) ;
+  const uint32_t identifiers [3] = { 0x100, 0x200, 0x300 } ;
+  const uint32_t periods [3] = { 1000, 10 * 1000, 2500 } ; // In µs
+  uint32_t sendDates [3] = { 0, 0, 0 } ;
+  const uint32_t start = micros () ;
+  uint32_t date = 0 ;
+  while (date < 1000 * 1000) {
+    CANFDMessage frame ;
+    for (uint32_t i=0 ; i<3 ; i++) {
+      if (date >= sendDates [i]) {
+        frame.id = identifiers [i] ;
+        frame.len = 8 ;
+        frame.data32 [0] = date ;
+        if (can1.tryToSendReturnStatusFD (frame) == 0) {
+          sendDates [i] += periods [i] ;
+        }
+      }
+    }
+    while (can1.receiveFD0 (frame)) {
+    }
+    gLogger.flush () ;
+    date = micros () - start ;
+  }
+  delay (10) ;
+  gLogger.flush (true) ;
+  can1.removeTraceLogger () ;
+  Serial.print ("Recorded frames: ") ;
+  Serial.print (gLogger.recordedFrameCount ()) ;
+  Serial.print (", trace size: ") ;
+  Serial.println (gTrace.mLength) ;
+//--- Replay twice as fast, without 0x300 frames
+  ACANFD_FeatherM4CAN_TraceReplay::Settings replaySettings ;
+  replaySettings.mSpeedPercent = 200 ;
+  replaySettings.mFilter = replayedFrame ;
+  const uint32_t replayErrorCode = gReplay.begin (replaySettings, gTrace.mBuffer, gTrace.mLength) ;
+  if (0 != replayErrorCode) {
+    Serial.print ("Error replay configuration: 0x") ;
+    Serial.println (replayErrorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static bool gReportDone = false ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  gReplay.poll () ;
+//--- Replayed frames are received in loop back mode
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+  }
+//--- Per frame deviations are discarded; print statistics at the end of replay
+  ACANFD_FeatherM4CAN_TraceReplay::FrameDeviation deviation ;
+  while (gReplay.readDeviation (deviation)) {
+  }
+  if (!gReportDone && (gReplay.state () != ACANFD_FeatherM4CAN_TraceReplay::RUNNING)) {
+    gReportDone = true ;
+    Serial.print ("Replayed frames: ") ;
+    Serial.print (gReplay.replayedFrameCount ()) ;
+    Serial.print (", filtered: ") ;
+    Serial.println (gReplay.filteredFrameCount ()) ;
+    Serial.print ("Deviation (ns): min ") ;
+    Serial.print (gReplay.minimumDeviation ()) ;
+    Serial.print (", avg ") ;
+    Serial.print (gReplay.averageDeviation ()) ;
+    Serial.print (", max ") ;
+    Serial.println (gReplay.maximumDeviation ()) ;
+    Serial.print ("Late frames: ") ;
+    Serial.println (gReplay.lateFrameCount ()) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,122 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, with traffic statistics
+// No external hardware required.
+// Frames 0x100 ... 0x107 are sent at various rates; two standard filters are defined, the second
+// one is never hit. Every second, per identifier and per filter statistics are displayed.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// 16 identifiers, 2 standard filters, no extended filter
+
+ACANFD_FeatherM4CAN_TrafficStatistics gStatistics (16, 2, 0) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, traffic statistics") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  ACANFD_FeatherM4CAN::StandardFilters standardFilters ;
+  standardFilters.addRange (0x100, 0x103, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+  standardFilters.addSingle (0x7FF, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ; // Dead filter
+  const uint32_t errorCode = can1.beginFD (settings, standardFilters) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  can1.setTrafficStatistics (gStatistics) ;
+}
+
+//-----------------------------------------------------------------
+
+static void printCounters (const ACANFD_FeatherM4CAN_TrafficStatistics::Counters & inCounters) {
+  Serial.print (" frames: ") ;
+  Serial.print (inCounters.mFrameCount) ;
+  Serial.print (", bytes: ") ;
+  Serial.print (inCounters.mByteCount) ;
+  Serial.print (", interval (us) min: ") ;
+  Serial.print ((inCounters.mFrameCount < 2) ? 0 : inCounters.mMinInterval) ;
+  Serial.print (", avg: ") ;
+  Serial.print (inCounters.averageInterval ()) ;
+  Serial.print (", max: ") ;
+  Serial.println (inCounters.mMaxInterval) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gDisplayDate = PERIOD ;
+static uint32_t gSendDate = 0 ;
+static uint32_t gSendCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Frame 0x100 + i is sent every (i + 1) * 10 ms
+  if (gSendDate <= millis ()) {
+    gSendDate += 10 ;
+    gSendCount += 1 ;
+    for (uint32_t i=0 ; i<8 ; i++) {
+      if ((gSendCount % (i + 1)) == 0) {
+        CANFDMessage frame ;
+        frame.id = 0x100 + i ;
+        frame.len = uint8_t (8 * (i % 3)) ;
+        can1.tryToSendReturnStatusFD (frame) ;
+      }
+    }
+  }
+//--- Received frames
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+  }
+//--- Display
+  if (gDisplayDate <= millis ()) {
+    gDisplayDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    ACANFD_FeatherM4CAN_TrafficStatistics::IdentifierCounters entries [16] ;
+    const uint16_t n = gStatistics.snapshot (entries, 16) ;
+    for (uint16_t i=0 ; i<n ; i++) {
+      Serial.print ("0x") ;
+      Serial.print (entries [i].mIdentifier, HEX) ;
+      printCounters (entries [i]) ;
+    }
+    for (uint8_t i=0 ; i<2 ; i++) {
+      Serial.print ("Filter ") ;
+      Serial.print (i) ;
+      printCounters (gStatistics.standardFilterCounters (i)) ;
+    }
+    Serial.print ("Non matching") ;
+    printCounters (gStatistics.nonMatchingCounters (false)) ;
+  }
+}
+
+//-----------------------------------------------------------------
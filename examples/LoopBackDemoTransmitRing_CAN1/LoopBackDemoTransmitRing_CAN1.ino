@@ -0,0 +1,138 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, with a transmit ring
+// No external hardware required.
+// Frames are sent by two producers, through the same transmit ring: the loop sends 0x100 frames,
+// the AC (analog comparator, unused here) interrupt, software triggered every millisecond at a
+// higher priority than the CAN interrupt, sends 0x200 frames. Both carry a sequence number, that
+// is checked on reception.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_TransmitRing gRing (32) ;
+
+//-----------------------------------------------------------------
+//  Second producer: AC interrupt handler
+//-----------------------------------------------------------------
+
+static volatile uint32_t gInterruptSentCount = 0 ;
+
+//-----------------------------------------------------------------
+
+extern "C" void AC_Handler (void) ; // SHOULD HAVE C LINKAGE
+
+void AC_Handler (void) {
+  CANFDMessage frame ;
+  frame.id = 0x200 ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  frame.data32 [0] = gInterruptSentCount ;
+  if (can1.tryToSendReturnStatusFD (frame) == 0) {
+    gInterruptSentCount += 1 ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, transmit ring") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  settings.mDriverReceiveFIFO0Size = 100 ;
+  settings.mInterruptPriority = 4 ;
+
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  can1.setTransmitRing (gRing) ;
+//--- AC interrupt preempts CAN interrupt
+  NVIC_SetPriority (AC_IRQn, 0) ;
+  NVIC_ClearPendingIRQ (AC_IRQn) ;
+  NVIC_EnableIRQ (AC_IRQn) ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+static uint32_t gTriggerDate = 0 ;
+static uint32_t gLoopSentCount = 0 ;
+static uint32_t gReceivedCount [2] = {0, 0} ;
+static uint32_t gSequenceErrorCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent by loop: ") ;
+    Serial.print (gLoopSentCount) ;
+    Serial.print (", by interrupt: ") ;
+    Serial.print (gInterruptSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount [0]) ;
+    Serial.print (" + ") ;
+    Serial.print (gReceivedCount [1]) ;
+    Serial.print (", sequence errors: ") ;
+    Serial.print (gSequenceErrorCount) ;
+    Serial.print (", ring overflows: ") ;
+    Serial.println (gRing.overflowCount ()) ;
+  }
+//--- Trigger the second producer
+  if (gTriggerDate <= millis ()) {
+    gTriggerDate += 1 ;
+    NVIC_SetPendingIRQ (AC_IRQn) ;
+  }
+//--- First producer
+  CANFDMessage frame ;
+  frame.id = 0x100 ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  frame.data32 [0] = gLoopSentCount ;
+  if (can1.tryToSendReturnStatusFD (frame) == 0) {
+    gLoopSentCount += 1 ;
+  }
+//--- Receive frames: the sequence number is the first data word
+  while (can1.receiveFD0 (frame)) {
+    const uint32_t producer = (frame.id == 0x200) ? 1 : 0 ;
+    if (frame.data32 [0] != gReceivedCount [producer]) {
+      gSequenceErrorCount += 1 ;
+    }
+    gReceivedCount [producer] = frame.data32 [0] + 1 ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,105 @@
+// CAN1 external LoopBackDemo for Adafruit Feather M4 CAN Express, sleeping until CAN events
+// No external hardware required.
+// The loop does not poll: waitForEvents puts the core in IDLE sleep mode until a frame has been
+// received, or a 100 ms timeout (a frame is then sent). Wake statistics are displayed every second.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 CANFD loopback test, waiting for events") ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+
+  const uint32_t errorCode = can1.beginFD (settings) ;
+
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gDisplayDate = PERIOD ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  const uint32_t events = can1.waitForEvents (
+    ACANFD_FeatherM4CAN::kEventReceiveFIFO0 | ACANFD_FeatherM4CAN::kEventErrorStateChange,
+    100 * 1000 // Timeout, in µs
+  ) ;
+//--- Timeout: send a frame
+  if (events == 0) {
+    CANFDMessage frame ;
+    frame.id = 0x542 ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 16 ;
+    if (can1.tryToSendReturnStatusFD (frame) == 0) {
+      gSentCount += 1 ;
+    }
+  }
+//--- Received frames
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+    gReceivedCount += 1 ;
+  }
+//--- Error state
+  if ((events & ACANFD_FeatherM4CAN::kEventErrorStateChange) != 0) {
+    Serial.println (can1.isBusOff () ? "Bus off" : "Error state change") ;
+  }
+//--- Display
+  if (gDisplayDate <= millis ()) {
+    gDisplayDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    const ACANFD_FeatherM4CAN::WakeStatistics stats = can1.wakeStatistics () ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", sleeps: ") ;
+    Serial.print (stats.mSleepCount) ;
+    Serial.print (", wake latency (ns) min: ") ;
+    Serial.print ((stats.mWakeCount == 0) ? 0 : stats.mMinWakeLatency) ;
+    Serial.print (", avg: ") ;
+    Serial.print (stats.averageWakeLatency ()) ;
+    Serial.print (", max: ") ;
+    Serial.println (stats.mMaxWakeLatency) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -45,6 +45,9 @@
 //  the frame cannot be emitted successfully. This error always increments 
 //  Tx Error Count by 8 until it reaches 256, at which point the controller
 //  becomes bus-off and stops all transmission.
+//
+//  The TransceiverDelayCompensationCalibration_CAN1 sketch measures the transceiver loop delay,
+//  and finds the error free range of this value.
 //-----------------------------------------------------------------
 
 #ifndef ARDUINO_FEATHER_M4_CAN
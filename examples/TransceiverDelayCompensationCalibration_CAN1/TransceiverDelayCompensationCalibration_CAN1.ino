@@ -0,0 +1,133 @@
+// CAN1 transceiver delay compensation calibration for Adafruit Feather M4 CAN Express
+// Do not connect CAN network: test frames are sent in external loop back mode.
+// Candidates are tried by increasing data bit rate: for each one, the transceiver delay
+// compensation offset is swept around the data sample point, until test frames fail. The highest
+// error free data bit rate is displayed, with its calibrated offset; CAN1 is then started with it.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #error "This sketch should be compiled for Arduino Feather M4 CAN (SAME51)"
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_FeatherM4CAN.h> should be included only from the .ino file
+//   From an other file, include <ACANFD_FeatherM4CAN-from-cpp.h>
+//   Before including <ACANFD_FeatherM4CAN.h>, you should define
+//   Message RAM size for CAN0 and Message RAM size for CAN1.
+//   Maximum required size is 4,352 (4,352 32-bit words).
+//   A 0 size means the CAN module is not configured; its TxCAN and RxCAN pins
+//   can be freely used for an other function.
+//   The begin method checks if actual size is greater or equal to required size.
+//   Hint: if you do not want to compute required size, print
+//   can1.messageRamRequiredMinimumSize () for getting it.
+
+#define CAN0_MESSAGE_RAM_SIZE (0)
+#define CAN1_MESSAGE_RAM_SIZE (1728)
+
+#include <ACANFD_FeatherM4CAN.h>
+
+//-----------------------------------------------------------------
+// Candidates, by increasing data bit rate
+
+static const ACANFD_FeatherM4CAN_Settings CANDIDATES [] = {
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x2),
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x4),
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x6),
+  ACANFD_FeatherM4CAN_Settings (1000 * 1000, DataBitRateFactor::x8)
+} ;
+
+static const uint8_t CANDIDATE_COUNT = sizeof (CANDIDATES) / sizeof (CANDIDATES [0]) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (115200) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 transceiver delay compensation calibration") ;
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x1) ;
+  settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+  const uint32_t errorCode = can1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can configuration ok") ;
+  }else{
+    Serial.print ("Error can configuration: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  const uint32_t calibrationErrorCode = can1.beginTDCCalibration (CANDIDATES, CANDIDATE_COUNT) ;
+  if (0 != calibrationErrorCode) {
+    Serial.print ("Error calibration: 0x") ;
+    Serial.println (calibrationErrorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 1000 ;
+static uint32_t gBlinkDate = PERIOD ;
+static bool gCalibrated = false ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  const ACANFD_FeatherM4CAN::TDCCalibrationState state = can1.pollTDCCalibration () ;
+  if (!gCalibrated && (state == ACANFD_FeatherM4CAN::TDC_CALIBRATION_FAILED)) {
+    gCalibrated = true ;
+    Serial.println ("Calibration failed: no error free candidate") ;
+  }else if (!gCalibrated && (state == ACANFD_FeatherM4CAN::TDC_CALIBRATION_DONE)) {
+    gCalibrated = true ;
+    ACANFD_FeatherM4CAN_Settings settings = CANDIDATES [can1.calibratedCandidateIndex ()] ;
+    settings.mTransceiverDelayCompensation = can1.calibratedTDCOffset () ;
+    settings.mTransceiverDelayCompensationFilter = can1.calibratedTDCFilter () ;
+    Serial.print ("Highest error free data bit rate: ") ;
+    Serial.print (settings.actualDataBitRate ()) ;
+    Serial.println (" bit/s") ;
+    Serial.print ("Measured transceiver loop delay: ") ;
+    Serial.print (can1.measuredTransceiverDelay ()) ;
+    Serial.println (" CAN clock periods") ;
+    Serial.print ("Error free offsets: ") ;
+    Serial.print (can1.calibratedTDCMinOffset ()) ;
+    Serial.print (" ... ") ;
+    Serial.print (can1.calibratedTDCMaxOffset ()) ;
+    Serial.print (", calibrated offset: ") ;
+    Serial.print (settings.mTransceiverDelayCompensation) ;
+    Serial.print (", filter window length: ") ;
+    Serial.println (settings.mTransceiverDelayCompensationFilter) ;
+    settings.mModuleMode = ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK ;
+    const uint32_t errorCode = can1.beginFD (settings) ;
+    if (0 == errorCode) {
+      Serial.println ("can configuration ok") ;
+    }else{
+      Serial.print ("Error can configuration: 0x") ;
+      Serial.println (errorCode, HEX) ;
+    }
+  }
+//--- Received frames (test frames are received back)
+  CANFDMessage frame ;
+  while (can1.receiveFD0 (frame)) {
+  }
+//--- Once calibrated, send a 64-byte frame every second, with bit rate switch
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += PERIOD ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    if (state == ACANFD_FeatherM4CAN::TDC_CALIBRATION_DONE) {
+      const ACANFD_FeatherM4CAN::Status status = can1.getStatus () ;
+      Serial.print ("Error count: Tx ") ;
+      Serial.print (status.txErrorCount ()) ;
+      Serial.print (", Rx ") ;
+      Serial.print (status.rxErrorCount ()) ;
+      Serial.print (", Transceiver Delay Compensation Value ") ;
+      Serial.println (status.transceiverDelayCompensationOffset ()) ;
+      frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+      frame.id = 0x123 ;
+      frame.len = 64 ;
+      can1.tryToSendReturnStatusFD (frame) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
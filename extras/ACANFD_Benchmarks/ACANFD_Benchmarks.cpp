@@ -0,0 +1,641 @@
+//--------------------------------------------------------------------------------------------------
+// Host microbenchmarks of the driver hot data structures:
+//   - fifo.*: ACANFD_FeatherM4CAN_FIFO append / remove (driver transmit and receive FIFOs),
+//     empty FIFO round trip, full FIFO with every overflow policy;
+//   - decode.* / encode.*: message RAM element decoding and encoding, as getMessageFrom and
+//     writeTxBuffer do, for every Payload setting (ACANFD_FeatherM4CAN_Codec payload specialized
+//     routines, selected by decoderForPayload / encoderForPayload), and CAN 2.0B classic codec;
+//   - settings.*: ACANFD_FeatherM4CAN_Settings bit timing solver, for usual bit rates and data
+//     bit rate factors;
+//   - filters.*: StandardFilters / ExtendedFilters encoding (addSingle, addDual, addRange,
+//     addClassic) of a 32 filter set;
+//   - signals.*: ACANFD_FeatherM4CAN_SignalFrame decoding and encoding of a 16 signal frame
+//     (Intel and Motorola signals, some of them crossing 64-bit words, scaled, multiplexed);
+//   - e2e.*: ACANFD_FeatherM4CAN_E2E CRC kernels over 64-byte payloads, and E2E stamp + check
+//     of a 64-byte frame (CRC32 and counter).
+//
+// Every benchmark runs a fixed number of operations per sample; the reported time is the best
+// sample (less sensitive to scheduling noise than the average), the median is also given.
+//
+// Build (Linux, from this directory):
+//   c++ -std=c++11 -O2 -fpermissive -DARDUINO_FEATHER_M4_CAN -I ../ACANFD_VirtualBus/host -I ../ACANFD_VirtualBus -I ../../src -o ACANFD_Benchmarks ACANFD_Benchmarks.cpp ../ACANFD_VirtualBus/ACANFD_VirtualBus.cpp ../../src/*.cpp
+//   (the virtual bus provides the peripheral register definitions the driver needs on host)
+//
+// Usage: ACANFD_Benchmarks [-samples <n>] [-filter <prefix>] [-compare <baseline.csv>]
+//                          [-threshold <percent>]
+//   Output is CSV on stdout, one line per benchmark:
+//     benchmark,operations,best_ns_per_op,median_ns_per_op,mops_per_s
+//   Save it as a baseline, then run with -compare: a benchmark is a regression if its best time
+//   exceeds the baseline one by more than threshold percent (default 10). Comparison is written
+//   on stderr; exit status is 2 if any regression has been found.
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN-from-cpp.h>
+#include <ACANFD_FeatherM4CAN_Codec.h>
+#include <ACANFD_FeatherM4CAN_Signal.h>
+#include <ACANFD_FeatherM4CAN_E2E.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Sink: results are accumulated here, so that the compiler cannot remove benchmarked code
+//--------------------------------------------------------------------------------------------------
+
+static volatile uint32_t gSink ;
+
+//--------------------------------------------------------------------------------------------------
+// Benchmark registry
+//--------------------------------------------------------------------------------------------------
+
+typedef uint32_t (* BenchmarkRoutine) (const void * inContext) ; // Returns a checksum
+
+class Benchmark {
+  public: std::string mName ;
+  public: BenchmarkRoutine mRoutine ;
+  public: const void * mContext ;
+  public: uint32_t mOperationsPerSample ;
+} ;
+
+static std::vector <Benchmark> gBenchmarks ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void addBenchmark (const std::string & inName,
+                          BenchmarkRoutine inRoutine,
+                          const void * inContext,
+                          const uint32_t inOperationsPerSample) {
+  Benchmark b ;
+  b.mName = inName ;
+  b.mRoutine = inRoutine ;
+  b.mContext = inContext ;
+  b.mOperationsPerSample = inOperationsPerSample ;
+  gBenchmarks.push_back (b) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Test frames: every length of 0 ... 64 bytes, standard and extended, all frame types
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FRAME_COUNT = 256 ; // Power of 2
+
+static CANFDMessage gFrames [FRAME_COUNT] ;
+static CANMessage gClassicFrames [FRAME_COUNT] ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void buildFrames (void) {
+  static const uint8_t FD_LENGTHS [] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+  uint32_t seed = 12345 ;
+  for (uint32_t i=0 ; i<FRAME_COUNT ; i++) {
+    seed = seed * 1103515245 + 12345 ;
+    CANFDMessage & frame = gFrames [i] ;
+    frame.ext = (i & 1) != 0 ;
+    frame.id = frame.ext ? ((seed >> 3) & 0x1FFFFFFF) : ((seed >> 8) & 0x7FF) ;
+    switch (i % 4) {
+    case 0 : frame.type = CANFDMessage::CAN_DATA ; frame.len = uint8_t (i % 9) ; break ;
+    case 1 : frame.type = CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ; frame.len = FD_LENGTHS [i % 16] ; break ;
+    case 2 : frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ; frame.len = FD_LENGTHS [(i / 4) % 16] ; break ;
+    default : frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ; frame.len = 64 ; break ;
+    }
+    for (uint32_t j=0 ; j<64 ; j++) {
+      frame.data [j] = uint8_t (seed >> (j % 24)) ;
+    }
+    CANMessage & classic = gClassicFrames [i] ;
+    classic.ext = frame.ext ;
+    classic.id = frame.id ;
+    classic.rtr = (i % 16) == 15 ;
+    classic.len = uint8_t (i % 9) ;
+    classic.data64 = (uint64_t (seed) << 32) | i ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// FIFO benchmarks
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FIFO_SIZE = 64 ; // Power of 2, as frame count
+static const uint32_t FIFO_OPERATIONS = 1 << 20 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchFIFOAppendRemove (const void *) {
+//--- One append and one remove per operation, FIFO count alternates between 0 and 1
+  static ACANFD_FeatherM4CAN_FIFO fifo ;
+  if (fifo.size () == 0) {
+    fifo.initWithSize (FIFO_SIZE) ;
+  }
+  uint32_t checksum = 0 ;
+  CANFDMessage frame ;
+  for (uint32_t i=0 ; i<FIFO_OPERATIONS ; i++) {
+    fifo.append (gFrames [i & (FRAME_COUNT - 1)]) ;
+    fifo.remove (frame) ;
+    checksum += frame.id ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchFIFOBurst (const void *) {
+//--- Fill the FIFO, then empty it: one append and one remove per operation
+  static ACANFD_FeatherM4CAN_FIFO fifo ;
+  if (fifo.size () == 0) {
+    fifo.initWithSize (FIFO_SIZE) ;
+  }
+  uint32_t checksum = 0 ;
+  CANFDMessage frame ;
+  for (uint32_t i=0 ; i<FIFO_OPERATIONS ; i+=FIFO_SIZE) {
+    for (uint32_t j=0 ; j<FIFO_SIZE ; j++) {
+      fifo.append (gFrames [(i + j) & (FRAME_COUNT - 1)]) ;
+    }
+    while (fifo.remove (frame)) {
+      checksum += frame.id ;
+    }
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchFIFOFull (const void * inContext) {
+//--- Append to a full FIFO: overflow policy path
+  const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy policy =
+    * (const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy *) inContext ;
+  ACANFD_FeatherM4CAN_FIFO fifo ;
+  fifo.initWithSize (FIFO_SIZE) ;
+  fifo.setOverflowPolicy (policy) ;
+  for (uint32_t j=0 ; j<FIFO_SIZE ; j++) {
+    fifo.append (gFrames [j]) ;
+  }
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<FIFO_OPERATIONS ; i++) {
+    checksum += fifo.append (gFrames [i & (FRAME_COUNT - 1)]) ;
+  }
+  return checksum + fifo.overflowCount () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchClassicFIFOAppendRemove (const void *) {
+  static ACANFD_FeatherM4CAN_ClassicFIFO fifo ;
+  if (fifo.size () == 0) {
+    fifo.initWithSize (FIFO_SIZE) ;
+  }
+  uint32_t checksum = 0 ;
+  CANMessage frame ;
+  for (uint32_t i=0 ; i<FIFO_OPERATIONS ; i++) {
+    fifo.append (gClassicFrames [i & (FRAME_COUNT - 1)]) ;
+    fifo.remove (frame) ;
+    checksum += frame.id ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Codec benchmarks: a message RAM image of FRAME_COUNT elements
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t CODEC_OPERATIONS = 1 << 20 ;
+
+static uint32_t gElements [FRAME_COUNT * 18] ; // Largest element: 18 words
+
+static const ACANFD_FeatherM4CAN_Settings::Payload PAYLOADS [8] = {
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_12_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_16_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_20_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_24_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_32_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_48_BYTES,
+  ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchEncode (const void * inContext) {
+  const ACANFD_FeatherM4CAN_Settings::Payload payload = * (const ACANFD_FeatherM4CAN_Settings::Payload *) inContext ;
+  const ACANFD_FeatherM4CAN_Codec::Encoder encoder = ACANFD_FeatherM4CAN_Codec::encoderForPayload (payload) ;
+  const uint32_t elementSize = ACANFD_FeatherM4CAN_Codec::elementWordCount (payload) ;
+  for (uint32_t i=0 ; i<CODEC_OPERATIONS ; i++) {
+    const uint32_t idx = i & (FRAME_COUNT - 1) ;
+    encoder (gFrames [idx], gElements + idx * elementSize) ;
+  }
+  return gElements [0] + gElements [elementSize * (FRAME_COUNT - 1) + 1] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchDecode (const void * inContext) {
+  const ACANFD_FeatherM4CAN_Settings::Payload payload = * (const ACANFD_FeatherM4CAN_Settings::Payload *) inContext ;
+  const ACANFD_FeatherM4CAN_Codec::Decoder decoder = ACANFD_FeatherM4CAN_Codec::decoderForPayload (payload) ;
+  const uint32_t elementSize = ACANFD_FeatherM4CAN_Codec::elementWordCount (payload) ;
+//--- Message RAM image, with the filter index an Rx element has
+  const ACANFD_FeatherM4CAN_Codec::Encoder encoder = ACANFD_FeatherM4CAN_Codec::encoderForPayload (payload) ;
+  for (uint32_t idx=0 ; idx<FRAME_COUNT ; idx++) {
+    uint32_t * element = gElements + idx * elementSize ;
+    encoder (gFrames [idx], element) ;
+    element [1] |= (idx & 0x7F) << 24 ; // FIDX
+  }
+  uint32_t checksum = 0 ;
+  CANFDMessage frame ;
+  for (uint32_t i=0 ; i<CODEC_OPERATIONS ; i++) {
+    decoder (gElements + (i & (FRAME_COUNT - 1)) * elementSize, frame) ;
+    checksum += frame.id + frame.len + frame.data32 [0] ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchEncodeClassic (const void *) {
+  for (uint32_t i=0 ; i<CODEC_OPERATIONS ; i++) {
+    const uint32_t idx = i & (FRAME_COUNT - 1) ;
+    ACANFD_FeatherM4CAN_Codec::encodeClassic (gClassicFrames [idx], gElements + idx * 4) ;
+  }
+  return gElements [0] + gElements [4 * (FRAME_COUNT - 1) + 1] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchDecodeClassic (const void *) {
+  for (uint32_t idx=0 ; idx<FRAME_COUNT ; idx++) {
+    ACANFD_FeatherM4CAN_Codec::encodeClassic (gClassicFrames [idx], gElements + idx * 4) ;
+  }
+  uint32_t checksum = 0 ;
+  CANMessage frame ;
+  for (uint32_t i=0 ; i<CODEC_OPERATIONS ; i++) {
+    ACANFD_FeatherM4CAN_Codec::decodeClassic (gElements + (i & (FRAME_COUNT - 1)) * 4, frame) ;
+    checksum += frame.id + frame.len + frame.data32 [0] ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit timing solver benchmarks
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t SOLVER_OPERATIONS = 1 << 12 ;
+
+static const uint32_t BIT_RATES [] = {
+  125 * 1000, 250 * 1000, 500 * 1000, 1000 * 1000, 83 * 1000 + 333, 727 * 1000
+} ;
+
+static const uint32_t BIT_RATE_COUNT = sizeof (BIT_RATES) / sizeof (BIT_RATES [0]) ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchSettings (const void * inContext) {
+  const DataBitRateFactor factor = * (const DataBitRateFactor *) inContext ;
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<SOLVER_OPERATIONS ; i++) {
+    const ACANFD_FeatherM4CAN_Settings settings (BIT_RATES [i % BIT_RATE_COUNT], factor) ;
+    checksum += settings.mBitRatePrescaler + settings.mArbitrationPhaseSegment1 ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchSettingsWithSamplePoints (const void *) {
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<SOLVER_OPERATIONS ; i++) {
+    const ACANFD_FeatherM4CAN_Settings settings (BIT_RATES [i % BIT_RATE_COUNT], 80, DataBitRateFactor::x4, 70) ;
+    checksum += settings.mBitRatePrescaler + settings.mArbitrationPhaseSegment1 ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Filter encoding benchmarks: one operation is building a 32 filter set
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FILTER_SET_OPERATIONS = 1 << 14 ;
+static const uint32_t FILTERS_PER_SET = 32 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchStandardFilters (const void *) {
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<FILTER_SET_OPERATIONS ; i++) {
+    ACANFD_FeatherM4CAN::StandardFilters filters ;
+    for (uint16_t j=0 ; j<FILTERS_PER_SET ; j+=4) {
+      const uint16_t base = uint16_t ((i + j * 61) & 0x7FF) ;
+      filters.addSingle (base, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+      filters.addDual (base, base ^ 0x155, ACANFD_FeatherM4CAN_FilterAction::FIFO1) ;
+      filters.addRange (base & 0x700, base | 0x0FF, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+      filters.addClassic (base, 0x7F0, ACANFD_FeatherM4CAN_FilterAction::REJECT) ;
+    }
+    checksum += filters.filterAtIndex (FILTERS_PER_SET - 1) ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchExtendedFilters (const void *) {
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<FILTER_SET_OPERATIONS ; i++) {
+    ACANFD_FeatherM4CAN::ExtendedFilters filters ;
+    for (uint32_t j=0 ; j<FILTERS_PER_SET ; j+=4) {
+      const uint32_t base = (i * 0x9E3779B1U + j) & 0x1FFFFFFF ;
+      filters.addSingle (base, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+      filters.addDual (base, base ^ 0x15555555, ACANFD_FeatherM4CAN_FilterAction::FIFO1) ;
+      filters.addRange (base & 0x1FFF0000, base | 0xFFFF, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+      filters.addClassic (base, 0x1FFFFF00, ACANFD_FeatherM4CAN_FilterAction::REJECT) ;
+    }
+    checksum += filters.firstWordAtIndex (FILTERS_PER_SET - 1) + filters.secondWordAtIndex (FILTERS_PER_SET - 1) ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Signal codec benchmarks
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t SIGNAL_OPERATIONS = 1 << 18 ;
+
+typedef ACANFD_FeatherM4CAN_ByteOrder ByteOrder ;
+
+class Speed : public ACANFD_FeatherM4CAN_Signal <0, 16, ByteOrder::INTEL> {
+  public: static constexpr float factor (void) { return 0.25f ; }
+} ;
+
+class Torque : public ACANFD_FeatherM4CAN_Signal <16, 12, ByteOrder::INTEL, true> {
+  public: static constexpr float factor (void) { return 0.5f ; }
+} ;
+
+class Temperature : public ACANFD_FeatherM4CAN_Signal <39, 8, ByteOrder::MOTOROLA> {
+  public: static constexpr float offset (void) { return -40.0f ; }
+} ;
+
+typedef ACANFD_FeatherM4CAN_Signal <60, 4, ByteOrder::INTEL> Multiplexor ;
+
+class Pressure : public ACANFD_FeatherM4CAN_MultiplexedSignal <Multiplexor, 1, ACANFD_FeatherM4CAN_Signal <64, 16, ByteOrder::INTEL>> {
+  public: static constexpr float factor (void) { return 0.1f ; }
+} ;
+
+class Voltage : public ACANFD_FeatherM4CAN_MultiplexedSignal <Multiplexor, 2, ACANFD_FeatherM4CAN_Signal <64, 16, ByteOrder::INTEL>> {
+  public: static constexpr float factor (void) { return 0.001f ; }
+} ;
+
+typedef ACANFD_FeatherM4CAN_SignalFrame <
+  Speed, Torque, Temperature, Multiplexor, Pressure, Voltage,
+  ACANFD_FeatherM4CAN_Signal <120, 16, ByteOrder::INTEL>,            // Crosses words 1 and 2
+  ACANFD_FeatherM4CAN_Signal <183, 24, ByteOrder::MOTOROLA, true>,
+  ACANFD_FeatherM4CAN_Signal <252, 10, ByteOrder::MOTOROLA>,         // Crosses words 3 and 4
+  ACANFD_FeatherM4CAN_Signal <256, 32, ByteOrder::INTEL, true>,
+  ACANFD_FeatherM4CAN_Signal <288, 1, ByteOrder::INTEL>,
+  ACANFD_FeatherM4CAN_Signal <289, 7, ByteOrder::INTEL>,
+  ACANFD_FeatherM4CAN_Signal <303, 40, ByteOrder::MOTOROLA>,
+  ACANFD_FeatherM4CAN_Signal <380, 20, ByteOrder::INTEL, true>,      // Crosses words 5 and 6
+  ACANFD_FeatherM4CAN_Signal <400, 48, ByteOrder::INTEL>,
+  ACANFD_FeatherM4CAN_Signal <455, 64, ByteOrder::MOTOROLA>
+> BenchmarkSignalFrame ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchSignalDecode (const void *) {
+  uint32_t checksum = 0 ;
+  float values [BenchmarkSignalFrame::SIGNAL_COUNT] ;
+  for (uint32_t i=0 ; i<SIGNAL_OPERATIONS ; i++) {
+    const uint64_t decoded = BenchmarkSignalFrame::decode (gFrames [i % FRAME_COUNT], values) ;
+    checksum += uint32_t (decoded) + uint32_t (values [i % 4]) ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchSignalEncode (const void *) {
+  uint32_t checksum = 0 ;
+  float values [BenchmarkSignalFrame::SIGNAL_COUNT] ;
+  for (uint32_t i=0 ; i<BenchmarkSignalFrame::SIGNAL_COUNT ; i++) {
+    values [i] = float (i * 37) - 100.0f ;
+  }
+  CANFDMessage frame ;
+  frame.len = 64 ;
+  for (uint32_t i=0 ; i<SIGNAL_OPERATIONS ; i++) {
+    values [3] = float (1 + (i & 1)) ; // Multiplexor
+    values [0] = float (i & 0xFFF) ;
+    BenchmarkSignalFrame::encode (frame, values) ;
+    checksum += frame.data32 [i % 16] ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// End-to-end protection benchmarks
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t E2E_OPERATIONS = 1 << 18 ;
+
+static const ACANFD_FeatherM4CAN_E2E::CRC CRC8 = ACANFD_FeatherM4CAN_E2E::CRC8_SAE_J1850 ;
+static const ACANFD_FeatherM4CAN_E2E::CRC CRC16 = ACANFD_FeatherM4CAN_E2E::CRC16_CCITT ;
+static const ACANFD_FeatherM4CAN_E2E::CRC CRC32 = ACANFD_FeatherM4CAN_E2E::CRC32_IEEE ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t benchCRC (const void * inContext) {
+  const ACANFD_FeatherM4CAN_E2E::CRC crc = * (const ACANFD_FeatherM4CAN_E2E::CRC *) inContext ;
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<E2E_OPERATIONS ; i++) {
+    const uint8_t * data = gFrames [i % FRAME_COUNT].data ;
+    switch (crc) {
+    case ACANFD_FeatherM4CAN_E2E::CRC8_SAE_J1850 : checksum += ACANFD_FeatherM4CAN_E2E::crc8 (data, 64) ; break ;
+    case ACANFD_FeatherM4CAN_E2E::CRC16_CCITT : checksum += ACANFD_FeatherM4CAN_E2E::crc16 (data, 64) ; break ;
+    default : checksum += ACANFD_FeatherM4CAN_E2E::crc32 (data, 64) ; break ;
+    }
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// A frame is encoded into a Tx buffer element and stamped, then checked as an Rx FIFO element
+
+static uint32_t benchE2EStampCheck (const void *) {
+  static ACANFD_FeatherM4CAN_E2E transmitter (0, 0, 1) ;
+  static ACANFD_FeatherM4CAN_E2E receiver (1, 0, 0) ;
+  static bool configured = false ;
+  if (!configured) {
+    configured = true ;
+    ACANFD_FeatherM4CAN_E2E::Profile profile ;
+    profile.mCRC = ACANFD_FeatherM4CAN_E2E::CRC32_IEEE ;
+    profile.mCRCOffset = 60 ;
+    profile.mCounterOffset = 0 ;
+    profile.mDataID = 0x1234 ;
+    transmitter.addTransmitProfile (0x123, false, profile) ;
+    receiver.setStandardReceiveProfile (0, profile) ;
+  }
+  CANFDMessage frame = gFrames [3] ; // 64 bytes
+  frame.id = 0x123 ;
+  frame.ext = false ;
+  uint32_t checksum = 0 ;
+  for (uint32_t i=0 ; i<E2E_OPERATIONS ; i++) {
+    ACANFD_FeatherM4CAN_Codec::encodeHeader (frame, gElements) ; // FIDX is 0 (page 1177)
+    ACANFD_FeatherM4CAN_Codec::copyWords (gElements + 2, frame.data32, 16) ;
+    transmitter.stampTxElement (gElements, 16) ;
+    checksum += receiver.acceptsRxElement (gElements, 16) ;
+  }
+  return checksum ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Registering benchmarks
+//--------------------------------------------------------------------------------------------------
+
+static const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy DROP_NEWEST = ACANFD_FeatherM4CAN_Settings::DROP_NEWEST ;
+static const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy DROP_OLDEST = ACANFD_FeatherM4CAN_Settings::DROP_OLDEST ;
+static const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy OVERWRITE_SAME_IDENTIFIER = ACANFD_FeatherM4CAN_Settings::OVERWRITE_SAME_IDENTIFIER ;
+
+static const DataBitRateFactor FACTORS [] = {
+  DataBitRateFactor::x1, DataBitRateFactor::x2, DataBitRateFactor::x4, DataBitRateFactor::x8
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void registerBenchmarks (void) {
+  addBenchmark ("fifo.append_remove", benchFIFOAppendRemove, nullptr, FIFO_OPERATIONS) ;
+  addBenchmark ("fifo.burst_64", benchFIFOBurst, nullptr, FIFO_OPERATIONS) ;
+  addBenchmark ("fifo.full_drop_newest", benchFIFOFull, &DROP_NEWEST, FIFO_OPERATIONS) ;
+  addBenchmark ("fifo.full_drop_oldest", benchFIFOFull, &DROP_OLDEST, FIFO_OPERATIONS) ;
+  addBenchmark ("fifo.full_overwrite_same_id", benchFIFOFull, &OVERWRITE_SAME_IDENTIFIER, FIFO_OPERATIONS) ;
+  addBenchmark ("fifo.classic_append_remove", benchClassicFIFOAppendRemove, nullptr, FIFO_OPERATIONS) ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    const std::string suffix = std::to_string (ACANFD_FeatherM4CAN_Settings::frameDataByteCountForPayload (PAYLOADS [i])) ;
+    addBenchmark ("decode.payload_" + suffix, benchDecode, &PAYLOADS [i], CODEC_OPERATIONS) ;
+    addBenchmark ("encode.payload_" + suffix, benchEncode, &PAYLOADS [i], CODEC_OPERATIONS) ;
+  }
+  addBenchmark ("decode.classic", benchDecodeClassic, nullptr, CODEC_OPERATIONS) ;
+  addBenchmark ("encode.classic", benchEncodeClassic, nullptr, CODEC_OPERATIONS) ;
+  for (uint32_t i=0 ; i<sizeof (FACTORS) / sizeof (FACTORS [0]) ; i++) {
+    addBenchmark ("settings.factor_x" + std::to_string (uint32_t (FACTORS [i])), benchSettings, &FACTORS [i], SOLVER_OPERATIONS) ;
+  }
+  addBenchmark ("settings.sample_points", benchSettingsWithSamplePoints, nullptr, SOLVER_OPERATIONS) ;
+  addBenchmark ("filters.standard_32", benchStandardFilters, nullptr, FILTER_SET_OPERATIONS) ;
+  addBenchmark ("filters.extended_32", benchExtendedFilters, nullptr, FILTER_SET_OPERATIONS) ;
+  addBenchmark ("signals.decode_16", benchSignalDecode, nullptr, SIGNAL_OPERATIONS) ;
+  addBenchmark ("signals.encode_16", benchSignalEncode, nullptr, SIGNAL_OPERATIONS) ;
+  addBenchmark ("e2e.crc8_64", benchCRC, &CRC8, E2E_OPERATIONS) ;
+  addBenchmark ("e2e.crc16_64", benchCRC, &CRC16, E2E_OPERATIONS) ;
+  addBenchmark ("e2e.crc32_64", benchCRC, &CRC32, E2E_OPERATIONS) ;
+  addBenchmark ("e2e.stamp_check_64", benchE2EStampCheck, nullptr, E2E_OPERATIONS) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Running
+//--------------------------------------------------------------------------------------------------
+
+class Result {
+  public: double mBestNanoSecondsPerOp ;
+  public: double mMedianNanoSecondsPerOp ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static Result runBenchmark (const Benchmark & inBenchmark, const uint32_t inSampleCount) {
+  gSink += inBenchmark.mRoutine (inBenchmark.mContext) ; // Warm up
+  std::vector <double> samples ;
+  for (uint32_t s=0 ; s<inSampleCount ; s++) {
+    const auto start = std::chrono::steady_clock::now () ;
+    gSink += inBenchmark.mRoutine (inBenchmark.mContext) ;
+    const auto end = std::chrono::steady_clock::now () ;
+    const double ns = double (std::chrono::duration_cast <std::chrono::nanoseconds> (end - start).count ()) ;
+    samples.push_back (ns / inBenchmark.mOperationsPerSample) ;
+  }
+  std::sort (samples.begin (), samples.end ()) ;
+  Result result ;
+  result.mBestNanoSecondsPerOp = samples [0] ;
+  result.mMedianNanoSecondsPerOp = samples [samples.size () / 2] ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Baseline: CSV written by a previous run, best time per benchmark
+//--------------------------------------------------------------------------------------------------
+
+static bool readBaseline (const char * inPath, std::map <std::string, double> & outBaseline) {
+  FILE * f = fopen (inPath, "r") ;
+  const bool ok = f != nullptr ;
+  if (ok) {
+    char line [256] ;
+    while (fgets (line, sizeof (line), f) != nullptr) {
+      char * comma = strchr (line, ',') ;
+      if ((comma != nullptr) && (strncmp (line, "benchmark,", 10) != 0)) {
+        *comma = '\0' ;
+        unsigned operations ;
+        double best ;
+        if (sscanf (comma + 1, "%u,%lf", &operations, &best) == 2) {
+          outBaseline [line] = best ;
+        }
+      }
+    }
+    fclose (f) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, const char * argv []) {
+  uint32_t sampleCount = 9 ;
+  const char * filter = "" ;
+  const char * baselinePath = nullptr ;
+  double threshold = 10.0 ;
+  for (int i=1 ; i<argc ; i++) {
+    if ((strcmp (argv [i], "-samples") == 0) && ((i + 1) < argc)) {
+      sampleCount = uint32_t (atoi (argv [++i])) ;
+    }else if ((strcmp (argv [i], "-filter") == 0) && ((i + 1) < argc)) {
+      filter = argv [++i] ;
+    }else if ((strcmp (argv [i], "-compare") == 0) && ((i + 1) < argc)) {
+      baselinePath = argv [++i] ;
+    }else if ((strcmp (argv [i], "-threshold") == 0) && ((i + 1) < argc)) {
+      threshold = atof (argv [++i]) ;
+    }else{
+      fprintf (stderr, "Usage: %s [-samples <n>] [-filter <prefix>] [-compare <baseline.csv>] [-threshold <percent>]\n", argv [0]) ;
+      return 1 ;
+    }
+  }
+  if (sampleCount == 0) {
+    sampleCount = 1 ;
+  }
+  std::map <std::string, double> baseline ;
+  if ((baselinePath != nullptr) && !readBaseline (baselinePath, baseline)) {
+    fprintf (stderr, "Cannot read %s\n", baselinePath) ;
+    return 1 ;
+  }
+  buildFrames () ;
+  registerBenchmarks () ;
+  printf ("benchmark,operations,best_ns_per_op,median_ns_per_op,mops_per_s\n") ;
+  uint32_t regressionCount = 0 ;
+  for (const Benchmark & b : gBenchmarks) {
+    if (strncmp (b.mName.c_str (), filter, strlen (filter)) == 0) {
+      const Result r = runBenchmark (b, sampleCount) ;
+      const double mops = (r.mBestNanoSecondsPerOp > 0.0) ? (1000.0 / r.mBestNanoSecondsPerOp) : 0.0 ;
+      printf ("%s,%u,%.3f,%.3f,%.2f\n", b.mName.c_str (), b.mOperationsPerSample,
+              r.mBestNanoSecondsPerOp, r.mMedianNanoSecondsPerOp, mops) ;
+      fflush (stdout) ;
+      const auto it = baseline.find (b.mName) ;
+      if (it != baseline.end ()) {
+        const double change = (it->second > 0.0)
+          ? (100.0 * (r.mBestNanoSecondsPerOp - it->second) / it->second)
+          : 0.0 ;
+        const bool regression = change > threshold ;
+        fprintf (stderr, "%-30s %10.3f ns -> %10.3f ns  %+7.1f %%%s\n", b.mName.c_str (), it->second,
+                 r.mBestNanoSecondsPerOp, change, regression ? "  REGRESSION" : "") ;
+        regressionCount += regression ;
+      }
+    }
+  }
+  if (baselinePath != nullptr) {
+    fprintf (stderr, "%u regression(s), threshold %.1f %%\n", regressionCount, threshold) ;
+  }
+  return (regressionCount > 0) ? 2 : 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
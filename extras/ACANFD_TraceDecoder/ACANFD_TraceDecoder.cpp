@@ -0,0 +1,217 @@
+//--------------------------------------------------------------------------------------------------
+// Host decoder of ACANFD_FeatherM4CAN_TraceLogger binary streams (see format description in
+// src/ACANFD_FeatherM4CAN_TraceLogger.h).
+//
+// Build (record format constants come from the library header, compiled with the host
+// <Arduino.h> of ACANFD_VirtualBus):
+//   c++ -std=c++11 -O2 -I ../../src -I ../ACANFD_VirtualBus/host -o ACANFD_TraceDecoder ACANFD_TraceDecoder.cpp
+//
+// Usage: ACANFD_TraceDecoder [-asc] [-start <seconds>] <trace file | ->
+//   Default output is candump log format: (seconds.microseconds) can0 123#1122 / 123##1AABB
+//   -asc: Vector ASC format
+//   -start: date of the first record, in seconds (default: 0)
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ACANFD_FeatherM4CAN_TraceLogger.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t LENGTH_FROM_DLC [16] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+enum class OutputFormat { candump, asc } ;
+
+//--------------------------------------------------------------------------------------------------
+// Returns false at end of file
+
+static bool readVarint (FILE * inFile, uint32_t & outValue) {
+  outValue = 0 ;
+  uint32_t shift = 0 ;
+  bool more = true ;
+  bool ok = true ;
+  while (more && ok) {
+    const int c = fgetc (inFile) ;
+    ok = (c != EOF) && (shift < 35) ;
+    if (ok) {
+      outValue |= uint32_t (c & 0x7F) << shift ;
+      shift += 7 ;
+      more = (c & 0x80) != 0 ;
+    }
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void printDate (const uint64_t inDate) {
+  printf ("%llu.%06llu", (unsigned long long) (inDate / 1000000), (unsigned long long) (inDate % 1000000)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void printCandumpFrame (const uint64_t inDate,
+                               const uint8_t inFlags,
+                               const uint32_t inIdentifier,
+                               const uint8_t * inData,
+                               const uint32_t inLength) {
+  printf ("(") ;
+  printDate (inDate) ;
+  printf (") can%u ", ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CAN1) != 0) ? 1 : 0) ;
+  printf (((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_EXTENDED) != 0) ? "%08X" : "%03X", inIdentifier) ;
+  if ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CANFD) != 0) {
+    printf ("##%X", ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) ? 1 : 0) ; // BRS flag
+  }else if ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) {
+    printf ("#R%u", inFlags & 0xF) ;
+  }else{
+    printf ("#") ;
+  }
+  for (uint32_t i=0 ; i<inLength ; i++) {
+    printf ("%02X", inData [i]) ;
+  }
+  printf ("\n") ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// ASC channels are numbered from 1
+
+static void printASCFrame (const uint64_t inDate,
+                           const uint8_t inFlags,
+                           const uint32_t inIdentifier,
+                           const uint8_t * inData,
+                           const uint32_t inLength) {
+  const unsigned channel = ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CAN1) != 0) ? 2 : 1 ;
+  char identifier [16] ;
+  snprintf (identifier, sizeof (identifier), ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_EXTENDED) != 0) ? "%Xx" : "%X", inIdentifier) ;
+  printf ("%11.6f ", double (inDate) / 1.0e6) ;
+  if ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CANFD) != 0) {
+    const unsigned brs = ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) ? 1 : 0 ;
+    printf ("CANFD %3u Rx %10s %32s %u 0 %x %2u", channel, identifier, "", brs, inFlags & 0xF, inLength) ;
+    for (uint32_t i=0 ; i<inLength ; i++) {
+      printf (" %02X", inData [i]) ;
+    }
+  //--- Message duration, message length, flags (EDL, BRS), CRC, bit timings: not available
+    printf ("        0    0 %8x        0    0    0    0    0\n", 0x1000 | (brs << 13)) ;
+  }else if ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) {
+    printf ("%u  %-15s Rx   r %u\n", channel, identifier, inFlags & 0xF) ;
+  }else{
+    printf ("%u  %-15s Rx   d %u", channel, identifier, inLength) ;
+    for (uint32_t i=0 ; i<inLength ; i++) {
+      printf (" %02X", inData [i]) ;
+    }
+    printf ("\n") ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static int decode (FILE * inFile, const OutputFormat inFormat, const uint64_t inStartDate) {
+  int result = 0 ;
+//--- Stream header
+  uint8_t header [5] ;
+  if ((fread (header, 1, 5, inFile) != 5) || (memcmp (header, "ACTR", 4) != 0)) {
+    fprintf (stderr, "error: not an ACANFD trace\n") ;
+    result = 1 ;
+  }else if (header [4] != ACANFD_FeatherM4CAN_TraceLogger::VERSION) {
+    fprintf (stderr, "error: unsupported trace version %u\n", header [4]) ;
+    result = 1 ;
+  }
+  if ((result == 0) && (inFormat == OutputFormat::asc)) {
+    printf ("base hex  timestamps absolute\n") ;
+    printf ("no internal events logged\n") ;
+    printf ("Begin Triggerblock\n") ;
+  }
+//--- Records
+  uint64_t date = inStartDate ;
+  uint32_t frameCount = 0 ;
+  uint32_t lostFrameCount = 0 ;
+  bool loop = result == 0 ;
+  while (loop) {
+    const int flags = fgetc (inFile) ;
+    uint32_t delta = 0 ;
+    uint32_t value = 0 ;
+    loop = (flags != EOF) && readVarint (inFile, delta) && readVarint (inFile, value) ;
+    if (loop) {
+      date += delta ;
+      if (flags == ACANFD_FeatherM4CAN_TraceLogger::LOST_FRAMES_RECORD) {
+        lostFrameCount += value ;
+        if (inFormat == OutputFormat::asc) {
+          printf ("%11.6f // %u lost frame(s)\n", double (date) / 1.0e6, value) ;
+        }else{
+          fprintf (stderr, "warning: %u frame(s) lost at ", value) ;
+          fprintf (stderr, "%llu us\n", (unsigned long long) (date - inStartDate)) ;
+        }
+      }else{
+        uint32_t length = 0 ;
+        if ((flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CANFD) != 0) {
+          length = LENGTH_FROM_DLC [flags & 0xF] ;
+        }else if ((flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) == 0) {
+          length = flags & 0xF ;
+        }
+        uint8_t data [64] ;
+        loop = fread (data, 1, length, inFile) == length ;
+        if (loop) {
+          frameCount += 1 ;
+          if (inFormat == OutputFormat::asc) {
+            printASCFrame (date, uint8_t (flags), value, data, length) ;
+          }else{
+            printCandumpFrame (date, uint8_t (flags), value, data, length) ;
+          }
+        }else{
+          fprintf (stderr, "warning: truncated record at end of trace\n") ;
+        }
+      }
+    }
+  }
+  if ((result == 0) && (inFormat == OutputFormat::asc)) {
+    printf ("End TriggerBlock\n") ;
+  }
+  if (result == 0) {
+    fprintf (stderr, "%u frame(s), %u lost\n", frameCount, lostFrameCount) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, const char * argv []) {
+  OutputFormat format = OutputFormat::candump ;
+  uint64_t startDate = 0 ;
+  const char * path = nullptr ;
+  bool ok = true ;
+  for (int i=1 ; (i<argc) && ok ; i++) {
+    if (strcmp (argv [i], "-asc") == 0) {
+      format = OutputFormat::asc ;
+    }else if ((strcmp (argv [i], "-start") == 0) && ((i + 1) < argc)) {
+      i += 1 ;
+      startDate = uint64_t (atof (argv [i]) * 1.0e6) ;
+    }else if (path == nullptr) {
+      path = argv [i] ;
+    }else{
+      ok = false ;
+    }
+  }
+  int result = 1 ;
+  if (!ok || (path == nullptr)) {
+    fprintf (stderr, "usage: %s [-asc] [-start <seconds>] <trace file | ->\n", argv [0]) ;
+  }else{
+    FILE * file = (strcmp (path, "-") == 0) ? stdin : fopen (path, "rb") ;
+    if (file == nullptr) {
+      fprintf (stderr, "error: cannot open %s\n", path) ;
+    }else{
+      result = decode (file, format, startDate) ;
+      if (file != stdin) {
+        fclose (file) ;
+      }
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,1239 @@
+//--------------------------------------------------------------------------------------------------
+// Register descriptions refer to DS60001507G data sheet, frame formats to ISO 11898-1:2015
+//--------------------------------------------------------------------------------------------------
+
+#include "ACANFD_VirtualBus.h"
+#include <ACANFD_FeatherM4CAN_Codec.h>
+#include <sys/mman.h>
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------------------
+//   HOST PERIPHERALS
+//--------------------------------------------------------------------------------------------------
+
+Gclk gACANFDHostGclk ;
+Mclk gACANFDHostMclk ;
+Port gACANFDHostPort ;
+Dmac gACANFDHostDmac ;
+Tc gACANFDHostTc [6] ;
+Pm gACANFDHostPm ;
+ACANFD_HostDWT gACANFDHostDWT ;
+ACANFD_HostCoreDebug gACANFDHostCoreDebug ;
+bool gACANFDHostCANInterruptPending = false ;
+
+//--------------------------------------------------------------------------------------------------
+//   SIMULATED DATE
+//--------------------------------------------------------------------------------------------------
+
+static ACANFD_VirtualBus::Date gDate = 0 ;
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t micros (void) {
+  return uint32_t (gDate / ACANFD_VirtualBus::TICKS_PER_MICROSECOND) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t millis (void) {
+  return uint32_t (gDate / (ACANFD_VirtualBus::TICKS_PER_MICROSECOND * 1000)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   REGISTERS OF THE NODE BEING CONSTRUCTED
+//--------------------------------------------------------------------------------------------------
+
+static Can * gConstructedNodeRegisters = nullptr ;
+
+//--------------------------------------------------------------------------------------------------
+
+Can * ACANFD_VirtualBus_registersOfConstructedNode (void) {
+  return gConstructedNodeRegisters ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_Module selectConstructedNode (Can & inRegisters) {
+  gConstructedNodeRegisters = & inRegisters ;
+  return ACANFD_FeatherM4CAN_Module::can0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   MESSAGE RAM
+//   Located at the SAME51 SRAM address: start addresses written in SIDFC, XIDFC, RXF0C, RXF1C,
+//   TXBC are the 16 lower bits of the address (page 1118)
+//--------------------------------------------------------------------------------------------------
+
+static const uintptr_t MESSAGE_RAM_ADDRESS = 0x20000000 ;
+static const uint32_t MESSAGE_RAM_WORD_SIZE = 0x10000 / 4 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t * messageRAM (void) {
+  static uint32_t * ram = nullptr ;
+  if (ram == nullptr) {
+    void * p = mmap ((void *) MESSAGE_RAM_ADDRESS, MESSAGE_RAM_WORD_SIZE * 4, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) ;
+    if (p != (void *) MESSAGE_RAM_ADDRESS) {
+      fprintf (stderr, "Cannot map message RAM at 0x%08lX\n", (unsigned long) MESSAGE_RAM_ADDRESS) ;
+      exit (1) ;
+    }
+    ram = (uint32_t *) p ;
+  }
+  return ram ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t * messageRAMPointer (const uint32_t inStartAddressRegister) {
+  return (uint32_t *) (MESSAGE_RAM_ADDRESS | (inStartAddressRegister & 0xFFFCU)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t * txBufferElement (const Can & inRegisters, const uint32_t inTxBufferIndex) {
+  const uint32_t tbds = inRegisters.TXESC.reg & 0x7 ; // Page 1166
+  const uint32_t wordCount = ACANFD_FeatherM4CAN_Settings::wordCountForPayload (ACANFD_FeatherM4CAN_Settings::Payload (tbds)) ;
+  return messageRAMPointer (inRegisters.TXBC.reg) + inTxBufferIndex * wordCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   NODE
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_VirtualBus::Node::Node (ACANFD_VirtualBus & inBus,
+                               const uint8_t inIndex,
+                               const char * inName,
+                               uint32_t * inMessageRAM,
+                               const uint32_t inMessageRAMWordSize) :
+mRegisters (),
+mCAN (selectConstructedNode (mRegisters), inMessageRAM, inMessageRAMWordSize),
+mBus (inBus),
+mName (inName),
+mMessageRAM (inMessageRAM),
+mPendingFrames (),
+mTxFIFOOrder (),
+mIndex (inIndex) {
+//--- Reset values (page 1123, 1152)
+  mRegisters.CCCR.reg.mValue = CAN_CCCR_INIT ;
+  mRegisters.XIDAM.reg.mValue = 0x1FFFFFFF ;
+//--- Registers handled by the controller model
+  ACANFD_VirtualRegister * registers [8] = {
+    & mRegisters.IR.reg, & mRegisters.TXBAR.reg, & mRegisters.TXBC.reg, & mRegisters.TXBCR.reg,
+    & mRegisters.RXF0C.reg, & mRegisters.RXF1C.reg, & mRegisters.RXF0A.reg, & mRegisters.RXF1A.reg
+  } ;
+  const ACANFD_VirtualRegister::WriteHandler handlers [8] = {
+    handleWriteIR, handleWriteTXBAR, handleWriteTXBC, handleWriteTXBCR,
+    handleWriteRXF0C, handleWriteRXF1C, handleWriteRXF0A, handleWriteRXF1A
+  } ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    registers [i]->mWriteHandler = handlers [i] ;
+    registers [i]->mContext = this ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_VirtualBus::Node::beginFD (const ACANFD_FeatherM4CAN_Settings & inSettings,
+                                           const ACANFD_FeatherM4CAN::StandardFilters & inStandardFilters,
+                                           const ACANFD_FeatherM4CAN::ExtendedFilters & inExtendedFilters) {
+  mTransmitFIFOOverflowPolicy = inSettings.mDriverTransmitFIFOOverflowPolicy ;
+  return mCAN.beginFD (inSettings, inStandardFilters, inExtendedFilters) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_VirtualBus::Node::send (const CANFDMessage & inMessage) {
+  PendingFrame frame ;
+  frame.mSendDate = gDate ;
+  frame.mIdentifier = inMessage.id ;
+  frame.mTxBufferIndex = 0 ;
+  frame.mExtended = inMessage.ext ;
+  frame.mInHardware = false ;
+  frame.mViaTxFIFO = inMessage.idx == 0 ;
+  mPendingFrames.push_back (frame) ;
+  const uint32_t overflowCount = mCAN.transmitFIFOOverflowCount () ;
+  const uint32_t sendStatus = mCAN.tryToSendReturnStatusFD (inMessage) ;
+  const bool overflow = mCAN.transmitFIFOOverflowCount () != overflowCount ;
+  mOverflowCounters [0] = mCAN.transmitFIFOOverflowCount () ;
+//--- Frame is rejected: it is the last pending frame, as it has not been written in hardware
+  if (sendStatus != 0) {
+    mPendingFrames.pop_back () ;
+    if (sendStatus == ACANFD_FeatherM4CAN::kTransmitBufferOverflow) {
+      mBus.recordOverflowEvent (*this, OverflowKind::DRIVER_TRANSMIT_FIFO, true, inMessage.id) ;
+    }
+  }else if (overflow) {
+  //--- An older frame of the driver transmit FIFO has been discarded
+    const bool sameIdentifier = mTransmitFIFOOverflowPolicy == ACANFD_FeatherM4CAN_Settings::OVERWRITE_SAME_IDENTIFIER ;
+    bool found = false ;
+    for (uint32_t i=0 ; (i+1) < mPendingFrames.size () && !found ; i++) {
+      const PendingFrame & f = mPendingFrames [i] ;
+      found = !f.mInHardware && f.mViaTxFIFO
+        && (!sameIdentifier || ((f.mIdentifier == inMessage.id) && (f.mExtended == inMessage.ext))) ;
+      if (found) {
+        mBus.recordOverflowEvent (*this, OverflowKind::DRIVER_TRANSMIT_FIFO, true, f.mIdentifier) ;
+        mPendingFrames.erase (mPendingFrames.begin () + i) ;
+      }
+    }
+    if (!found) {
+      mBus.recordOverflowEvent (*this, OverflowKind::DRIVER_TRANSMIT_FIFO, false, 0) ;
+    }
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   REGISTER WRITE HANDLERS
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteIR (void * /* inContext */,
+                                       ACANFD_VirtualRegister & ioRegister,
+                                       const uint32_t inValue) {
+  ioRegister.mValue &= ~ inValue ; // Write 1 to clear (page 1137)
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::updateTXFQS (Node & ioNode) {
+  Can & r = ioNode.mRegisters ;
+  const uint32_t txFIFOSize = (r.TXBC.reg >> 24) & 0x3F ; // Page 1164
+  const uint32_t pendingCount = uint32_t (ioNode.mTxFIFOOrder.size ()) ;
+  const uint32_t freeLevel = txFIFOSize - pendingCount ;
+  const uint32_t getIndex = (pendingCount > 0) ? ioNode.mTxFIFOOrder.front () : ioNode.mTxFIFOPutIndex ;
+  r.TXFQS.reg.mValue = // Page 1165
+    freeLevel
+  |
+    (getIndex << 8)
+  |
+    (uint32_t (ioNode.mTxFIFOPutIndex) << 16)
+  |
+    ((freeLevel == 0) ? (1U << 21) : 0)
+  ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteTXBC (void * inContext,
+                                         ACANFD_VirtualRegister & ioRegister,
+                                         const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  ioRegister.mValue = inValue ;
+  node.mRegisters.TXBRP.reg.mValue = 0 ;
+  node.mRegisters.TXBTO.reg.mValue = 0 ;
+  node.mTxFIFOOrder.clear () ;
+  node.mTxFIFOPutIndex = uint8_t ((inValue >> 16) & 0x3F) ; // First Tx FIFO buffer follows dedicated buffers
+  node.mBus.updateTXFQS (node) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteTXBAR (void * inContext,
+                                          ACANFD_VirtualRegister & /* ioRegister */,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  Can & r = node.mRegisters ;
+  const uint32_t dedicatedBufferCount = (r.TXBC.reg >> 16) & 0x3F ; // Page 1164
+  const uint32_t txFIFOSize = (r.TXBC.reg >> 24) & 0x3F ;
+  const uint32_t bufferCount = dedicatedBufferCount + txFIFOSize ;
+  for (uint32_t b=0 ; b<bufferCount ; b++) {
+    const uint32_t mask = 1U << b ;
+    if (((inValue & mask) != 0) && ((r.TXBRP.reg & mask) == 0)) {
+      r.TXBRP.reg.mValue |= mask ; // Page 1167
+      r.TXBTO.reg.mValue &= ~ mask ; // Page 1169
+      const bool viaTxFIFO = b >= dedicatedBufferCount ;
+      if (viaTxFIFO) {
+        node.mTxFIFOOrder.push_back (uint8_t (b)) ;
+        node.mTxFIFOPutIndex = uint8_t (((b + 1) < bufferCount) ? (b + 1) : dedicatedBufferCount) ;
+      }
+    //--- Pending frame: sent by Node::send, or requested now
+      const uint32_t w0 = txBufferElement (r, b) [0] ;
+      const bool extended = (w0 & (1U << 30)) != 0 ;
+      const uint32_t identifier = extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+      bool found = false ;
+      for (uint32_t i=0 ; (i < node.mPendingFrames.size ()) && !found ; i++) {
+        Node::PendingFrame & f = node.mPendingFrames [i] ;
+        found = !f.mInHardware && (f.mViaTxFIFO == viaTxFIFO)
+          && (f.mIdentifier == identifier) && (f.mExtended == extended) ;
+        if (found) {
+          f.mInHardware = true ;
+          f.mTxBufferIndex = uint8_t (b) ;
+        }
+      }
+      if (!found) {
+        Node::PendingFrame f ;
+        f.mSendDate = gDate ;
+        f.mIdentifier = identifier ;
+        f.mTxBufferIndex = uint8_t (b) ;
+        f.mExtended = extended ;
+        f.mInHardware = true ;
+        f.mViaTxFIFO = viaTxFIFO ;
+        node.mPendingFrames.push_back (f) ;
+      }
+    }
+  }
+  node.mBus.updateTXFQS (node) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cancellation of a pending request: TXBRP bit is reset, TXBCF bit is set. The request of a frame
+// being sent is not cancelled, it is completed by the transmission.
+
+void ACANFD_VirtualBus::handleWriteTXBCR (void * inContext,
+                                          ACANFD_VirtualRegister & /* ioRegister */,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  Can & r = node.mRegisters ;
+  const Transmission & t = node.mBus.mTransmissions [node.mBus.busOfNode (node)] ;
+  for (uint32_t b=0 ; b<32 ; b++) {
+    const uint32_t mask = 1U << b ;
+    const bool beingSent = t.mInProgress && (t.mTransmitter == & node) && (t.mTxBufferIndex == b) ;
+    if (((inValue & mask) != 0) && ((r.TXBRP.reg & mask) != 0) && !beingSent) {
+      r.TXBRP.reg.mValue &= ~ mask ;
+      r.TXBCF.reg.mValue |= mask ;
+      for (uint32_t i=0 ; i<node.mTxFIFOOrder.size () ; i++) {
+        if (node.mTxFIFOOrder [i] == b) {
+          node.mTxFIFOOrder.erase (node.mTxFIFOOrder.begin () + i) ;
+          break ;
+        }
+      }
+    //--- The frame can be requested again
+      for (uint32_t i=0 ; i<node.mPendingFrames.size () ; i++) {
+        Node::PendingFrame & f = node.mPendingFrames [i] ;
+        if (f.mInHardware && (f.mTxBufferIndex == b)) {
+          f.mInHardware = false ;
+          break ;
+        }
+      }
+    }
+  }
+  node.mBus.updateTXFQS (node) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writing RXFnC resets Rx FIFO n status
+
+void ACANFD_VirtualBus::handleWriteRXF0C (void * inContext,
+                                          ACANFD_VirtualRegister & ioRegister,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  ioRegister.mValue = inValue ;
+  node.mRegisters.RXF0S.reg.mValue = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteRXF1C (void * inContext,
+                                          ACANFD_VirtualRegister & ioRegister,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  ioRegister.mValue = inValue ;
+  node.mRegisters.RXF1S.reg.mValue = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Acknowledge releases all elements up to the acknowledged one (pages 1155-1158)
+
+static void acknowledgeRxFIFO (const uint32_t inRXFC,
+                               ACANFD_VirtualRegister & ioRXFS,
+                               const uint32_t inAcknowledgeIndex) {
+  const uint32_t size = (inRXFC >> 16) & 0x7F ;
+  const uint32_t rxfs = ioRXFS.mValue ;
+  uint32_t fillLevel = rxfs & 0x7F ;
+  const uint32_t getIndex = (rxfs >> 8) & 0x3F ;
+  if ((fillLevel > 0) && (inAcknowledgeIndex < size)) {
+    uint32_t n = ((inAcknowledgeIndex + size - getIndex) % size) + 1 ;
+    if (n > fillLevel) {
+      n = fillLevel ;
+    }
+    fillLevel -= n ;
+    const uint32_t newGetIndex = (getIndex + n) % size ;
+    ioRXFS.mValue = (rxfs & (0x3FU << 16)) | (newGetIndex << 8) | fillLevel ; // F0F, RF0L cleared
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteRXF0A (void * inContext,
+                                          ACANFD_VirtualRegister & ioRegister,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  ioRegister.mValue = inValue ;
+  acknowledgeRxFIFO (node.mRegisters.RXF0C.reg, node.mRegisters.RXF0S.reg, inValue & 0x3F) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::handleWriteRXF1A (void * inContext,
+                                          ACANFD_VirtualRegister & ioRegister,
+                                          const uint32_t inValue) {
+  Node & node = * (Node *) inContext ;
+  ioRegister.mValue = inValue ;
+  acknowledgeRxFIFO (node.mRegisters.RXF1C.reg, node.mRegisters.RXF1S.reg, inValue & 0x3F) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   FRAME BITS
+//   Counts actual bits: dynamic stuff bits are inserted after 5 consecutive bits of same value,
+//   from SOF to CRC (CAN 2.0B frame), from SOF to end of data field (CANFD frame). A stuff bit
+//   following BRS is sent at data bit rate.
+//--------------------------------------------------------------------------------------------------
+
+class FrameBitCounter {
+  public: uint32_t mNominalBitCount = 0 ;
+  public: uint32_t mDataBitCount = 0 ;
+  public: uint16_t mCRC15 = 0 ;
+  private: uint32_t mRunLength = 0 ;
+  private: uint32_t mLastBit = 2 ;
+
+  public: void appendStuffedBit (const uint32_t inBit, const bool inFast, const bool inStuffBitIsFast) {
+    countBit (inFast) ;
+    if (inBit == mLastBit) {
+      mRunLength += 1 ;
+    }else{
+      mRunLength = 1 ;
+      mLastBit = inBit ;
+    }
+    if (mRunLength == 5) {
+      countBit (inStuffBitIsFast) ;
+      mLastBit = 1 - inBit ;
+      mRunLength = 1 ;
+    }
+  }
+
+  public: void appendField (const uint32_t inValue, const uint32_t inBitCount, const bool inFast, const bool inCRC) {
+    for (uint32_t i=inBitCount ; i>0 ; i--) {
+      const uint32_t bit = (inValue >> (i - 1)) & 1 ;
+      if (inCRC) { // CRC-15, polynomial 0x4599
+        const uint32_t crcNext = bit ^ ((mCRC15 >> 14) & 1) ;
+        mCRC15 = uint16_t ((mCRC15 << 1) & 0x7FFF) ;
+        if (crcNext != 0) {
+          mCRC15 ^= 0x4599 ;
+        }
+      }
+      appendStuffedBit (bit, inFast, inFast) ;
+    }
+  }
+
+  private: void countBit (const bool inFast) {
+    if (inFast) {
+      mDataBitCount += 1 ;
+    }else{
+      mNominalBitCount += 1 ;
+    }
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// inHeader: Rx FIFO element words 0 and 1 of the frame (page 1177)
+
+static const uint32_t TRAILER_BIT_COUNT = 1 /* CRC delimiter */ + 1 /* ACK */ + 1 /* ACK delimiter */
+                                        + 7 /* EOF */ + 3 /* IFS */ ;
+
+static void frameBitCounts (const uint32_t * inHeader,
+                            const uint32_t * inData,
+                            uint32_t & outNominalBitCount,
+                            uint32_t & outDataBitCount) {
+  const uint32_t w0 = inHeader [0] ;
+  const uint32_t w1 = inHeader [1] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  const uint32_t rtr = (w0 >> 29) & 1 ;
+  const uint32_t dlc = (w1 >> 16) & 0xF ;
+  const bool brs = (w1 & (1U << 20)) != 0 ;
+  const bool fdf = (w1 & (1U << 21)) != 0 ;
+  const uint32_t esi = w0 >> 31 ;
+  const uint32_t baseIdentifier = extended ? ((w0 >> 18) & 0x7FF) : ((w0 >> 18) & 0x7FF) ;
+  uint32_t length = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [dlc] ;
+  if (!fdf && (length > 8)) {
+    length = 8 ;
+  }
+  if (rtr != 0) {
+    length = 0 ;
+  }
+  FrameBitCounter counter ;
+  const bool crc = !fdf ;
+//--- Arbitration and control fields
+  counter.appendField (0, 1, false, crc) ; // SOF
+  counter.appendField (baseIdentifier, 11, false, crc) ;
+  if (extended) {
+    counter.appendField (1, 1, false, crc) ; // SRR
+    counter.appendField (1, 1, false, crc) ; // IDE
+    counter.appendField (w0 & 0x3FFFF, 18, false, crc) ;
+    counter.appendField (fdf ? 0 : rtr, 1, false, crc) ; // RTR, RRS
+  }else{
+    counter.appendField (fdf ? 0 : rtr, 1, false, crc) ; // RTR, RRS
+    counter.appendField (0, 1, false, crc) ; // IDE
+  }
+  if (fdf) {
+    counter.appendField (1, 1, false, false) ; // FDF
+    counter.appendField (0, 1, false, false) ; // res
+    counter.appendStuffedBit (brs ? 1 : 0, false, brs) ; // BRS
+    counter.appendField (esi, 1, brs, false) ; // ESI
+  }else{
+    counter.appendField (0, extended ? 2 : 1, false, crc) ; // r1 r0, r0
+  }
+  counter.appendField (dlc, 4, brs, crc) ;
+//--- Data field
+  for (uint32_t i=0 ; i<length ; i++) {
+    const uint32_t byte = (inData [i / 4] >> (8 * (i % 4))) & 0xFF ;
+    counter.appendField (byte, 8, brs, crc) ;
+  }
+//--- CRC field
+  if (fdf) { // Stuff count, CRC with fixed stuff bits
+    const uint32_t fixedBitCount = (length <= 16) ? (4 + 17 + 6) : (4 + 21 + 7) ;
+    if (brs) {
+      counter.mDataBitCount += fixedBitCount ;
+    }else{
+      counter.mNominalBitCount += fixedBitCount ;
+    }
+  }else{
+    counter.appendField (counter.mCRC15, 15, false, false) ;
+  }
+  outNominalBitCount = counter.mNominalBitCount + TRAILER_BIT_COUNT ;
+  outDataBitCount = counter.mDataBitCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit durations, in CAN root clock periods, from NBTP (page 1125) and DBTP (page 1119)
+
+static uint32_t nominalBitDuration (const Can & inRegisters) {
+  const uint32_t nbtp = inRegisters.NBTP.reg ;
+  const uint32_t brp = ((nbtp >> 16) & 0x1FF) + 1 ;
+  const uint32_t tseg1 = ((nbtp >> 8) & 0xFF) + 1 ;
+  const uint32_t tseg2 = (nbtp & 0x7F) + 1 ;
+  return brp * (1 + tseg1 + tseg2) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t dataBitDuration (const Can & inRegisters) {
+  const uint32_t dbtp = inRegisters.DBTP.reg ;
+  const uint32_t brp = ((dbtp >> 16) & 0x1F) + 1 ;
+  const uint32_t tseg1 = ((dbtp >> 8) & 0x1F) + 1 ;
+  const uint32_t tseg2 = ((dbtp >> 4) & 0xF) + 1 ;
+  return brp * (1 + tseg1 + tseg2) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame header as transmitted, from Tx buffer element (FDF and BRS are ignored if CANFD operation,
+// bit rate switching are disabled, page 1123); RTR is not used by CANFD frames
+
+static void transmittedHeader (const Can & inRegisters, const uint32_t * inTxElement, uint32_t outHeader [2]) {
+  const uint32_t cccr = inRegisters.CCCR.reg ;
+  uint32_t w0 = inTxElement [0] ;
+  uint32_t w1 = inTxElement [1] & 0x003F0000U ; // DLC, BRS, FDF
+  if ((cccr & CAN_CCCR_FDOE) == 0) {
+    w1 &= ~ ((1U << 21) | (1U << 20)) ;
+  }else if ((cccr & CAN_CCCR_BRSE) == 0) {
+    w1 &= ~ (1U << 20) ;
+  }
+  if ((w1 & (1U << 21)) != 0) {
+    w0 &= ~ (1U << 29) ;
+  }else{
+    w1 &= ~ (1U << 20) ;
+  }
+  outHeader [0] = w0 ;
+  outHeader [1] = w1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Lower value wins: identifier, RTR / SRR, IDE, extended identifier, RTR
+
+static uint64_t arbitrationKey (const uint32_t * inHeader) {
+  const uint32_t w0 = inHeader [0] ;
+  const uint64_t baseIdentifier = (w0 >> 18) & 0x7FF ;
+  const uint64_t rtr = (w0 >> 29) & 1 ;
+  uint64_t key ;
+  if ((w0 & (1U << 30)) != 0) {
+    key = (baseIdentifier << 21) | (1U << 20) | (1U << 19) | (uint64_t (w0 & 0x3FFFF) << 1) | rtr ;
+  }else{
+    key = (baseIdentifier << 21) | (rtr << 20) ;
+  }
+  return key ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   BUS
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t gAllocatedMessageRAMWordCount = 0 ;
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_VirtualBus::ACANFD_VirtualBus (void) :
+mNodes (),
+mPeriodicFrames (),
+mTransmissions (1),
+mBusBusyDurations (1, 0),
+mOverflowEvents (),
+mStatistics (),
+mFrameLog (nullptr),
+mDate (0),
+mIdenticalArbitrationCount (0) {
+  gDate = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_VirtualBus::~ ACANFD_VirtualBus (void) {
+  for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+    delete mNodes [i] ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_VirtualBus::Node * ACANFD_VirtualBus::addNode (const char * inName, const uint32_t inMessageRAMWordSize) {
+  Node * node = nullptr ;
+  if (((gAllocatedMessageRAMWordCount + inMessageRAMWordSize) <= MESSAGE_RAM_WORD_SIZE) && (mNodes.size () < 255)) {
+    uint32_t * ram = messageRAM () + gAllocatedMessageRAMWordCount ;
+    gAllocatedMessageRAMWordCount += inMessageRAMWordSize ;
+    node = new Node (*this, uint8_t (mNodes.size ()), inName, ram, inMessageRAMWordSize) ;
+    mNodes.push_back (node) ;
+    mTransmissions.push_back (Transmission ()) ;
+    mBusBusyDurations.push_back (0) ;
+  }
+  return node ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::setLoop (Node & inNode, LoopRoutine inRoutine, const uint32_t inPeriodMicros) {
+  inNode.mLoopRoutine = inRoutine ;
+  inNode.mLoopPeriod = Date ((inPeriodMicros > 0) ? inPeriodMicros : 1) * TICKS_PER_MICROSECOND ;
+  inNode.mNextLoopDate = mDate ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::addPeriodicFrame (Node & inNode,
+                                          const CANFDMessage & inMessage,
+                                          const uint32_t inPeriodMicros,
+                                          const uint32_t inOffsetMicros) {
+  PeriodicFrame f ;
+  f.mMessage = inMessage ;
+  f.mPeriod = Date ((inPeriodMicros > 0) ? inPeriodMicros : 1) * TICKS_PER_MICROSECOND ;
+  f.mNextDate = mDate + Date (inOffsetMicros) * TICKS_PER_MICROSECOND ;
+  f.mNode = & inNode ;
+  mPeriodicFrames.push_back (f) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bus 0 is the shared bus; a node in internal loop back mode (TEST.LBCK and CCCR.MON, page 1121)
+// has its own bus
+
+uint32_t ACANFD_VirtualBus::busOfNode (const Node & inNode) const {
+  const bool internalLoopBack = ((inNode.mRegisters.TEST.reg & CAN_TEST_LBCK) != 0)
+                             && ((inNode.mRegisters.CCCR.reg & CAN_CCCR_MON) != 0) ;
+  return internalLoopBack ? (inNode.mIndex + 1U) : 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   OVERFLOW EVENTS
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::recordOverflowEvent (const Node & inNode,
+                                             const OverflowKind inKind,
+                                             const bool inIdentifierIsKnown,
+                                             const uint32_t inIdentifier) {
+  OverflowEvent event ;
+  event.mDate = mDate ;
+  event.mIdentifier = inIdentifier ;
+  event.mNodeIndex = inNode.mIndex ;
+  event.mKind = inKind ;
+  event.mIdentifierIsKnown = inIdentifierIsKnown ;
+  mOverflowEvents.push_back (event) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Driver FIFO overflows that did not occur in Node::send
+
+void ACANFD_VirtualBus::checkDriverOverflowCounters (Node & ioNode) {
+  const uint32_t counters [3] = {
+    ioNode.mCAN.transmitFIFOOverflowCount (),
+    ioNode.mCAN.driverReceiveFIFO0OverflowCount (),
+    ioNode.mCAN.driverReceiveFIFO1OverflowCount ()
+  } ;
+  const OverflowKind kinds [3] = {
+    OverflowKind::DRIVER_TRANSMIT_FIFO,
+    OverflowKind::DRIVER_RECEIVE_FIFO0,
+    OverflowKind::DRIVER_RECEIVE_FIFO1
+  } ;
+  for (uint32_t i=0 ; i<3 ; i++) {
+    while (ioNode.mOverflowCounters [i] != counters [i]) {
+      ioNode.mOverflowCounters [i] += 1 ;
+      recordOverflowEvent (ioNode, kinds [i], false, 0) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   INTERRUPTS
+//   An interrupt line is active if an enabled flag routed to it is set (IE page 1141, ILS page
+//   1144, ILE page 1146)
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::serviceInterrupts (void) {
+  bool again = true ;
+  for (uint32_t pass = 0 ; (pass < 16) && again ; pass++) {
+    again = false ;
+  //--- Software triggered CAN interrupt (NVIC_SetPendingIRQ): all nodes are serviced
+    const bool triggered = gACANFDHostCANInterruptPending ;
+    gACANFDHostCANInterruptPending = false ;
+    for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+      Node & node = * mNodes [i] ;
+      const Can & r = node.mRegisters ;
+      const uint32_t pending = r.IR.reg & r.IE.reg ;
+      const bool line0 = ((pending & ~ r.ILS.reg) != 0) && ((r.ILE.reg & CAN_ILE_EINT0) != 0) ;
+      const bool line1 = ((pending & r.ILS.reg) != 0) && ((r.ILE.reg & CAN_ILE_EINT1) != 0) ;
+      if (triggered || line0 || line1) {
+        node.mCAN.interruptServiceRoutine () ;
+        checkDriverOverflowCounters (node) ;
+        again = true ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRANSMISSION
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_VirtualBus::startTransmission (const uint32_t inBus) {
+  Node * winner = nullptr ;
+  uint32_t winnerBuffer = 0 ;
+  uint64_t winnerKey = 0 ;
+  uint32_t winnerHeader [2] = {0, 0} ;
+  for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+    Node & node = * mNodes [i] ;
+    const Can & r = node.mRegisters ;
+    const uint32_t cccr = r.CCCR.reg ;
+    const bool canTransmit = ((cccr & CAN_CCCR_INIT) == 0)
+      && (((cccr & CAN_CCCR_MON) == 0) || ((r.TEST.reg & CAN_TEST_LBCK) != 0)) ;
+    if (canTransmit && (busOfNode (node) == inBus)) {
+    //--- Candidates: requested dedicated Tx buffers, Tx FIFO get element
+      const uint32_t dedicatedBufferCount = (r.TXBC.reg >> 16) & 0x3F ;
+      uint32_t candidates = r.TXBRP.reg & ((1U << dedicatedBufferCount) - 1) ;
+      if (!node.mTxFIFOOrder.empty ()) {
+        candidates |= 1U << node.mTxFIFOOrder.front () ;
+      }
+      for (uint32_t b=0 ; b<32 ; b++) {
+        if ((candidates & (1U << b)) != 0) {
+          uint32_t header [2] ;
+          transmittedHeader (r, txBufferElement (r, b), header) ;
+          const uint64_t key = arbitrationKey (header) ;
+          if ((winner == nullptr) || (key < winnerKey)) {
+            winner = & node ;
+            winnerBuffer = b ;
+            winnerKey = key ;
+            winnerHeader [0] = header [0] ;
+            winnerHeader [1] = header [1] ;
+          }else if ((key == winnerKey) && (winner != & node)) {
+            mIdenticalArbitrationCount += 1 ;
+          }
+        }
+      }
+    }
+  }
+  if (winner != nullptr) {
+    Transmission & t = mTransmissions [inBus] ;
+    const uint32_t * element = txBufferElement (winner->mRegisters, winnerBuffer) ;
+    const uint32_t tbds = winner->mRegisters.TXESC.reg & 0x7 ;
+    const uint32_t dataWordCount = ACANFD_FeatherM4CAN_Settings::wordCountForPayload (ACANFD_FeatherM4CAN_Settings::Payload (tbds)) - 2 ;
+    for (uint32_t i=0 ; i<16 ; i++) {
+      t.mData [i] = (i < dataWordCount) ? element [2 + i] : 0 ;
+    }
+    t.mHeader [0] = winnerHeader [0] ;
+    t.mHeader [1] = winnerHeader [1] ;
+    t.mTransmitter = winner ;
+    t.mTxBufferIndex = uint8_t (winnerBuffer) ;
+    t.mInProgress = true ;
+    t.mStartDate = mDate ;
+    uint32_t nominalBitCount ;
+    uint32_t dataBitCount ;
+    frameBitCounts (t.mHeader, t.mData, nominalBitCount, dataBitCount) ;
+    const Date nominalBit = nominalBitDuration (winner->mRegisters) ;
+    const Date duration = nominalBitCount * nominalBit + dataBitCount * Date (dataBitDuration (winner->mRegisters)) ;
+    t.mIdleDate = mDate + duration ;
+    t.mCompletionDate = t.mIdleDate - 3 * nominalBit ; // Intermission
+    mBusBusyDurations [inBus] += duration ;
+  //--- Send date of the frame
+    t.mSendDate = mDate ;
+    for (uint32_t i=0 ; i<winner->mPendingFrames.size () ; i++) {
+      const Node::PendingFrame & f = winner->mPendingFrames [i] ;
+      if (f.mInHardware && (f.mTxBufferIndex == winnerBuffer)) {
+        t.mSendDate = f.mSendDate ;
+        break ;
+      }
+    }
+  }
+  return winner != nullptr ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::completeTransmission (Transmission & ioTransmission) {
+  ioTransmission.mInProgress = false ;
+  Node & transmitter = * ioTransmission.mTransmitter ;
+  Can & r = transmitter.mRegisters ;
+  const uint32_t b = ioTransmission.mTxBufferIndex ;
+//--- Transmitter: TXBRP, TXBTO (pages 1167, 1169), Tx FIFO, IR.TC if enabled by TXBTIE
+  r.TXBRP.reg.mValue &= ~ (1U << b) ;
+  r.TXBTO.reg.mValue |= 1U << b ;
+  if (!transmitter.mTxFIFOOrder.empty () && (transmitter.mTxFIFOOrder.front () == b)) {
+    transmitter.mTxFIFOOrder.pop_front () ;
+  }
+  updateTXFQS (transmitter) ;
+  if ((r.TXBTIE.reg & (1U << b)) != 0) {
+    r.IR.reg.mValue |= CAN_IR_TC ;
+  }
+  transmitter.mTransmittedFrameCount += 1 ;
+  for (uint32_t i=0 ; i<transmitter.mPendingFrames.size () ; i++) {
+    const Node::PendingFrame & f = transmitter.mPendingFrames [i] ;
+    if (f.mInHardware && (f.mTxBufferIndex == b)) {
+      transmitter.mPendingFrames.erase (transmitter.mPendingFrames.begin () + i) ;
+      break ;
+    }
+  }
+//--- Statistics
+  const uint32_t w0 = ioTransmission.mHeader [0] ;
+  const uint32_t w1 = ioTransmission.mHeader [1] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  const uint32_t identifier = extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+  const Date queueingDelay = ioTransmission.mStartDate - ioTransmission.mSendDate ;
+  const Date responseTime = ioTransmission.mCompletionDate - ioTransmission.mSendDate ;
+  const Date duration = ioTransmission.mIdleDate - ioTransmission.mStartDate ;
+  const uint64_t key = (uint64_t (transmitter.mIndex) << 32) | (uint64_t (extended) << 31) | identifier ;
+  FrameStatistics & s = mStatistics [key] ;
+  s.mCount += 1 ;
+  s.mQueueingDelaySum += queueingDelay ;
+  if (s.mMinQueueingDelay > queueingDelay) {
+    s.mMinQueueingDelay = queueingDelay ;
+  }
+  if (s.mMaxQueueingDelay < queueingDelay) {
+    s.mMaxQueueingDelay = queueingDelay ;
+  }
+  if (s.mWorstCaseResponseTime < responseTime) {
+    s.mWorstCaseResponseTime = responseTime ;
+  }
+  s.mDuration = duration ;
+  if (mFrameLog != nullptr) {
+    const double us = double (TICKS_PER_MICROSECOND) ;
+    fprintf (mFrameLog, "%.3f,%s,%X,%u,%u,%u,%u,%.3f,%.3f,%.3f\n",
+             double (ioTransmission.mStartDate) / us,
+             transmitter.mName,
+             identifier,
+             extended,
+             (w1 >> 21) & 1,
+             (w1 >> 20) & 1,
+             ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [(w1 >> 16) & 0xF],
+             double (duration) / us,
+             double (queueingDelay) / us,
+             double (responseTime) / us) ;
+  }
+//--- Receivers: every active node of the bus; the transmitter only in loop back mode
+  const uint32_t bus = busOfNode (transmitter) ;
+  for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+    Node & node = * mNodes [i] ;
+    const bool active = ((node.mRegisters.CCCR.reg & CAN_CCCR_INIT) == 0) && (busOfNode (node) == bus) ;
+    const bool receives = (& node != & transmitter) || ((node.mRegisters.TEST.reg & CAN_TEST_LBCK) != 0) ;
+    if (active && receives) {
+      const bool brs = (ioTransmission.mHeader [1] & (1U << 20)) != 0 ;
+      if (nominalBitDuration (node.mRegisters) != nominalBitDuration (r)) {
+        protocolError (node, false) ;
+      }else if (brs && (dataBitDuration (node.mRegisters) != dataBitDuration (r))) {
+        protocolError (node, true) ;
+      }else{
+        receiveFrame (node, ioTransmission.mHeader, ioTransmission.mData) ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Data phase sampling by the transmitter of a frame with BRS, delayed by its transceiver loop.
+// With transceiver delay compensation (page 1134), the secondary sample point is the measured
+// delay plus TDCO; it is stored in TDCV field of PSR (page 1131). It should fall inside the
+// received bit (TDCO from 1 to data bit duration - 1 clock), not before TDCF, and not after
+// 127 clocks. Without compensation, the delay should be lower than the sample point.
+
+bool ACANFD_VirtualBus::dataPhaseIsSampled (const Transmission & inTransmission) {
+  Node & transmitter = * inTransmission.mTransmitter ;
+  Can & r = transmitter.mRegisters ;
+  const uint32_t delay = transmitter.mTransceiverLoopDelay ;
+  bool ok = true ;
+  if ((delay > 0) && ((inTransmission.mHeader [1] & (1U << 20)) != 0)) {
+    const uint32_t dbtp = r.DBTP.reg ;
+    if ((dbtp & CAN_DBTP_TDC) != 0) {
+      const uint32_t tdco = (r.TDCR.reg >> 8) & 0x7F ;
+      const uint32_t tdcf = r.TDCR.reg & 0x7F ;
+      const uint32_t ssp = delay + tdco ;
+      ok = (tdco >= 1) && (tdco < dataBitDuration (r)) && (ssp >= tdcf) && (ssp <= 127) ;
+      if (ok) {
+        r.PSR.reg.mValue = (r.PSR.reg.mValue & ~ (0x7FU << 16)) | (ssp << 16) ;
+      }
+    }else{
+      const uint32_t brp = ((dbtp >> 16) & 0x1F) + 1 ;
+      const uint32_t tseg1 = ((dbtp >> 8) & 0x1F) + 1 ;
+      ok = delay < (brp * (1 + tseg1)) ;
+    }
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit error in data phase (page 1131); with DAR (page 1123), the Tx buffer request is cancelled
+// (TXBCF is set), otherwise the frame is retransmitted
+
+void ACANFD_VirtualBus::abortTransmission (Transmission & ioTransmission) {
+  ioTransmission.mInProgress = false ;
+  Node & transmitter = * ioTransmission.mTransmitter ;
+  Can & r = transmitter.mRegisters ;
+  const uint32_t b = ioTransmission.mTxBufferIndex ;
+  transmitter.mDestroyedFrameCount += 1 ;
+  r.PSR.reg.mValue = (r.PSR.reg.mValue & ~ (7U << 8)) | (4U << 8) ;
+  r.IR.reg.mValue |= CAN_IR_PED ;
+  if ((r.CCCR.reg & CAN_CCCR_DAR) != 0) {
+    r.TXBRP.reg.mValue &= ~ (1U << b) ;
+    r.TXBCF.reg.mValue |= 1U << b ;
+    if (!transmitter.mTxFIFOOrder.empty () && (transmitter.mTxFIFOOrder.front () == b)) {
+      transmitter.mTxFIFOOrder.pop_front () ;
+    }
+    updateTXFQS (transmitter) ;
+    for (uint32_t i=0 ; i<transmitter.mPendingFrames.size () ; i++) {
+      const Node::PendingFrame & f = transmitter.mPendingFrames [i] ;
+      if (f.mInHardware && (f.mTxBufferIndex == b)) {
+        transmitter.mPendingFrames.erase (transmitter.mPendingFrames.begin () + i) ;
+        break ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RECEPTION
+//--------------------------------------------------------------------------------------------------
+
+// Bit timing mismatch: reported as a stuff error in arbitration phase, as a CRC error in data
+// phase (LEC / DLEC of PSR, page 1131)
+
+void ACANFD_VirtualBus::protocolError (Node & ioReceiver, const bool inDataPhase) {
+  Can & r = ioReceiver.mRegisters ;
+  ioReceiver.mProtocolErrorCount += 1 ;
+  if (inDataPhase) {
+    r.PSR.reg.mValue = (r.PSR.reg.mValue & ~ (7U << 8)) | (6U << 8) ;
+    r.IR.reg.mValue |= CAN_IR_PED ;
+  }else{
+    r.PSR.reg.mValue = (r.PSR.reg.mValue & ~ 7U) | 1U ;
+    r.IR.reg.mValue |= CAN_IR_PEA ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+// Standard filter element (page 1182): returns 0 (no match), 1 (match, store into Rx FIFO 0),
+// 2 (match, store into Rx FIFO 1), 3 (match, reject)
+
+static uint32_t matchStandardFilter (const uint32_t inFilter, const uint32_t inIdentifier) {
+  const uint32_t sft = inFilter >> 30 ;
+  const uint32_t sfec = (inFilter >> 27) & 7 ;
+  const uint32_t id1 = (inFilter >> 16) & 0x7FF ;
+  const uint32_t id2 = inFilter & 0x7FF ;
+  bool match = false ;
+  switch (sft) {
+  case 0 : match = (id1 <= inIdentifier) && (inIdentifier <= id2) ; break ;
+  case 1 : match = (inIdentifier == id1) || (inIdentifier == id2) ; break ;
+  case 2 : match = (inIdentifier & id2) == (id1 & id2) ; break ;
+  default : break ;
+  }
+  uint32_t result = 0 ;
+  if (match) {
+    switch (sfec) {
+    case 1 : case 5 : result = 1 ; break ;
+    case 2 : case 6 : result = 2 ; break ;
+    case 3 : result = 3 ; break ;
+    default : break ; // Disabled, priority only, Rx buffer: not modeled
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Extended filter element (page 1184), same result as matchStandardFilter
+
+static uint32_t matchExtendedFilter (const uint32_t * inFilter, const uint32_t inIdentifier, const uint32_t inXIDAM) {
+  const uint32_t efec = inFilter [0] >> 29 ;
+  const uint32_t id1 = inFilter [0] & 0x1FFFFFFF ;
+  const uint32_t eft = inFilter [1] >> 30 ;
+  const uint32_t id2 = inFilter [1] & 0x1FFFFFFF ;
+  const uint32_t maskedIdentifier = inIdentifier & inXIDAM ;
+  bool match = false ;
+  switch (eft) {
+  case 0 : match = (id1 <= maskedIdentifier) && (maskedIdentifier <= id2) ; break ;
+  case 1 : match = (maskedIdentifier == id1) || (maskedIdentifier == id2) ; break ;
+  case 2 : match = (maskedIdentifier & id2) == (id1 & id2) ; break ;
+  case 3 : match = (id1 <= inIdentifier) && (inIdentifier <= id2) ; break ;
+  }
+  uint32_t result = 0 ;
+  if (match) {
+    switch (efec) {
+    case 1 : case 5 : result = 1 ; break ;
+    case 2 : case 6 : result = 2 ; break ;
+    case 3 : result = 3 ; break ;
+    default : break ;
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::receiveFrame (Node & ioReceiver, const uint32_t * inHeader, const uint32_t * inData) {
+  Can & r = ioReceiver.mRegisters ;
+  const uint32_t w0 = inHeader [0] ;
+  const uint32_t w1 = inHeader [1] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  const bool remote = (w0 & (1U << 29)) != 0 ;
+  const bool fdf = (w1 & (1U << 21)) != 0 ;
+  const uint32_t identifier = extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+  bool accepted = !fdf || ((r.CCCR.reg & CAN_CCCR_FDOE) != 0) ;
+  if (!accepted) {
+    ioReceiver.mDiscardedFDFrameCount += 1 ;
+  }
+//--- Global filter (page 1148): remote frames
+  const uint32_t gfc = r.GFC.reg ;
+  if (accepted && remote) {
+    accepted = (gfc & (extended ? (1U << 0) : (1U << 1))) == 0 ;
+  }
+//--- Filters
+  uint32_t fifo = 0 ;
+  uint32_t filterIndex = 0 ;
+  bool nonMatching = true ;
+  if (accepted) {
+    uint32_t result = 0 ;
+    if (extended) {
+      const uint32_t xidfc = r.XIDFC.reg ;
+      const uint32_t * filters = messageRAMPointer (xidfc) ;
+      const uint32_t count = (xidfc >> 16) & 0x7F ;
+      for (uint32_t i=0 ; (i<count) && (result == 0) ; i++) {
+        result = matchExtendedFilter (filters + 2 * i, identifier, r.XIDAM.reg) ;
+        filterIndex = i ;
+      }
+    }else{
+      const uint32_t sidfc = r.SIDFC.reg ;
+      const uint32_t * filters = messageRAMPointer (sidfc) ;
+      const uint32_t count = (sidfc >> 16) & 0xFF ;
+      for (uint32_t i=0 ; (i<count) && (result == 0) ; i++) {
+        result = matchStandardFilter (filters [i], identifier) ;
+        filterIndex = i ;
+      }
+    }
+    if (result == 0) { // Non matching frame: ANFS, ANFE
+      const uint32_t anf = (gfc >> (extended ? 2 : 4)) & 3 ;
+      accepted = anf < 2 ;
+      fifo = anf ;
+      filterIndex = 0 ;
+    }else{
+      nonMatching = false ;
+      accepted = result < 3 ;
+      fifo = result - 1 ;
+    }
+  }
+//--- Store into Rx FIFO (pages 1155-1158, element page 1177)
+  if (accepted) {
+    const uint32_t rxfc = (fifo == 0) ? r.RXF0C.reg : r.RXF1C.reg ;
+    ACANFD_VirtualRegister & rxfs = (fifo == 0) ? r.RXF0S.reg : r.RXF1S.reg ;
+    const uint32_t size = (rxfc >> 16) & 0x7F ;
+    const bool overwrite = (rxfc & (1U << 31)) != 0 ;
+    const uint32_t s = rxfs.mValue ;
+    uint32_t fillLevel = s & 0x7F ;
+    uint32_t getIndex = (s >> 8) & 0x3F ;
+    uint32_t putIndex = (s >> 16) & 0x3F ;
+    const bool full = (size > 0) && (fillLevel == size) ;
+    if (size == 0) {
+      accepted = false ;
+    }else if (full && !overwrite) { // Blocking mode: frame is lost
+      rxfs.mValue = s | (1U << 25) ; // RFnL
+      r.IR.reg.mValue |= (fifo == 0) ? CAN_IR_RF0L : CAN_IR_RF1L ;
+      recordOverflowEvent (ioReceiver, (fifo == 0) ? OverflowKind::HARDWARE_RX_FIFO0 : OverflowKind::HARDWARE_RX_FIFO1, true, identifier) ;
+      accepted = false ;
+    }else if (full) { // Overwrite mode: oldest element is overwritten
+      getIndex = (getIndex + 1) % size ;
+      fillLevel -= 1 ;
+      recordOverflowEvent (ioReceiver, (fifo == 0) ? OverflowKind::HARDWARE_RX_FIFO0 : OverflowKind::HARDWARE_RX_FIFO1, false, 0) ;
+    }
+    if (accepted) {
+      const uint32_t payload = (r.RXESC.reg >> ((fifo == 0) ? 0 : 4)) & 7 ; // Page 1162
+      const uint32_t elementWordCount = ACANFD_FeatherM4CAN_Settings::wordCountForPayload (ACANFD_FeatherM4CAN_Settings::Payload (payload)) ;
+      uint32_t * element = messageRAMPointer (rxfc) + putIndex * elementWordCount ;
+      element [0] = w0 ;
+      element [1] = (r.TSCV.reg & 0xFFFF) | w1 | (filterIndex << 24) | (nonMatching ? (1U << 31) : 0) ;
+      for (uint32_t i=2 ; i<elementWordCount ; i++) {
+        element [i] = inData [i - 2] ;
+      }
+      putIndex = (putIndex + 1) % size ;
+      fillLevel += 1 ;
+      rxfs.mValue = fillLevel | (getIndex << 8) | (putIndex << 16) | ((fillLevel == size) ? (1U << 24) : 0) ;
+      r.IR.reg.mValue |= (fifo == 0) ? CAN_IR_RF0N : CAN_IR_RF1N ;
+      if (fillLevel == size) {
+        r.IR.reg.mValue |= (fifo == 0) ? CAN_IR_RF0F : CAN_IR_RF1F ;
+      }
+      ioReceiver.mReceivedFrameCount += 1 ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RUN
+//   At a given date: idle buses start arbitration, then the next date is computed; at this date,
+//   transmissions complete, then application events run.
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::run (const uint32_t inDurationMicros) {
+  const Date endDate = mDate + Date (inDurationMicros) * TICKS_PER_MICROSECOND ;
+  bool loop = true ;
+  while (loop) {
+  //--- Arbitration on idle buses (also for requests written between two run calls)
+    for (uint32_t i=0 ; i<mTransmissions.size () ; i++) {
+      if (!mTransmissions [i].mInProgress && (mTransmissions [i].mIdleDate <= mDate)) {
+        startTransmission (i) ;
+      }
+    }
+  //--- Next event date
+    Date next = endDate ;
+    for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+      if ((mNodes [i]->mLoopRoutine != nullptr) && (mNodes [i]->mNextLoopDate < next)) {
+        next = mNodes [i]->mNextLoopDate ;
+      }
+    }
+    for (uint32_t i=0 ; i<mPeriodicFrames.size () ; i++) {
+      if (mPeriodicFrames [i].mNextDate < next) {
+        next = mPeriodicFrames [i].mNextDate ;
+      }
+    }
+    for (uint32_t i=0 ; i<mTransmissions.size () ; i++) {
+      const Transmission & t = mTransmissions [i] ;
+      if (t.mInProgress && (t.mCompletionDate < next)) {
+        next = t.mCompletionDate ;
+      }else if (!t.mInProgress && (t.mIdleDate > mDate) && (t.mIdleDate < next)) {
+        next = t.mIdleDate ;
+      }
+    }
+    loop = next < endDate ;
+    mDate = next ;
+    gDate = mDate ;
+    if (loop) {
+    //--- Transmission completion
+      for (uint32_t i=0 ; i<mTransmissions.size () ; i++) {
+        if (mTransmissions [i].mInProgress && (mTransmissions [i].mCompletionDate == mDate)) {
+          if (dataPhaseIsSampled (mTransmissions [i])) {
+            completeTransmission (mTransmissions [i]) ;
+          }else{
+            abortTransmission (mTransmissions [i]) ;
+          }
+        }
+      }
+      serviceInterrupts () ;
+    //--- Application events
+      for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+        Node & node = * mNodes [i] ;
+        if ((node.mLoopRoutine != nullptr) && (node.mNextLoopDate == mDate)) {
+          node.mNextLoopDate += node.mLoopPeriod ;
+          node.mLoopRoutine (node) ;
+          checkDriverOverflowCounters (node) ;
+          serviceInterrupts () ;
+        }
+      }
+      for (uint32_t i=0 ; i<mPeriodicFrames.size () ; i++) {
+        PeriodicFrame & f = mPeriodicFrames [i] ;
+        if (f.mNextDate == mDate) {
+          f.mNextDate += f.mPeriod ;
+          f.mNode->send (f.mMessage) ;
+          serviceInterrupts () ;
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   REPORT
+//--------------------------------------------------------------------------------------------------
+
+static const char * overflowKindName (const ACANFD_VirtualBus::OverflowKind inKind) {
+  switch (inKind) {
+  case ACANFD_VirtualBus::OverflowKind::DRIVER_TRANSMIT_FIFO : return "driver transmit FIFO" ;
+  case ACANFD_VirtualBus::OverflowKind::HARDWARE_RX_FIFO0 : return "hardware Rx FIFO 0" ;
+  case ACANFD_VirtualBus::OverflowKind::HARDWARE_RX_FIFO1 : return "hardware Rx FIFO 1" ;
+  case ACANFD_VirtualBus::OverflowKind::DRIVER_RECEIVE_FIFO0 : return "driver receive FIFO 0" ;
+  case ACANFD_VirtualBus::OverflowKind::DRIVER_RECEIVE_FIFO1 : return "driver receive FIFO 1" ;
+  }
+  return "" ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_VirtualBus::printReport (FILE * inFile, const uint32_t inMaxListedOverflowEvents) const {
+  const double us = double (TICKS_PER_MICROSECOND) ;
+  fprintf (inFile, "Simulated duration: %.3f ms\n", double (mDate) / (us * 1000.0)) ;
+  if (mDate > 0) {
+    fprintf (inFile, "Bus load: %.2f %%\n", 100.0 * double (mBusBusyDurations [0]) / double (mDate)) ;
+    for (uint32_t i=1 ; i<mBusBusyDurations.size () ; i++) {
+      if (mBusBusyDurations [i] > 0) {
+        fprintf (inFile, "Bus load of %s internal loop back: %.2f %%\n",
+                 mNodes [i - 1]->mName, 100.0 * double (mBusBusyDurations [i]) / double (mDate)) ;
+      }
+    }
+  }
+  if (mIdenticalArbitrationCount > 0) {
+    fprintf (inFile, "WARNING: %u arbitrations between identical identifiers of different nodes\n", mIdenticalArbitrationCount) ;
+  }
+//--- Nodes
+  fprintf (inFile, "\n%-12s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+           "Node", "Sent", "Received", "TxFIFO", "HwRxFIFO0", "HwRxFIFO1", "RxFIFO0", "RxFIFO1", "FDIgnored", "BitTiming", "Destroyed") ;
+  for (uint32_t i=0 ; i<mNodes.size () ; i++) {
+    const Node & node = * mNodes [i] ;
+    uint32_t counts [5] = {0, 0, 0, 0, 0} ;
+    for (uint32_t e=0 ; e<mOverflowEvents.size () ; e++) {
+      if (mOverflowEvents [e].mNodeIndex == i) {
+        counts [uint32_t (mOverflowEvents [e].mKind)] += 1 ;
+      }
+    }
+    fprintf (inFile, "%-12s %10u %10u %10u %10u %10u %10u %10u %10u %10u %10u\n",
+             node.mName, node.mTransmittedFrameCount, node.mReceivedFrameCount,
+             counts [0], counts [1], counts [2], counts [3], counts [4], node.mDiscardedFDFrameCount,
+             node.mProtocolErrorCount, node.mDestroyedFrameCount) ;
+  }
+//--- Per identifier, in µs
+  fprintf (inFile, "\n%-12s %10s %8s %10s %10s %10s %10s %10s\n",
+           "Node", "Identifier", "Count", "Duration", "MinQueue", "AvgQueue", "MaxQueue", "WCRT") ;
+  for (StatisticsMap::const_iterator it = mStatistics.begin () ; it != mStatistics.end () ; ++it) {
+    const FrameStatistics & s = it->second ;
+    const uint32_t nodeIndex = uint32_t (it->first >> 32) ;
+    const bool extended = ((it->first >> 31) & 1) != 0 ;
+    char identifier [16] ;
+    snprintf (identifier, sizeof (identifier), extended ? "%08X" : "%03X", uint32_t (it->first & 0x1FFFFFFF)) ;
+    fprintf (inFile, "%-12s %10s %8u %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+             mNodes [nodeIndex]->mName, identifier, s.mCount,
+             double (s.mDuration) / us,
+             double (s.mMinQueueingDelay) / us,
+             double (s.mQueueingDelaySum) / (us * double (s.mCount)),
+             double (s.mMaxQueueingDelay) / us,
+             double (s.mWorstCaseResponseTime) / us) ;
+  }
+//--- Overflow events
+  fprintf (inFile, "\nOverflow events: %u\n", uint32_t (mOverflowEvents.size ())) ;
+  for (uint32_t e=0 ; (e<mOverflowEvents.size ()) && (e<inMaxListedOverflowEvents) ; e++) {
+    const OverflowEvent & event = mOverflowEvents [e] ;
+    fprintf (inFile, "  %12.3f us  %-12s %s", double (event.mDate) / us,
+             mNodes [event.mNodeIndex]->mName, overflowKindName (event.mKind)) ;
+    if (event.mIdentifierIsKnown) {
+      fprintf (inFile, ", identifier 0x%X", event.mIdentifier) ;
+    }
+    fprintf (inFile, "\n") ;
+  }
+  if (mOverflowEvents.size () > inMaxListedOverflowEvents) {
+    fprintf (inFile, "  ...\n") ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,284 @@
+//--------------------------------------------------------------------------------------------------
+// Host simulation of a CAN bus with several ACANFD_FeatherM4CAN nodes. Every node runs the
+// unchanged driver (compiled with host/Arduino.h) against a model of its M_CAN controller:
+// message RAM, filters, Rx FIFOs, Tx buffers and Tx FIFO, TXBAR / TXBRP / TXBTO, interrupt flags.
+// Register descriptions refer to DS60001507G data sheet, frame formats to ISO 11898-1:2015.
+//
+// Bus model:
+//   - when the bus is idle, pending transmission requests of all nodes arbitrate: the lowest
+//     arbitration field wins (a standard frame wins against an extended frame with the same base
+//     identifier); inside a node, dedicated Tx buffers and the Tx FIFO head compete by identifier;
+//   - frame duration is exact: stuff bits are counted from the actual frame bits, nominal and data
+//     bit durations come from NBTP and DBTP registers, that begin wrote from
+//     ACANFD_FeatherM4CAN_Settings; bits from ESI to the end of CRC are sent at data bit rate
+//     when BRS is set (as ACANFD_FeatherM4CAN_BusStatistics does);
+//   - transmission completes (TXBTO, IR.TC) and frames are received at the end of EOF; the
+//     next arbitration starts after the 3-bit intermission;
+//   - software runs in zero time: interrupt service routines are called as soon as an enabled
+//     interrupt flag is set, application events run at their date;
+//   - errors and acknowledge are not modeled: every frame is received by all active nodes whose
+//     bit timing matches the transmitter one. A node with another nominal bit duration (or, for a
+//     frame with BRS, another data bit duration) gets a protocol error instead (LEC / DLEC of PSR,
+//     IR.PEA / IR.PED), the error frame it would send is not modeled;
+//   - a node can have a transceiver loop delay: its frames with BRS are then destroyed by a bit
+//     error in data phase (DLEC of PSR, IR.PED) if the data phase is not correctly sampled, with
+//     transceiver delay compensation (DBTP.TDC, TDCR) or without it. A destroyed frame is not
+//     received by any node, it is retransmitted unless CCCR.DAR is set; it takes the bus for
+//     its full duration;
+//   - a node in INTERNAL_LOOP_BACK mode has its own private bus; BUS_MONITORING nodes only
+//     receive; EXTERNAL_LOOP_BACK nodes also receive their own frames.
+//   - DMA is not modeled: nodes copy frames by CPU.
+//
+// Message RAM of all nodes is allocated at the SAME51 SRAM address 0x20000000, so that the
+// driver address checks are unchanged: the message RAM total size is 16,384 words.
+//
+// Reports: per frame queueing delay (from send to SOF) and response time (from send to end of
+// EOF), worst case response time per node and identifier, overflow events (driver transmit FIFO,
+// hardware Rx FIFOs, driver receive FIFOs) with their dates.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN-from-cpp.h>
+#include <stdio.h>
+#include <map>
+#include <vector>
+#include <deque>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_VirtualBus {
+
+  //································································································
+  // Dates are counted in CAN root clock periods (48 MHz)
+  //································································································
+
+  public: typedef uint64_t Date ;
+
+  public: static const uint32_t TICKS_PER_MICROSECOND = ACANFD_FeatherM4CAN_Settings::CAN_ROOT_CLOCK_FREQUENCY / 1000000 ;
+
+  //································································································
+  // Overflow events
+  //································································································
+
+  public: enum class OverflowKind : uint8_t {
+    DRIVER_TRANSMIT_FIFO, // Frame rejected (DROP_NEWEST) or an other one discarded
+    HARDWARE_RX_FIFO0, // Rx FIFO 0 full, frame lost (blocking mode) or oldest overwritten
+    HARDWARE_RX_FIFO1,
+    DRIVER_RECEIVE_FIFO0,
+    DRIVER_RECEIVE_FIFO1
+  } ;
+
+  public: class OverflowEvent {
+    public: Date mDate ;
+    public: uint32_t mIdentifier ; // Lost frame identifier, if known
+    public: uint8_t mNodeIndex ;
+    public: OverflowKind mKind ;
+    public: bool mIdentifierIsKnown ;
+  } ;
+
+  //································································································
+  // Node
+  //································································································
+
+  public: class Node ;
+
+  public: typedef void (* LoopRoutine) (Node & inNode) ;
+
+  public: class Node {
+    public: Node (ACANFD_VirtualBus & inBus,
+                  const uint8_t inIndex,
+                  const char * inName,
+                  uint32_t * inMessageRAM,
+                  const uint32_t inMessageRAMWordSize) ;
+
+  //--- Driver
+    public: inline ACANFD_FeatherM4CAN & can (void) { return mCAN ; }
+    public: inline const char * name (void) const { return mName ; }
+    public: inline uint8_t index (void) const { return mIndex ; }
+
+  //--- Begin the driver, and record transmit FIFO overflow policy
+    public: uint32_t beginFD (const ACANFD_FeatherM4CAN_Settings & inSettings,
+                              const ACANFD_FeatherM4CAN::StandardFilters & inStandardFilters = ACANFD_FeatherM4CAN::StandardFilters (),
+                              const ACANFD_FeatherM4CAN::ExtendedFilters & inExtendedFilters = ACANFD_FeatherM4CAN::ExtendedFilters ()) ;
+
+  //--- Send a frame (tryToSendReturnStatusFD), its queueing delay is measured from now. Frames
+  //    sent directly by the driver (can ().tryToSendReturnStatusFD, ISO-TP, gateway) are measured
+  //    from their transmission request (TXBAR write).
+    public: uint32_t send (const CANFDMessage & inMessage) ;
+
+  //--- Counters
+    public: inline uint32_t transmittedFrameCount (void) const { return mTransmittedFrameCount ; }
+    public: inline uint32_t receivedFrameCount (void) const { return mReceivedFrameCount ; }
+
+  //--- Controller model, private to the simulator
+    public: class PendingFrame {
+      public: Date mSendDate ;
+      public: uint32_t mIdentifier ;
+      public: uint8_t mTxBufferIndex ;
+      public: bool mExtended ;
+      public: bool mInHardware ;
+      public: bool mViaTxFIFO ;
+    } ;
+
+    public: Can mRegisters ;
+    public: ACANFD_FeatherM4CAN mCAN ;
+    public: ACANFD_VirtualBus & mBus ;
+    public: const char * mName ;
+    public: uint32_t * mMessageRAM ;
+    public: std::deque <PendingFrame> mPendingFrames ;
+    public: std::deque <uint8_t> mTxFIFOOrder ; // Requested Tx FIFO buffers, oldest first
+    public: uint8_t mTxFIFOPutIndex = 0 ;
+    public: LoopRoutine mLoopRoutine = nullptr ;
+    public: Date mLoopPeriod = 0 ;
+    public: Date mNextLoopDate = 0 ;
+    public: uint32_t mTransmittedFrameCount = 0 ;
+    public: uint32_t mReceivedFrameCount = 0 ;
+    public: uint32_t mDiscardedFDFrameCount = 0 ; // CANFD frames seen by a CAN 2.0B node
+    public: uint32_t mProtocolErrorCount = 0 ; // Frames seen with a bit timing mismatch
+    public: uint32_t mTransceiverLoopDelay = 0 ; // In CAN root clock periods, 0: not modeled
+    public: uint32_t mDestroyedFrameCount = 0 ; // Frames with BRS whose data phase was not sampled
+    public: uint32_t mOverflowCounters [3] = {0, 0, 0} ; // Last seen driver FIFO overflow counters
+    public: ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy mTransmitFIFOOverflowPolicy = ACANFD_FeatherM4CAN_Settings::DROP_NEWEST ;
+    public: const uint8_t mIndex ;
+
+    private: Node (const Node &) = delete ;
+    private: Node & operator = (const Node &) = delete ;
+  } ;
+
+  //································································································
+  // Constructor, destructor
+  //································································································
+
+  public: ACANFD_VirtualBus (void) ;
+  public: ~ ACANFD_VirtualBus (void) ;
+
+  //································································································
+  // Building the simulation: returns nullptr if message RAM is exhausted
+  //································································································
+
+  public: Node * addNode (const char * inName, const uint32_t inMessageRAMWordSize = 4352) ;
+
+  public: void setLoop (Node & inNode, LoopRoutine inRoutine, const uint32_t inPeriodMicros) ;
+
+  public: void addPeriodicFrame (Node & inNode,
+                                 const CANFDMessage & inMessage,
+                                 const uint32_t inPeriodMicros,
+                                 const uint32_t inOffsetMicros = 0) ;
+
+  //--- CSV log of every transmitted frame (nullptr: no log)
+  public: inline void setFrameLog (FILE * inFile) { mFrameLog = inFile ; }
+
+  //································································································
+  // Running (can be called several times, simulation goes on)
+  //································································································
+
+  public: void run (const uint32_t inDurationMicros) ;
+
+  public: inline Date date (void) const { return mDate ; }
+
+  //································································································
+  // Report
+  //································································································
+
+  public: void printReport (FILE * inFile, const uint32_t inMaxListedOverflowEvents = 20) const ;
+
+  public: inline const std::vector <OverflowEvent> & overflowEvents (void) const { return mOverflowEvents ; }
+
+  //································································································
+  // Per identifier statistics
+  //································································································
+
+  public: class FrameStatistics {
+    public: uint32_t mCount = 0 ;
+    public: Date mQueueingDelaySum = 0 ;
+    public: Date mMinQueueingDelay = ~ Date (0) ;
+    public: Date mMaxQueueingDelay = 0 ;
+    public: Date mWorstCaseResponseTime = 0 ;
+    public: Date mDuration = 0 ; // Of the last frame
+  } ;
+
+  public: typedef std::map <uint64_t, FrameStatistics> StatisticsMap ; // Key: node, IDE, identifier
+
+  public: inline const StatisticsMap & frameStatistics (void) const { return mStatistics ; }
+
+  //································································································
+  // Private types
+  //································································································
+
+  private: class PeriodicFrame {
+    public: CANFDMessage mMessage ;
+    public: Date mPeriod ;
+    public: Date mNextDate ;
+    public: Node * mNode ;
+  } ;
+
+  private: class Transmission {
+    public: Date mStartDate = 0 ;
+    public: Date mCompletionDate = 0 ; // End of EOF
+    public: Date mIdleDate = 0 ; // End of intermission
+    public: Node * mTransmitter = nullptr ;
+    public: uint32_t mHeader [2] = {0, 0} ;
+    public: uint32_t mData [16] ;
+    public: Date mSendDate = 0 ;
+    public: uint8_t mTxBufferIndex = 0 ;
+    public: bool mInProgress = false ;
+  } ;
+
+  //································································································
+  // Register write handlers (controller model)
+  //································································································
+
+  private: static void handleWriteIR (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteTXBAR (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteTXBC (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteTXBCR (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteRXF0C (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteRXF1C (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteRXF0A (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+  private: static void handleWriteRXF1A (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+
+  //································································································
+  // Private methods
+  //································································································
+
+  private: uint32_t busOfNode (const Node & inNode) const ;
+  private: bool startTransmission (const uint32_t inBus) ;
+  private: void completeTransmission (Transmission & ioTransmission) ;
+  private: bool dataPhaseIsSampled (const Transmission & inTransmission) ;
+  private: void abortTransmission (Transmission & ioTransmission) ;
+  private: void receiveFrame (Node & ioReceiver, const uint32_t * inHeader, const uint32_t * inData) ;
+  private: void protocolError (Node & ioReceiver, const bool inDataPhase) ;
+  private: void serviceInterrupts (void) ;
+  private: void checkDriverOverflowCounters (Node & ioNode) ;
+  private: void recordOverflowEvent (const Node & inNode,
+                                     const OverflowKind inKind,
+                                     const bool inIdentifierIsKnown,
+                                     const uint32_t inIdentifier) ;
+  private: void updateTXFQS (Node & ioNode) ;
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: std::vector <Node *> mNodes ;
+  private: std::vector <PeriodicFrame> mPeriodicFrames ;
+  private: std::vector <Transmission> mTransmissions ; // Index 0: shared bus, i+1: node i private bus
+  private: std::vector <Date> mBusBusyDurations ;
+  private: std::vector <OverflowEvent> mOverflowEvents ;
+  private: StatisticsMap mStatistics ;
+  private: FILE * mFrameLog ;
+  private: Date mDate ;
+  private: uint32_t mIdenticalArbitrationCount ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_VirtualBus (const ACANFD_VirtualBus &) = delete ;
+  private: ACANFD_VirtualBus & operator = (const ACANFD_VirtualBus &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------------------
+// Virtual bus demo: three ACANFD_FeatherM4CAN nodes on a 1 Mbit/s x4 CANFD bus.
+//   - "engine" sends 0x080 (64 bytes, BRS) every 2 ms and 0x100 (8 bytes) every 1 ms;
+//   - "body" sends 0x200 (8 bytes) every 5 ms and a burst of 0x300 ... 0x31F every 20 ms, that
+//     overflows its driver transmit FIFO;
+//   - "logger" has a 16-frame driver receive FIFO, drained every 10 ms: it overflows.
+//
+// Build (Linux, from this directory):
+//   c++ -std=c++11 -O2 -fpermissive -DARDUINO_FEATHER_M4_CAN -I host -I ../../src -o VirtualBusDemo ACANFD_VirtualBus.cpp VirtualBusDemo.cpp ../../src/*.cpp
+//   (-fpermissive: the driver converts message RAM pointers to uint32_t)
+//
+// Usage: VirtualBusDemo [duration in ms (default 100)] [frame log CSV file]
+//--------------------------------------------------------------------------------------------------
+
+#include "ACANFD_VirtualBus.h"
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static void drainReceiveFIFO (ACANFD_VirtualBus::Node & inNode) {
+  CANFDMessage frame ;
+  while (inNode.can ().receiveFD0 (frame)) {
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void sendBurst (ACANFD_VirtualBus::Node & inNode) {
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 16 ;
+  for (uint32_t i=0 ; i<32 ; i++) {
+    frame.id = 0x300 + i ;
+    inNode.send (frame) ;
+  }
+  drainReceiveFIFO (inNode) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, const char * argv []) {
+  const uint32_t durationMillis = (argc > 1) ? uint32_t (atoi (argv [1])) : 100 ;
+  FILE * frameLog = nullptr ;
+  if (argc > 2) {
+    frameLog = fopen (argv [2], "w") ;
+    if (frameLog == nullptr) {
+      fprintf (stderr, "Cannot open %s\n", argv [2]) ;
+      return 1 ;
+    }
+    fprintf (frameLog, "start_us,node,id,ext,fdf,brs,len,duration_us,queueing_us,response_us\n") ;
+  }
+  ACANFD_VirtualBus bus ;
+  bus.setFrameLog (frameLog) ;
+  ACANFD_VirtualBus::Node * engine = bus.addNode ("engine") ;
+  ACANFD_VirtualBus::Node * body = bus.addNode ("body") ;
+  ACANFD_VirtualBus::Node * logger = bus.addNode ("logger") ;
+//--- Configuration
+  ACANFD_FeatherM4CAN_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  uint32_t errorCode = engine->beginFD (settings) ;
+  settings.mDriverTransmitFIFOSize = 8 ;
+  errorCode |= body->beginFD (settings) ;
+  settings.mDriverReceiveFIFO0Size = 16 ;
+  settings.mHardwareRxFIFO0Size = 16 ;
+  errorCode |= logger->beginFD (settings) ;
+  if (errorCode != 0) {
+    fprintf (stderr, "Configuration error 0x%X\n", errorCode) ;
+    return 1 ;
+  }
+//--- Traffic
+  CANFDMessage frame ;
+  frame.id = 0x080 ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  for (uint32_t i=0 ; i<64 ; i++) {
+    frame.data [i] = uint8_t (i) ;
+  }
+  bus.addPeriodicFrame (*engine, frame, 2000) ;
+  frame.id = 0x100 ;
+  frame.type = CANFDMessage::CAN_DATA ;
+  frame.len = 8 ;
+  bus.addPeriodicFrame (*engine, frame, 1000, 100) ;
+  frame.id = 0x200 ;
+  bus.addPeriodicFrame (*body, frame, 5000, 300) ;
+  bus.setLoop (*engine, drainReceiveFIFO, 1000) ;
+  bus.setLoop (*body, sendBurst, 20000) ;
+  bus.setLoop (*logger, drainReceiveFIFO, 10000) ;
+//--- Run
+  bus.run (durationMillis * 1000) ;
+  bus.printReport (stdout) ;
+  if (frameLog != nullptr) {
+    fclose (frameLog) ;
+  }
+  return 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------------------
+// Virtual bus regression tests: driver behaviours that need a controller model (register values
+// kept across end / beginFD, message RAM contents, procedures refused when the controller is not
+// started).
+//
+// Build (Linux, from this directory):
+//   c++ -std=c++11 -O2 -fpermissive -DARDUINO_FEATHER_M4_CAN -I host -I ../../src -o VirtualBusTests ACANFD_VirtualBus.cpp VirtualBusTests.cpp ../../src/*.cpp
+//   (-fpermissive: the driver converts message RAM pointers to uint32_t)
+//
+// Usage: VirtualBusTests; prints a line per test, exit status is the failed test count.
+//--------------------------------------------------------------------------------------------------
+
+#include "ACANFD_VirtualBus.h"
+#include <ACANFD_FeatherM4CAN_GatewayRoutes.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t gFailureCount = 0 ;
+
+//--- Message RAM of the simulated nodes is never released: 2,048 words per node, so that the nodes
+//    of all tests fit into the 16,384-word SAME51 message RAM
+static const uint32_t NODE_MESSAGE_RAM_WORD_SIZE = 2048 ;
+
+static void check (const char * inTestName, const bool inOk) {
+  printf ("%s: %s\n", inTestName, inOk ? "ok" : "FAILED") ;
+  if (!inOk) {
+    gFailureCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// beginFD, end, then beginFD with smaller Rx FIFO payloads: RXESC keeps its value while the clock
+// is gated, so it should be assigned (page 1162), and frames are received with the new element
+// size.
+
+static void testBeginEndBeginWithSmallerPayload (void) {
+  ACANFD_VirtualBus bus ;
+  ACANFD_VirtualBus::Node * sender = bus.addNode ("sender", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_VirtualBus::Node * receiver = bus.addNode ("receiver", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  uint32_t errorCode = sender->beginFD (settings) ;
+  errorCode |= receiver->beginFD (settings) ; // 64-byte payloads
+  receiver->can ().end () ;
+  settings.mHardwareRxFIFO0Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES ;
+  settings.mHardwareRxFIFO1Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES ;
+  errorCode |= receiver->beginFD (settings) ;
+  const bool registerOk = receiver->mRegisters.RXESC.reg == 0 ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CAN_DATA ;
+  frame.len = 8 ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    frame.id = 0x100 + i ;
+    for (uint32_t j=0 ; j<8 ; j++) {
+      frame.data [j] = uint8_t (i + j) ;
+    }
+    sender->send (frame) ;
+  }
+  bus.run (10 * 1000) ;
+  uint32_t receivedCount = 0 ;
+  bool dataOk = true ;
+  while (receiver->can ().receiveFD0 (frame)) {
+    const uint32_t i = frame.id - 0x100 ;
+    dataOk = dataOk && (i == receivedCount) && (frame.len == 8) ;
+    for (uint32_t j=0 ; j<8 ; j++) {
+      dataOk = dataOk && (frame.data [j] == uint8_t (i + j)) ;
+    }
+    receivedCount += 1 ;
+  }
+  check ("begin, end, begin with smaller payload",
+         (errorCode == 0) && registerOk && dataOk && (receivedCount == 8)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// A 64-byte frame is received by the gateway source in an 8-byte Rx element, and forwarded by the
+// target through its Tx FIFO, whose two elements held 64-byte frames before: the 56 bytes the Rx
+// element does not hold are sent as 0xCC, not as the bytes of a previous frame.
+
+static void testGatewayFillsMissingData (void) {
+  ACANFD_VirtualBus bus ;
+  ACANFD_VirtualBus::Node * sender = bus.addNode ("sender", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_VirtualBus::Node * source = bus.addNode ("source", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_VirtualBus::Node * target = bus.addNode ("target", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_VirtualBus::Node * receiver = bus.addNode ("receiver", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  uint32_t errorCode = sender->beginFD (settings) ;
+  errorCode |= receiver->beginFD (settings) ;
+  ACANFD_FeatherM4CAN_Settings targetSettings = settings ;
+  targetSettings.mHardwareTransmitTxFIFOSize = 2 ;
+  errorCode |= target->beginFD (targetSettings) ;
+  ACANFD_FeatherM4CAN_Settings sourceSettings = settings ;
+  sourceSettings.mHardwareRxFIFO0Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES ;
+  sourceSettings.mNonMatchingStandardFrameReception = ACANFD_FeatherM4CAN_FilterAction::REJECT ;
+  ACANFD_FeatherM4CAN::StandardFilters filters ;
+  filters.addSingle (0x100, ACANFD_FeatherM4CAN_FilterAction::FIFO0) ;
+  errorCode |= source->beginFD (sourceSettings, filters) ;
+  static ACANFD_FeatherM4CAN_GatewayRoutes routes (1, 0) ;
+  routes.setStandardRoute (0, ACANFD_FeatherM4CAN_GatewayRoutes::FORWARD, 0x7FF, 0x200) ;
+  source->can ().setGateway (target->can (), routes) ;
+//--- Previous frames of the target Tx FIFO elements
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  frame.id = 0x300 ;
+  for (uint32_t i=0 ; i<64 ; i++) {
+    frame.data [i] = 0x55 ;
+  }
+  target->send (frame) ;
+  target->send (frame) ;
+  bus.run (1000) ;
+//--- Forwarded frame
+  frame.id = 0x100 ;
+  for (uint32_t i=0 ; i<64 ; i++) {
+    frame.data [i] = uint8_t (i) ;
+  }
+  sender->send (frame) ;
+  bus.run (2000) ;
+  bool forwarded = false ;
+  bool dataOk = true ;
+  while (receiver->can ().receiveFD0 (frame)) {
+    if (frame.id == 0x200) {
+      forwarded = true ;
+      dataOk = frame.len == 64 ;
+      for (uint32_t i=0 ; i<64 ; i++) {
+        dataOk = dataOk && (frame.data [i] == ((i < 8) ? uint8_t (i) : 0xCC)) ;
+      }
+    }
+  }
+  check ("gateway fills data missing from Rx element", (errorCode == 0) && forwarded && dataOk) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit rate detection before beginFD and after end is refused with kControllerNotStarted (the
+// procedure writes CCCR and the bit timing registers), and while a TDC calibration runs with
+// kTDCCalibrationRunning; the detection state is not changed.
+
+static void testBitRateDetectionNeedsStartedController (void) {
+  ACANFD_VirtualBus bus ;
+  ACANFD_VirtualBus::Node * node = bus.addNode ("node", NODE_MESSAGE_RAM_WORD_SIZE) ;
+  ACANFD_FeatherM4CAN_Settings settings (500 * 1000, DataBitRateFactor::x4) ;
+  const uint32_t beforeBegin = node->can ().beginBitRateDetection (&settings, 1, 100) ;
+  uint32_t errorCode = node->beginFD (settings) ;
+  const uint32_t calibrationErrorCode = node->can ().beginTDCCalibration (&settings, 1) ;
+  const uint32_t duringCalibration = node->can ().beginBitRateDetection (&settings, 1, 100) ;
+  node->can ().end () ;
+  const uint32_t afterEnd = node->can ().beginBitRateDetection (&settings, 1, 100) ;
+  check ("bit rate detection needs a started controller",
+         (errorCode == 0) && (calibrationErrorCode == 0)
+         && (beforeBegin == ACANFD_FeatherM4CAN::kControllerNotStarted)
+         && (duringCalibration == ACANFD_FeatherM4CAN::kTDCCalibrationRunning)
+         && (afterEnd == ACANFD_FeatherM4CAN::kControllerNotStarted)
+         && (node->can ().bitRateDetectionState () == ACANFD_FeatherM4CAN::BIT_RATE_DETECTION_IDLE)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (void) {
+  testBeginEndBeginWithSmallerPayload () ;
+  testGatewayFillsMissingData () ;
+  testBitRateDetectionNeedsStartedController () ;
+  return int (gFailureCount) ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,344 @@
+//--------------------------------------------------------------------------------------------------
+// Host replacement of <Arduino.h> for ACANFD_VirtualBus: the library sources are compiled
+// unchanged for the host. CAN registers are virtual, a write can be handled by the controller
+// model (write-1-to-clear IR bits, TXBAR transmission requests, Rx FIFO acknowledges, ...).
+// Interrupts are never preempting: the simulator calls interrupt service routines between
+// application events, so noInterrupts / interrupts are no-op.
+// Register offsets refer to DS60001507G data sheet.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ARDUINO_FEATHER_M4_CAN
+  #define ARDUINO_FEATHER_M4_CAN
+#endif
+
+//--------------------------------------------------------------------------------------------------
+//   VIRTUAL REGISTER
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_VirtualRegister {
+  public: typedef void (* WriteHandler) (void * inContext, ACANFD_VirtualRegister & ioRegister, const uint32_t inValue) ;
+
+  public: uint32_t mValue = 0 ;
+  public: WriteHandler mWriteHandler = nullptr ;
+  public: void * mContext = nullptr ;
+
+  public: inline operator uint32_t (void) const { return mValue ; }
+
+  public: inline ACANFD_VirtualRegister & operator = (const uint32_t inValue) {
+    if (mWriteHandler != nullptr) {
+      mWriteHandler (mContext, *this, inValue) ;
+    }else{
+      mValue = inValue ;
+    }
+    return *this ;
+  }
+
+  public: inline ACANFD_VirtualRegister & operator |= (const uint32_t inValue) { return *this = mValue | inValue ; }
+  public: inline ACANFD_VirtualRegister & operator &= (const uint32_t inValue) { return *this = mValue & inValue ; }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+struct ACANFD_VirtualRegister32 { ACANFD_VirtualRegister reg ; } ;
+
+//--------------------------------------------------------------------------------------------------
+//   CAN
+//--------------------------------------------------------------------------------------------------
+
+struct Can {
+  ACANFD_VirtualRegister32 CREL, ENDN, MRCFG, DBTP, TEST, RWD, CCCR, NBTP, TSCC, TSCV, TOCC, TOCV,
+    ECR, PSR, TDCR, IR, IE, ILS, ILE, GFC, SIDFC, XIDFC, XIDAM, HPMS, NDAT1, NDAT2, RXF0C, RXF0S,
+    RXF0A, RXBC, RXF1C, RXF1S, RXF1A, RXESC, TXBC, TXFQS, TXESC, TXBRP, TXBAR, TXBCR, TXBTO, TXBCF,
+    TXBTIE, TXBCIE, TXEFC, TXEFS, TXEFA ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// Every ACANFD_FeatherM4CAN instance is bound to the registers of the virtual bus node that is
+// being constructed, whatever its module
+
+Can * ACANFD_VirtualBus_registersOfConstructedNode (void) ;
+
+#define CAN0 (ACANFD_VirtualBus_registersOfConstructedNode ())
+#define CAN1 (ACANFD_VirtualBus_registersOfConstructedNode ())
+
+//--------------------------------------------------------------------------------------------------
+
+#define CAN_CCCR_INIT  (1U << 0)
+#define CAN_CCCR_CCE   (1U << 1)
+#define CAN_CCCR_ASM   (1U << 2)
+#define CAN_CCCR_CSA   (1U << 3)
+#define CAN_CCCR_CSR   (1U << 4)
+#define CAN_CCCR_MON   (1U << 5)
+#define CAN_CCCR_DAR   (1U << 6)
+#define CAN_CCCR_TEST  (1U << 7)
+#define CAN_CCCR_FDOE  (1U << 8)
+#define CAN_CCCR_BRSE  (1U << 9)
+#define CAN_TEST_LBCK  (1U << 4)
+#define CAN_DBTP_TDC   (1U << 23)
+
+#define CAN_IR_RF0N    (1U << 0)
+#define CAN_IR_RF0W    (1U << 1)
+#define CAN_IR_RF0F    (1U << 2)
+#define CAN_IR_RF0L    (1U << 3)
+#define CAN_IR_RF1N    (1U << 4)
+#define CAN_IR_RF1W    (1U << 5)
+#define CAN_IR_RF1F    (1U << 6)
+#define CAN_IR_RF1L    (1U << 7)
+#define CAN_IR_HPM     (1U << 8)
+#define CAN_IR_TC      (1U << 9)
+#define CAN_IR_TCF     (1U << 10)
+#define CAN_IR_TFE     (1U << 11)
+#define CAN_IR_BO      (1U << 25)
+#define CAN_IR_EW      (1U << 24)
+#define CAN_IR_EP      (1U << 23)
+#define CAN_IR_PEA     (1U << 27)
+#define CAN_IR_PED     (1U << 28)
+
+#define CAN_IE_RF0NE   (1U << 0)
+#define CAN_IE_RF0WE   (1U << 1)
+#define CAN_IE_RF0FE   (1U << 2)
+#define CAN_IE_RF0LE   (1U << 3)
+#define CAN_IE_RF1NE   (1U << 4)
+#define CAN_IE_RF1WE   (1U << 5)
+#define CAN_IE_RF1FE   (1U << 6)
+#define CAN_IE_RF1LE   (1U << 7)
+#define CAN_IE_TCE     (1U << 9)
+#define CAN_IE_TFEE    (1U << 11)
+#define CAN_IE_EPE     (1U << 23)
+#define CAN_IE_EWE     (1U << 24)
+#define CAN_IE_BOE     (1U << 25)
+#define CAN_IE_PEAE    (1U << 27)
+#define CAN_IE_PEDE    (1U << 28)
+
+#define CAN_ILE_EINT0  (1U << 0)
+#define CAN_ILE_EINT1  (1U << 1)
+
+#define CAN_RXF0C_F0OM (1U << 31)
+#define CAN_RXF1C_F1OM (1U << 31)
+
+//--------------------------------------------------------------------------------------------------
+//   OTHER PERIPHERALS (written by begin, not modeled)
+//--------------------------------------------------------------------------------------------------
+
+struct ACANFD_HostRegister32 { volatile uint32_t reg ; } ;
+struct ACANFD_HostRegister16 { volatile uint16_t reg ; } ;
+struct ACANFD_HostRegister8  { volatile uint8_t reg ; } ;
+
+struct Gclk { ACANFD_HostRegister32 PCHCTRL [48] ; } ;
+struct Mclk { ACANFD_HostRegister32 AHBMASK, APBAMASK, APBBMASK, APBCMASK, APBDMASK ; } ;
+
+struct PortGroup {
+  ACANFD_HostRegister32 DIR, DIRCLR, DIRSET, DIRTGL, OUT, OUTCLR, OUTSET, OUTTGL, IN ;
+  ACANFD_HostRegister8 PMUX [16] ;
+  ACANFD_HostRegister8 PINCFG [32] ;
+} ;
+
+struct Port { PortGroup Group [4] ; } ;
+
+struct DmacDescriptor {
+  ACANFD_HostRegister16 BTCTRL, BTCNT ;
+  ACANFD_HostRegister32 SRCADDR, DSTADDR, DESCADDR ;
+} ;
+
+struct DmacChannel {
+  ACANFD_HostRegister32 CHCTRLA ;
+  ACANFD_HostRegister8 CHCTRLB, CHPRILVL, CHEVCTRL, CHINTENCLR, CHINTENSET, CHINTFLAG, CHSTATUS ;
+} ;
+
+struct Dmac {
+  ACANFD_HostRegister16 CTRL, CRCCTRL ;
+  ACANFD_HostRegister32 CRCDATAIN, CRCCHKSUM, SWTRIGCTRL, PRICTRL0, INTSTATUS, BUSYCH, PENDCH, ACTIVE,
+                        BASEADDR, WRBADDR ;
+  DmacChannel Channel [32] ;
+} ;
+
+struct TcCount32 {
+  ACANFD_HostRegister32 CTRLA ;
+  ACANFD_HostRegister8 CTRLBCLR, CTRLBSET ;
+  ACANFD_HostRegister16 EVCTRL ;
+  ACANFD_HostRegister8 INTENCLR, INTENSET, INTFLAG, STATUS, WAVE, DRVCTRL, DBGCTRL ;
+  ACANFD_HostRegister32 SYNCBUSY, COUNT ;
+  ACANFD_HostRegister32 CC [2] ;
+  ACANFD_HostRegister32 CCBUF [2] ;
+} ;
+
+union Tc { TcCount32 COUNT32 ; } ;
+
+struct Pm { ACANFD_HostRegister8 SLEEPCFG ; } ;
+struct ACANFD_HostDWT { volatile uint32_t CTRL, CYCCNT ; } ;
+struct ACANFD_HostCoreDebug { volatile uint32_t DEMCR ; } ;
+
+extern Gclk gACANFDHostGclk ;
+extern Mclk gACANFDHostMclk ;
+extern Port gACANFDHostPort ;
+extern Dmac gACANFDHostDmac ;
+extern Tc gACANFDHostTc [6] ;
+extern Pm gACANFDHostPm ;
+extern ACANFD_HostDWT gACANFDHostDWT ;
+extern ACANFD_HostCoreDebug gACANFDHostCoreDebug ;
+
+#define GCLK (&gACANFDHostGclk)
+#define MCLK (&gACANFDHostMclk)
+#define PORT (&gACANFDHostPort)
+#define DMAC (&gACANFDHostDmac)
+#define TC0  (&gACANFDHostTc [0])
+#define TC1  (&gACANFDHostTc [1])
+#define TC2  (&gACANFDHostTc [2])
+#define TC3  (&gACANFDHostTc [3])
+#define TC4  (&gACANFDHostTc [4])
+#define TC5  (&gACANFDHostTc [5])
+#define PM   (&gACANFDHostPm)
+#define DWT  (&gACANFDHostDWT)
+#define CoreDebug (&gACANFDHostCoreDebug)
+
+#define PM_SLEEPCFG_SLEEPMODE_IDLE         (2U)
+#define DWT_CTRL_CYCCNTENA_Msk             (1U << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk         (1U << 24)
+#define F_CPU                              120000000UL
+
+#define CAN0_GCLK_ID                       27
+#define CAN1_GCLK_ID                       28
+#define GCLK_PCHCTRL_CHEN                  (1U << 6)
+#define GCLK_PCHCTRL_GEN_GCLK1             (1U)
+#define MCLK_AHBMASK_CAN0                  (1U << 17)
+#define MCLK_AHBMASK_CAN1                  (1U << 18)
+#define MCLK_AHBMASK_DMAC                  (1U << 9)
+#define PORT_PINCFG_PMUXEN                 (1U << 0)
+#define PORT_PINCFG_INEN                   (1U << 1)
+#define PORT_PMUX_PMUXE(x)                 ((x) & 0xF)
+#define PORT_PMUX_PMUXO(x)                 (((x) & 0xF) << 4)
+#define DMAC_CH_NUM                        32
+#define DMAC_CTRL_SWRST                    (1U << 0)
+#define DMAC_CTRL_DMAENABLE                (1U << 1)
+#define DMAC_CTRL_LVLEN(x)                 (((x) & 0xF) << 8)
+#define DMAC_CHCTRLA_SWRST                 (1U << 0)
+#define DMAC_CHCTRLA_ENABLE                (1U << 1)
+#define DMAC_CHCTRLA_TRIGSRC(x)            (((x) & 0x7F) << 8)
+#define DMAC_CHCTRLA_TRIGACT_TRANSACTION   (3U << 20)
+#define DMAC_CHINTENSET_TERR               (1U << 0)
+#define DMAC_CHINTENSET_TCMPL              (1U << 1)
+#define DMAC_CHINTFLAG_TERR                (1U << 0)
+#define DMAC_CHINTFLAG_TCMPL               (1U << 1)
+#define DMAC_BTCTRL_VALID                  (1U << 0)
+#define DMAC_BTCTRL_BLOCKACT_NOACT         (0U << 3)
+#define DMAC_BTCTRL_BLOCKACT_INT           (1U << 3)
+#define DMAC_BTCTRL_BEATSIZE_WORD          (2U << 8)
+#define DMAC_BTCTRL_SRCINC                 (1U << 10)
+#define DMAC_BTCTRL_DSTINC                 (1U << 11)
+#define TC0_GCLK_ID                        9
+#define TC2_GCLK_ID                        26
+#define TC4_GCLK_ID                        30
+#define MCLK_APBAMASK_TC0                  (1U << 14)
+#define MCLK_APBAMASK_TC1                  (1U << 15)
+#define MCLK_APBBMASK_TC2                  (1U << 13)
+#define MCLK_APBBMASK_TC3                  (1U << 14)
+#define MCLK_APBCMASK_TC4                  (1U << 3)
+#define MCLK_APBCMASK_TC5                  (1U << 4)
+#define TC_CTRLA_SWRST                     (1U << 0)
+#define TC_CTRLA_ENABLE                    (1U << 1)
+#define TC_CTRLA_MODE_COUNT32              (2U << 2)
+#define TC_CTRLA_PRESCALER_DIV1            (0U << 8)
+#define TC_CTRLBSET_CMD_READSYNC           (4U << 5)
+#define TC_INTENCLR_MASK                   0x33U
+#define TC_INTENSET_MC0                    (1U << 4)
+#define TC_INTFLAG_MC0                     (1U << 4)
+#define TC_INTFLAG_MASK                    0x33U
+#define TC_WAVE_WAVEGEN_NFRQ               (0U)
+#define TC_SYNCBUSY_SWRST                  (1U << 0)
+#define TC_SYNCBUSY_ENABLE                 (1U << 1)
+#define TC_SYNCBUSY_CTRLB                  (1U << 2)
+#define TC_SYNCBUSY_COUNT                  (1U << 4)
+#define TC_SYNCBUSY_CC0                    (1U << 6)
+
+//--------------------------------------------------------------------------------------------------
+//   INTERRUPTS
+//--------------------------------------------------------------------------------------------------
+
+typedef enum {
+  DMAC_0_IRQn = 31,
+  DMAC_1_IRQn = 32,
+  DMAC_2_IRQn = 33,
+  DMAC_3_IRQn = 34,
+  DMAC_4_IRQn = 35,
+  CAN0_IRQn = 78,
+  CAN1_IRQn = 79,
+  TC0_IRQn = 107,
+  TC2_IRQn = 109,
+  TC4_IRQn = 111,
+  AC_IRQn = 122,
+  PERIPH_COUNT_IRQn = 137
+} IRQn_Type ;
+
+#define __NVIC_PRIO_BITS 3
+
+inline void NVIC_EnableIRQ (IRQn_Type) {}
+inline void NVIC_DisableIRQ (IRQn_Type) {}
+inline void NVIC_ClearPendingIRQ (IRQn_Type) {}
+//--- A software triggered CAN interrupt is serviced by the simulator for every node
+extern bool gACANFDHostCANInterruptPending ;
+inline void NVIC_SetPendingIRQ (IRQn_Type inIRQ) {
+  if ((inIRQ == CAN0_IRQn) || (inIRQ == CAN1_IRQn)) {
+    gACANFDHostCANInterruptPending = true ;
+  }
+}
+inline void NVIC_SetPriority (IRQn_Type, uint32_t) {}
+inline uint32_t NVIC_GetPriority (IRQn_Type) { return 0 ; }
+inline void noInterrupts (void) {}
+inline void interrupts (void) {}
+inline void __DSB (void) {}
+inline void __WFI (void) {}
+inline void __ISB (void) {}
+inline void __DMB (void) {}
+inline uint32_t __get_PRIMASK (void) { return 0 ; }
+inline void __set_PRIMASK (const uint32_t) {}
+inline void __disable_irq (void) {}
+
+//--- Exclusive accesses: without preemption, a store exclusive always succeeds
+inline uint32_t __LDREXW (volatile uint32_t * inAddress) { return *inAddress ; }
+inline uint32_t __STREXW (const uint32_t inValue, volatile uint32_t * inAddress) {
+  *inAddress = inValue ;
+  return 0 ;
+}
+inline void __CLREX (void) {}
+
+//--------------------------------------------------------------------------------------------------
+//   TIME (simulated date)
+//--------------------------------------------------------------------------------------------------
+
+uint32_t micros (void) ;
+uint32_t millis (void) ;
+
+//--------------------------------------------------------------------------------------------------
+//   PRINT, STREAM
+//--------------------------------------------------------------------------------------------------
+
+class Print {
+  public: virtual ~ Print (void) {}
+  public: virtual size_t write (uint8_t inByte) = 0 ;
+  public: virtual size_t write (const uint8_t * inBuffer, size_t inSize) {
+    size_t n = 0 ;
+    for (size_t i=0 ; i<inSize ; i++) {
+      n += write (inBuffer [i]) ;
+    }
+    return n ;
+  }
+  public: virtual int availableForWrite (void) { return 0 ; }
+} ;
+
+class Stream : public Print {
+  public: virtual int available (void) = 0 ;
+  public: virtual int read (void) = 0 ;
+  public: virtual int peek (void) = 0 ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -12,6 +12,14 @@
 
 #include <ACANFD_FeatherM4CAN_Settings.h>
 #include <ACANFD_FeatherM4CAN_FIFO.h>
+#include <ACANFD_FeatherM4CAN_BusStatistics.h>
+#include <ACANFD_FeatherM4CAN_Codec.h>
+#include <ACANFD_FeatherM4CAN_GatewayRoutes.h>
+#include <ACANFD_FeatherM4CAN_TraceLogger.h>
+#include <ACANFD_FeatherM4CAN_MessageRamArena.h>
+#include <ACANFD_FeatherM4CAN_MergedReceiveStream.h>
+#include <ACANFD_FeatherM4CAN_TrafficStatistics.h>
+#include <ACANFD_FeatherM4CAN_TransmitRing.h>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -19,6 +27,11 @@ enum class ACANFD_FeatherM4CAN_Module { can0, can1 } ;
 
 //--------------------------------------------------------------------------------------------------
 
+class ACANFD_FeatherM4CAN_ISOTP ;
+class ACANFD_FeatherM4CAN_E2E ;
+
+//--------------------------------------------------------------------------------------------------
+
 class ACANFD_FeatherM4CAN {
 
 //--------------------------------------------------------------------------------------------------
@@ -175,9 +188,20 @@ class ACANFD_FeatherM4CAN {
 //--------------------------------------------------------------------------------------------------
 
 //--- Constructor
+//    inDMAChannel: DMAC channel used for copying frames between message RAM and driver FIFOs,
+//    NO_DMA_CHANNEL for copying by CPU (see CAN0_DMA_CHANNEL and CAN1_DMA_CHANNEL in ACANFD_FeatherM4CAN.h)
+  public: static const uint8_t NO_DMA_CHANNEL = 255 ;
+
   public: ACANFD_FeatherM4CAN (const ACANFD_FeatherM4CAN_Module inModule,
                                uint32_t * inMessageRAMPtr,
-                               const uint32_t inMessageRamWordSize) ;
+                               const uint32_t inMessageRamWordSize,
+                               const uint8_t inDMAChannel = NO_DMA_CHANNEL) ;
+
+//--- Constructor, message RAM is allocated from inArena by beginFD (see CAN_MESSAGE_RAM_ARENA_SIZE
+//    in ACANFD_FeatherM4CAN.h)
+  public: ACANFD_FeatherM4CAN (const ACANFD_FeatherM4CAN_Module inModule,
+                               ACANFD_FeatherM4CAN_MessageRamArena & inArena,
+                               const uint8_t inDMAChannel = NO_DMA_CHANNEL) ;
 
 //--- begin; returns a result code :
 //  0 : Ok
@@ -192,6 +216,8 @@ class ACANFD_FeatherM4CAN {
   public: static const uint32_t kHardwareRxFIFO1SizeGreaterThan64      = 1 << 27 ;
   public: static const uint32_t kStandardFilterCountGreaterThan128     = 1 << 28 ;
   public: static const uint32_t kExtendedFilterCountGreaterThan128     = 1 << 29 ;
+  public: static const uint32_t kInvalidDMAChannel                     = 1 << 30 ;
+  public: static const uint32_t kInvalidInterruptSettings              = 1U << 31 ;
 
   public: uint32_t beginFD (const ACANFD_FeatherM4CAN_Settings & inSettings,
                             const StandardFilters & inStandardFilters = StandardFilters (),
@@ -203,6 +229,50 @@ class ACANFD_FeatherM4CAN {
 //--- Getting Message RAM required minimum size
   public: uint32_t messageRamRequiredMinimumSize (void) ;
 
+//--- Message RAM layout, computed by beginFD (even if it fails): sections are contiguous, in this
+//    order, from mStart (nullptr if no message RAM could be allocated). Offsets and sizes are in
+//    32-bit words.
+  public: class MessageRamSection {
+    public: uint16_t mWordOffset = 0 ;
+    public: uint16_t mWordCount = 0 ;
+  } ;
+
+  public: class MessageRamLayout {
+    public: uint32_t * mStart = nullptr ;
+    public: MessageRamSection mStandardFilters ;
+    public: MessageRamSection mExtendedFilters ;
+    public: MessageRamSection mRxFIFO0 ;
+    public: MessageRamSection mRxFIFO1 ;
+    public: MessageRamSection mTxBuffers ;
+
+    public: inline uint32_t wordCount (void) const {
+      return uint32_t (mTxBuffers.mWordOffset) + mTxBuffers.mWordCount ;
+    }
+  } ;
+
+  public: inline const MessageRamLayout & messageRamLayout (void) const { return mMessageRamLayout ; }
+
+//--- Live reconfiguration, after a successful beginFD: bit timings, transceiver delay compensation,
+//    module mode, retransmission, bus off recovery policy and driver FIFOs (sizes, overflow
+//    policies, high water marks) are changed, without releasing message RAM nor driver FIFOs:
+//    - frames of driver FIFOs are kept; when a FIFO shrinks, its newest frames that do not fit are
+//      dropped, and counted as overflows;
+//    - hardware Tx FIFO requests that have not been sent are cancelled, and written back at the
+//      head of driver transmit FIFO; requested dedicated Tx buffers are requested again;
+//    - hardware Rx FIFOs are emptied into driver receive FIFOs (a frame being received is lost).
+//    Message RAM layout (hardware FIFO sizes, payloads and modes, classic CAN 2.0B only setting),
+//    filters, global filter configuration and interrupt settings are those given to beginFD.
+//    Returns 0 if ok (otherwise the controller is not changed):
+  public: static const uint32_t kControllerNotStarted    = 1 << 18 ;
+  public: static const uint32_t kMessageRamLayoutChanged = 1 << 19 ;
+
+  public: uint32_t reconfigure (const ACANFD_FeatherM4CAN_Settings & inSettings) ;
+
+//--- end: stops controller (pending transmit requests are lost), disables its interrupts, DMA,
+//    pins and clocks, frees driver FIFOs and releases message RAM to its arena. Gateway, ISO-TP,
+//    E2E, merged receive stream and transmit ring are removed. Then only beginFD can be called.
+  public: void end (void) ;
+
 //--- Testing send buffer
   public: bool sendBufferNotFullForIndex (const uint32_t inTxBufferIndex) ;
 
@@ -212,13 +282,43 @@ class ACANFD_FeatherM4CAN {
   public: static const uint32_t kTransmitBufferIndexTooLarge = 2 ;
   public: static const uint32_t kTransmitBufferOverflow      = 3 ;
 
-  public: inline uint32_t transmitFIFOSize (void) const { return mDriverTransmitFIFO.size () ; }
-  public: inline uint32_t transmitFIFOCount (void) const { return mDriverTransmitFIFO.count () ; }
-  public: inline uint32_t transmitFIFOPeakCount (void) const { return mDriverTransmitFIFO.peakCount () ; }
+//--- Timed transmission through a dedicated Tx buffer (inMessageIndex: 1 ... dedicated Tx buffer
+//    count, as CANFDMessage::idx): prepareDedicatedTxBuffer writes the frame into the buffer without
+//    requesting its transmission, it returns false if the buffer does not exist or is pending, or
+//    if the message is invalid; requestDedicatedTxBuffer only writes TXBAR (interrupt service
+//    routine), it returns false if the buffer does not exist.
+  public: bool prepareDedicatedTxBuffer (const CANFDMessage & inMessage, const uint32_t inMessageIndex) ;
+  public: bool requestDedicatedTxBuffer (const uint32_t inMessageIndex) ;
+
+//--- Driver FIFO accessors: in classic CAN 2.0B mode, FIFOs of CANFDMessage have a zero size,
+//    otherwise FIFOs of CANMessage have a zero size.
+  public: inline uint32_t transmitFIFOSize (void) const {
+    return mDriverTransmitFIFO.size () + mDriverClassicTransmitFIFO.size () ;
+  }
+  public: inline uint32_t transmitFIFOCount (void) const {
+    return mDriverTransmitFIFO.count () + mDriverClassicTransmitFIFO.count () ;
+  }
+  public: inline uint32_t transmitFIFOPeakCount (void) const {
+    return mDriverTransmitFIFO.peakCount () + mDriverClassicTransmitFIFO.peakCount () ;
+  }
+  public: inline uint32_t transmitFIFOOverflowCount (void) const {
+    return mDriverTransmitFIFO.overflowCount () + mDriverClassicTransmitFIFO.overflowCount () ;
+  }
   public: inline ACANFD_FeatherM4CAN_Settings::Payload hardwareTxBufferPayload (void) const {
     return mHardwareTxBufferPayload ;
   }
 
+//--- Classic CAN 2.0B frames: in classic mode (mClassicCAN20BOnly setting), they are stored as is
+//    in driver FIFOs; otherwise they are converted to / from CANFDMessage. In CANFD mode,
+//    receive0 / receive1 return false if the next received frame is a CANFD frame (it is kept,
+//    get it with receiveFD0 / receiveFD1).
+  public: uint32_t tryToSendReturnStatus (const CANMessage & inMessage) ;
+  public: inline bool tryToSend (const CANMessage & inMessage) { return tryToSendReturnStatus (inMessage) == 0 ; }
+  public: bool receive0 (CANMessage & outMessage) ;
+  public: bool receive1 (CANMessage & outMessage) ;
+  public: inline bool receive (CANMessage & outMessage) { return receive0 (outMessage) || receive1 (outMessage) ; }
+  public: inline bool isClassicCAN20BOnly (void) const { return mClassicCAN20BOnly ; }
+
 //--- Receiving messages
   public: bool availableFD0 (void) ;
   public: bool receiveFD0 (CANFDMessage & outMessage) ;
@@ -228,37 +328,433 @@ class ACANFD_FeatherM4CAN {
   public: bool dispatchReceivedMessageFIFO0 (void) ;
   public: bool dispatchReceivedMessageFIFO1 (void) ;
 
+//--- Budgeted dispatch: frames are dispatched from driver receive FIFOs by weighted round robin
+//    (up to inFIFO0Weight frames from FIFO 0, then up to inFIFO1Weight frames from FIFO 1, and so
+//    on), until both FIFOs are empty, or inMaxFrameCount frames have been dispatched, or
+//    inMaxDuration µs have elapsed (checked after each frame). 0 budget means no limit; a 0 weight
+//    means the FIFO is served only when the other one is empty (strict priority).
+  public: class DispatchResult {
+    public: uint32_t mDispatchedFIFO0Count = 0 ;
+    public: uint32_t mDispatchedFIFO1Count = 0 ;
+    public: uint32_t mPendingFIFO0Count = 0 ; // Frames left in driver receive FIFOs on return
+    public: uint32_t mPendingFIFO1Count = 0 ;
+    public: uint32_t mElapsedDuration = 0 ; // In µs
+    public: inline uint32_t dispatchedCount (void) const { return mDispatchedFIFO0Count + mDispatchedFIFO1Count ; }
+    public: inline uint32_t pendingCount (void) const { return mPendingFIFO0Count + mPendingFIFO1Count ; }
+  } ;
+
+  public: DispatchResult dispatchReceivedMessages (const uint32_t inMaxDuration,
+                                                   const uint32_t inMaxFrameCount = 0,
+                                                   const uint8_t inFIFO0Weight = 1,
+                                                   const uint8_t inFIFO1Weight = 1) ;
+
 //--- Driver Transmit buffer
   private: ACANFD_FeatherM4CAN_FIFO mDriverTransmitFIFO ;
+  private: ACANFD_FeatherM4CAN_ClassicFIFO mDriverClassicTransmitFIFO ;
 
 //--- Driver receive FIFO 0
   private: ACANFD_FeatherM4CAN_FIFO mDriverReceiveFIFO0 ;
-  public: uint32_t driverReceiveFIFO0Size (void) { return mDriverReceiveFIFO0.size () ; }
-  public: uint32_t driverReceiveFIFO0Count (void) { return mDriverReceiveFIFO0.count () ; }
-  public: uint32_t driverReceiveFIFO0PeakCount (void) { return mDriverReceiveFIFO0.peakCount () ; }
-  public: void resetDriverReceiveFIFO0PeakCount (void) { mDriverReceiveFIFO0.resetPeakCount () ; }
+  private: ACANFD_FeatherM4CAN_ClassicFIFO mDriverClassicReceiveFIFO0 ;
+  public: uint32_t driverReceiveFIFO0Size (void) {
+    return mDriverReceiveFIFO0.size () + mDriverClassicReceiveFIFO0.size () ;
+  }
+  public: uint32_t driverReceiveFIFO0Count (void) {
+    return mDriverReceiveFIFO0.count () + mDriverClassicReceiveFIFO0.count () ;
+  }
+  public: uint32_t driverReceiveFIFO0PeakCount (void) {
+    return mDriverReceiveFIFO0.peakCount () + mDriverClassicReceiveFIFO0.peakCount () ;
+  }
+  public: void resetDriverReceiveFIFO0PeakCount (void) {
+    mDriverReceiveFIFO0.resetPeakCount () ;
+    mDriverClassicReceiveFIFO0.resetPeakCount () ;
+  }
+  public: uint32_t driverReceiveFIFO0OverflowCount (void) {
+    return mDriverReceiveFIFO0.overflowCount () + mDriverClassicReceiveFIFO0.overflowCount () ;
+  }
+  public: uint32_t hardwareRxFIFO0LostCount (void) { return mHardwareRxFIFO0LostCount ; }
   public: inline ACANFD_FeatherM4CAN_Settings::Payload hardwareRxFIFO0Payload (void) const {
     return mHardwareRxFIFO0Payload ;
   }
 
 //--- Driver receive FIFO 1
   private: ACANFD_FeatherM4CAN_FIFO mDriverReceiveFIFO1 ;
-  public: uint32_t driverReceiveFIFO1Size (void) { return mDriverReceiveFIFO1.size () ; }
-  public: uint32_t driverReceiveFIFO1Count (void) { return mDriverReceiveFIFO1.count () ; }
-  public: uint32_t driverReceiveFIFO1PeakCount (void) { return mDriverReceiveFIFO1.peakCount () ; }
-  public: void resetDriverReceiveFIFO1PeakCount (void) { mDriverReceiveFIFO1.resetPeakCount () ; }
+  private: ACANFD_FeatherM4CAN_ClassicFIFO mDriverClassicReceiveFIFO1 ;
+  public: uint32_t driverReceiveFIFO1Size (void) {
+    return mDriverReceiveFIFO1.size () + mDriverClassicReceiveFIFO1.size () ;
+  }
+  public: uint32_t driverReceiveFIFO1Count (void) {
+    return mDriverReceiveFIFO1.count () + mDriverClassicReceiveFIFO1.count () ;
+  }
+  public: uint32_t driverReceiveFIFO1PeakCount (void) {
+    return mDriverReceiveFIFO1.peakCount () + mDriverClassicReceiveFIFO1.peakCount () ;
+  }
+  public: void resetDriverReceiveFIFO1PeakCount (void) {
+    mDriverReceiveFIFO1.resetPeakCount () ;
+    mDriverClassicReceiveFIFO1.resetPeakCount () ;
+  }
+  public: uint32_t driverReceiveFIFO1OverflowCount (void) {
+    return mDriverReceiveFIFO1.overflowCount () + mDriverClassicReceiveFIFO1.overflowCount () ;
+  }
+  public: uint32_t hardwareRxFIFO1LostCount (void) { return mHardwareRxFIFO1LostCount ; }
   public: inline ACANFD_FeatherM4CAN_Settings::Payload hardwareRxFIFO1Payload (void) const {
     return mHardwareRxFIFO1Payload ;
   }
 
+//--- Loss accounting: software overflows of driver FIFOs, messages lost by hardware Rx FIFOs
+  public: void resetLossCounts (void) ;
+  private: volatile uint32_t mHardwareRxFIFO0LostCount = 0 ;
+  private: volatile uint32_t mHardwareRxFIFO1LostCount = 0 ;
+
+//--- Hardware Rx FIFOs in overwrite mode (bit 0: Rx FIFO 0, bit 1: Rx FIFO 1); in this mode, the
+//    get index following the last released element, for counting overwritten elements
+  private: uint8_t mHardwareRxFIFOOverwriteMask = 0 ;
+  private: uint8_t mHardwareRxFIFONextGetIndex [2] = {0, 0} ;
+
+//--- Error handling
+  public: class ErrorStatistics {
+  //--- Indexed by LEC / DLEC value of PSR register (page 1131):
+  //    1: stuff error, 2: form error, 3: ack error, 4: bit1 error, 5: bit0 error, 6: CRC error
+    public: uint32_t mArbitrationPhaseErrorCount [8] = {0, 0, 0, 0, 0, 0, 0, 0} ;
+    public: uint32_t mDataPhaseErrorCount [8] = {0, 0, 0, 0, 0, 0, 0, 0} ;
+    public: uint32_t mErrorWarningCount = 0 ;
+    public: uint32_t mErrorPassiveCount = 0 ;
+    public: uint32_t mBusOffCount = 0 ;
+    public: uint32_t mBusOffRecoveryCount = 0 ;
+    public: uint32_t mBusOffDuration = 0 ; // Cumulated, in ms
+  } ;
+
+  public: ErrorStatistics errorStatistics (void) ;
+  public: void resetErrorStatistics (void) ;
+  public: bool isBusOff (void) const { return mBusOff ; }
+  public: void recoverFromBusOff (void) ;
+  public: void pollBusOffRecovery (void) ;
+
+//--- Pausing transmission: frames are kept in driver transmit FIFO, and are sent on resume.
+//    Transmission is automatically paused while the controller is bus off.
+  public: void pauseTransmission (void) ;
+  public: void resumeTransmission (void) ;
+  public: bool transmissionIsPaused (void) const { return mTransmissionPaused || mBusOff ; }
+
+//--- Bus load statistics (enabled by mEnableBusStatistics setting)
+  public: ACANFD_FeatherM4CAN_BusStatistics::Snapshot busStatistics (void) ;
+
+//--- Automatic bit rate detection, for a controller started by beginFD. The controller is switched
+//    to bus monitoring mode, and the bit timings of candidates are tried in order: only NBTP, DBTP
+//    and TDCR registers are written, message RAM and driver FIFOs are unchanged. A candidate is
+//    locked as soon as inRequiredFrameCount frames are received without protocol error; it is
+//    rejected on the first protocol error (LEC / DLEC of PSR register, page 1131), or when
+//    inDwellTime ms have elapsed without lock. Detection lasts at most
+//    inCandidateCount * inDwellTime ms; call pollBitRateDetection from loop until it returns
+//    BIT_RATE_DETECTION_LOCKED or BIT_RATE_DETECTION_FAILED.
+//    On lock, the controller is switched to inLockedMode, and protocol errors counted while wrong
+//    candidates were tried are removed from error statistics. On failure, the bit timing and the
+//    mode the controller had before detection are restored, and error statistics too.
+//    Only bit timing settings of candidates are used; a candidate whose mBitSettingOk is false is
+//    skipped. Candidates array should remain valid until detection ends.
+//    The data bit rate is checked only by frames with bit rate switch: candidates that differ only
+//    by data bit rate are not distinguished by other frames, the first one is locked, and
+//    dataBitRateVerified returns false.
+//    beginBitRateDetection returns 0 if detection has started; otherwise the controller and the
+//    detection state are not changed: kControllerNotStarted (before beginFD, or after end),
+//    kTDCCalibrationRunning, or kBitRateDetectionRunning. As both procedures save and write the
+//    controller bit timing and mode, beginTDCCalibration also returns these two errors.
+  public: typedef enum : uint8_t {
+    BIT_RATE_DETECTION_IDLE,
+    BIT_RATE_DETECTION_RUNNING,
+    BIT_RATE_DETECTION_LOCKED,
+    BIT_RATE_DETECTION_FAILED
+  } BitRateDetectionState ;
+
+  public: static const uint8_t NO_BIT_RATE_CANDIDATE = 255 ;
+
+  public: static const uint32_t kTDCCalibrationRunning   = 1 << 15 ;
+  public: static const uint32_t kBitRateDetectionRunning = 1 << 16 ;
+
+  public: uint32_t beginBitRateDetection (const ACANFD_FeatherM4CAN_Settings * inCandidates,
+                                          const uint8_t inCandidateCount,
+                                          const uint32_t inDwellTime,
+                                          const uint8_t inRequiredFrameCount = 2,
+                                          const ACANFD_FeatherM4CAN_Settings::ModuleMode inLockedMode = ACANFD_FeatherM4CAN_Settings::NORMAL_FD) ;
+  public: BitRateDetectionState pollBitRateDetection (void) ;
+  public: inline BitRateDetectionState bitRateDetectionState (void) const { return mBitRateDetectionState ; }
+//--- NO_BIT_RATE_CANDIDATE while not locked
+  public: inline uint8_t lockedBitRateCandidateIndex (void) const {
+    return (mBitRateDetectionState == BIT_RATE_DETECTION_LOCKED) ? mBitRateCandidateIndex : NO_BIT_RATE_CANDIDATE ;
+  }
+  public: inline bool dataBitRateVerified (void) const { return mDataBitRateVerified ; }
+  public: inline uint32_t bitRateDetectionDuration (void) const { return mBitRateDetectionDuration ; } // In ms
+  private: void startBitRateCandidate (void) ;
+  private: void endBitRateDetection (const BitRateDetectionState inState) ;
+  private: const ACANFD_FeatherM4CAN_Settings * mBitRateCandidates = nullptr ;
+  private: ErrorStatistics mBitRateDetectionErrorStatistics ; // Before detection
+  private: uint32_t mBitRateSavedCCCR = 0 ; // Controller configuration before detection
+  private: uint32_t mBitRateSavedTEST = 0 ;
+  private: uint32_t mBitRateSavedNBTP = 0 ;
+  private: uint32_t mBitRateSavedDBTP = 0 ;
+  private: uint32_t mBitRateSavedTDCR = 0 ;
+  private: uint32_t mBitRateSavedNominalBitClockCount = 0 ;
+  private: uint32_t mBitRateDetectionStartDate = 0 ; // In ms
+  private: uint32_t mBitRateCandidateStartDate = 0 ; // In ms
+  private: uint32_t mBitRateDetectionDwellTime = 0 ; // In ms
+  private: uint32_t mBitRateDetectionDuration = 0 ; // In ms
+  private: uint32_t mBitRateCandidateErrorCount = 0 ; // Protocol error count when candidate started
+  private: uint32_t mBitRateCandidateFrameCount = 0 ; // mReceivedFrameCount when candidate started
+  private: uint32_t mBitRateCandidateBRSFrameCount = 0 ; // mReceivedBRSFrameCount when candidate started
+  private: volatile uint32_t mReceivedFrameCount = 0 ; // Every received frame, even if it is not stored
+  private: volatile uint32_t mReceivedBRSFrameCount = 0 ; // Received frames with bit rate switch
+  private: volatile BitRateDetectionState mBitRateDetectionState = BIT_RATE_DETECTION_IDLE ;
+  private: ACANFD_FeatherM4CAN_Settings::ModuleMode mBitRateLockedMode = ACANFD_FeatherM4CAN_Settings::NORMAL_FD ;
+  private: uint8_t mBitRateCandidateCount = 0 ;
+  private: uint8_t mBitRateCandidateIndex = 0 ;
+  private: uint8_t mBitRateRequiredFrameCount = 0 ;
+  private: bool mDataBitRateVerified = false ;
+
+//--- Transceiver delay compensation calibration, for a controller started by beginFD. Candidates
+//    are tried in order, they should be sorted by increasing data bit rate. For each candidate,
+//    the controller is switched to external loop back mode, with automatic retransmission
+//    disabled, and inFrameCount test frames (CANFD, bit rate switch, 64 bytes, standard
+//    identifier inTestFrameIdentifier) are sent for each tested transceiver delay compensation
+//    offset (TDCO, page 1134):
+//      - the first tested offset is derived from the candidate: the data phase sample point, in
+//        CAN clock periods; the transceiver loop delay is then measured (TDCV field of PSR
+//        register, page 1131, minus TDCO);
+//      - the offset is increased, then decreased, until a test frame fails: the calibrated
+//        offset is the middle of the error free window, the filter window length (TDCF) is the
+//        calibrated offset plus half the measured delay.
+//    Calibration stops at the first candidate whose derived offset fails, at bus off, or when all
+//    candidates have been tried. The result is the last error free candidate, that is the highest
+//    error free data bit rate; copy it into the settings given to beginFD, with
+//    calibratedTDCOffset () as mTransceiverDelayCompensation and calibratedTDCFilter () as
+//    mTransceiverDelayCompensationFilter. Call pollTDCCalibration from loop until it returns
+//    TDC_CALIBRATION_DONE or TDC_CALIBRATION_FAILED.
+//    At the end, the bit timing and mode of the controller are restored, and protocol errors of
+//    failed test frames are removed from error statistics. Test frames are sent on the bus, and
+//    received as any frame (reject inTestFrameIdentifier by filters, or discard them). Do not send
+//    frames while calibration is running. Candidates array should remain valid until calibration
+//    ends.
+//    beginTDCCalibration returns 0 if calibration has started; otherwise the controller and the
+//    calibration state are not changed: kControllerNotStarted, kTDCCalibrationNeedsCANFD for a
+//    controller started in classic CAN 2.0B only mode (mClassicCAN20BOnly setting),
+//    kBitRateDetectionRunning, or kTDCCalibrationRunning.
+  public: typedef enum : uint8_t {
+    TDC_CALIBRATION_IDLE,
+    TDC_CALIBRATION_RUNNING,
+    TDC_CALIBRATION_DONE,
+    TDC_CALIBRATION_FAILED // No error free candidate
+  } TDCCalibrationState ;
+
+  public: static const uint8_t NO_CALIBRATED_CANDIDATE = 255 ;
+
+  public: static const uint32_t kTDCCalibrationNeedsCANFD = 1 << 17 ;
+
+  public: uint32_t beginTDCCalibration (const ACANFD_FeatherM4CAN_Settings * inCandidates,
+                                        const uint8_t inCandidateCount,
+                                        const uint8_t inFrameCount = 4,
+                                        const uint16_t inTestFrameIdentifier = 0x7FF) ;
+  public: TDCCalibrationState pollTDCCalibration (void) ;
+  public: inline TDCCalibrationState tdcCalibrationState (void) const { return mTDCCalibrationState ; }
+//--- Results, valid when state is TDC_CALIBRATION_DONE; offsets and delay in CAN clock periods
+  public: inline uint8_t calibratedCandidateIndex (void) const {
+    return (mTDCCalibrationState == TDC_CALIBRATION_DONE) ? mTDCResultCandidateIndex : NO_CALIBRATED_CANDIDATE ;
+  }
+  public: inline uint8_t calibratedTDCOffset (void) const { return mTDCResultOffset ; }
+  public: inline uint8_t calibratedTDCFilter (void) const { return mTDCResultFilter ; }
+  public: inline uint8_t calibratedTDCMinOffset (void) const { return mTDCResultMinOffset ; } // Error free window
+  public: inline uint8_t calibratedTDCMaxOffset (void) const { return mTDCResultMaxOffset ; }
+  public: inline uint8_t measuredTransceiverDelay (void) const { return mTDCResultDelay ; }
+  private: void startTDCCandidate (void) ;
+  private: void applyTDCOffset (void) ;
+  private: void sendTDCTestFrame (void) ;
+  private: void handleTDCTestResult (const bool inErrorFree) ;
+  private: void endTDCCalibration (void) ;
+  private: const ACANFD_FeatherM4CAN_Settings * mTDCCandidates = nullptr ;
+  private: ErrorStatistics mTDCErrorStatistics ; // Before calibration
+  private: uint32_t mTDCSavedCCCR = 0 ; // Controller configuration before calibration
+  private: uint32_t mTDCSavedTEST = 0 ;
+  private: uint32_t mTDCSavedNBTP = 0 ;
+  private: uint32_t mTDCSavedDBTP = 0 ;
+  private: uint32_t mTDCSavedTDCR = 0 ;
+  private: uint32_t mTDCSavedNominalBitClockCount = 0 ;
+  private: uint32_t mTDCFrameStartDate = 0 ; // In ms
+  private: uint32_t mTDCFrameErrorCount = 0 ; // Protocol error count when test frame was sent
+  private: volatile TDCCalibrationState mTDCCalibrationState = TDC_CALIBRATION_IDLE ;
+  private: uint16_t mTDCTestFrameIdentifier = 0x7FF ;
+  private: uint8_t mTDCCandidateCount = 0 ;
+  private: uint8_t mTDCCandidateIndex = 0 ;
+  private: uint8_t mTDCFrameCount = 0 ; // Test frames per offset
+  private: uint8_t mTDCSentFrameCount = 0 ; // For current offset
+  private: uint8_t mTDCDerivedOffset = 0 ; // Of current candidate
+  private: uint8_t mTDCOffset = 0 ; // Current offset
+  private: uint8_t mTDCMinOffset = 0 ; // Error free window of current candidate
+  private: uint8_t mTDCMaxOffset = 0 ;
+  private: uint8_t mTDCDelay = 0 ; // Measured for current candidate
+  private: bool mTDCDecreasing = false ; // Offset is increased, then decreased
+  private: uint8_t mTDCResultCandidateIndex = NO_CALIBRATED_CANDIDATE ;
+  private: uint8_t mTDCResultOffset = 0 ;
+  private: uint8_t mTDCResultFilter = 0 ;
+  private: uint8_t mTDCResultMinOffset = 0 ;
+  private: uint8_t mTDCResultMaxOffset = 0 ;
+  private: uint8_t mTDCResultDelay = 0 ;
+
+//--- Sleeping until driver events: waitForEvents puts the core in IDLE sleep mode (WFI) until one
+//    of inEvents has occurred, or inTimeout µs have elapsed (0: no timeout, the timeout is checked
+//    when an interrupt wakes up the core, at least every ms by SysTick). Other interrupts are
+//    serviced while sleeping. Returns the occurred events, 0 on timeout.
+//    kEventReceiveFIFO0 / 1: driver receive FIFO 0 / 1 is not empty;
+//    kEventTransmitFIFOBelowThreshold: driver transmit FIFO count <= inTransmitFIFOThreshold;
+//    kEventErrorStateChange: error warning, error passive or bus off status has changed since the
+//    event was last returned.
+//    Wake latency is the duration from the end of the interrupt service routine that made an event
+//    occur to the return of waitForEvents; it is measured with the DWT cycle counter, only if the
+//    core has been sleeping.
+  public: static const uint32_t kEventReceiveFIFO0               = 1 << 0 ;
+  public: static const uint32_t kEventReceiveFIFO1               = 1 << 1 ;
+  public: static const uint32_t kEventTransmitFIFOBelowThreshold = 1 << 2 ;
+  public: static const uint32_t kEventErrorStateChange           = 1 << 3 ;
+
+  public: uint32_t waitForEvents (const uint32_t inEvents,
+                                  const uint32_t inTimeout = 0,
+                                  const uint16_t inTransmitFIFOThreshold = 0) ;
+
+  public: class WakeStatistics {
+    public: uint32_t mWaitCount = 0 ; // waitForEvents calls
+    public: uint32_t mSleepCount = 0 ; // WFI executions
+    public: uint32_t mTimeoutCount = 0 ;
+    public: uint32_t mWakeCount = 0 ; // Events that occurred while sleeping (latency is measured)
+    public: uint32_t mMinWakeLatency = UINT32_MAX ; // In ns
+    public: uint32_t mMaxWakeLatency = 0 ; // In ns
+    public: uint64_t mWakeLatencySum = 0 ; // In ns
+    public: inline uint32_t averageWakeLatency (void) const { // In ns
+      return (mWakeCount == 0) ? 0 : uint32_t (mWakeLatencySum / mWakeCount) ;
+    }
+  } ;
+
+  public: WakeStatistics wakeStatistics (void) ;
+  public: void resetWakeStatistics (void) ;
+  private: uint32_t occurredEvents (const uint32_t inEvents) const ;
+  private: void noteWaitedEvents (void) ;
+  private: WakeStatistics mWakeStatistics ;
+  private: volatile uint32_t mWaitedEvents = 0 ; // Not 0 while waitForEvents is sleeping
+  private: volatile uint32_t mWaitedEventDate = 0 ; // DWT cycle counter
+  private: uint16_t mTransmitFIFOWakeThreshold = 0 ;
+  private: volatile bool mErrorStateChanged = false ;
+
+//--- DMA copy: frames are copied between message RAM and driver FIFOs by the DMAC, at most
+//    DMA_MAX_ELEMENT_COUNT frames per transfer. DMA is disabled if a transfer error occurs.
+  public: inline bool usesDMA (void) const { return mDMAEnabled ; }
+  public: void dmaInterruptServiceRoutine (void) ;
+  private: static const uint32_t DMA_MAX_ELEMENT_COUNT = 8 ;
+  private: enum DMAState : uint8_t { DMA_IDLE, DMA_RECEIVE_FIFO0, DMA_RECEIVE_FIFO1, DMA_TRANSMIT } ;
+  private: DmacDescriptor * mDMAFirstDescriptor = nullptr ; // In DMAC descriptor table
+  private: DmacDescriptor * mDMALinkedDescriptors = nullptr ; // DMA_MAX_ELEMENT_COUNT - 1 descriptors
+  private: uint8_t mDMATxBufferIndexes [DMA_MAX_ELEMENT_COUNT] ;
+  private: const uint8_t mDMAChannel ;
+  private: bool mDMAEnabled = false ;
+  private: volatile DMAState mDMAState = DMA_IDLE ;
+  private: uint8_t mDMAElementCount = 0 ;
+  private: uint8_t mDMARxFIFOAcknowledgeIndex = 0 ;
+  private: uint8_t mDMADeferredRxFIFOMask = 0 ; // Bit 0: Rx FIFO 0, bit 1: Rx FIFO 1
+  private: bool mDMATransmitRequested = false ;
+  private: bool mDMALastTransferWasReception = false ;
+
+//--- Gateway: frames received by this controller are routed by inRoutes, forwarded frames are
+//    sent by inTarget, from this controller interrupt service routine. inRoutes should remain valid
+//    while the gateway is set (declare it as a global variable). While a gateway is set, received
+//    frames are copied by CPU (DMA is still used for transmission).
+//    A forwarded frame is lost if the target controller is in classic CAN 2.0B mode and the frame
+//    is a CANFD frame, if it cannot be enqueued in target driver transmit FIFO, or if the target
+//    controller is not started.
+  public: void setGateway (ACANFD_FeatherM4CAN & inTarget, const ACANFD_FeatherM4CAN_GatewayRoutes & inRoutes) ;
+  public: void removeGateway (void) ;
+  public: inline uint32_t gatewayForwardedCount (void) const { return mGatewayForwardedCount ; }
+  public: inline uint32_t gatewayLostCount (void) const { return mGatewayLostCount ; }
+  public: void resetGatewayCounts (void) ;
+  private: ACANFD_FeatherM4CAN * mGatewayTarget = nullptr ;
+  private: const ACANFD_FeatherM4CAN_GatewayRoutes * mGatewayRoutes = nullptr ;
+  private: volatile uint32_t mGatewayForwardedCount = 0 ;
+  private: volatile uint32_t mGatewayLostCount = 0 ;
+
+//--- ISO-TP: frames with an ISO-TP channel receive identifier are handled by inISOTP, from
+//    interrupt service routine; they are not routed by gateway, nor entered in driver receive
+//    FIFOs. While an ISO-TP engine is set, received frames are copied by CPU.
+  public: void setISOTP (ACANFD_FeatherM4CAN_ISOTP & inISOTP) ;
+  public: void removeISOTP (void) ;
+  private: ACANFD_FeatherM4CAN_ISOTP * mISOTP = nullptr ;
+
+//--- Trace: every received frame is recorded by inLogger, from interrupt service routine (before
+//    it is handled by ISO-TP engine or gateway)
+  public: void setTraceLogger (ACANFD_FeatherM4CAN_TraceLogger & inLogger) ;
+  public: void removeTraceLogger (void) ;
+  private: ACANFD_FeatherM4CAN_TraceLogger * mTraceLogger = nullptr ;
+
+//--- Traffic statistics: every received frame is recorded by inStatistics, per identifier and per
+//    filter index, from interrupt service routine (before it is handled by E2E module, ISO-TP engine
+//    or gateway)
+  public: void setTrafficStatistics (ACANFD_FeatherM4CAN_TrafficStatistics & inStatistics) ;
+  public: void removeTrafficStatistics (void) ;
+  private: ACANFD_FeatherM4CAN_TrafficStatistics * mTrafficStatistics = nullptr ;
+
+//--- Transmit ring: frames sent to the Tx FIFO (idx is 0) are appended to inRing, interrupts
+//    enabled, and written into the hardware Tx FIFO by the CAN interrupt service routine, in
+//    reservation order; several interrupt service routines and the loop can send concurrently.
+//    Frames of the ring are not counted by driver transmit FIFO accessors, and are copied by CPU.
+//    Frames remaining in the ring when it is removed are not sent. Sending through the ring a frame
+//    to a controller that is not started returns kControllerNotStarted.
+  public: void setTransmitRing (ACANFD_FeatherM4CAN_TransmitRing & inRing) ;
+  public: void removeTransmitRing (void) ;
+  private: uint32_t sendThroughTransmitRing (const CANFDMessage & inMessage) ;
+  private: void writeTransmitRingIntoHardwareTxFIFO (const bool inPreemptible) ;
+  private: ACANFD_FeatherM4CAN_TransmitRing * mTransmitRing = nullptr ;
+
+//--- End-to-end protection: frames received by protected filters are checked by inE2E, from
+//    interrupt service routine (after trace, before ISO-TP engine and gateway), rejected frames are
+//    discarded; sent frames with a protected identifier are stamped when written into message RAM.
+//    While an E2E module is set, received frames are copied by CPU.
+  public: void setE2E (ACANFD_FeatherM4CAN_E2E & inE2E) ;
+  public: void removeE2E (void) ;
+  private: ACANFD_FeatherM4CAN_E2E * mE2E = nullptr ;
+
+//--- Merged receive stream: received frames (that are not discarded by E2E module, handled by ISO-TP
+//    engine, or only forwarded by gateway) are entered into inStream, instead of driver receive
+//    FIFOs, with their hardware receive date. Set the same stream to both controllers for getting
+//    frames of CAN0 and CAN1 in arrival order. While a stream is set, received frames are copied by
+//    CPU.
+  public: void setMergedReceiveStream (ACANFD_FeatherM4CAN_MergedReceiveStream & inStream) ;
+  public: void removeMergedReceiveStream (void) ;
+  private: uint32_t receiveDate (const uint32_t * inElement) const ;
+  private: ACANFD_FeatherM4CAN_MergedReceiveStream * mMergedReceiveStream = nullptr ;
+  private: uint32_t mNominalBitClockCount = 1 ; // CAN clock cycles per nominal bit (timestamp counter tick)
+
+//--- Received frames are inspected by CPU if a gateway, an ISO-TP engine, an E2E module or a merged
+//    receive stream is set; they are copied by CPU if a hardware Rx FIFO is in overwrite mode
+  private: inline bool receptionUsesDMA (void) const {
+    return mDMAEnabled && (mGatewayTarget == nullptr) && (mISOTP == nullptr) && (mE2E == nullptr)
+      && (mMergedReceiveStream == nullptr) && (mHardwareRxFIFOOverwriteMask == 0) ;
+  }
+
+//--- Controller interrupt
+  public: inline IRQn_Type interruptNumber (void) const {
+    return (mModule == ACANFD_FeatherM4CAN_Module::can0) ? CAN0_IRQn : CAN1_IRQn ;
+  }
+
+//--- Interrupt line 1, serviced by line1InterruptServiceRoutine if mInterruptLine1IRQ setting is
+//    set: the CAN interrupt service routine disables EINT1 and pends this IRQ, EINT1 is enabled
+//    again when its flags have been handled. Interrupts are disabled while an event is handled, and
+//    enabled between frames written from driver transmit FIFO into hardware Tx FIFO.
+  public: void line1InterruptServiceRoutine (void) ;
+  private: uint32_t mInterruptLine1Flags = 0 ; // IR flags routed to EINT1
+  private: int16_t mInterruptLine1IRQ = ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ ;
+
 //--- Private properties
   private: Can * mModulePtr ;
   private: uint32_t * mMessageRAMPtr ;
-  public: const uint32_t mMessageRamWordSize ;
+  public: const uint32_t mMessageRamWordSize ; // 0 if message RAM is allocated from an arena
+  private: ACANFD_FeatherM4CAN_MessageRamArena * mMessageRamArena = nullptr ;
+  private: uint32_t mMessageRamArenaBlockSize = 0 ; // Word count of the block allocated from arena
+  private: MessageRamLayout mMessageRamLayout ;
   private: uint32_t * mRxFIFO0Pointer = nullptr ;
   private: uint32_t * mRxFIFO1Pointer = nullptr ;
   private: uint32_t * mTxBuffersPointer = nullptr ;
-  private: uint32_t * mEndOfMessageRamPointer = nullptr ;
   private: DynamicArray < ACANFDCallBackRoutine > mStandardFilterCallBackArray ;
   private: DynamicArray < ACANFDCallBackRoutine > mExtendedFilterCallBackArray ;
   private: ACANFDCallBackRoutine mNonMatchingStandardMessageCallBack = nullptr ;
@@ -266,12 +762,58 @@ class ACANFD_FeatherM4CAN {
   private: ACANFD_FeatherM4CAN_Settings::Payload mHardwareRxFIFO0Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES ;
   private: ACANFD_FeatherM4CAN_Settings::Payload mHardwareRxFIFO1Payload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES ;
   private: ACANFD_FeatherM4CAN_Settings::Payload mHardwareTxBufferPayload = ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES ;
+  private: ACANFD_FeatherM4CAN_Codec::Decoder mRxFIFO0Decoder = nullptr ;
+  private: ACANFD_FeatherM4CAN_Codec::Decoder mRxFIFO1Decoder = nullptr ;
+  private: ACANFD_FeatherM4CAN_Codec::Encoder mTxBufferEncoder = nullptr ;
+  private: uint8_t mRxFIFO0ElementWordCount = 18 ;
+  private: uint8_t mRxFIFO1ElementWordCount = 18 ;
+  private: uint8_t mTxBufferElementWordCount = 18 ;
   private: ACANFD_FeatherM4CAN_Module mModule ;
+  private: ACANFD_FeatherM4CAN_BusStatistics mBusStatistics ;
+  private: ErrorStatistics mErrorStatistics ;
+  private: uint32_t mBusOffDate = 0 ; // In ms
+  private: uint32_t mBusOffRecoveryDelay = 0 ; // In ms
+  private: uint32_t mBusOffRecoveryInitialDelay = 0 ; // In ms
+  private: uint32_t mBusOffRecoveryMaximumDelay = 0 ; // In ms
+  private: ACANFD_FeatherM4CAN_Settings::BusOffRecoveryPolicy mBusOffRecoveryPolicy = ACANFD_FeatherM4CAN_Settings::BUS_OFF_RECOVERY_MANUAL ;
+  private: volatile bool mBusOff = false ;
+  private: volatile bool mBusOffRecoveryPending = false ;
+  private: volatile bool mTransmissionPaused = false ;
+  private: bool mClassicCAN20BOnly = false ;
 
 //--- Private methods
   public: void interruptServiceRoutine (void) ;
   private: void writeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) ;
+  private: void writeClassicTxBuffer (const CANMessage & inMessage, const uint32_t inTxBufferIndex) ;
+  private: void encodeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) ;
+  private: void encodeClassicTxBuffer (const CANMessage & inMessage, const uint32_t inTxBufferIndex) ;
+  private: void receiveFromHardwareRxFIFO (const uint32_t inFIFOIndex) ;
+  private: void handleRxFIFOElement (const uint32_t inFIFOIndex,
+                                     const uint32_t * inElement,
+                                     const uint32_t inElementWordCount) ;
+  private: void acknowledgeHardwareRxFIFOElement (const uint32_t inFIFOIndex, const uint32_t inElementIndex) ;
+  private: bool forwardRxElement (const uint32_t * inElement, const uint32_t inDataWordCount, const uint32_t inWord0) ;
+  private: void configureDMA (void) ;
+  private: void scheduleDMA (void) ;
+  private: bool startReceiveDMA (const uint32_t inFIFOIndex) ;
+  private: void startTransmitDMA (void) ;
+  private: void startDMATransfer (const uint32_t inDescriptorCount) ;
+  private: DmacDescriptor * dmaDescriptorAtIndex (const uint32_t inIndex) const ;
+  private: void completeReceiveDMA (const uint32_t inFIFOIndex) ;
+  private: void completeTransmitDMA (void) ;
+  private: void abortDMA (void) ;
   private: void internalDispatchReceivedMessage (const CANFDMessage & inMessage) ;
+  private: void serviceInterrupts (const uint32_t inFlagMask, const bool inPreemptible) ;
+  private: void writeDriverTransmitFIFOIntoHardwareTxFIFO (const bool inPreemptible = false) ;
+  private: void handleErrorInterrupts (const uint32_t inIR) ;
+  private: void startBusOffRecoverySequence (void) ;
+  private: void enterConfigurationMode (void) ;
+  private: void leaveConfigurationMode (const uint32_t inCCCR) ;
+  private: void writeBitTiming (const ACANFD_FeatherM4CAN_Settings & inSettings) ;
+  private: uint32_t writeModuleMode (const ACANFD_FeatherM4CAN_Settings::ModuleMode inMode) ;
+  private: void setDriverFIFOPolicies (const ACANFD_FeatherM4CAN_Settings & inSettings) ;
+  private: bool sameMessageRamLayout (const ACANFD_FeatherM4CAN_Settings & inSettings) const ;
+  private: void writeBackCancelledTxFIFORequests (const uint32_t inCancelledRequests, const uint32_t inTXFQS) ;
 
 //--- Status class
   public: class Status {
@@ -281,6 +823,10 @@ class ACANFD_FeatherM4CAN {
     public: inline uint16_t txErrorCount (void) const { return isBusOff () ? 256 : uint8_t (mErrorCount) ; }
     public: inline uint8_t rxErrorCount (void) const { return uint8_t (mErrorCount >> 8) ; }
     public: inline bool isBusOff (void) const { return (mProtocolStatus & (1 << 7)) != 0 ; }
+    public: inline bool isErrorWarning (void) const { return (mProtocolStatus & (1 << 6)) != 0 ; }
+    public: inline bool isErrorPassive (void) const { return (mProtocolStatus & (1 << 5)) != 0 ; }
+    public: inline uint8_t lastErrorCode (void) const { return uint8_t (mProtocolStatus) & 0x7 ; }
+    public: inline uint8_t dataLastErrorCode (void) const { return uint8_t (mProtocolStatus >> 8) & 0x7 ; }
     public: inline uint8_t transceiverDelayCompensationOffset (void) const { return uint8_t (mProtocolStatus >> 16) & 0x7F ; }
   } ;
 
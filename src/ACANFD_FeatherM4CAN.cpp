@@ -3,6 +3,12 @@
 //--------------------------------------------------------------------------------------------------
 
 #include <ACANFD_FeatherM4CAN-from-cpp.h>
+#include <ACANFD_FeatherM4CAN_ISOTP.h>
+#include <ACANFD_FeatherM4CAN_E2E.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ERROR_INTERRUPTS = CAN_IR_BO | CAN_IR_EP | CAN_IR_EW | CAN_IR_PEA | CAN_IR_PED ;
 
 //--------------------------------------------------------------------------------------------------
 //    Constructor
@@ -10,17 +16,44 @@
 
 ACANFD_FeatherM4CAN::ACANFD_FeatherM4CAN (const ACANFD_FeatherM4CAN_Module inModule,
                                           uint32_t * inMessageRAMPtr,
-                                          const uint32_t inMessageRamWordSize) :
+                                          const uint32_t inMessageRamWordSize,
+                                          const uint8_t inDMAChannel) :
+mDMATxBufferIndexes (),
+mDMAChannel (inDMAChannel),
 mModulePtr ((inModule == ACANFD_FeatherM4CAN_Module::can0) ? CAN0 : CAN1),
 mMessageRAMPtr (inMessageRAMPtr),
 mMessageRamWordSize (inMessageRamWordSize),
 mModule (inModule) {
 }
 
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::ACANFD_FeatherM4CAN (const ACANFD_FeatherM4CAN_Module inModule,
+                                          ACANFD_FeatherM4CAN_MessageRamArena & inArena,
+                                          const uint8_t inDMAChannel) :
+mDMATxBufferIndexes (),
+mDMAChannel (inDMAChannel),
+mModulePtr ((inModule == ACANFD_FeatherM4CAN_Module::can0) ? CAN0 : CAN1),
+mMessageRAMPtr (nullptr),
+mMessageRamWordSize (0),
+mMessageRamArena (& inArena),
+mModule (inModule) {
+}
+
 //--------------------------------------------------------------------------------------------------
 //    beginFD method
 //--------------------------------------------------------------------------------------------------
 
+static uint8_t hardwareRxFIFOOverwriteMask (const ACANFD_FeatherM4CAN_Settings & inSettings) {
+  return uint8_t (
+    ((inSettings.mHardwareRxFIFO0Mode == ACANFD_FeatherM4CAN_Settings::RX_FIFO_OVERWRITE) ? (1U << 0) : 0)
+  |
+    ((inSettings.mHardwareRxFIFO1Mode == ACANFD_FeatherM4CAN_Settings::RX_FIFO_OVERWRITE) ? (1U << 1) : 0)
+  ) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 uint32_t ACANFD_FeatherM4CAN::beginFD (const ACANFD_FeatherM4CAN_Settings & inSettings,
                                        const ExtendedFilters & inExtendedFilters) {
   return beginFD (inSettings, ACANFD_FeatherM4CAN::StandardFilters (), inExtendedFilters) ;
@@ -57,6 +90,21 @@ uint32_t ACANFD_FeatherM4CAN::beginFD (const ACANFD_FeatherM4CAN_Settings & inSe
   if (inExtendedFilters.count () > 128) {
     errorCode |= kExtendedFilterCountGreaterThan128 ;
   }
+  if ((mDMAChannel != NO_DMA_CHANNEL) && (mDMAChannel >= DMAC_CH_NUM)) {
+    errorCode |= kInvalidDMAChannel ;
+  }
+  const uint32_t lowestPriority = (1 << __NVIC_PRIO_BITS) - 1 ;
+  if (inSettings.mInterruptPriority > lowestPriority) {
+    errorCode |= kInvalidInterruptSettings ;
+  }
+  if (inSettings.mInterruptLine1IRQ != ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ) {
+    const int16_t irq = inSettings.mInterruptLine1IRQ ;
+    if ((irq < 0) || (irq >= PERIPH_COUNT_IRQn) || (irq == CAN0_IRQn) || (irq == CAN1_IRQn)
+     || (inSettings.mInterruptLine1Priority > lowestPriority)
+     || (inSettings.mInterruptLine1Priority <= inSettings.mInterruptPriority)) {
+      errorCode |= kInvalidInterruptSettings ;
+    }
+  }
 //------------------------------------------------------ Enable CAN Clock (48 MHz)
   switch (mModule) {
   case ACANFD_FeatherM4CAN_Module::can0 :
@@ -69,60 +117,22 @@ uint32_t ACANFD_FeatherM4CAN::beginFD (const ACANFD_FeatherM4CAN_Settings & inSe
     break ;
   }
 //------------------------------------------------------ Start configuring CAN module
-  mModulePtr->CCCR.reg = CAN_CCCR_INIT ; // Page 1123
-  while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) == 0) {
-//      mModulePtr->CCCR.reg = CAN_CCCR_INIT ;
-  }
-//------------------------------------------------------ Enable configuration change
-  mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE ;
-  mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE | CAN_CCCR_TEST ;
-  uint32_t cccr  = CAN_CCCR_BRSE | CAN_CCCR_FDOE ;
+  enterConfigurationMode () ;
+  uint32_t cccr  = inSettings.mClassicCAN20BOnly ? 0 : (CAN_CCCR_BRSE | CAN_CCCR_FDOE) ;
 //------------------------------------------------------ Select mode
-  mModulePtr->TEST.reg = 0 ;
-  switch (inSettings.mModuleMode) {
-  case ACANFD_FeatherM4CAN_Settings::NORMAL_FD :
-    break ;
-  case ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK :
-    mModulePtr->TEST.reg = CAN_TEST_LBCK ;
-    cccr |= CAN_CCCR_MON | CAN_CCCR_TEST ;
-    break ;
-  case ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK :
-    mModulePtr->TEST.reg = CAN_TEST_LBCK ;
-    cccr |= CAN_CCCR_TEST ;
-    break ;
-  case ACANFD_FeatherM4CAN_Settings::BUS_MONITORING :
-    cccr |= CAN_CCCR_MON ;
-    break ;
-  }
+  cccr |= writeModuleMode (inSettings.mModuleMode) ;
   if (!inSettings.mEnableRetransmission) {
     cccr |= CAN_CCCR_DAR ; // Page 1123
   }
-//------------------------------------------------------ Set nominal Bit Timing and Prescaler (page 1125)
-  mModulePtr->NBTP.reg =
-    (uint32_t (inSettings.mArbitrationSJW - 1) << 25)
-  |
-    (uint32_t (inSettings.mBitRatePrescaler - 1) << 16)
-  |
-    (uint32_t (inSettings.mArbitrationPhaseSegment1 - 1) << 8)
-  |
-    (uint32_t (inSettings.mArbitrationPhaseSegment2 - 1) << 0)
-  ;
-//     Serial.print ("NBTP 0x") ;
-//     Serial.println (mModulePtr->NBTP.reg, HEX) ;
-//------------------------------------------------------ Set data Bit Timing and Prescaler (page 1119)
-  mModulePtr->DBTP.reg =
-    CAN_DBTP_TDC // Enable Transceiver Delay Compensation ?
-  |
-    (uint32_t (inSettings.mBitRatePrescaler - 1) << 16)
-  |
-    (uint32_t (inSettings.mDataPhaseSegment1 - 1) << 8)
-  |
-    (uint32_t (inSettings.mDataPhaseSegment2 - 1) << 4)
+//------------------------------------------------------ Nominal and data bit timing, transceiver delay compensation
+  writeBitTiming (inSettings) ;
+//------------------------------------------------------ Timestamp counter: incremented every nominal bit time;
+//   its value is stored in RXTS field of received elements (page 1177)
+  mModulePtr->TSCC.reg =
+    (0U << 16) // TCP: prescaler 1
   |
-    (uint32_t (inSettings.mDataSJW - 1) << 0)
+    (1U << 0) // TSS: value incremented according to TCP
   ;
-//------------------------------------------------------ Transmitter Delay Compensation
-  mModulePtr->TDCR.reg = uint32_t (inSettings.mTransceiverDelayCompensation) << 8 ; // Page 1134
 //------------------------------------------------------ Global Filter Configuration (page 1148)
   mModulePtr->GFC.reg =
     (uint32_t (inSettings.mNonMatchingStandardFrameReception) << 4)
@@ -133,104 +143,194 @@ uint32_t ACANFD_FeatherM4CAN::beginFD (const ACANFD_FeatherM4CAN_Settings & inSe
   |
     (uint32_t (inSettings.mDiscardReceivedExtendedRemoteFrames) << 0)
   ;
-//------------------------------------------------------ Configure message RAM
-//    mModulePtr->MRCFG.reg = 3 ; // Page 1118
-  uint32_t * ptr = mMessageRAMPtr ;
-//--- Allocate Standard ID Filters (0 ... 128 elements -> 0 ... 128 words)
-   mModulePtr->SIDFC.reg =
-    (uint32_t (ptr) & 0xFFFFU) // Standard ID Filter Configuration, page 1269
-  |
-    (inStandardFilters.count () << 16) // Standard filter count
-  ;
-  mStandardFilterCallBackArray.setCapacity (inStandardFilters.count ()) ;
-  for (uint32_t i=0 ; i<inStandardFilters.count () ; i++) {
-    *ptr = inStandardFilters.filterAtIndex (i) ; // Page 1149
-    ptr += 1 ;
-    mStandardFilterCallBackArray.append (inStandardFilters.callBackAtIndex (i)) ;
-  }
-//--- Allocate Extended ID Filters (0 ... 64 elements -> 0 ... 128 words)
-  mModulePtr->XIDFC.reg =
-    (uint32_t (ptr) & 0xFFFFU) // Standard ID Filter Configuration, page 1150
-  |
-    (inExtendedFilters.count () << 16) // Standard filter count
-  ;
-  mExtendedFilterCallBackArray.setCapacity (inExtendedFilters.count ()) ;
-  for (uint32_t i=0 ; i<inExtendedFilters.count () ; i++) {
-    *ptr = inExtendedFilters.firstWordAtIndex (i) ;
-    ptr += 1 ;
-    *ptr = inExtendedFilters.secondWordAtIndex (i) ;
-    ptr += 1 ;
-    mExtendedFilterCallBackArray.append (inExtendedFilters.callBackAtIndex (i)) ;
-  }
-//--- Allocate Rx FIFO 0 (0 ... 64 elements -> 0 ... 1152 words)
-  mRxFIFO0Pointer = ptr ;
-  mHardwareRxFIFO0Payload = inSettings.mHardwareRxFIFO0Payload ;
-  mModulePtr->RXF0C.reg = // Page 1155
-    (uint32_t (ptr) & 0xFFFFU) // FOSA
-  |
-    (uint32_t (inSettings.mHardwareRxFIFO0Size) << 16) // F0S
-  ;
-  mModulePtr->RXESC.reg |= uint32_t (inSettings.mHardwareRxFIFO0Payload) ; // Rx FIFO 0 element size (page 1162)
-  ptr += inSettings.mHardwareRxFIFO0Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO0Payload) ;
-//--- Allocate Rx FIFO 1 (0 ... 64 elements -> 0 ... 1152 words)
-  mRxFIFO1Pointer = ptr ;
-  mHardwareRxFIFO1Payload = inSettings.mHardwareRxFIFO1Payload ;
-  mModulePtr->RXF1C.reg = // Page 1159
-    (uint32_t (ptr) & 0xFFFFU) // FOSA
-  |
-    (uint32_t (inSettings.mHardwareRxFIFO1Size) << 16) // F0S
-  ;
-  mModulePtr->RXESC.reg |= uint32_t (inSettings.mHardwareRxFIFO1Payload) << 4 ; // Rx FIFO 1 element size (page 1162)
-  ptr += inSettings.mHardwareRxFIFO1Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO1Payload) ;
-//--- Allocate Rx Buffers (0 ... 64 elements -> 0 ... 1152 words)
-//       EMPTY
-//--- Allocate Tx Event / FIFO (0 ... 32 elements -> 0 ... 64 words)
-//       EMPTY
-//--- Allocate Tx Buffers (0 ... 32 elements -> 0 ... 576 words)
-  mHardwareTxBufferPayload = inSettings.mHardwareTransmitBufferPayload ;
-  mModulePtr->TXESC.reg = uint32_t (mHardwareTxBufferPayload) ; // page 1166
-  mTxBuffersPointer = ptr ;
-  mModulePtr->TXBC.reg = // Page 1164
-    (uint32_t (ptr) & 0xFFFFU) // Tx Buffer start address
-  |
-    (inSettings.mHardwareTransmitTxFIFOSize << 24) // Number of Transmit FIFO / Queue buffers
-  |
-    (inSettings.mHardwareDedicacedTxBufferCount << 16) // Number of Dedicaced Tx buffers
-  ;
-  const uint32_t txBufferCount = inSettings.mHardwareDedicacedTxBufferCount + inSettings.mHardwareTransmitTxFIFOSize ;
-  ptr += txBufferCount * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareTxBufferPayload) ;
-  mEndOfMessageRamPointer = ptr ;
-//------------------------------------------------------ Display Message RAM Allocation
-  const uint32_t requiredSize = mEndOfMessageRamPointer - mMessageRAMPtr ;
-  if (requiredSize > mMessageRamWordSize) {
+//------------------------------------------------------ Message RAM layout
+  MessageRamLayout layout ;
+  layout.mStandardFilters.mWordCount = uint16_t (inStandardFilters.count ()) ;
+  layout.mExtendedFilters.mWordOffset = layout.mStandardFilters.mWordCount ;
+  layout.mExtendedFilters.mWordCount = uint16_t (2 * inExtendedFilters.count ()) ;
+  layout.mRxFIFO0.mWordOffset = layout.mExtendedFilters.mWordOffset + layout.mExtendedFilters.mWordCount ;
+  layout.mRxFIFO0.mWordCount = uint16_t (inSettings.mHardwareRxFIFO0Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (inSettings.mHardwareRxFIFO0Payload)) ;
+  layout.mRxFIFO1.mWordOffset = layout.mRxFIFO0.mWordOffset + layout.mRxFIFO0.mWordCount ;
+  layout.mRxFIFO1.mWordCount = uint16_t (inSettings.mHardwareRxFIFO1Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (inSettings.mHardwareRxFIFO1Payload)) ;
+  layout.mTxBuffers.mWordOffset = layout.mRxFIFO1.mWordOffset + layout.mRxFIFO1.mWordCount ;
+  layout.mTxBuffers.mWordCount = uint16_t (
+    (inSettings.mHardwareDedicacedTxBufferCount + inSettings.mHardwareTransmitTxFIFOSize)
+  *
+    ACANFD_FeatherM4CAN_Settings::wordCountForPayload (inSettings.mHardwareTransmitBufferPayload)
+  ) ;
+  const uint32_t requiredSize = layout.wordCount () ;
+//------------------------------------------------------ Message RAM allocation: from arena, the
+//                                                         current block is kept if large enough
+  if (mMessageRamArena != nullptr) {
+    if (requiredSize > mMessageRamArenaBlockSize) {
+      mMessageRamArena->release (mMessageRAMPtr, mMessageRamArenaBlockSize) ;
+      mMessageRAMPtr = mMessageRamArena->allocate (requiredSize) ;
+      mMessageRamArenaBlockSize = (mMessageRAMPtr == nullptr) ? 0 : requiredSize ;
+    }
+    if (mMessageRAMPtr == nullptr) {
+      errorCode |= kMessageRamTooSmall ;
+    }
+  }else if (requiredSize > mMessageRamWordSize) {
     errorCode |= kMessageRamTooSmall ;
   }
-  if (uint32_t (mEndOfMessageRamPointer) > 0x2000FFFF) {
-    errorCode |= kMessageRamTooSmall ;
+  if ((mMessageRAMPtr != nullptr) && (uint32_t (mMessageRAMPtr + requiredSize) > 0x20010000)) {
+    errorCode |= kMessageRamNotInFirst64kio ;
   }
+  layout.mStart = mMessageRAMPtr ;
+  mMessageRamLayout = layout ;
+//------------------------------------------------------ Configure message RAM (only if it fits)
   if (errorCode == 0) {
+  //  mModulePtr->MRCFG.reg = 3 ; // Page 1118
+    uint32_t * ptr = mMessageRAMPtr ;
+  //--- Allocate Standard ID Filters (0 ... 128 elements -> 0 ... 128 words)
+    mModulePtr->SIDFC.reg =
+      (uint32_t (ptr) & 0xFFFFU) // Standard ID Filter Configuration, page 1269
+    |
+      (inStandardFilters.count () << 16) // Standard filter count
+    ;
+    mStandardFilterCallBackArray.setCapacity (inStandardFilters.count ()) ;
+    for (uint32_t i=0 ; i<inStandardFilters.count () ; i++) {
+      *ptr = inStandardFilters.filterAtIndex (i) ; // Page 1149
+      ptr += 1 ;
+      mStandardFilterCallBackArray.append (inStandardFilters.callBackAtIndex (i)) ;
+    }
+  //--- Allocate Extended ID Filters (0 ... 64 elements -> 0 ... 128 words)
+    mModulePtr->XIDFC.reg =
+      (uint32_t (ptr) & 0xFFFFU) // Standard ID Filter Configuration, page 1150
+    |
+      (inExtendedFilters.count () << 16) // Standard filter count
+    ;
+    mExtendedFilterCallBackArray.setCapacity (inExtendedFilters.count ()) ;
+    for (uint32_t i=0 ; i<inExtendedFilters.count () ; i++) {
+      *ptr = inExtendedFilters.firstWordAtIndex (i) ;
+      ptr += 1 ;
+      *ptr = inExtendedFilters.secondWordAtIndex (i) ;
+      ptr += 1 ;
+      mExtendedFilterCallBackArray.append (inExtendedFilters.callBackAtIndex (i)) ;
+    }
+  //--- Allocate Rx FIFO 0 (0 ... 64 elements -> 0 ... 1152 words)
+    mRxFIFO0Pointer = ptr ;
+    mHardwareRxFIFO0Payload = inSettings.mHardwareRxFIFO0Payload ;
+    mRxFIFO0ElementWordCount = uint8_t (ACANFD_FeatherM4CAN_Codec::elementWordCount (mHardwareRxFIFO0Payload)) ;
+    mRxFIFO0Decoder = ACANFD_FeatherM4CAN_Codec::decoderForPayload (mHardwareRxFIFO0Payload) ;
+    mModulePtr->RXF0C.reg = // Page 1155
+      (uint32_t (ptr) & 0xFFFFU) // FOSA
+    |
+      (uint32_t (inSettings.mHardwareRxFIFO0Size) << 16) // F0S
+    |
+      (uint32_t (inSettings.mHardwareRxFIFO0Mode == ACANFD_FeatherM4CAN_Settings::RX_FIFO_OVERWRITE) << 31) // F0OM
+    ;
+    ptr += inSettings.mHardwareRxFIFO0Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO0Payload) ;
+  //--- Allocate Rx FIFO 1 (0 ... 64 elements -> 0 ... 1152 words)
+    mRxFIFO1Pointer = ptr ;
+    mHardwareRxFIFO1Payload = inSettings.mHardwareRxFIFO1Payload ;
+    mRxFIFO1ElementWordCount = uint8_t (ACANFD_FeatherM4CAN_Codec::elementWordCount (mHardwareRxFIFO1Payload)) ;
+    mRxFIFO1Decoder = ACANFD_FeatherM4CAN_Codec::decoderForPayload (mHardwareRxFIFO1Payload) ;
+    mModulePtr->RXF1C.reg = // Page 1159
+      (uint32_t (ptr) & 0xFFFFU) // FOSA
+    |
+      (uint32_t (inSettings.mHardwareRxFIFO1Size) << 16) // F0S
+    |
+      (uint32_t (inSettings.mHardwareRxFIFO1Mode == ACANFD_FeatherM4CAN_Settings::RX_FIFO_OVERWRITE) << 31) // F1OM
+    ;
+  //--- Rx FIFO 0 and 1 element sizes (page 1162): assigned, as the register keeps its value after
+  //    end (clock gating does not reset it)
+    mModulePtr->RXESC.reg =
+      uint32_t (inSettings.mHardwareRxFIFO0Payload) // F0DS
+    |
+      (uint32_t (inSettings.mHardwareRxFIFO1Payload) << 4) // F1DS
+    ;
+    ptr += inSettings.mHardwareRxFIFO1Size * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO1Payload) ;
+  //--- Allocate Rx Buffers (0 ... 64 elements -> 0 ... 1152 words)
+  //       EMPTY
+  //--- Allocate Tx Event / FIFO (0 ... 32 elements -> 0 ... 64 words)
+  //       EMPTY
+  //--- Allocate Tx Buffers (0 ... 32 elements -> 0 ... 576 words)
+    mHardwareTxBufferPayload = inSettings.mHardwareTransmitBufferPayload ;
+    mTxBufferElementWordCount = uint8_t (ACANFD_FeatherM4CAN_Codec::elementWordCount (mHardwareTxBufferPayload)) ;
+    mTxBufferEncoder = ACANFD_FeatherM4CAN_Codec::encoderForPayload (mHardwareTxBufferPayload) ;
+    mModulePtr->TXESC.reg = uint32_t (mHardwareTxBufferPayload) ; // page 1166
+    mTxBuffersPointer = ptr ;
+    mModulePtr->TXBC.reg = // Page 1164
+      (uint32_t (ptr) & 0xFFFFU) // Tx Buffer start address
+    |
+      (inSettings.mHardwareTransmitTxFIFOSize << 24) // Number of Transmit FIFO / Queue buffers
+    |
+      (inSettings.mHardwareDedicacedTxBufferCount << 16) // Number of Dedicaced Tx buffers
+    ;
   //------------------------------------------------------ Configure Driver buffers
-    mDriverTransmitFIFO.initWithSize (inSettings.mDriverTransmitFIFOSize) ;
-    mDriverReceiveFIFO0.initWithSize (inSettings.mDriverReceiveFIFO0Size) ;
-    mDriverReceiveFIFO1.initWithSize (inSettings.mDriverReceiveFIFO1Size) ;
+  //--- In classic CAN 2.0B mode, only CANMessage FIFOs are allocated, otherwise only CANFDMessage FIFOs
+    mClassicCAN20BOnly = inSettings.mClassicCAN20BOnly ;
+    const uint16_t fdFactor = mClassicCAN20BOnly ? 0 : 1 ;
+    const uint16_t classicFactor = mClassicCAN20BOnly ? 1 : 0 ;
+    mDriverTransmitFIFO.initWithSize (fdFactor * inSettings.mDriverTransmitFIFOSize) ;
+    mDriverReceiveFIFO0.initWithSize (fdFactor * inSettings.mDriverReceiveFIFO0Size) ;
+    mDriverReceiveFIFO1.initWithSize (fdFactor * inSettings.mDriverReceiveFIFO1Size) ;
+    mDriverClassicTransmitFIFO.initWithSize (classicFactor * inSettings.mDriverTransmitFIFOSize) ;
+    mDriverClassicReceiveFIFO0.initWithSize (classicFactor * inSettings.mDriverReceiveFIFO0Size) ;
+    mDriverClassicReceiveFIFO1.initWithSize (classicFactor * inSettings.mDriverReceiveFIFO1Size) ;
+    setDriverFIFOPolicies (inSettings) ;
+    mHardwareRxFIFO0LostCount = 0 ;
+    mHardwareRxFIFO1LostCount = 0 ;
+    mHardwareRxFIFOOverwriteMask = hardwareRxFIFOOverwriteMask (inSettings) ;
+    mHardwareRxFIFONextGetIndex [0] = 0 ;
+    mHardwareRxFIFONextGetIndex [1] = 0 ;
     mNonMatchingStandardMessageCallBack = inSettings.mNonMatchingStandardMessageCallBack ;
     mNonMatchingExtendedMessageCallBack = inSettings.mNonMatchingExtendedMessageCallBack ;
+    mBusStatistics.init (inSettings, micros ()) ;
+  //------------------------------------------------------ Error handling
+    mErrorStatistics = ErrorStatistics () ;
+    mBitRateDetectionState = BIT_RATE_DETECTION_IDLE ;
+    mBusOffRecoveryPolicy = inSettings.mBusOffRecoveryPolicy ;
+    mBusOffRecoveryInitialDelay = inSettings.mBusOffRecoveryInitialDelay ;
+    mBusOffRecoveryMaximumDelay = inSettings.mBusOffRecoveryMaximumDelay ;
+    mBusOffRecoveryDelay = mBusOffRecoveryInitialDelay ;
+    mBusOff = false ;
+    mBusOffRecoveryPending = false ;
+    mTransmissionPaused = false ;
+  //------------------------------------------------------ Interrupt priority (before DMA, the DMAC
+  //                                                         interrupt gets the same priority)
+    NVIC_SetPriority (interruptNumber (), inSettings.mInterruptPriority) ;
+  //------------------------------------------------------ DMA
+  //--- Not used in classic CAN 2.0B mode: CPU copies the two data words faster
+    mDMAState = DMA_IDLE ;
+    mDMADeferredRxFIFOMask = 0 ;
+    mDMATransmitRequested = false ;
+    mDMAEnabled = false ;
+    if ((mDMAChannel != NO_DMA_CHANNEL) && !mClassicCAN20BOnly) {
+      configureDMA () ;
+    }
   //------------------------------------------------------ Interrupts
     uint32_t interruptRegister = CAN_IE_RF0NE ; // Receive FIFO 0 Non Empty
     interruptRegister |= CAN_IE_RF1NE ; // Receive FIFO 1 Non Empty
+    interruptRegister |= CAN_IE_RF0LE | CAN_IE_RF1LE ; // Receive FIFO 0, FIFO 1 Message Lost
     interruptRegister |= CAN_IE_TCE ; // Enable Transmission Completed Interrupt: page 1141
+    interruptRegister |= CAN_IE_BOE | CAN_IE_EPE | CAN_IE_EWE ; // Bus_Off, Error Passive, Warning Status
+    interruptRegister |= CAN_IE_PEAE | CAN_IE_PEDE ; // Protocol Error in Arbitration Phase, in Data Phase
     mModulePtr->IE.reg = interruptRegister ;
     mModulePtr->TXBTIE.reg = ~ 0 ;
-    mModulePtr->ILS.reg = 0 ; // All interrupt on EINT0
-    switch (mModule) {
-    case ACANFD_FeatherM4CAN_Module::can0 :
-      NVIC_EnableIRQ (CAN0_IRQn) ;
-      break ;
-    case ACANFD_FeatherM4CAN_Module::can1 :
-      NVIC_EnableIRQ (CAN1_IRQn) ;
-      break ;
+  //--- Interrupt lines: ILS bits have the same positions as IR flags
+    uint32_t line1Flags = 0 ;
+    if (inSettings.mReceptionInterruptLine == ACANFD_FeatherM4CAN_Settings::EINT1) {
+      line1Flags |= CAN_IR_RF0N | CAN_IR_RF1N | CAN_IR_RF0L | CAN_IR_RF1L ;
+    }
+    if (inSettings.mTransmissionInterruptLine == ACANFD_FeatherM4CAN_Settings::EINT1) {
+      line1Flags |= CAN_IR_TC ;
+    }
+    if (inSettings.mErrorInterruptLine == ACANFD_FeatherM4CAN_Settings::EINT1) {
+      line1Flags |= ERROR_INTERRUPTS ;
     }
-    mModulePtr->ILE.reg = CAN_ILE_EINT0 ; // Enable Interrupt 0
+    mInterruptLine1Flags = line1Flags ;
+    mModulePtr->ILS.reg = line1Flags ;
+    mInterruptLine1IRQ = inSettings.mInterruptLine1IRQ ;
+    if (mInterruptLine1IRQ != ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ) {
+      const IRQn_Type line1IRQ = IRQn_Type (mInterruptLine1IRQ) ;
+      NVIC_SetPriority (line1IRQ, inSettings.mInterruptLine1Priority) ;
+      NVIC_ClearPendingIRQ (line1IRQ) ;
+      NVIC_EnableIRQ (line1IRQ) ;
+    }
+    NVIC_EnableIRQ (interruptNumber ()) ;
+    mModulePtr->ILE.reg = CAN_ILE_EINT0 | CAN_ILE_EINT1 ; // Enable both interrupt lines
   //------------------------------------------------------ Select TX ad RX pins
   //  CAN0: PA22 is Tx_CAN, PA23 is Rx_CAN
   //  CAN1: PB14 is Tx_CAN, PB15 is Rx_CAN
@@ -269,159 +369,669 @@ uint32_t ACANFD_FeatherM4CAN::beginFD (const ACANFD_FeatherM4CAN_Settings & inSe
       break ;
     }
   //------------------------------------------------------ Activate CAN controller
-    mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE | cccr ; // Page 1123
-    mModulePtr->CCCR.reg = CAN_CCCR_INIT | cccr ; // Page 1123, reset CCE bit
-    mModulePtr->CCCR.reg = cccr ; // Page 1123, reset INIT bit
-    while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) != 0) {
-//      mModulePtr->CCCR.reg = cccr ; // Page 1123, reset INIT bit
-    }
+    leaveConfigurationMode (cccr) ;
+  }else{
+    mTxBuffersPointer = nullptr ; // Controller is not started
   }
 //--- Return error code (0 --> no error)
   return errorCode ;
 }
 
+//--------------------------------------------------------------------------------------------------
+//    end method
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::end (void) {
+  if (mTxBuffersPointer != nullptr) {
+  //------------------------------------------------------ Interrupts
+    NVIC_DisableIRQ (interruptNumber ()) ;
+    if (mInterruptLine1IRQ != ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ) {
+      NVIC_DisableIRQ (IRQn_Type (mInterruptLine1IRQ)) ;
+    }
+    mModulePtr->ILE.reg = 0 ;
+    mModulePtr->IE.reg = 0 ;
+  //------------------------------------------------------ DMA: DMAC interrupt can be shared with other
+  //                                                         channels, only channel interrupts are disabled
+    if (mDMAEnabled) {
+      DmacChannel & channel = DMAC->Channel [mDMAChannel] ;
+      channel.CHCTRLA.reg &= ~ DMAC_CHCTRLA_ENABLE ;
+      channel.CHINTENCLR.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR ;
+      mDMAEnabled = false ;
+    }
+    mDMAState = DMA_IDLE ;
+    mDMADeferredRxFIFOMask = 0 ;
+    mDMATransmitRequested = false ;
+  //------------------------------------------------------ Stop CAN controller: bus activity stops at once
+    mModulePtr->CCCR.reg = CAN_CCCR_INIT ; // Page 1123
+    while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) == 0) {
+    }
+    mModulePtr->IR.reg = ~ 0U ;
+    NVIC_ClearPendingIRQ (interruptNumber ()) ;
+  //------------------------------------------------------ Release TX and RX pins (GPIO inputs, input
+  //                                                         buffer disabled)
+    switch (mModule) {
+    case ACANFD_FeatherM4CAN_Module::can0 :
+      { const uint32_t canTxPin = 22 ;
+        const uint32_t canRxPin = 23 ;
+        const uint32_t GROUP_PA = 0 ; // PA
+        PORT->Group [GROUP_PA].DIRCLR.reg = (1 << canTxPin) | (1 << canRxPin) ;
+        PORT->Group [GROUP_PA].PINCFG [canTxPin].reg = 0 ;
+        PORT->Group [GROUP_PA].PINCFG [canRxPin].reg = 0 ;
+      }
+      break ;
+    case ACANFD_FeatherM4CAN_Module::can1 :
+      { const uint32_t canTxPin = 14 ;
+        const uint32_t canRxPin = 15 ;
+        const uint32_t GROUP_PB = 1 ; // PB
+        PORT->Group [GROUP_PB].DIRCLR.reg = (1 << canTxPin) | (1 << canRxPin) ;
+        PORT->Group [GROUP_PB].PINCFG [canTxPin].reg = 0 ;
+        PORT->Group [GROUP_PB].PINCFG [canRxPin].reg = 0 ;
+      //--- PB12 set: transceiver in silent mode
+        const uint32_t canSilentPin = 12 ;
+        PORT->Group [GROUP_PB].OUTSET.reg = (1 << canSilentPin) ;
+      //--- PB13 reset: BOOST_EN disabled
+        const uint32_t boostEnablePin = 13 ;
+        PORT->Group [GROUP_PB].OUTCLR.reg = (1 << boostEnablePin) ;
+      }
+      break ;
+    }
+  //------------------------------------------------------ Disable CAN Clock
+    switch (mModule) {
+    case ACANFD_FeatherM4CAN_Module::can0 :
+      GCLK->PCHCTRL [CAN0_GCLK_ID].reg = 0 ;
+      MCLK->AHBMASK.reg &= ~ MCLK_AHBMASK_CAN0 ;
+      break ;
+    case ACANFD_FeatherM4CAN_Module::can1 :
+      GCLK->PCHCTRL [CAN1_GCLK_ID].reg = 0 ;
+      MCLK->AHBMASK.reg &= ~ MCLK_AHBMASK_CAN1 ;
+      break ;
+    }
+  //------------------------------------------------------ Driver FIFOs
+    mDriverTransmitFIFO.free () ;
+    mDriverReceiveFIFO0.free () ;
+    mDriverReceiveFIFO1.free () ;
+    mDriverClassicTransmitFIFO.free () ;
+    mDriverClassicReceiveFIFO0.free () ;
+    mDriverClassicReceiveFIFO1.free () ;
+  //------------------------------------------------------ Message RAM: a block that is not the last
+  //                                                         one of the arena is kept for next beginFD
+    if ((mMessageRamArena != nullptr) && mMessageRamArena->release (mMessageRAMPtr, mMessageRamArenaBlockSize)) {
+      mMessageRAMPtr = nullptr ;
+      mMessageRamArenaBlockSize = 0 ;
+    }
+    mRxFIFO0Pointer = nullptr ;
+    mRxFIFO1Pointer = nullptr ;
+    mTxBuffersPointer = nullptr ; // Controller is not started
+  //------------------------------------------------------ Attachments: setGateway, setISOTP, setE2E,
+  //                                                         setMergedReceiveStream, setTransmitRing
+  //                                                         should be called again after beginFD
+    mGatewayTarget = nullptr ;
+    mGatewayRoutes = nullptr ;
+    mISOTP = nullptr ;
+    mE2E = nullptr ;
+    mMergedReceiveStream = nullptr ;
+    mTransmitRing = nullptr ;
+  //------------------------------------------------------ State
+    mBusOff = false ;
+    mBusOffRecoveryPending = false ;
+    mTransmissionPaused = false ;
+    mBitRateDetectionState = BIT_RATE_DETECTION_IDLE ;
+    mTDCCalibrationState = TDC_CALIBRATION_IDLE ;
+  }
+}
+
 //--------------------------------------------------------------------------------------------------
 
 uint32_t ACANFD_FeatherM4CAN::messageRamRequiredMinimumSize (void) {
-  return mEndOfMessageRamPointer - mMessageRAMPtr ;
+  return mMessageRamLayout.wordCount () ;
 }
 
 //--------------------------------------------------------------------------------------------------
-//   RECEPTION
+//   CONFIGURATION
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::availableFD0 (void) {
-  noInterrupts () ;
-    const bool hasMessage = !mDriverReceiveFIFO0.isEmpty () ;
-  interrupts () ;
-  return hasMessage ;
+void ACANFD_FeatherM4CAN::enterConfigurationMode (void) {
+  mModulePtr->CCCR.reg = CAN_CCCR_INIT ; // Page 1123
+  while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) == 0) {
+//      mModulePtr->CCCR.reg = CAN_CCCR_INIT ;
+  }
+//--- Enable configuration change
+  mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE ;
+  mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE | CAN_CCCR_TEST ;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::receiveFD0 (CANFDMessage & outMessage) {
-  noInterrupts () ;
-    const bool hasMessage = mDriverReceiveFIFO0.remove (outMessage) ;
-  interrupts () ;
-  return hasMessage ;
+void ACANFD_FeatherM4CAN::leaveConfigurationMode (const uint32_t inCCCR) {
+  mModulePtr->CCCR.reg = CAN_CCCR_INIT | CAN_CCCR_CCE | inCCCR ; // Page 1123
+  mModulePtr->CCCR.reg = CAN_CCCR_INIT | inCCCR ; // Page 1123, reset CCE bit
+  mModulePtr->CCCR.reg = inCCCR ; // Page 1123, reset INIT bit
+  while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) != 0) {
+//      mModulePtr->CCCR.reg = inCCCR ; // Page 1123, reset INIT bit
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
+// Writes TEST register (CCCR.TEST should be set), returns MON and TEST bits of CCCR
 
-bool ACANFD_FeatherM4CAN::availableFD1 (void) {
-  noInterrupts () ;
-    const bool hasMessage = !mDriverReceiveFIFO1.isEmpty () ;
-  interrupts () ;
-  return hasMessage ;
+uint32_t ACANFD_FeatherM4CAN::writeModuleMode (const ACANFD_FeatherM4CAN_Settings::ModuleMode inMode) {
+  uint32_t cccr = 0 ;
+  mModulePtr->TEST.reg = 0 ;
+  switch (inMode) {
+  case ACANFD_FeatherM4CAN_Settings::NORMAL_FD :
+    break ;
+  case ACANFD_FeatherM4CAN_Settings::INTERNAL_LOOP_BACK :
+    mModulePtr->TEST.reg = CAN_TEST_LBCK ;
+    cccr |= CAN_CCCR_MON | CAN_CCCR_TEST ;
+    break ;
+  case ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK :
+    mModulePtr->TEST.reg = CAN_TEST_LBCK ;
+    cccr |= CAN_CCCR_TEST ;
+    break ;
+  case ACANFD_FeatherM4CAN_Settings::BUS_MONITORING :
+    cccr |= CAN_CCCR_MON ;
+    break ;
+  }
+  return cccr ;
 }
 
 //--------------------------------------------------------------------------------------------------
+// CCCR.CCE should be set
 
-bool ACANFD_FeatherM4CAN::receiveFD1 (CANFDMessage & outMessage) {
-  noInterrupts () ;
-    const bool hasMessage = mDriverReceiveFIFO1.remove (outMessage) ;
-  interrupts () ;
-  return hasMessage ;
+void ACANFD_FeatherM4CAN::writeBitTiming (const ACANFD_FeatherM4CAN_Settings & inSettings) {
+//--- Set nominal Bit Timing and Prescaler (page 1125)
+  mModulePtr->NBTP.reg =
+    (uint32_t (inSettings.mArbitrationSJW - 1) << 25)
+  |
+    (uint32_t (inSettings.mBitRatePrescaler - 1) << 16)
+  |
+    (uint32_t (inSettings.mArbitrationPhaseSegment1 - 1) << 8)
+  |
+    (uint32_t (inSettings.mArbitrationPhaseSegment2 - 1) << 0)
+  ;
+//     Serial.print ("NBTP 0x") ;
+//     Serial.println (mModulePtr->NBTP.reg, HEX) ;
+  mNominalBitClockCount = uint32_t (inSettings.mBitRatePrescaler)
+    * (1U + inSettings.mArbitrationPhaseSegment1 + inSettings.mArbitrationPhaseSegment2) ;
+//--- Set data Bit Timing and Prescaler (page 1119)
+  mModulePtr->DBTP.reg =
+    CAN_DBTP_TDC // Enable Transceiver Delay Compensation ?
+  |
+    (uint32_t (inSettings.mBitRatePrescaler - 1) << 16)
+  |
+    (uint32_t (inSettings.mDataPhaseSegment1 - 1) << 8)
+  |
+    (uint32_t (inSettings.mDataPhaseSegment2 - 1) << 4)
+  |
+    (uint32_t (inSettings.mDataSJW - 1) << 0)
+  ;
+//--- Transmitter Delay Compensation
+  mModulePtr->TDCR.reg = // Page 1134
+    (uint32_t (inSettings.mTransceiverDelayCompensation & 0x7F) << 8)
+  |
+    (uint32_t (inSettings.mTransceiverDelayCompensationFilter & 0x7F) << 0)
+  ;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::dispatchReceivedMessage (void) {
-  CANFDMessage message ;
-  bool result = false ;
-  if (receiveFD0 (message)) {
-    result = true ;
-    internalDispatchReceivedMessage (message) ;
-  }
-  if (receiveFD1 (message)) {
-    result = true ;
-    internalDispatchReceivedMessage (message) ;
-  }
-  return result ;
+void ACANFD_FeatherM4CAN::setDriverFIFOPolicies (const ACANFD_FeatherM4CAN_Settings & inSettings) {
+  mDriverTransmitFIFO.setOverflowPolicy (inSettings.mDriverTransmitFIFOOverflowPolicy) ;
+  mDriverReceiveFIFO0.setOverflowPolicy (inSettings.mDriverReceiveFIFO0OverflowPolicy) ;
+  mDriverReceiveFIFO1.setOverflowPolicy (inSettings.mDriverReceiveFIFO1OverflowPolicy) ;
+  mDriverClassicTransmitFIFO.setOverflowPolicy (inSettings.mDriverTransmitFIFOOverflowPolicy) ;
+  mDriverClassicReceiveFIFO0.setOverflowPolicy (inSettings.mDriverReceiveFIFO0OverflowPolicy) ;
+  mDriverClassicReceiveFIFO1.setOverflowPolicy (inSettings.mDriverReceiveFIFO1OverflowPolicy) ;
+  mDriverTransmitFIFO.setHighWaterMark (inSettings.mDriverTransmitFIFOHighWaterMark,
+                                        inSettings.mDriverTransmitFIFOHighWaterCallBack) ;
+  mDriverReceiveFIFO0.setHighWaterMark (inSettings.mDriverReceiveFIFO0HighWaterMark,
+                                        inSettings.mDriverReceiveFIFO0HighWaterCallBack) ;
+  mDriverReceiveFIFO1.setHighWaterMark (inSettings.mDriverReceiveFIFO1HighWaterMark,
+                                        inSettings.mDriverReceiveFIFO1HighWaterCallBack) ;
+  mDriverClassicTransmitFIFO.setHighWaterMark (inSettings.mDriverTransmitFIFOHighWaterMark,
+                                               inSettings.mDriverTransmitFIFOHighWaterCallBack) ;
+  mDriverClassicReceiveFIFO0.setHighWaterMark (inSettings.mDriverReceiveFIFO0HighWaterMark,
+                                               inSettings.mDriverReceiveFIFO0HighWaterCallBack) ;
+  mDriverClassicReceiveFIFO1.setHighWaterMark (inSettings.mDriverReceiveFIFO1HighWaterMark,
+                                               inSettings.mDriverReceiveFIFO1HighWaterCallBack) ;
 }
 
+//--------------------------------------------------------------------------------------------------
+//   LIVE RECONFIGURATION
+//   While the controller is reconfigured, its interrupts are disabled, and transmission is paused
+//   (driver transmit FIFO is not written into hardware Tx FIFO). A DMA transfer in flight is
+//   completed first.
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::dispatchReceivedMessageFIFO0 (void) {
-  CANFDMessage message ;
-  const bool result = receiveFD0 (message) ;
-  if (result) {
-    internalDispatchReceivedMessage (message) ;
-  }
-  return result ;
+bool ACANFD_FeatherM4CAN::sameMessageRamLayout (const ACANFD_FeatherM4CAN_Settings & inSettings) const {
+  const uint32_t txbc = mModulePtr->TXBC.reg ; // Page 1164
+  return (inSettings.mClassicCAN20BOnly == mClassicCAN20BOnly)
+    && (inSettings.mHardwareRxFIFO0Size == ((mModulePtr->RXF0C.reg >> 16) & 0x7F)) // Page 1155
+    && (inSettings.mHardwareRxFIFO1Size == ((mModulePtr->RXF1C.reg >> 16) & 0x7F)) // Page 1159
+    && (inSettings.mHardwareRxFIFO0Payload == mHardwareRxFIFO0Payload)
+    && (inSettings.mHardwareRxFIFO1Payload == mHardwareRxFIFO1Payload)
+    && (hardwareRxFIFOOverwriteMask (inSettings) == mHardwareRxFIFOOverwriteMask)
+    && (inSettings.mHardwareDedicacedTxBufferCount == ((txbc >> 16) & 0x3F))
+    && (inSettings.mHardwareTransmitTxFIFOSize == ((txbc >> 24) & 0x3F))
+    && (inSettings.mHardwareTransmitBufferPayload == mHardwareTxBufferPayload)
+  ;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::dispatchReceivedMessageFIFO1 (void) {
-  CANFDMessage message ;
-  const bool result = receiveFD1 (message) ;
-  if (result) {
-    internalDispatchReceivedMessage (message) ;
+uint32_t ACANFD_FeatherM4CAN::reconfigure (const ACANFD_FeatherM4CAN_Settings & inSettings) {
+  uint32_t errorCode = inSettings.CANFDBitSettingConsistency () ;
+  if (mTxBuffersPointer == nullptr) {
+    errorCode |= kControllerNotStarted ;
+  }else if (!sameMessageRamLayout (inSettings)) {
+    errorCode |= kMessageRamLayoutChanged ;
   }
-  return result ;
+  if (errorCode == 0) {
+    const bool hasLine1IRQ = mInterruptLine1IRQ != ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ ;
+    noInterrupts () ;
+      const bool transmissionWasPaused = mTransmissionPaused ;
+      mTransmissionPaused = true ;
+    interrupts () ;
+    NVIC_DisableIRQ (interruptNumber ()) ;
+    if (hasLine1IRQ) {
+      NVIC_DisableIRQ (IRQn_Type (mInterruptLine1IRQ)) ;
+    }
+  //--- DMAC interrupt is still enabled: a completed transfer can only start an other one for
+  //    deferred hardware Rx FIFOs
+    while (mDMAState != DMA_IDLE) {
+    }
+  //--- Cancel hardware transmit requests; a frame being sent is not cancelled: its TXBRP bit is
+  //    reset when its transmission is completed, and its TXBTO bit is set (page 1169)
+    const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+    const uint32_t pendingRequests = mModulePtr->TXBRP.reg ; // Page 1167
+    mModulePtr->TXBCR.reg = pendingRequests ;
+    while ((mModulePtr->TXBRP.reg & pendingRequests) != 0) {
+    }
+    const uint32_t cancelledRequests = pendingRequests & ~ mModulePtr->TXBTO.reg ;
+  //--- Stop bus activity, and empty hardware Rx FIFOs, as configuration resets their status
+    mModulePtr->CCCR.reg = CAN_CCCR_INIT ; // Page 1123
+    while ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) == 0) {
+    }
+    noInterrupts () ;
+      while ((mModulePtr->RXF0S.reg & 0x7F) > 0) {
+        receiveFromHardwareRxFIFO (0) ;
+      }
+      while ((mModulePtr->RXF1S.reg & 0x7F) > 0) {
+        receiveFromHardwareRxFIFO (1) ;
+      }
+      if (mBusStatistics.isEnabled ()) {
+        mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+      }
+    interrupts () ;
+  //--- Mode, retransmission, bit timings
+    enterConfigurationMode () ;
+    uint32_t cccr = mClassicCAN20BOnly ? 0 : (CAN_CCCR_BRSE | CAN_CCCR_FDOE) ;
+    cccr |= writeModuleMode (inSettings.mModuleMode) ;
+    if (!inSettings.mEnableRetransmission) {
+      cccr |= CAN_CCCR_DAR ; // Page 1123
+    }
+    writeBitTiming (inSettings) ;
+  //--- Driver FIFOs: only those of the current frame format are allocated
+    const uint16_t fdFactor = mClassicCAN20BOnly ? 0 : 1 ;
+    const uint16_t classicFactor = mClassicCAN20BOnly ? 1 : 0 ;
+    noInterrupts () ;
+      mDriverTransmitFIFO.resize (fdFactor * inSettings.mDriverTransmitFIFOSize) ;
+      mDriverReceiveFIFO0.resize (fdFactor * inSettings.mDriverReceiveFIFO0Size) ;
+      mDriverReceiveFIFO1.resize (fdFactor * inSettings.mDriverReceiveFIFO1Size) ;
+      mDriverClassicTransmitFIFO.resize (classicFactor * inSettings.mDriverTransmitFIFOSize) ;
+      mDriverClassicReceiveFIFO0.resize (classicFactor * inSettings.mDriverReceiveFIFO0Size) ;
+      mDriverClassicReceiveFIFO1.resize (classicFactor * inSettings.mDriverReceiveFIFO1Size) ;
+      setDriverFIFOPolicies (inSettings) ;
+      writeBackCancelledTxFIFORequests (cancelledRequests, txfqs) ;
+      mBusStatistics.setBitTimings (inSettings) ;
+      mBusOffRecoveryPolicy = inSettings.mBusOffRecoveryPolicy ;
+      mBusOffRecoveryInitialDelay = inSettings.mBusOffRecoveryInitialDelay ;
+      mBusOffRecoveryMaximumDelay = inSettings.mBusOffRecoveryMaximumDelay ;
+      mBusOffRecoveryDelay = mBusOffRecoveryInitialDelay ;
+      mBusOffRecoveryPending = false ;
+    interrupts () ;
+  //--- Leaving INIT state starts bus integration (bus off recovery sequence if controller is bus off)
+    leaveConfigurationMode (cccr) ;
+  //--- Cancelled dedicated Tx buffers are requested again, their message RAM elements are unchanged
+    const uint32_t dedicatedTxBufferCount = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
+    noInterrupts () ;
+      mModulePtr->TXBAR.reg = cancelledRequests & ((1U << dedicatedTxBufferCount) - 1) ; // Page 1168
+      mTransmissionPaused = transmissionWasPaused ;
+      writeDriverTransmitFIFOIntoHardwareTxFIFO () ;
+    interrupts () ;
+    if (hasLine1IRQ) {
+      NVIC_EnableIRQ (IRQn_Type (mInterruptLine1IRQ)) ;
+    }
+    NVIC_EnableIRQ (interruptNumber ()) ;
+  }
+  return errorCode ;
 }
 
 //--------------------------------------------------------------------------------------------------
+// Cancelled hardware Tx FIFO elements are written back from the last one, at the head of driver
+// transmit FIFO: they are sent again in their order, before the frames of driver transmit FIFO.
+// Decoded fields of a Tx buffer element are at the same positions as in an Rx FIFO element (page
+// 1177); message marker is 0, so idx is 0. A frame with an end-to-end protected identifier is
+// stamped again when it is written into message RAM.
 
-void ACANFD_FeatherM4CAN::internalDispatchReceivedMessage (const CANFDMessage & inMessage) {
-  const uint32_t filterIndex = inMessage.idx ;
-  ACANFDCallBackRoutine callBack = nullptr ;
-  if (inMessage.ext) {
-    if (filterIndex == 255) {
-      callBack = mNonMatchingStandardMessageCallBack ;
-    }else if (filterIndex < mExtendedFilterCallBackArray.count ()) {
-      callBack = mExtendedFilterCallBackArray [filterIndex] ;
-    }
-  }else{ // Standard message
-    if (filterIndex == 255) {
-      callBack = mNonMatchingExtendedMessageCallBack ;
-    }else if (filterIndex < mStandardFilterCallBackArray.count ()) {
-      callBack = mStandardFilterCallBackArray [filterIndex] ;
+void ACANFD_FeatherM4CAN::writeBackCancelledTxFIFORequests (const uint32_t inCancelledRequests,
+                                                              const uint32_t inTXFQS) {
+  const uint32_t txbc = mModulePtr->TXBC.reg ; // Page 1164
+  const uint32_t dedicatedTxBufferCount = (txbc >> 16) & 0x3F ;
+  const uint32_t txFIFOSize = (txbc >> 24) & 0x3F ;
+  const uint32_t getIndex = (inTXFQS >> 8) & 0x1F ; // Page 1165
+  const uint32_t fillLevel = txFIFOSize - (inTXFQS & 0x3F) ;
+  for (uint32_t i=fillLevel ; i>0 ; i--) {
+    const uint32_t txBufferIndex = dedicatedTxBufferCount
+      + (getIndex - dedicatedTxBufferCount + i - 1) % txFIFOSize ;
+    if ((inCancelledRequests & (1U << txBufferIndex)) != 0) {
+      const uint32_t * element = mTxBuffersPointer + txBufferIndex * mTxBufferElementWordCount ;
+      if (mClassicCAN20BOnly) {
+        CANMessage message ;
+        ACANFD_FeatherM4CAN_Codec::decodeClassic (element, message) ;
+        mDriverClassicTransmitFIFO.prepend (message) ;
+      }else{
+        CANFDMessage message ;
+        ACANFD_FeatherM4CAN_Codec::decoderForPayload (mHardwareTxBufferPayload) (element, message) ;
+        mDriverTransmitFIFO.prepend (message) ;
+      }
     }
   }
-  if (callBack != nullptr) {
-    callBack (inMessage) ;
-  }
 }
 
 //--------------------------------------------------------------------------------------------------
-//   EMISSION
+//   LOSS ACCOUNTING
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN::sendBufferNotFullForIndex (const uint32_t inMessageIndex) {
-  bool canSend = false ;
+void ACANFD_FeatherM4CAN::resetLossCounts (void) {
   noInterrupts () ;
-    if (inMessageIndex == 0) { // Send via Tx FIFO ?
-      canSend = !mDriverTransmitFIFO.isFull () ;
-    }else{ // Send via dedicaced Tx Buffer ?
-      const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
-      if (inMessageIndex <= numberOfDedicacedTxBuffers) {
-        const uint32_t txBufferIndex = inMessageIndex - 1 ;
-        canSend = (mModulePtr->TXBRP.reg & (1U << txBufferIndex)) == 0 ; // Page 1167
-      }
-    }
+    mDriverTransmitFIFO.resetOverflowCount () ;
+    mDriverReceiveFIFO0.resetOverflowCount () ;
+    mDriverReceiveFIFO1.resetOverflowCount () ;
+    mDriverClassicTransmitFIFO.resetOverflowCount () ;
+    mDriverClassicReceiveFIFO0.resetOverflowCount () ;
+    mDriverClassicReceiveFIFO1.resetOverflowCount () ;
+    mHardwareRxFIFO0LostCount = 0 ;
+    mHardwareRxFIFO1LostCount = 0 ;
   interrupts () ;
-  return canSend ;
 }
 
+//--------------------------------------------------------------------------------------------------
+//   BUS STATISTICS
 //--------------------------------------------------------------------------------------------------
 
-uint32_t ACANFD_FeatherM4CAN::tryToSendReturnStatusFD (const CANFDMessage & inMessage) {
+ACANFD_FeatherM4CAN_BusStatistics::Snapshot ACANFD_FeatherM4CAN::busStatistics (void) {
   noInterrupts () ;
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+    }
+    const ACANFD_FeatherM4CAN_BusStatistics::Snapshot result = mBusStatistics.snapshot (micros ()) ;
+  interrupts () ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RECEPTION
+//--------------------------------------------------------------------------------------------------
+
+static void classicMessageFrom (const CANFDMessage & inMessage, CANMessage & outMessage) {
+  outMessage.id = inMessage.id ;
+  outMessage.ext = inMessage.ext ;
+  outMessage.rtr = inMessage.type == CANFDMessage::CAN_REMOTE ;
+  outMessage.idx = inMessage.idx ;
+  outMessage.len = inMessage.len ;
+  outMessage.data64 = inMessage.data64 [0] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::availableFD0 (void) {
+  noInterrupts () ;
+    const bool hasMessage = !mDriverReceiveFIFO0.isEmpty () || !mDriverClassicReceiveFIFO0.isEmpty () ;
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::receiveFD0 (CANFDMessage & outMessage) {
+  CANMessage classicMessage ;
+  noInterrupts () ;
+    bool hasMessage = mDriverReceiveFIFO0.remove (outMessage) ;
+    const bool hasClassicMessage = !hasMessage && mDriverClassicReceiveFIFO0.remove (classicMessage) ;
+  interrupts () ;
+  if (hasClassicMessage) {
+    outMessage = CANFDMessage (classicMessage) ;
+    hasMessage = true ;
+  }
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::receive0 (CANMessage & outMessage) {
+  noInterrupts () ;
+    bool hasMessage = mDriverClassicReceiveFIFO0.remove (outMessage) ;
+    if (!hasMessage && !mDriverReceiveFIFO0.isEmpty ()) { // CANFD mode
+      const CANFDMessage * message = mDriverReceiveFIFO0.slotForRemove (0) ;
+      hasMessage = (message->type == CANFDMessage::CAN_DATA) || (message->type == CANFDMessage::CAN_REMOTE) ;
+      if (hasMessage) {
+        classicMessageFrom (*message, outMessage) ;
+        mDriverReceiveFIFO0.discardHead () ;
+      }
+    }
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::availableFD1 (void) {
+  noInterrupts () ;
+    const bool hasMessage = !mDriverReceiveFIFO1.isEmpty () || !mDriverClassicReceiveFIFO1.isEmpty () ;
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::receiveFD1 (CANFDMessage & outMessage) {
+  CANMessage classicMessage ;
+  noInterrupts () ;
+    bool hasMessage = mDriverReceiveFIFO1.remove (outMessage) ;
+    const bool hasClassicMessage = !hasMessage && mDriverClassicReceiveFIFO1.remove (classicMessage) ;
+  interrupts () ;
+  if (hasClassicMessage) {
+    outMessage = CANFDMessage (classicMessage) ;
+    hasMessage = true ;
+  }
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::receive1 (CANMessage & outMessage) {
+  noInterrupts () ;
+    bool hasMessage = mDriverClassicReceiveFIFO1.remove (outMessage) ;
+    if (!hasMessage && !mDriverReceiveFIFO1.isEmpty ()) { // CANFD mode
+      const CANFDMessage * message = mDriverReceiveFIFO1.slotForRemove (0) ;
+      hasMessage = (message->type == CANFDMessage::CAN_DATA) || (message->type == CANFDMessage::CAN_REMOTE) ;
+      if (hasMessage) {
+        classicMessageFrom (*message, outMessage) ;
+        mDriverReceiveFIFO1.discardHead () ;
+      }
+    }
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::dispatchReceivedMessage (void) {
+  CANFDMessage message ;
+  bool result = false ;
+  if (receiveFD0 (message)) {
+    result = true ;
+    internalDispatchReceivedMessage (message) ;
+  }
+  if (receiveFD1 (message)) {
+    result = true ;
+    internalDispatchReceivedMessage (message) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::dispatchReceivedMessageFIFO0 (void) {
+  CANFDMessage message ;
+  const bool result = receiveFD0 (message) ;
+  if (result) {
+    internalDispatchReceivedMessage (message) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::dispatchReceivedMessageFIFO1 (void) {
+  CANFDMessage message ;
+  const bool result = receiveFD1 (message) ;
+  if (result) {
+    internalDispatchReceivedMessage (message) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::DispatchResult ACANFD_FeatherM4CAN::dispatchReceivedMessages (const uint32_t inMaxDuration,
+                                                                                   const uint32_t inMaxFrameCount,
+                                                                                   const uint8_t inFIFO0Weight,
+                                                                                   const uint8_t inFIFO1Weight) {
+  DispatchResult result ;
+  const uint32_t start = micros () ;
+  const bool noWeight = (inFIFO0Weight == 0) && (inFIFO1Weight == 0) ;
+  const uint32_t fifo0Weight = noWeight ? 1 : inFIFO0Weight ;
+  const uint32_t fifo1Weight = noWeight ? 1 : inFIFO1Weight ;
+  uint32_t fifoIndex = 0 ; // FIFO being served
+  uint32_t served = 0 ; // Frames dispatched from it in the current round
+  bool fifo0Empty = false ;
+  bool fifo1Empty = false ;
+  bool loop = true ;
+  while (loop && !(fifo0Empty && fifo1Empty)) {
+  //--- Next FIFO when its weight is exhausted, or it is empty
+    const uint32_t weight = (fifoIndex == 0) ? fifo0Weight : fifo1Weight ;
+    const bool empty = (fifoIndex == 0) ? fifo0Empty : fifo1Empty ;
+    const bool otherEmpty = (fifoIndex == 0) ? fifo1Empty : fifo0Empty ;
+    if (empty || ((served >= weight) && !otherEmpty)) {
+      fifoIndex ^= 1 ;
+      served = 0 ;
+    }else{
+      CANFDMessage message ;
+      if (!((fifoIndex == 0) ? receiveFD0 (message) : receiveFD1 (message))) {
+        if (fifoIndex == 0) {
+          fifo0Empty = true ;
+        }else{
+          fifo1Empty = true ;
+        }
+      }else{
+        internalDispatchReceivedMessage (message) ;
+        served += 1 ;
+      //--- The other FIFO may have received frames in the meantime
+        if (fifoIndex == 0) {
+          result.mDispatchedFIFO0Count += 1 ;
+          fifo1Empty = false ;
+        }else{
+          result.mDispatchedFIFO1Count += 1 ;
+          fifo0Empty = false ;
+        }
+      //--- Budget
+        if ((inMaxFrameCount > 0) && (result.dispatchedCount () >= inMaxFrameCount)) {
+          loop = false ;
+        }else if ((inMaxDuration > 0) && ((micros () - start) >= inMaxDuration)) {
+          loop = false ;
+        }
+      }
+    }
+  }
+  result.mPendingFIFO0Count = driverReceiveFIFO0Count () ;
+  result.mPendingFIFO1Count = driverReceiveFIFO1Count () ;
+  result.mElapsedDuration = micros () - start ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::internalDispatchReceivedMessage (const CANFDMessage & inMessage) {
+  const uint32_t filterIndex = inMessage.idx ;
+  ACANFDCallBackRoutine callBack = nullptr ;
+  if (inMessage.ext) {
+    if (filterIndex == 255) {
+      callBack = mNonMatchingStandardMessageCallBack ;
+    }else if (filterIndex < mExtendedFilterCallBackArray.count ()) {
+      callBack = mExtendedFilterCallBackArray [filterIndex] ;
+    }
+  }else{ // Standard message
+    if (filterIndex == 255) {
+      callBack = mNonMatchingExtendedMessageCallBack ;
+    }else if (filterIndex < mStandardFilterCallBackArray.count ()) {
+      callBack = mStandardFilterCallBackArray [filterIndex] ;
+    }
+  }
+  if (callBack != nullptr) {
+    callBack (inMessage) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   EMISSION
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::sendBufferNotFullForIndex (const uint32_t inMessageIndex) {
+  bool canSend = false ;
+  noInterrupts () ;
+    if (inMessageIndex == 0) { // Send via Tx FIFO ?
+      canSend = mClassicCAN20BOnly ? !mDriverClassicTransmitFIFO.isFull () : !mDriverTransmitFIFO.isFull () ;
+    }else{ // Send via dedicaced Tx Buffer ?
+      const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
+      if (inMessageIndex <= numberOfDedicacedTxBuffers) {
+        const uint32_t txBufferIndex = inMessageIndex - 1 ;
+        canSend = (mModulePtr->TXBRP.reg & (1U << txBufferIndex)) == 0 ; // Page 1167
+      }
+    }
+  interrupts () ;
+  return canSend ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN::tryToSendReturnStatusFD (const CANFDMessage & inMessage) {
+  if ((mTransmitRing != nullptr) && (inMessage.idx == 0)) {
+    return sendThroughTransmitRing (inMessage) ;
+  }
+  if (mClassicCAN20BOnly) {
+    uint32_t sendStatus = kInvalidMessage ;
+    if ((inMessage.type == CANFDMessage::CAN_DATA) || (inMessage.type == CANFDMessage::CAN_REMOTE)) {
+      CANMessage message ;
+      classicMessageFrom (inMessage, message) ;
+      sendStatus = tryToSendReturnStatus (message) ;
+    }
+    return sendStatus ;
+  }
+  const uint32_t primask = __get_PRIMASK () ; // ISO-TP may call it with interrupts disabled
+  __disable_irq () ;
     uint32_t sendStatus = 0 ;
     if (!inMessage.isValid ()) {
       sendStatus = kInvalidMessage ;
     }else if (inMessage.idx == 0) { // Send via Tx FIFO ?
       const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
       const uint32_t hardwareTransmitFifoFreeLevel = txfqs & 0x3F ; // Page 1165
-      if ((hardwareTransmitFifoFreeLevel > 0) && mDriverTransmitFIFO.isEmpty ()) {
+      if ((hardwareTransmitFifoFreeLevel > 0) && mDriverTransmitFIFO.isEmpty () && !transmissionIsPaused ()) {
         const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
         writeTxBuffer (inMessage, putIndex) ;
-      }else if (mDriverTransmitFIFO.isFull ()) {
+      }else if (!mDriverTransmitFIFO.append (inMessage)) { // Overflow handled by FIFO policy
         sendStatus = kTransmitBufferOverflow ;
-      }else{
-        mDriverTransmitFIFO.append (inMessage) ;
       }
     }else{ // Send via dedicaced Tx Buffer ?
       const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
@@ -437,184 +1047,1569 @@ uint32_t ACANFD_FeatherM4CAN::tryToSendReturnStatusFD (const CANFDMessage & inMe
         sendStatus = kTransmitBufferIndexTooLarge ;
       }
     }
-  interrupts () ;
+  __set_PRIMASK (primask) ;
   return sendStatus ;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void ACANFD_FeatherM4CAN::writeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) {
-//--- Compute Tx Buffer address
-  uint32_t * txBufferPtr = mTxBuffersPointer ;
-  txBufferPtr += inTxBufferIndex * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareTxBufferPayload) ;
-//--- Identifier and extended bit
-  if (inMessage.ext) {
-    txBufferPtr [0] = (inMessage.id & 0x1FFFFFFFU) | (1U << 30) ;
-  }else{
-    txBufferPtr [0] = (inMessage.id & 0x7FFU) << 18 ;
-  }
-//---Control
-  uint32_t lengthCode ;
-  if (inMessage.len > 48) {
-    lengthCode = 15 ;
-  }else if (inMessage.len > 32) {
-    lengthCode = 14 ;
-  }else if (inMessage.len > 24) {
-    lengthCode = 13 ;
-  }else if (inMessage.len > 20) {
-    lengthCode = 12 ;
-  }else if (inMessage.len > 16) {
-    lengthCode = 11 ;
-  }else if (inMessage.len > 12) {
-    lengthCode = 10 ;
-  }else if (inMessage.len > 8) {
-    lengthCode = 9 ;
-  }else{
-    lengthCode = inMessage.len ;
-  }
-  txBufferPtr [1] = uint32_t (lengthCode) << 16 ;
-//---
-  const uint32_t lg = ACANFD_FeatherM4CAN_Settings::frameDataByteCountForPayload (mHardwareTxBufferPayload) ;
-  const uint32_t sentCount = (lg < inMessage.len) ? lg : inMessage.len ;
-//---
-  switch (inMessage.type) {
-  case CANFDMessage::CAN_REMOTE :
-    txBufferPtr [0] |= 1 << 29 ; // Set RTR bit
-    break ;
-  case CANFDMessage::CAN_DATA :
-    txBufferPtr [2] = inMessage.data32 [0] ;
-    txBufferPtr [3] = inMessage.data32 [1] ;
-    break ;
-  case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH :
-    { txBufferPtr [1] |= 1 << 21 ; // Set FDF bit
-      const uint32_t wc = (sentCount + 3) / 4 ;
-      for (uint32_t i=0 ; i<wc ; i++) {
-        txBufferPtr [i+2] = inMessage.data32 [i] ;
+uint32_t ACANFD_FeatherM4CAN::tryToSendReturnStatus (const CANMessage & inMessage) {
+  if (!mClassicCAN20BOnly) {
+    return tryToSendReturnStatusFD (CANFDMessage (inMessage)) ;
+  }
+  if ((mTransmitRing != nullptr) && (inMessage.idx == 0)) {
+    return sendThroughTransmitRing (CANFDMessage (inMessage)) ;
+  }
+  const uint32_t primask = __get_PRIMASK () ;
+  __disable_irq () ;
+    uint32_t sendStatus = 0 ;
+    if (inMessage.len > 8) {
+      sendStatus = kInvalidMessage ;
+    }else if (inMessage.idx == 0) { // Send via Tx FIFO ?
+      const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+      const uint32_t hardwareTransmitFifoFreeLevel = txfqs & 0x3F ; // Page 1165
+      if ((hardwareTransmitFifoFreeLevel > 0) && mDriverClassicTransmitFIFO.isEmpty () && !transmissionIsPaused ()) {
+        const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        writeClassicTxBuffer (inMessage, putIndex) ;
+      }else if (!mDriverClassicTransmitFIFO.append (inMessage)) { // Overflow handled by FIFO policy
+        sendStatus = kTransmitBufferOverflow ;
+      }
+    }else{ // Send via dedicaced Tx Buffer ?
+      const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
+      if (inMessage.idx <= numberOfDedicacedTxBuffers) {
+        const uint32_t txBufferIndex = inMessage.idx - 1 ;
+        const bool hardwareTxBufferIsEmpty = (mModulePtr->TXBRP.reg & (1U << txBufferIndex)) == 0 ; // Page 1167
+        if (hardwareTxBufferIsEmpty) {
+          writeClassicTxBuffer (inMessage, txBufferIndex) ;
+        }else{
+          sendStatus = kTransmitBufferOverflow ;
+        }
+      }else{
+        sendStatus = kTransmitBufferIndexTooLarge ;
       }
     }
-    break ;
-  case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH :
-    { txBufferPtr [1] |= (1 << 21) | (1 << 20) ; // Set FDF and BRS bits
-      const uint32_t wc = (sentCount + 3) / 4 ;
-      for (uint32_t i=0 ; i<wc ; i++) {
-        txBufferPtr [i+2] = inMessage.data32 [i] ;
+  __set_PRIMASK (primask) ;
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// No critical section: the frame is copied into its ring slot with interrupts enabled, the CAN
+// interrupt service routine writes it into the hardware Tx FIFO
+
+uint32_t ACANFD_FeatherM4CAN::sendThroughTransmitRing (const CANFDMessage & inMessage) {
+  uint32_t sendStatus = 0 ;
+  const bool classicFrame = (inMessage.type == CANFDMessage::CAN_DATA) || (inMessage.type == CANFDMessage::CAN_REMOTE) ;
+  if (mTxBuffersPointer == nullptr) {
+    sendStatus = kControllerNotStarted ;
+  }else if (!inMessage.isValid () || (mClassicCAN20BOnly && !classicFrame)) {
+    sendStatus = kInvalidMessage ;
+  }else if (!mTransmitRing->append (inMessage)) {
+    sendStatus = kTransmitBufferOverflow ;
+  }else{
+    NVIC_SetPendingIRQ (interruptNumber ()) ;
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TIMED TRANSMISSION
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::prepareDedicatedTxBuffer (const CANFDMessage & inMessage,
+                                                    const uint32_t inMessageIndex) {
+  bool ok = false ;
+  noInterrupts () ;
+    const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
+    if ((inMessageIndex > 0) && (inMessageIndex <= numberOfDedicacedTxBuffers) && inMessage.isValid ()) {
+      const uint32_t txBufferIndex = inMessageIndex - 1 ;
+      ok = (mModulePtr->TXBRP.reg & (1U << txBufferIndex)) == 0 ; // Page 1167
+      if (ok && mClassicCAN20BOnly) {
+        ok = (inMessage.type == CANFDMessage::CAN_DATA) || (inMessage.type == CANFDMessage::CAN_REMOTE) ;
+        if (ok) {
+          CANMessage message ;
+          classicMessageFrom (inMessage, message) ;
+          encodeClassicTxBuffer (message, txBufferIndex) ;
+        }
+      }else if (ok) {
+        encodeTxBuffer (inMessage, txBufferIndex) ;
       }
     }
-    break ;
+  interrupts () ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN::requestDedicatedTxBuffer (const uint32_t inMessageIndex) {
+  const uint32_t numberOfDedicacedTxBuffers = (mModulePtr->TXBC.reg >> 16) & 0x3F ; // Page 1164
+  const bool ok = (inMessageIndex > 0) && (inMessageIndex <= numberOfDedicacedTxBuffers) ;
+  if (ok) {
+    mModulePtr->TXBAR.reg = 1U << (inMessageIndex - 1) ; // Page 1168
   }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// CAN 2.0B frame: only the two header words and the two data words are written
+
+void ACANFD_FeatherM4CAN::writeClassicTxBuffer (const CANMessage & inMessage, const uint32_t inTxBufferIndex) {
+  encodeClassicTxBuffer (inMessage, inTxBufferIndex) ;
 //---Request transmit
   mModulePtr->TXBAR.reg = 1U << inTxBufferIndex ; // Page 1168
 }
 
-//--------------------------------------------------------------------------------------------------
-//   INTERRUPT SERVICE ROUTINES
 //--------------------------------------------------------------------------------------------------
 
-static void getMessageFrom (uint32_t * inMessageRamAddress,
-                            const ACANFD_FeatherM4CAN_Settings::Payload inPayLoad,
-                            CANFDMessage & outMessage) {
-  const uint32_t lg = ACANFD_FeatherM4CAN_Settings::frameDataByteCountForPayload (inPayLoad) ;
-  const uint32_t w0 = inMessageRamAddress [0] ;
-  outMessage.id = w0 & 0x1FFFFFFF ;
-  const bool remote = (w0 & (1 << 29)) != 0 ;
-  outMessage.ext = (w0 & (1 << 30)) != 0 ;
-//   const bool esi = (w0 & (1 << 31)) != 0 ;
-  if (!outMessage.ext) {
-    outMessage.id >>= 18 ;
-  }
-  const uint32_t w1 = inMessageRamAddress [1] ;
-  const uint32_t dlc = (w1 >> 16) & 0xF ;
-  static const uint8_t CANFD_LENGTH_FROM_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
-  outMessage.len = CANFD_LENGTH_FROM_CODE [dlc] ;
-  const bool fdf = (w1 & (1 << 21)) != 0 ;
-  const bool brs = (w1 & (1 << 20)) != 0 ;
-  if (fdf) { // CANFD frame
-    outMessage.type = brs ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
-  }else if (remote) {
-    outMessage.type = CANFDMessage::CAN_REMOTE ;
-  }else{
-    outMessage.type = CANFDMessage::CAN_DATA ;
+void ACANFD_FeatherM4CAN::encodeClassicTxBuffer (const CANMessage & inMessage, const uint32_t inTxBufferIndex) {
+//--- Compute Tx Buffer address
+  uint32_t * txBufferPtr = mTxBuffersPointer ;
+  txBufferPtr += inTxBufferIndex * mTxBufferElementWordCount ;
+//--- Bus statistics: account for a previous frame sent by this buffer, before TXBAR resets TXBTO bit
+  if (mBusStatistics.isEnabled ()) {
+    mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+    mBusStatistics.noteTransmitRequest (inMessage, inTxBufferIndex) ;
   }
-//--- Filter index
-  if ((w1 & (1U << 31)) != 0) { // Filter index available ? Page 1177-1178
-    outMessage.idx = 255 ; // Not available
-  }else{
-    const uint32_t filterIndex = (w1 >> 24) & 0x7F ;
-    outMessage.idx = uint8_t (filterIndex) ;
+//--- Header and data
+  ACANFD_FeatherM4CAN_Codec::encodeClassic (inMessage, txBufferPtr) ;
+//--- End-to-end protection
+  if (mE2E != nullptr) {
+    mE2E->stampTxElement (txBufferPtr, 2) ;
   }
-//--- Get data
-  if (outMessage.type != CANFDMessage::CAN_REMOTE) {
-    const uint32_t receiveByteCount = (lg < outMessage.len) ? lg : outMessage.len ;
-    const uint32_t wc = (receiveByteCount + 3) / 4 ;
-    for (uint32_t i=0 ; i<wc ; i++) {
-      outMessage.data32 [i] = inMessageRamAddress [i+2] ;
-    }
-    for (uint32_t i=receiveByteCount ; i<outMessage.len ; i++) {
-      outMessage.data [i] = 0xCC ;
-    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::writeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) {
+  encodeTxBuffer (inMessage, inTxBufferIndex) ;
+//---Request transmit
+  mModulePtr->TXBAR.reg = 1U << inTxBufferIndex ; // Page 1168
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::encodeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) {
+//--- Compute Tx Buffer address
+  uint32_t * txBufferPtr = mTxBuffersPointer ;
+  txBufferPtr += inTxBufferIndex * mTxBufferElementWordCount ;
+//--- Bus statistics: account for a previous frame sent by this buffer, before TXBAR resets TXBTO bit
+  if (mBusStatistics.isEnabled ()) {
+    mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+    mBusStatistics.noteTransmitRequest (inMessage, inTxBufferIndex) ;
+  }
+//--- Header and data
+  mTxBufferEncoder (inMessage, txBufferPtr) ;
+//--- End-to-end protection
+  if (mE2E != nullptr) {
+    mE2E->stampTxElement (txBufferPtr, mTxBufferElementWordCount - 2U) ;
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+//   GATEWAY
 //--------------------------------------------------------------------------------------------------
 
-void ACANFD_FeatherM4CAN::interruptServiceRoutine (void) {
-  bool loop = true ;
-  while (loop) {
-    const uint32_t it = mModulePtr->IR.reg ;
-    if ((it & CAN_IR_RF0N) != 0) { // Receive FIFO 0 Non Empty
-      CANFDMessage message ;
-    //--- Get read index
-      const uint32_t readIndex = (mModulePtr->RXF0S.reg >> 8) & 0x3F ;
-    //--- Compute message RAM address
-      uint32_t * address = mRxFIFO0Pointer ;
-      address += readIndex * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO0Payload) ;
-    //--- Get message
-      getMessageFrom (address, mHardwareRxFIFO0Payload, message) ;
-    //--- Clear receive flag
-      mModulePtr->RXF0A.reg = readIndex ;
-    //--- Interrupt Acknowledge
-      mModulePtr->IR.reg = CAN_IR_RF0N ;
-    //--- Enter message into driver receive buffer 0
-      mDriverReceiveFIFO0.append (message) ;
-    }else if ((it & CAN_IR_RF1N) != 0) { // Receive FIFO 1 Non Empty
-      CANFDMessage message ;
-    //--- Get read index
-      const uint32_t readIndex = (mModulePtr->RXF1S.reg >> 8) & 0x3F ;
-    //--- Compute message RAM address
-      uint32_t * address = mRxFIFO1Pointer ;
-      address += readIndex * ACANFD_FeatherM4CAN_Settings::wordCountForPayload (mHardwareRxFIFO1Payload) ;
-    //--- Get message
-      getMessageFrom (address, mHardwareRxFIFO1Payload, message) ;
-    //--- Clear receive flag
-      mModulePtr->RXF1A.reg = readIndex ;
-    //--- Interrupt Acknowledge
-      mModulePtr->IR.reg = CAN_IR_RF1N ;
-    //--- Enter message into driver receive buffer 1
-      mDriverReceiveFIFO1.append (message) ;
+void ACANFD_FeatherM4CAN::setGateway (ACANFD_FeatherM4CAN & inTarget,
+                                      const ACANFD_FeatherM4CAN_GatewayRoutes & inRoutes) {
+  noInterrupts () ;
+    mGatewayRoutes = & inRoutes ;
+    mGatewayTarget = & inTarget ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeGateway (void) {
+  noInterrupts () ;
+    mGatewayTarget = nullptr ;
+    mGatewayRoutes = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::resetGatewayCounts (void) {
+  noInterrupts () ;
+    mGatewayForwardedCount = 0 ;
+    mGatewayLostCount = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called by the interrupt service routine of the gateway source controller. inElement is the Rx
+// FIFO element, that has inDataWordCount data words; inWord0 is the (rewritten) Tx buffer element
+// word 0. If the frame can be sent now (driver transmit FIFO and transmit ring are empty), the
+// element is copied as is into the hardware Tx FIFO, data bytes missing from it are 0xCC;
+// otherwise it is decoded and enqueued into driver transmit FIFO. Returns false if the frame is lost,
+// that is also the case if the target controller is not started (end has been called).
+// Interrupts are disabled, as CAN0 and CAN1 interrupts may have different priorities; PRIMASK is
+// restored, as the source routine may run with interrupts disabled (preemptible line 1 routine).
+
+bool ACANFD_FeatherM4CAN::forwardRxElement (const uint32_t * inElement,
+                                            const uint32_t inDataWordCount,
+                                            const uint32_t inWord0) {
+  const uint32_t w1 = inElement [1] & 0x003F0000U ; // DLC, BRS, FDF (page 1177)
+  const bool isCANFDFrame = (w1 & (1U << 21)) != 0 ;
+  bool ok = (mTxBuffersPointer != nullptr) && !(mClassicCAN20BOnly && isCANFDFrame) ;
+  if (ok) {
+    const uint32_t primask = __get_PRIMASK () ;
+    __disable_irq () ;
+      const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+      const bool sendNow = ((txfqs & 0x3F) > 0)
+        && mDriverTransmitFIFO.isEmpty () && mDriverClassicTransmitFIFO.isEmpty ()
+        && ((mTransmitRing == nullptr) || (mTransmitRing->count () == 0))
+        && !transmissionIsPaused () && (mDMAState != DMA_TRANSMIT) ;
+      if (sendNow) {
+        const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        uint32_t * txBufferPtr = mTxBuffersPointer + putIndex * mTxBufferElementWordCount ;
+        if (mBusStatistics.isEnabled ()) {
+          CANFDMessage message ;
+          ACANFD_FeatherM4CAN_Codec::decodeHeader (inElement, message) ;
+          mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+          mBusStatistics.noteTransmitRequest (message, putIndex) ;
+        }
+        txBufferPtr [0] = inWord0 ;
+        txBufferPtr [1] = w1 ;
+        uint32_t wc = (uint32_t (ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [(w1 >> 16) & 0xF]) + 3) / 4 ;
+        if (wc > uint32_t (mTxBufferElementWordCount - 2)) {
+          wc = mTxBufferElementWordCount - 2 ;
+        }
+        const uint32_t copiedWordCount = (wc > inDataWordCount) ? inDataWordCount : wc ;
+        ACANFD_FeatherM4CAN_Codec::copyWords (txBufferPtr + 2, inElement + 2, copiedWordCount) ;
+      //--- Bytes that did not fit in the Rx element: 0xCC, as the queued path (fillMissingData)
+        for (uint32_t i=copiedWordCount ; i<wc ; i++) {
+          txBufferPtr [2 + i] = 0xCCCCCCCCU ;
+        }
+        if (mE2E != nullptr) {
+          mE2E->stampTxElement (txBufferPtr, wc) ;
+        }
+        mModulePtr->TXBAR.reg = 1U << putIndex ; // Page 1168
+      }else{
+        const uint32_t header [2] = { inWord0, w1 } ;
+        CANFDMessage message ;
+        ACANFD_FeatherM4CAN_Codec::decodeHeader (header, message) ;
+        ACANFD_FeatherM4CAN_Codec::copyWords (message.data32, inElement + 2,
+                                              ACANFD_FeatherM4CAN_Codec::dataWordCount (message, inDataWordCount)) ;
+        ACANFD_FeatherM4CAN_Codec::fillMissingData (message, 4 * inDataWordCount) ;
+        message.idx = 0 ; // Sent via Tx FIFO
+        if (mClassicCAN20BOnly) {
+          CANMessage classicMessage ;
+          classicMessageFrom (message, classicMessage) ;
+          ok = mDriverClassicTransmitFIFO.append (classicMessage) ;
+        }else{
+          ok = mDriverTransmitFIFO.append (message) ;
+        }
+      }
+    __set_PRIMASK (primask) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   ISO-TP
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setISOTP (ACANFD_FeatherM4CAN_ISOTP & inISOTP) {
+  noInterrupts () ;
+    mISOTP = & inISOTP ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeISOTP (void) {
+  noInterrupts () ;
+    mISOTP = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   END-TO-END PROTECTION
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setE2E (ACANFD_FeatherM4CAN_E2E & inE2E) {
+  noInterrupts () ;
+    mE2E = & inE2E ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeE2E (void) {
+  noInterrupts () ;
+    mE2E = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRACE
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setTraceLogger (ACANFD_FeatherM4CAN_TraceLogger & inLogger) {
+  noInterrupts () ;
+    mTraceLogger = & inLogger ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeTraceLogger (void) {
+  noInterrupts () ;
+    mTraceLogger = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRAFFIC STATISTICS
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setTrafficStatistics (ACANFD_FeatherM4CAN_TrafficStatistics & inStatistics) {
+  noInterrupts () ;
+    mTrafficStatistics = & inStatistics ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeTrafficStatistics (void) {
+  noInterrupts () ;
+    mTrafficStatistics = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   MERGED RECEIVE STREAM
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setMergedReceiveStream (ACANFD_FeatherM4CAN_MergedReceiveStream & inStream) {
+  noInterrupts () ;
+    mMergedReceiveStream = & inStream ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeMergedReceiveStream (void) {
+  noInterrupts () ;
+    mMergedReceiveStream = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRANSMIT RING
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::setTransmitRing (ACANFD_FeatherM4CAN_TransmitRing & inRing) {
+  noInterrupts () ;
+    mTransmitRing = & inRing ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::removeTransmitRing (void) {
+  noInterrupts () ;
+    mTransmitRing = nullptr ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The 16-bit timestamp counter is sampled at start of frame (RXTS, page 1177): the frame started
+// (TSCV - RXTS) nominal bit times ago. The counter wraps around after 65,536 bit times (65 ms at
+// 1 Mbit/s), that bounds the interrupt latency.
+
+uint32_t ACANFD_FeatherM4CAN::receiveDate (const uint32_t * inElement) const {
+  const uint32_t elapsedBitCount = (mModulePtr->TSCV.reg - inElement [1]) & 0xFFFFU ;
+  const uint32_t clocksPerMicroSecond = ACANFD_FeatherM4CAN_Settings::CAN_ROOT_CLOCK_FREQUENCY / 1000000 ;
+  return micros () - (elapsedBitCount * mNominalBitClockCount) / clocksPerMicroSecond ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   INTERRUPT SERVICE ROUTINES
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::interruptServiceRoutine (void) {
+//--- Frames published by transmit ring producers (they trigger the CAN interrupt)
+  writeTransmitRingIntoHardwareTxFIFO (false) ;
+  if (mInterruptLine1IRQ == ACANFD_FeatherM4CAN_Settings::NO_INTERRUPT_LINE_1_IRQ) {
+    serviceInterrupts (~ 0U, false) ;
+    noteWaitedEvents () ;
+  }else{
+    serviceInterrupts (~ mInterruptLine1Flags, false) ;
+  //--- EINT1 flags are handled at line 1 priority
+    const uint32_t it = mModulePtr->IR.reg & mModulePtr->IE.reg & mInterruptLine1Flags ;
+    if ((it != 0) && ((mModulePtr->ILE.reg & CAN_ILE_EINT1) != 0)) {
+      mModulePtr->ILE.reg = CAN_ILE_EINT0 ;
+      NVIC_SetPendingIRQ (IRQn_Type (mInterruptLine1IRQ)) ;
+    }
+    noteWaitedEvents () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::line1InterruptServiceRoutine (void) {
+  serviceInterrupts (mInterruptLine1Flags, true) ;
+  noInterrupts () ;
+    noteWaitedEvents () ;
+  interrupts () ;
+//--- If an EINT1 flag has been raised in the meantime, the CAN interrupt is triggered again
+  mModulePtr->ILE.reg = CAN_ILE_EINT0 | CAN_ILE_EINT1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Handles interrupt flags of inFlagMask. If inPreemptible, the CAN interrupt service routine can
+// preempt it: each event is handled with interrupts disabled, except the transmit FIFO refill that
+// enables interrupts between frames.
+
+void ACANFD_FeatherM4CAN::serviceInterrupts (const uint32_t inFlagMask, const bool inPreemptible) {
+  bool loop = true ;
+  while (loop) {
+    if (inPreemptible) {
+      noInterrupts () ;
+    }
+    const uint32_t it = mModulePtr->IR.reg & mModulePtr->IE.reg & inFlagMask ; // Rx FIFO flags are masked during DMA
+    if ((it & CAN_IR_RF0N) != 0) { // Receive FIFO 0 Non Empty
+      if (receptionUsesDMA ()) {
+        mModulePtr->IE.reg &= ~ CAN_IE_RF0NE ; // Enabled again when hardware Rx FIFO 0 is empty
+        mDMADeferredRxFIFOMask |= 1 << 0 ;
+        scheduleDMA () ;
+      }else{
+        receiveFromHardwareRxFIFO (0) ;
+      }
+    }else if ((it & CAN_IR_RF1N) != 0) { // Receive FIFO 1 Non Empty
+      if (receptionUsesDMA ()) {
+        mModulePtr->IE.reg &= ~ CAN_IE_RF1NE ; // Enabled again when hardware Rx FIFO 1 is empty
+        mDMADeferredRxFIFOMask |= 1 << 1 ;
+        scheduleDMA () ;
+      }else{
+        receiveFromHardwareRxFIFO (1) ;
+      }
     }else if ((it & CAN_IR_TC) != 0) {
     //--- Interrupt Acknowledge
       mModulePtr->IR.reg = CAN_IR_TC ;
+    //--- Bus statistics
+      if (mBusStatistics.isEnabled ()) {
+        mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+      }
+    //--- A frame has been sent: bus off backoff delay restarts from its initial value
+      mBusOffRecoveryDelay = mBusOffRecoveryInitialDelay ;
     //--- Write message into transmit fifo ?
-      bool writeMessage = true ;
-      CANFDMessage message ;
-      while (writeMessage) {
-        const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
-        const uint32_t txFifoFreeLevel = txfqs & 0x3F ;
-        if ((txFifoFreeLevel > 0) && mDriverTransmitFIFO.remove (message)) {
-          const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
-          writeTxBuffer (message, putIndex) ;
+      writeDriverTransmitFIFOIntoHardwareTxFIFO (inPreemptible) ;
+    //--- ISO-TP consecutive frames
+      if (mISOTP != nullptr) {
+        mISOTP->handleTransmitCompleted () ;
+      }
+    }else if ((it & (CAN_IR_RF0L | CAN_IR_RF1L)) != 0) { // Message lost by a hardware Rx FIFO
+    //--- Interrupt Acknowledge
+      mModulePtr->IR.reg = it & (CAN_IR_RF0L | CAN_IR_RF1L) ;
+    //--- The flag is raised again by the next lost message
+      if ((it & CAN_IR_RF0L) != 0) {
+        mHardwareRxFIFO0LostCount += 1 ;
+      }
+      if ((it & CAN_IR_RF1L) != 0) {
+        mHardwareRxFIFO1LostCount += 1 ;
+      }
+    }else if ((it & ERROR_INTERRUPTS) != 0) {
+    //--- Interrupt Acknowledge
+      mModulePtr->IR.reg = it & ERROR_INTERRUPTS ;
+      handleErrorInterrupts (it) ;
+    }else{
+      loop = false ;
+    }
+    if (inPreemptible) {
+      interrupts () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Transfers the oldest element of a hardware Rx FIFO into driver receive FIFO, by CPU.
+// In overwrite mode, the controller overwrites the element at get index when the FIFO is full,
+// and increments the get index: an element could be overwritten while it is handled. So each
+// element is copied and released first; if the get index has changed during the copy, the copy is
+// discarded. As the interrupt service routine may have been held off while the FIFO was filled,
+// the whole hardware FIFO is emptied. Get index skips are counted as lost frames (the RFnL flag is
+// not raised by an overwrite); a skip of a whole FIFO size cannot be detected, so the count is a
+// lower bound.
+
+void ACANFD_FeatherM4CAN::receiveFromHardwareRxFIFO (const uint32_t inFIFOIndex) {
+  const uint32_t elementWordCount = (inFIFOIndex == 0) ? mRxFIFO0ElementWordCount : mRxFIFO1ElementWordCount ;
+  const uint32_t * rxFIFOPointer = (inFIFOIndex == 0) ? mRxFIFO0Pointer : mRxFIFO1Pointer ;
+  if ((mHardwareRxFIFOOverwriteMask & (1U << inFIFOIndex)) == 0) { // Blocking mode
+    const uint32_t rxfs = (inFIFOIndex == 0) ? mModulePtr->RXF0S.reg : mModulePtr->RXF1S.reg ;
+    const uint32_t readIndex = (rxfs >> 8) & 0x3F ;
+    handleRxFIFOElement (inFIFOIndex, rxFIFOPointer + readIndex * elementWordCount, elementWordCount) ;
+    acknowledgeHardwareRxFIFOElement (inFIFOIndex, readIndex) ;
+  }else{ // Overwrite mode
+    const uint32_t rxfc = (inFIFOIndex == 0) ? mModulePtr->RXF0C.reg : mModulePtr->RXF1C.reg ; // Page 1155, 1159
+    const uint32_t hardwareFIFOSize = (rxfc >> 16) & 0x7F ;
+    bool loop = true ;
+    while (loop) {
+      const uint32_t rxfs = (inFIFOIndex == 0) ? mModulePtr->RXF0S.reg : mModulePtr->RXF1S.reg ;
+      loop = (rxfs & 0x7F) > 0 ; // Fill level
+      if (loop) {
+        const uint32_t readIndex = (rxfs >> 8) & 0x3F ;
+        const uint32_t skippedCount = (readIndex + hardwareFIFOSize - mHardwareRxFIFONextGetIndex [inFIFOIndex]) % hardwareFIFOSize ;
+        if (inFIFOIndex == 0) {
+          mHardwareRxFIFO0LostCount += skippedCount ;
         }else{
-          writeMessage = false ;
+          mHardwareRxFIFO1LostCount += skippedCount ;
+        }
+        mHardwareRxFIFONextGetIndex [inFIFOIndex] = uint8_t (readIndex) ;
+        const uint32_t * address = rxFIFOPointer + readIndex * elementWordCount ;
+        uint32_t element [18] ; // Header (2 words), at most 16 data words (page 1177)
+        for (uint32_t i=0 ; i<elementWordCount ; i++) {
+          element [i] = address [i] ;
+        }
+        const uint32_t rxfsAfterCopy = (inFIFOIndex == 0) ? mModulePtr->RXF0S.reg : mModulePtr->RXF1S.reg ;
+        if (((rxfsAfterCopy >> 8) & 0x3F) == readIndex) {
+          acknowledgeHardwareRxFIFOElement (inFIFOIndex, readIndex) ;
+          mHardwareRxFIFONextGetIndex [inFIFOIndex] = uint8_t ((readIndex + 1) % hardwareFIFOSize) ;
+          handleRxFIFOElement (inFIFOIndex, element, elementWordCount) ;
         }
       }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Handles a hardware Rx FIFO element (in message RAM, or its copy). An ISO-TP frame is handled by
+// ISO-TP engine. If a gateway is set, the element is first routed: it can be forwarded to the
+// target controller, and it is entered into driver receive FIFO only if its route says so. If a
+// merged receive stream is set, it replaces driver receive FIFOs.
+
+void ACANFD_FeatherM4CAN::handleRxFIFOElement (const uint32_t inFIFOIndex,
+                                               const uint32_t * inElement,
+                                               const uint32_t inElementWordCount) {
+//--- Reception counts, for automatic bit rate detection (BRS bit, page 1177)
+  mReceivedFrameCount += 1 ;
+  if ((inElement [1] & (1U << 20)) != 0) {
+    mReceivedBRSFrameCount += 1 ;
+  }
+//--- Trace
+  if (mTraceLogger != nullptr) {
+    mTraceLogger->recordRxElement (inElement, inElementWordCount - 2, uint8_t (mModule == ACANFD_FeatherM4CAN_Module::can1)) ;
+  }
+//--- Traffic statistics
+  if (mTrafficStatistics != nullptr) {
+    mTrafficStatistics->recordRxElement (inElement, micros ()) ;
+  }
+//--- End-to-end protection, ISO-TP, gateway
+  bool receive = true ;
+  if ((mE2E != nullptr) && !mE2E->acceptsRxElement (inElement, inElementWordCount - 2)) {
+    receive = false ;
+  }else if ((mISOTP != nullptr) && mISOTP->handleRxElement (inElement, inElementWordCount - 2)) {
+    receive = false ;
+  }else if (mGatewayTarget != nullptr) {
+    const ACANFD_FeatherM4CAN_GatewayRoutes::Route & route = mGatewayRoutes->routeForRxElement (inElement) ;
+    receive = route.receives () ;
+    if (route.forwards ()) {
+      if (mGatewayTarget->forwardRxElement (inElement, inElementWordCount - 2, route.forwardedHeader (inElement [0]))) {
+        mGatewayForwardedCount += 1 ;
+      }else{
+        mGatewayLostCount += 1 ;
+      }
+    }
+  }
+//--- Get message, enter it into driver receive FIFO (overflow is accounted by the FIFO)
+  if (!receive) {
+    if (mBusStatistics.isEnabled ()) {
+      CANFDMessage message ;
+      ACANFD_FeatherM4CAN_Codec::decodeHeader (inElement, message) ;
+      mBusStatistics.recordReceivedFrame (message, micros ()) ;
+    }
+  }else if (mMergedReceiveStream != nullptr) {
+    const uint32_t date = receiveDate (inElement) ;
+    CANFDMessage message ;
+    if (mClassicCAN20BOnly) {
+      CANMessage classicMessage ;
+      ACANFD_FeatherM4CAN_Codec::decodeClassic (inElement, classicMessage) ;
+      message = CANFDMessage (classicMessage) ;
     }else{
-      loop = false ;
+      ((inFIFOIndex == 0) ? mRxFIFO0Decoder : mRxFIFO1Decoder) (inElement, message) ;
+    }
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.recordReceivedFrame (message, micros ()) ;
+    }
+    mMergedReceiveStream->append (message, date, uint8_t (mModule == ACANFD_FeatherM4CAN_Module::can1), uint8_t (inFIFOIndex)) ;
+  }else if (mClassicCAN20BOnly) {
+    CANMessage message ;
+    ACANFD_FeatherM4CAN_Codec::decodeClassic (inElement, message) ;
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.recordReceivedFrame (message, micros ()) ;
+    }
+    ((inFIFOIndex == 0) ? mDriverClassicReceiveFIFO0 : mDriverClassicReceiveFIFO1).append (message) ;
+  }else{
+    CANFDMessage message ;
+    ((inFIFOIndex == 0) ? mRxFIFO0Decoder : mRxFIFO1Decoder) (inElement, message) ;
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.recordReceivedFrame (message, micros ()) ;
+    }
+    ((inFIFOIndex == 0) ? mDriverReceiveFIFO0 : mDriverReceiveFIFO1).append (message) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::acknowledgeHardwareRxFIFOElement (const uint32_t inFIFOIndex,
+                                                            const uint32_t inElementIndex) {
+  if (inFIFOIndex == 0) {
+    mModulePtr->RXF0A.reg = inElementIndex ; // Clear receive flag
+    mModulePtr->IR.reg = CAN_IR_RF0N ; // Interrupt Acknowledge
+  }else{
+    mModulePtr->RXF1A.reg = inElementIndex ; // Clear receive flag
+    mModulePtr->IR.reg = CAN_IR_RF1N ; // Interrupt Acknowledge
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::writeDriverTransmitFIFOIntoHardwareTxFIFO (const bool inPreemptible) {
+  if (usesDMA ()) {
+    if (!transmissionIsPaused ()) {
+      mDMATransmitRequested = true ;
+      scheduleDMA () ;
+    }
+  }else if (mClassicCAN20BOnly) {
+    bool writeMessage = !transmissionIsPaused () ;
+    CANMessage message ;
+    while (writeMessage) {
+      if (inPreemptible) { // Called with interrupts disabled: preemption window between frames
+        interrupts () ;
+        noInterrupts () ;
+      }
+      const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+      const uint32_t txFifoFreeLevel = txfqs & 0x3F ;
+      if ((txFifoFreeLevel > 0) && mDriverClassicTransmitFIFO.remove (message)) {
+        const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        writeClassicTxBuffer (message, putIndex) ;
+      }else{
+        writeMessage = false ;
+      }
+    }
+  }else{
+    bool writeMessage = !transmissionIsPaused () ;
+    CANFDMessage message ;
+    while (writeMessage) {
+      if (inPreemptible) { // Called with interrupts disabled: preemption window between frames
+        interrupts () ;
+        noInterrupts () ;
+      }
+      const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+      const uint32_t txFifoFreeLevel = txfqs & 0x3F ;
+      if ((txFifoFreeLevel > 0) && mDriverTransmitFIFO.remove (message)) {
+        const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        writeTxBuffer (message, putIndex) ;
+      }else{
+        writeMessage = false ;
+      }
+    }
+  }
+  writeTransmitRingIntoHardwareTxFIFO (inPreemptible) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Transmit ring consumer. Every hardware Tx FIFO write is done from CAN interrupt service routine,
+// or with interrupts disabled, so the put index is never used twice. Nothing is written while
+// a DMA transfer to the hardware Tx FIFO is in flight; completeTransmitDMA calls it again.
+
+void ACANFD_FeatherM4CAN::writeTransmitRingIntoHardwareTxFIFO (const bool inPreemptible) {
+  bool writeMessage = (mTransmitRing != nullptr) && (mDMAState != DMA_TRANSMIT) && !transmissionIsPaused () ;
+  while (writeMessage) {
+    if (inPreemptible) { // Called with interrupts disabled: preemption window between frames
+      interrupts () ;
+      noInterrupts () ;
+    }
+    const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+    const uint32_t txFifoFreeLevel = txfqs & 0x3F ;
+    const CANFDMessage * message = nullptr ;
+    if ((txFifoFreeLevel > 0) && (mTransmitRing != nullptr)) {
+      message = mTransmitRing->head () ;
+    }
+    if (message == nullptr) {
+      writeMessage = false ;
+    }else{
+      const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+      if (mClassicCAN20BOnly) {
+        CANMessage classicMessage ;
+        classicMessageFrom (*message, classicMessage) ;
+        writeClassicTxBuffer (classicMessage, putIndex) ;
+      }else{
+        writeTxBuffer (*message, putIndex) ;
+      }
+      mTransmitRing->discardHead () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   DMA COPY
+//   Frames are copied between message RAM and driver FIFOs by a DMAC channel, that is software
+//   triggered. Only data words are copied by DMA, the two header words are handled by CPU.
+//   A transfer handles at most DMA_MAX_ELEMENT_COUNT frames, through linked descriptors. Only
+//   one transfer is in flight; while a hardware Rx FIFO is waiting for DMA, its RFxN interrupt
+//   is disabled. DMAC and CAN interrupts have the same priority, so they do not preempt each
+//   other.
+//--------------------------------------------------------------------------------------------------
+
+static DmacDescriptor * allocateDMADescriptors (const uint32_t inCount) {
+//--- Descriptors should be 128-bit aligned; they are never released
+  uint8_t * ptr = new uint8_t [inCount * sizeof (DmacDescriptor) + 15] () ;
+  return (DmacDescriptor *) ((uintptr_t (ptr) + 15) & ~ uintptr_t (15)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void setDMADescriptor (DmacDescriptor * inDescriptor,
+                              const uint32_t * inSource,
+                              uint32_t * inDestination,
+                              const uint32_t inWordCount) {
+  inDescriptor->BTCTRL.reg =
+    DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC
+  |
+    DMAC_BTCTRL_BLOCKACT_NOACT
+  ;
+  inDescriptor->BTCNT.reg = uint16_t (inWordCount) ;
+//--- With address increment, SRCADDR and DSTADDR are addresses of the end of the block
+  inDescriptor->SRCADDR.reg = uint32_t (inSource + inWordCount) ;
+  inDescriptor->DSTADDR.reg = uint32_t (inDestination + inWordCount) ;
+  inDescriptor->DESCADDR.reg = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::configureDMA (void) {
+  MCLK->AHBMASK.reg |= MCLK_AHBMASK_DMAC ;
+//--- If the DMAC is already enabled (by an other library), its descriptor tables are shared
+  if ((DMAC->CTRL.reg & DMAC_CTRL_DMAENABLE) == 0) {
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST ;
+    while ((DMAC->CTRL.reg & DMAC_CTRL_SWRST) != 0) {}
+    DmacDescriptor * descriptors = allocateDMADescriptors (2 * DMAC_CH_NUM) ;
+    DMAC->BASEADDR.reg = uint32_t (descriptors) ;
+    DMAC->WRBADDR.reg = uint32_t (descriptors + DMAC_CH_NUM) ;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN (0xF) ;
+  }
+  DmacDescriptor * baseDescriptors = (DmacDescriptor *) DMAC->BASEADDR.reg ;
+  mDMAFirstDescriptor = & baseDescriptors [mDMAChannel] ;
+  if (mDMALinkedDescriptors == nullptr) {
+    mDMALinkedDescriptors = allocateDMADescriptors (DMA_MAX_ELEMENT_COUNT - 1) ;
+  }
+//--- Reset channel, software trigger starts the whole transaction
+  DmacChannel & channel = DMAC->Channel [mDMAChannel] ;
+  channel.CHCTRLA.reg = 0 ;
+  while ((channel.CHCTRLA.reg & DMAC_CHCTRLA_ENABLE) != 0) {}
+  channel.CHCTRLA.reg = DMAC_CHCTRLA_SWRST ;
+  while ((channel.CHCTRLA.reg & DMAC_CHCTRLA_SWRST) != 0) {}
+  channel.CHCTRLA.reg = DMAC_CHCTRLA_TRIGSRC (0) | DMAC_CHCTRLA_TRIGACT_TRANSACTION ;
+  channel.CHINTENSET.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR ;
+//--- DMAC interrupt has CAN interrupt priority
+  const IRQn_Type canIRQ = interruptNumber () ;
+  const IRQn_Type dmaIRQ = IRQn_Type ((mDMAChannel < 4) ? (DMAC_0_IRQn + mDMAChannel) : DMAC_4_IRQn) ;
+  NVIC_SetPriority (dmaIRQ, NVIC_GetPriority (canIRQ)) ;
+  NVIC_EnableIRQ (dmaIRQ) ;
+  mDMAEnabled = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+DmacDescriptor * ACANFD_FeatherM4CAN::dmaDescriptorAtIndex (const uint32_t inIndex) const {
+  return (inIndex == 0) ? mDMAFirstDescriptor : & mDMALinkedDescriptors [inIndex - 1] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::startDMATransfer (const uint32_t inDescriptorCount) {
+  mDMAElementCount = uint8_t (inDescriptorCount) ;
+  for (uint32_t i=1 ; i<inDescriptorCount ; i++) {
+    dmaDescriptorAtIndex (i - 1)->DESCADDR.reg = uint32_t (dmaDescriptorAtIndex (i)) ;
+  }
+  dmaDescriptorAtIndex (inDescriptorCount - 1)->BTCTRL.reg |= DMAC_BTCTRL_BLOCKACT_INT ;
+  __DSB () ; // Descriptors are written before the DMAC fetches them
+  DMAC->Channel [mDMAChannel].CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE ;
+  DMAC->SWTRIGCTRL.reg = 1U << mDMAChannel ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns false if nothing can be transferred: hardware Rx FIFO is empty, or driver receive
+// FIFO is full.
+
+bool ACANFD_FeatherM4CAN::startReceiveDMA (const uint32_t inFIFOIndex) {
+  ACANFD_FeatherM4CAN_FIFO & driverFIFO = (inFIFOIndex == 0) ? mDriverReceiveFIFO0 : mDriverReceiveFIFO1 ;
+  const ACANFD_FeatherM4CAN_Settings::Payload payload = (inFIFOIndex == 0) ? mHardwareRxFIFO0Payload : mHardwareRxFIFO1Payload ;
+  const uint32_t * rxFIFOPointer = (inFIFOIndex == 0) ? mRxFIFO0Pointer : mRxFIFO1Pointer ;
+  const uint32_t rxfs = (inFIFOIndex == 0) ? mModulePtr->RXF0S.reg : mModulePtr->RXF1S.reg ;
+  const uint32_t rxfc = (inFIFOIndex == 0) ? mModulePtr->RXF0C.reg : mModulePtr->RXF1C.reg ; // Page 1155, 1159
+  uint32_t n = rxfs & 0x7F ; // Fill level
+  if (n > driverFIFO.freeCount ()) {
+    n = driverFIFO.freeCount () ;
+  }
+  if (n > DMA_MAX_ELEMENT_COUNT) {
+    n = DMA_MAX_ELEMENT_COUNT ;
+  }
+  if (n > 0) {
+    const uint32_t hardwareFIFOSize = (rxfc >> 16) & 0x7F ;
+    const uint32_t wordCount = ACANFD_FeatherM4CAN_Codec::elementWordCount (payload) ;
+    uint32_t elementIndex = (rxfs >> 8) & 0x3F ; // Get index
+    for (uint32_t i=0 ; i<n ; i++) {
+      const uint32_t * address = rxFIFOPointer + elementIndex * wordCount ;
+      CANFDMessage * message = driverFIFO.slotForAppend (uint16_t (i)) ;
+      ACANFD_FeatherM4CAN_Codec::decodeHeader (address, *message) ;
+      const uint32_t wc = ACANFD_FeatherM4CAN_Codec::dataWordCount (*message, wordCount - 2) ;
+      setDMADescriptor (dmaDescriptorAtIndex (i), address + 2, message->data32, (wc > 0) ? wc : 1) ;
+      mDMARxFIFOAcknowledgeIndex = uint8_t (elementIndex) ;
+      elementIndex += 1 ;
+      if (elementIndex == hardwareFIFOSize) {
+        elementIndex = 0 ;
+      }
+    }
+    mDMAState = (inFIFOIndex == 0) ? DMA_RECEIVE_FIFO0 : DMA_RECEIVE_FIFO1 ;
+    mDMALastTransferWasReception = true ;
+    startDMATransfer (n) ;
+  }
+  return n > 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::completeReceiveDMA (const uint32_t inFIFOIndex) {
+  ACANFD_FeatherM4CAN_FIFO & driverFIFO = (inFIFOIndex == 0) ? mDriverReceiveFIFO0 : mDriverReceiveFIFO1 ;
+  const ACANFD_FeatherM4CAN_Settings::Payload payload = (inFIFOIndex == 0) ? mHardwareRxFIFO0Payload : mHardwareRxFIFO1Payload ;
+  for (uint32_t i=0 ; i<mDMAElementCount ; i++) {
+    CANFDMessage & message = *driverFIFO.slotForAppend (uint16_t (i)) ;
+    ACANFD_FeatherM4CAN_Codec::fillMissingData (message, 4 * ACANFD_FeatherM4CAN_Codec::dataWordCount (payload)) ;
+    mReceivedFrameCount += 1 ;
+    if (message.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) {
+      mReceivedBRSFrameCount += 1 ;
+    }
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.recordReceivedFrame (message, micros ()) ;
+    }
+    if (mTraceLogger != nullptr) {
+      mTraceLogger->record (message, uint8_t (mModule == ACANFD_FeatherM4CAN_Module::can1)) ;
+    }
+    if (mTrafficStatistics != nullptr) {
+      mTrafficStatistics->record (message, micros ()) ;
+    }
+  }
+  driverFIFO.commitAppend (mDMAElementCount) ;
+//--- Release hardware Rx FIFO elements up to the last transferred one
+  if (inFIFOIndex == 0) {
+    mModulePtr->RXF0A.reg = mDMARxFIFOAcknowledgeIndex ;
+  }else{
+    mModulePtr->RXF1A.reg = mDMARxFIFOAcknowledgeIndex ;
+  }
+//--- Frames may have been received during transfer
+  mDMADeferredRxFIFOMask |= uint8_t (1U << inFIFOIndex) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::startTransmitDMA (void) {
+  const uint32_t txfqs = mModulePtr->TXFQS.reg ; // Page 1165
+  uint32_t n = txfqs & 0x3F ; // Free level
+  if (n > mDriverTransmitFIFO.count ()) {
+    n = mDriverTransmitFIFO.count () ;
+  }
+  if (n > DMA_MAX_ELEMENT_COUNT) {
+    n = DMA_MAX_ELEMENT_COUNT ;
+  }
+  if (n > 0) {
+    const uint32_t txbc = mModulePtr->TXBC.reg ; // Page 1164
+    const uint32_t dedicatedTxBufferCount = (txbc >> 16) & 0x3F ;
+    const uint32_t txFIFOSize = (txbc >> 24) & 0x3F ;
+    uint32_t txBufferIndex = (txfqs >> 16) & 0x1F ; // Put index
+    for (uint32_t i=0 ; i<n ; i++) {
+      CANFDMessage * message = mDriverTransmitFIFO.slotForRemove (uint16_t (i)) ;
+      if (mE2E != nullptr) {
+        mE2E->stamp (*message) ;
+      }
+      uint32_t * txBufferPtr = mTxBuffersPointer + txBufferIndex * mTxBufferElementWordCount ;
+      ACANFD_FeatherM4CAN_Codec::encodeHeader (*message, txBufferPtr) ;
+      const uint32_t wc = ACANFD_FeatherM4CAN_Codec::dataWordCount (*message, mTxBufferElementWordCount - 2U) ;
+      setDMADescriptor (dmaDescriptorAtIndex (i), message->data32, txBufferPtr + 2, (wc > 0) ? wc : 1) ;
+      mDMATxBufferIndexes [i] = uint8_t (txBufferIndex) ;
+      txBufferIndex += 1 ;
+      if (txBufferIndex == (dedicatedTxBufferCount + txFIFOSize)) {
+        txBufferIndex = dedicatedTxBufferCount ;
+      }
+    }
+    mDriverTransmitFIFO.pinHead (uint16_t (n)) ;
+    mDMAState = DMA_TRANSMIT ;
+    mDMALastTransferWasReception = false ;
+    startDMATransfer (n) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::completeTransmitDMA (void) {
+  if (mBusStatistics.isEnabled ()) {
+    mBusStatistics.handleTransmissionOccurred (mModulePtr->TXBTO.reg, micros ()) ; // Page 1169
+  }
+//--- Request transmissions one by one, for keeping FIFO order
+  for (uint32_t i=0 ; i<mDMAElementCount ; i++) {
+    const uint32_t txBufferIndex = mDMATxBufferIndexes [i] ;
+    if (mBusStatistics.isEnabled ()) {
+      mBusStatistics.noteTransmitRequest (*mDriverTransmitFIFO.slotForRemove (uint16_t (i)), txBufferIndex) ;
+    }
+    mModulePtr->TXBAR.reg = 1U << txBufferIndex ; // Page 1168
+  }
+  mDriverTransmitFIFO.discardPinnedHead () ;
+  mDMATransmitRequested = !mDriverTransmitFIFO.isEmpty () && !transmissionIsPaused () ;
+  writeTransmitRingIntoHardwareTxFIFO (false) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called with DMA idle, or busy (then nothing is done until completion). A deferred hardware Rx FIFO
+// is copied by CPU if received frames should now be inspected: a gateway, an ISO-TP engine, an E2E
+// module or a merged receive stream has been set since its RFnN interrupt.
+
+void ACANFD_FeatherM4CAN::scheduleDMA (void) {
+//--- After a reception, a pending transmission goes first
+  if ((mDMAState == DMA_IDLE) && mDMATransmitRequested && mDMALastTransferWasReception) {
+    mDMATransmitRequested = false ;
+    startTransmitDMA () ;
+  }
+//--- Hardware Rx FIFOs
+  for (uint32_t fifoIndex = 0 ; (fifoIndex < 2) && (mDMAState == DMA_IDLE) ; fifoIndex++) {
+    const uint8_t mask = uint8_t (1U << fifoIndex) ;
+    if ((mDMADeferredRxFIFOMask & mask) != 0) {
+    //--- Clear flag before reading fill level: a frame received from now raises it again
+      mModulePtr->IR.reg = (fifoIndex == 0) ? CAN_IR_RF0N : CAN_IR_RF1N ;
+      if (!receptionUsesDMA () || !startReceiveDMA (fifoIndex)) {
+      //--- Frames are inspected, or driver receive FIFO is full: CPU transfer applies driver FIFO
+      //    overflow policy
+        bool loop = true ;
+        while (loop) {
+          const uint32_t rxfs = (fifoIndex == 0) ? mModulePtr->RXF0S.reg : mModulePtr->RXF1S.reg ;
+          loop = (rxfs & 0x7F) > 0 ;
+          if (loop) {
+            receiveFromHardwareRxFIFO (fifoIndex) ;
+          }
+        }
+      //--- Hardware Rx FIFO is empty
+        mDMADeferredRxFIFOMask &= uint8_t (~ mask) ;
+        mModulePtr->IE.reg |= (fifoIndex == 0) ? CAN_IE_RF0NE : CAN_IE_RF1NE ;
+      }
+    }
+  }
+//--- Hardware Tx FIFO
+  if ((mDMAState == DMA_IDLE) && mDMATransmitRequested) {
+    mDMATransmitRequested = false ;
+    startTransmitDMA () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// On transfer error, DMA is disabled, and frames are copied by CPU from now
+
+void ACANFD_FeatherM4CAN::abortDMA (void) {
+  DmacChannel & channel = DMAC->Channel [mDMAChannel] ;
+  channel.CHCTRLA.reg &= ~ DMAC_CHCTRLA_ENABLE ;
+  channel.CHINTENCLR.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR ;
+  mDMAEnabled = false ;
+//--- Transmit FIFO head messages are written again by CPU
+  if (mDMAState == DMA_TRANSMIT) {
+    mDriverTransmitFIFO.unpinHead () ;
+  }
+  mDMAState = DMA_IDLE ;
+  mDMADeferredRxFIFOMask = 0 ;
+  mDMATransmitRequested = false ;
+//--- Hardware Rx FIFO elements have not been acknowledged
+  while ((mModulePtr->RXF0S.reg & 0x7F) > 0) {
+    receiveFromHardwareRxFIFO (0) ;
+  }
+  while ((mModulePtr->RXF1S.reg & 0x7F) > 0) {
+    receiveFromHardwareRxFIFO (1) ;
+  }
+  mModulePtr->IE.reg |= CAN_IE_RF0NE | CAN_IE_RF1NE ;
+  writeDriverTransmitFIFOIntoHardwareTxFIFO () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::dmaInterruptServiceRoutine (void) {
+  DmacChannel & channel = DMAC->Channel [mDMAChannel] ;
+  const uint8_t flags = channel.CHINTFLAG.reg ;
+  channel.CHINTFLAG.reg = flags ; // Interrupt acknowledge
+  if ((flags & DMAC_CHINTFLAG_TERR) != 0) {
+    abortDMA () ;
+  }else if ((flags & DMAC_CHINTFLAG_TCMPL) != 0) {
+    const DMAState state = mDMAState ;
+    mDMAState = DMA_IDLE ;
+    switch (state) {
+    case DMA_IDLE :
+      break ;
+    case DMA_RECEIVE_FIFO0 :
+      completeReceiveDMA (0) ;
+      break ;
+    case DMA_RECEIVE_FIFO1 :
+      completeReceiveDMA (1) ;
+      break ;
+    case DMA_TRANSMIT :
+      completeTransmitDMA () ;
+      break ;
+    }
+    scheduleDMA () ;
+    noteWaitedEvents () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   SLEEPING UNTIL DRIVER EVENTS
+//   WFI is executed with interrupts disabled (PRIMASK): an interrupt that becomes pending wakes up
+//   the core without being taken, so an event cannot occur between its test and WFI. Interrupts are
+//   then enabled for servicing it.
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t CPU_CYCLES_PER_MICROSECOND = F_CPU / 1000000 ;
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN::occurredEvents (const uint32_t inEvents) const {
+  uint32_t events = 0 ;
+  if (((inEvents & kEventReceiveFIFO0) != 0)
+   && (!mDriverReceiveFIFO0.isEmpty () || !mDriverClassicReceiveFIFO0.isEmpty ())) {
+    events |= kEventReceiveFIFO0 ;
+  }
+  if (((inEvents & kEventReceiveFIFO1) != 0)
+   && (!mDriverReceiveFIFO1.isEmpty () || !mDriverClassicReceiveFIFO1.isEmpty ())) {
+    events |= kEventReceiveFIFO1 ;
+  }
+  if (((inEvents & kEventTransmitFIFOBelowThreshold) != 0) && (transmitFIFOCount () <= mTransmitFIFOWakeThreshold)) {
+    events |= kEventTransmitFIFOBelowThreshold ;
+  }
+  if (((inEvents & kEventErrorStateChange) != 0) && mErrorStateChanged) {
+    events |= kEventErrorStateChange ;
+  }
+  return events ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called at the end of interrupt service routines, with interrupts disabled
+
+void ACANFD_FeatherM4CAN::noteWaitedEvents (void) {
+  if ((mWaitedEvents != 0) && (occurredEvents (mWaitedEvents) != 0)) {
+    mWaitedEventDate = DWT->CYCCNT ;
+    mWaitedEvents = 0 ; // Only the first event is dated
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN::waitForEvents (const uint32_t inEvents,
+                                             const uint32_t inTimeout,
+                                             const uint16_t inTransmitFIFOThreshold) {
+//--- DWT cycle counter
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk ;
+    DWT->CYCCNT = 0 ;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk ;
+  }
+//--- IDLE sleep mode keeps CAN clocks running; SLEEPCFG should read the written value before WFI
+  if (PM->SLEEPCFG.reg != PM_SLEEPCFG_SLEEPMODE_IDLE) {
+    PM->SLEEPCFG.reg = PM_SLEEPCFG_SLEEPMODE_IDLE ;
+    while (PM->SLEEPCFG.reg != PM_SLEEPCFG_SLEEPMODE_IDLE) {}
+  }
+  const uint32_t start = micros () ;
+  bool slept = false ;
+  bool timeout = false ;
+  noInterrupts () ;
+    mWakeStatistics.mWaitCount += 1 ;
+    mTransmitFIFOWakeThreshold = inTransmitFIFOThreshold ;
+    uint32_t events = occurredEvents (inEvents) ;
+    while ((events == 0) && !timeout) {
+      mWaitedEvents = inEvents ;
+      __DSB () ;
+      __WFI () ;
+      slept = true ;
+      mWakeStatistics.mSleepCount += 1 ;
+      interrupts () ; // Pending interrupts are serviced here
+      noInterrupts () ;
+      events = occurredEvents (inEvents) ;
+      timeout = (inTimeout > 0) && ((micros () - start) >= inTimeout) ;
+    }
+  //--- Wake latency, if an interrupt service routine has dated the event
+    if (slept && (events != 0) && (mWaitedEvents == 0)) {
+      const uint32_t cycles = DWT->CYCCNT - mWaitedEventDate ;
+      const uint32_t latency = uint32_t (uint64_t (cycles) * 1000 / CPU_CYCLES_PER_MICROSECOND) ;
+      mWakeStatistics.mWakeCount += 1 ;
+      mWakeStatistics.mWakeLatencySum += latency ;
+      if (mWakeStatistics.mMinWakeLatency > latency) {
+        mWakeStatistics.mMinWakeLatency = latency ;
+      }
+      if (mWakeStatistics.mMaxWakeLatency < latency) {
+        mWakeStatistics.mMaxWakeLatency = latency ;
+      }
+    }
+    mWaitedEvents = 0 ;
+    if (events == 0) {
+      mWakeStatistics.mTimeoutCount += 1 ;
+    }
+    if ((events & kEventErrorStateChange) != 0) {
+      mErrorStateChanged = false ;
+    }
+  interrupts () ;
+  return events ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::WakeStatistics ACANFD_FeatherM4CAN::wakeStatistics (void) {
+  noInterrupts () ;
+    const WakeStatistics result = mWakeStatistics ;
+  interrupts () ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::resetWakeStatistics (void) {
+  noInterrupts () ;
+    mWakeStatistics = WakeStatistics () ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   ERROR HANDLING
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::handleErrorInterrupts (const uint32_t inIR) {
+  const uint32_t psr = mModulePtr->PSR.reg ; // Reading PSR resets LEC and DLEC to 7 (page 1131)
+//--- Error warning, error passive and bus off interrupts are raised on status change
+  if ((inIR & (CAN_IR_EW | CAN_IR_EP | CAN_IR_BO)) != 0) {
+    mErrorStateChanged = true ;
+  }
+//--- Protocol errors
+  if ((inIR & CAN_IR_PEA) != 0) {
+    const uint32_t lec = psr & 0x7 ;
+    mErrorStatistics.mArbitrationPhaseErrorCount [lec] += 1 ;
+  }
+  if ((inIR & CAN_IR_PED) != 0) {
+    const uint32_t dlec = (psr >> 8) & 0x7 ;
+    mErrorStatistics.mDataPhaseErrorCount [dlec] += 1 ;
+  }
+//--- Error warning, error passive: the interrupt is raised on status change
+  if (((inIR & CAN_IR_EW) != 0) && ((psr & (1 << 6)) != 0)) {
+    mErrorStatistics.mErrorWarningCount += 1 ;
+  }
+  if (((inIR & CAN_IR_EP) != 0) && ((psr & (1 << 5)) != 0)) {
+    mErrorStatistics.mErrorPassiveCount += 1 ;
+  }
+//--- Bus off: the interrupt is raised on status change
+  if ((inIR & CAN_IR_BO) != 0) {
+    const bool busOff = (psr & (1 << 7)) != 0 ;
+    if (busOff && !mBusOff) { // Enter bus off, CCCR.INIT has been set by hardware (page 1123)
+      mBusOff = true ;
+      mBusOffDate = millis () ;
+      mErrorStatistics.mBusOffCount += 1 ;
+      switch (mBusOffRecoveryPolicy) {
+      case ACANFD_FeatherM4CAN_Settings::BUS_OFF_RECOVERY_MANUAL :
+        break ;
+      case ACANFD_FeatherM4CAN_Settings::BUS_OFF_RECOVERY_IMMEDIATE :
+        startBusOffRecoverySequence () ;
+        break ;
+      case ACANFD_FeatherM4CAN_Settings::BUS_OFF_RECOVERY_WITH_BACKOFF :
+        mBusOffRecoveryPending = true ;
+        break ;
+      }
+    }else if (!busOff && mBusOff) { // Recovery sequence completed
+      mBusOff = false ;
+      mErrorStatistics.mBusOffRecoveryCount += 1 ;
+      mErrorStatistics.mBusOffDuration += millis () - mBusOffDate ;
+      writeDriverTransmitFIFOIntoHardwareTxFIFO () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::startBusOffRecoverySequence (void) {
+  mBusOffRecoveryPending = false ;
+//--- Resetting INIT starts the recovery sequence: 129 occurrences of 11 recessive bits
+  if ((mModulePtr->CCCR.reg & CAN_CCCR_INIT) != 0) { // Page 1123
+    mModulePtr->CCCR.reg &= ~ CAN_CCCR_INIT ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::recoverFromBusOff (void) {
+  noInterrupts () ;
+    if (mBusOff) {
+      startBusOffRecoverySequence () ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::pollBusOffRecovery (void) {
+  noInterrupts () ;
+    if (mBusOffRecoveryPending && ((millis () - mBusOffDate) >= mBusOffRecoveryDelay)) {
+      const uint32_t nextDelay = mBusOffRecoveryDelay * 2 ;
+      mBusOffRecoveryDelay = (nextDelay < mBusOffRecoveryMaximumDelay) ? nextDelay : mBusOffRecoveryMaximumDelay ;
+      startBusOffRecoverySequence () ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::ErrorStatistics ACANFD_FeatherM4CAN::errorStatistics (void) {
+  noInterrupts () ;
+    const ErrorStatistics result = mErrorStatistics ;
+  interrupts () ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::resetErrorStatistics (void) {
+  noInterrupts () ;
+    mErrorStatistics = ErrorStatistics () ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::pauseTransmission (void) {
+  noInterrupts () ;
+    mTransmissionPaused = true ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::resumeTransmission (void) {
+  noInterrupts () ;
+    mTransmissionPaused = false ;
+    writeDriverTransmitFIFOIntoHardwareTxFIFO () ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   AUTOMATIC BIT RATE DETECTION
+//   While a candidate is tried, its protocol errors are counted by handleErrorInterrupts, and its
+//   received frames by handleRxFIFOElement (or completeReceiveDMA).
+//--------------------------------------------------------------------------------------------------
+
+// Every PEA / PED interrupt is counted, whatever LEC / DLEC value: PSR register can have been read
+// (by getStatus) before the interrupt service routine
+
+static uint32_t protocolErrorCount (const ACANFD_FeatherM4CAN::ErrorStatistics & inStatistics) {
+  uint32_t result = 0 ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    result += inStatistics.mArbitrationPhaseErrorCount [i] + inStatistics.mDataPhaseErrorCount [i] ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN::beginBitRateDetection (const ACANFD_FeatherM4CAN_Settings * inCandidates,
+                                                     const uint8_t inCandidateCount,
+                                                     const uint32_t inDwellTime,
+                                                     const uint8_t inRequiredFrameCount,
+                                                     const ACANFD_FeatherM4CAN_Settings::ModuleMode inLockedMode) {
+  uint32_t errorCode = 0 ;
+  if (mTxBuffersPointer == nullptr) {
+    errorCode = kControllerNotStarted ;
+  }else if (mTDCCalibrationState == TDC_CALIBRATION_RUNNING) { // Both procedures save and write CCCR
+    errorCode = kTDCCalibrationRunning ;
+  }else if (mBitRateDetectionState == BIT_RATE_DETECTION_RUNNING) {
+    errorCode = kBitRateDetectionRunning ;
+  }else{
+    noInterrupts () ;
+      mBitRateDetectionErrorStatistics = mErrorStatistics ;
+    interrupts () ;
+    mBitRateSavedCCCR = mModulePtr->CCCR.reg & ~ (CAN_CCCR_INIT | CAN_CCCR_CCE) ;
+    mBitRateSavedTEST = mModulePtr->TEST.reg & CAN_TEST_LBCK ;
+    mBitRateSavedNBTP = mModulePtr->NBTP.reg ;
+    mBitRateSavedDBTP = mModulePtr->DBTP.reg ;
+    mBitRateSavedTDCR = mModulePtr->TDCR.reg ;
+    mBitRateSavedNominalBitClockCount = mNominalBitClockCount ;
+    mBitRateCandidates = inCandidates ;
+    mBitRateCandidateCount = inCandidateCount ;
+    mBitRateCandidateIndex = 0 ;
+    mBitRateDetectionDwellTime = inDwellTime ;
+    mBitRateRequiredFrameCount = (inRequiredFrameCount > 0) ? inRequiredFrameCount : 1 ;
+    mBitRateLockedMode = inLockedMode ;
+    mDataBitRateVerified = false ;
+    mBitRateDetectionDuration = 0 ;
+    mBitRateDetectionStartDate = millis () ;
+    mBitRateDetectionState = BIT_RATE_DETECTION_RUNNING ;
+    startBitRateCandidate () ;
+  }
+  return errorCode ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::BitRateDetectionState ACANFD_FeatherM4CAN::pollBitRateDetection (void) {
+  if (mBitRateDetectionState == BIT_RATE_DETECTION_RUNNING) {
+    noInterrupts () ;
+      const uint32_t errorCount = protocolErrorCount (mErrorStatistics) - mBitRateCandidateErrorCount ;
+      const uint32_t frameCount = mReceivedFrameCount - mBitRateCandidateFrameCount ;
+      const uint32_t brsFrameCount = mReceivedBRSFrameCount - mBitRateCandidateBRSFrameCount ;
+    interrupts () ;
+    if (errorCount > 0) {
+      mBitRateCandidateIndex += 1 ;
+      startBitRateCandidate () ;
+    }else if (frameCount >= mBitRateRequiredFrameCount) {
+      mDataBitRateVerified = brsFrameCount > 0 ;
+      endBitRateDetection (BIT_RATE_DETECTION_LOCKED) ;
+    }else if ((millis () - mBitRateCandidateStartDate) >= mBitRateDetectionDwellTime) {
+      mBitRateCandidateIndex += 1 ;
+      startBitRateCandidate () ;
+    }
+  }
+  return mBitRateDetectionState ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Candidates whose bit setting is not correct are skipped. The controller leaves INIT state in bus
+// monitoring mode; it integrates to bus activity (11 consecutive recessive bits) before receiving,
+// so a frame in progress when a candidate starts is ignored.
+
+void ACANFD_FeatherM4CAN::startBitRateCandidate (void) {
+  while ((mBitRateCandidateIndex < mBitRateCandidateCount)
+      && !mBitRateCandidates [mBitRateCandidateIndex].mBitSettingOk) {
+    mBitRateCandidateIndex += 1 ;
+  }
+  if (mBitRateCandidateIndex == mBitRateCandidateCount) {
+    endBitRateDetection (BIT_RATE_DETECTION_FAILED) ;
+  }else{
+    const uint32_t cccr = mModulePtr->CCCR.reg & (CAN_CCCR_BRSE | CAN_CCCR_FDOE | CAN_CCCR_DAR) ;
+    enterConfigurationMode () ;
+    writeBitTiming (mBitRateCandidates [mBitRateCandidateIndex]) ;
+    leaveConfigurationMode (cccr | writeModuleMode (ACANFD_FeatherM4CAN_Settings::BUS_MONITORING)) ;
+    noInterrupts () ;
+      mBitRateCandidateErrorCount = protocolErrorCount (mErrorStatistics) ;
+      mBitRateCandidateFrameCount = mReceivedFrameCount ;
+      mBitRateCandidateBRSFrameCount = mReceivedBRSFrameCount ;
+    interrupts () ;
+    mBitRateCandidateStartDate = millis () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::endBitRateDetection (const BitRateDetectionState inState) {
+  if (inState == BIT_RATE_DETECTION_LOCKED) {
+    const uint32_t cccr = mModulePtr->CCCR.reg & (CAN_CCCR_BRSE | CAN_CCCR_FDOE | CAN_CCCR_DAR) ;
+    enterConfigurationMode () ;
+    leaveConfigurationMode (cccr | writeModuleMode (mBitRateLockedMode)) ;
+    noInterrupts () ;
+      mBusStatistics.setBitTimings (mBitRateCandidates [mBitRateCandidateIndex]) ;
+      mErrorStatistics = mBitRateDetectionErrorStatistics ;
+    interrupts () ;
+  }else{ // Failed: restore bit timing and mode of the controller before detection
+    enterConfigurationMode () ;
+    mModulePtr->NBTP.reg = mBitRateSavedNBTP ;
+    mModulePtr->DBTP.reg = mBitRateSavedDBTP ;
+    mModulePtr->TDCR.reg = mBitRateSavedTDCR ;
+    mModulePtr->TEST.reg = mBitRateSavedTEST ;
+    mNominalBitClockCount = mBitRateSavedNominalBitClockCount ;
+    leaveConfigurationMode (mBitRateSavedCCCR) ;
+    noInterrupts () ;
+      mErrorStatistics = mBitRateDetectionErrorStatistics ;
+    interrupts () ;
+  }
+  mBitRateDetectionDuration = millis () - mBitRateDetectionStartDate ;
+  mBitRateDetectionState = inState ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRANSCEIVER DELAY COMPENSATION CALIBRATION
+//   A test frame is error free if it has been sent (TXBRP bit reset) without protocol error. As
+//   automatic retransmission is disabled, a failed test frame is not retransmitted: it increments
+//   transmit error count by 8 (a successful one decrements it), the calibration sends at most two
+//   failing offsets per candidate.
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t TDC_TEST_FRAME_TIMEOUT = 50 ; // In ms
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN::beginTDCCalibration (const ACANFD_FeatherM4CAN_Settings * inCandidates,
+                                                   const uint8_t inCandidateCount,
+                                                   const uint8_t inFrameCount,
+                                                   const uint16_t inTestFrameIdentifier) {
+  uint32_t errorCode = 0 ;
+  if (mTxBuffersPointer == nullptr) {
+    errorCode = kControllerNotStarted ;
+  }else if (mClassicCAN20BOnly) { // Test frames are CANFD frames, CCCR would enable CANFD
+    errorCode = kTDCCalibrationNeedsCANFD ;
+  }else if (mBitRateDetectionState == BIT_RATE_DETECTION_RUNNING) { // Both procedures save and write CCCR
+    errorCode = kBitRateDetectionRunning ;
+  }else if (mTDCCalibrationState == TDC_CALIBRATION_RUNNING) {
+    errorCode = kTDCCalibrationRunning ;
+  }else{
+    noInterrupts () ;
+      mTDCErrorStatistics = mErrorStatistics ;
+    interrupts () ;
+    mTDCSavedCCCR = mModulePtr->CCCR.reg & ~ (CAN_CCCR_INIT | CAN_CCCR_CCE) ;
+    mTDCSavedTEST = mModulePtr->TEST.reg & CAN_TEST_LBCK ;
+    mTDCSavedNBTP = mModulePtr->NBTP.reg ;
+    mTDCSavedDBTP = mModulePtr->DBTP.reg ;
+    mTDCSavedTDCR = mModulePtr->TDCR.reg ;
+    mTDCSavedNominalBitClockCount = mNominalBitClockCount ;
+    mTDCCandidates = inCandidates ;
+    mTDCCandidateCount = inCandidateCount ;
+    mTDCCandidateIndex = 0 ;
+    mTDCFrameCount = (inFrameCount > 0) ? inFrameCount : 1 ;
+    mTDCTestFrameIdentifier = inTestFrameIdentifier & 0x7FF ;
+    mTDCResultCandidateIndex = NO_CALIBRATED_CANDIDATE ;
+    mTDCCalibrationState = TDC_CALIBRATION_RUNNING ;
+    startTDCCandidate () ;
+  }
+  return errorCode ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN::TDCCalibrationState ACANFD_FeatherM4CAN::pollTDCCalibration (void) {
+  if (mTDCCalibrationState == TDC_CALIBRATION_RUNNING) {
+    noInterrupts () ;
+      const bool sent = (mModulePtr->TXBRP.reg == 0) && (mDriverTransmitFIFO.count () == 0) ;
+      const bool errorFree = (protocolErrorCount (mErrorStatistics) == mTDCFrameErrorCount)
+        && ((mModulePtr->IR.reg & (CAN_IR_PEA | CAN_IR_PED)) == 0) ;
+      const bool busOff = mBusOff ;
+    interrupts () ;
+    if (busOff) {
+      endTDCCalibration () ;
+    }else if (sent || !errorFree || ((millis () - mTDCFrameStartDate) >= TDC_TEST_FRAME_TIMEOUT)) {
+      handleTDCTestResult (sent && errorFree) ;
+    }
+  }
+  return mTDCCalibrationState ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The first tested offset is the data phase sample point, in CAN clock periods (DBTP uses the
+// nominal bit rate prescaler)
+
+void ACANFD_FeatherM4CAN::startTDCCandidate (void) {
+  while ((mTDCCandidateIndex < mTDCCandidateCount) && !mTDCCandidates [mTDCCandidateIndex].mBitSettingOk) {
+    mTDCCandidateIndex += 1 ;
+  }
+  if (mTDCCandidateIndex == mTDCCandidateCount) {
+    endTDCCalibration () ;
+  }else{
+    const ACANFD_FeatherM4CAN_Settings & candidate = mTDCCandidates [mTDCCandidateIndex] ;
+    const uint32_t samplePoint = uint32_t (candidate.mBitRatePrescaler) * (1U + candidate.mDataPhaseSegment1) ;
+    mTDCDerivedOffset = uint8_t ((samplePoint < 127) ? samplePoint : 127) ;
+    mTDCOffset = mTDCDerivedOffset ;
+    mTDCDecreasing = false ;
+    applyTDCOffset () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::applyTDCOffset (void) {
+  ACANFD_FeatherM4CAN_Settings settings = mTDCCandidates [mTDCCandidateIndex] ;
+  settings.mTransceiverDelayCompensation = mTDCOffset ;
+  settings.mTransceiverDelayCompensationFilter = 0 ;
+  enterConfigurationMode () ;
+  writeBitTiming (settings) ;
+  const uint32_t cccr = CAN_CCCR_BRSE | CAN_CCCR_FDOE | CAN_CCCR_DAR ;
+  leaveConfigurationMode (cccr | writeModuleMode (ACANFD_FeatherM4CAN_Settings::EXTERNAL_LOOP_BACK)) ;
+  mTDCSentFrameCount = 0 ;
+  sendTDCTestFrame () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Alternating bits in data field: the data phase has the highest edge rate
+
+void ACANFD_FeatherM4CAN::sendTDCTestFrame (void) {
+  CANFDMessage frame ;
+  frame.id = mTDCTestFrameIdentifier ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  for (uint32_t i=0 ; i<16 ; i++) {
+    frame.data32 [i] = 0x55555555 ;
+  }
+  noInterrupts () ;
+    mTDCFrameErrorCount = protocolErrorCount (mErrorStatistics) ;
+  interrupts () ;
+  mTDCFrameStartDate = millis () ;
+  mTDCSentFrameCount += 1 ;
+  if (tryToSendReturnStatusFD (frame) != 0) {
+    handleTDCTestResult (false) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN::handleTDCTestResult (const bool inErrorFree) {
+  if (inErrorFree && (mTDCSentFrameCount < mTDCFrameCount)) { // Next test frame, same offset
+    sendTDCTestFrame () ;
+  }else if (!mTDCDecreasing) { // Increasing from derived offset
+    if (inErrorFree && (mTDCOffset == mTDCDerivedOffset)) { // SSP position, minus offset (page 1131)
+      const uint32_t tdcv = (mModulePtr->PSR.reg >> 16) & 0x7F ;
+      mTDCDelay = uint8_t ((tdcv > mTDCOffset) ? (tdcv - mTDCOffset) : 0) ;
+    }
+    if (inErrorFree) {
+      mTDCMaxOffset = mTDCOffset ;
+    }
+    if (!inErrorFree && (mTDCOffset == mTDCDerivedOffset)) { // Candidate fails: calibration ends
+      endTDCCalibration () ;
+    }else if (inErrorFree && (mTDCOffset < 127)) {
+      mTDCOffset += 1 ;
+      applyTDCOffset () ;
+    }else{
+      mTDCDecreasing = true ;
+      mTDCMinOffset = mTDCDerivedOffset ;
+      mTDCOffset = mTDCDerivedOffset ;
+      if (mTDCOffset > 0) {
+        mTDCOffset -= 1 ;
+        applyTDCOffset () ;
+      }else{
+        handleTDCTestResult (false) ;
+      }
     }
+  }else if (inErrorFree && (mTDCOffset > 0)) { // Decreasing
+    mTDCMinOffset = mTDCOffset ;
+    mTDCOffset -= 1 ;
+    applyTDCOffset () ;
+  }else{ // Error free window of candidate is found
+    if (inErrorFree) {
+      mTDCMinOffset = mTDCOffset ;
+    }
+    mTDCResultCandidateIndex = mTDCCandidateIndex ;
+    mTDCResultMinOffset = mTDCMinOffset ;
+    mTDCResultMaxOffset = mTDCMaxOffset ;
+    mTDCResultOffset = uint8_t ((uint32_t (mTDCMinOffset) + mTDCMaxOffset) / 2) ;
+    const uint32_t filter = mTDCResultOffset + mTDCDelay / 2U ;
+    mTDCResultFilter = uint8_t ((filter < 127) ? filter : 127) ;
+    mTDCResultDelay = mTDCDelay ;
+    mTDCCandidateIndex += 1 ;
+    startTDCCandidate () ;
   }
 }
 
 //--------------------------------------------------------------------------------------------------
 
+void ACANFD_FeatherM4CAN::endTDCCalibration (void) {
+  enterConfigurationMode () ;
+  mModulePtr->NBTP.reg = mTDCSavedNBTP ;
+  mModulePtr->DBTP.reg = mTDCSavedDBTP ;
+  mModulePtr->TDCR.reg = mTDCSavedTDCR ;
+  mModulePtr->TEST.reg = mTDCSavedTEST ;
+  mNominalBitClockCount = mTDCSavedNominalBitClockCount ;
+  leaveConfigurationMode (mTDCSavedCCCR) ;
+  noInterrupts () ;
+    mErrorStatistics = mTDCErrorStatistics ;
+  interrupts () ;
+  mTDCCalibrationState = (mTDCResultCandidateIndex == NO_CALIBRATED_CANDIDATE)
+    ? TDC_CALIBRATION_FAILED
+    : TDC_CALIBRATION_DONE ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 ACANFD_FeatherM4CAN::Status::Status (Can * inModulePtr) :
 mErrorCount (uint16_t (inModulePtr->ECR.reg)),
 mProtocolStatus (inModulePtr->PSR.reg) {
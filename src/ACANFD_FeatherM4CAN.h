@@ -21,14 +21,71 @@
   #error "The CAN1_MESSAGE_RAM_SIZE compile time symbol should be defined in the .ino file, before including <ACANFD_FeatherM4CAN.h>"
 #endif
 
+//--------------------------------------------------------------------------------------------------
+// Optional: CAN_MESSAGE_RAM_ARENA_SIZE compile time symbol defines a single message RAM array,
+// shared by CAN0 and CAN1: in beginFD, every controller takes from it exactly the size its
+// settings and filters require. CAN0_MESSAGE_RAM_SIZE and CAN1_MESSAGE_RAM_SIZE then only select
+// configured modules (0: not configured, other value: configured).
+// Hint: print canX.messageRamLayout () for getting where each section went.
+//--------------------------------------------------------------------------------------------------
+
+#ifdef CAN_MESSAGE_RAM_ARENA_SIZE
+  #if CAN_MESSAGE_RAM_ARENA_SIZE <= 0
+    #error "CAN_MESSAGE_RAM_ARENA_SIZE should be greater than 0"
+  #endif
+
+  static uint32_t gMessageRamArenaWords [CAN_MESSAGE_RAM_ARENA_SIZE] ;
+
+  ACANFD_FeatherM4CAN_MessageRamArena gMessageRamArena (gMessageRamArenaWords, CAN_MESSAGE_RAM_ARENA_SIZE) ;
+
+  #define ACANFD_FEATHER_M4_CAN0_MESSAGE_RAM gMessageRamArena
+  #define ACANFD_FEATHER_M4_CAN1_MESSAGE_RAM gMessageRamArena
+#else
+  #define ACANFD_FEATHER_M4_CAN0_MESSAGE_RAM gMessageRam0, CAN0_MESSAGE_RAM_SIZE
+  #define ACANFD_FEATHER_M4_CAN1_MESSAGE_RAM gMessageRam1, CAN1_MESSAGE_RAM_SIZE
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Optional: CAN0_DMA_CHANNEL and CAN1_DMA_CHANNEL compile time symbols select the DMAC channel
+// (0, 1, 2 or 3) used for copying frames between message RAM and driver FIFOs. If not defined,
+// frames are copied by CPU.
+//--------------------------------------------------------------------------------------------------
+
+#if defined (CAN0_DMA_CHANNEL) && defined (CAN1_DMA_CHANNEL)
+  #if CAN0_DMA_CHANNEL == CAN1_DMA_CHANNEL
+    #error "CAN0_DMA_CHANNEL and CAN1_DMA_CHANNEL should be different"
+  #endif
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+#define ACANFD_FEATHER_M4_CAN_DMAC_HANDLER(channel) ACANFD_FEATHER_M4_CAN_DMAC_HANDLER_NAME (channel)
+#define ACANFD_FEATHER_M4_CAN_DMAC_HANDLER_NAME(channel) DMAC_##channel##_Handler
+
 //--------------------------------------------------------------------------------------------------
 //  CAN0
 //--------------------------------------------------------------------------------------------------
 
 #if CAN0_MESSAGE_RAM_SIZE > 0
-  static uint32_t gMessageRam0 [CAN0_MESSAGE_RAM_SIZE] ;
+  #ifndef CAN_MESSAGE_RAM_ARENA_SIZE
+    static uint32_t gMessageRam0 [CAN0_MESSAGE_RAM_SIZE] ;
+  #endif
+
+  #ifdef CAN0_DMA_CHANNEL
+    #if (CAN0_DMA_CHANNEL < 0) || (CAN0_DMA_CHANNEL > 3)
+      #error "CAN0_DMA_CHANNEL should be 0, 1, 2 or 3"
+    #endif
 
-  ACANFD_FeatherM4CAN can0 (ACANFD_FeatherM4CAN_Module::can0, gMessageRam0, CAN0_MESSAGE_RAM_SIZE) ;
+    ACANFD_FeatherM4CAN can0 (ACANFD_FeatherM4CAN_Module::can0, ACANFD_FEATHER_M4_CAN0_MESSAGE_RAM, CAN0_DMA_CHANNEL) ;
+
+    extern "C" void ACANFD_FEATHER_M4_CAN_DMAC_HANDLER (CAN0_DMA_CHANNEL) (void) ; // SHOULD HAVE C LINKAGE
+
+    void ACANFD_FEATHER_M4_CAN_DMAC_HANDLER (CAN0_DMA_CHANNEL) (void) {
+      can0.dmaInterruptServiceRoutine () ;
+    }
+  #else
+    ACANFD_FeatherM4CAN can0 (ACANFD_FeatherM4CAN_Module::can0, ACANFD_FEATHER_M4_CAN0_MESSAGE_RAM) ;
+  #endif
 
   extern "C" void CAN0_Handler (void) ; // SHOULD HAVE C LINKAGE
 
@@ -42,9 +99,25 @@
 //--------------------------------------------------------------------------------------------------
 
 #if CAN1_MESSAGE_RAM_SIZE > 0
-  uint32_t gMessageRam1 [CAN1_MESSAGE_RAM_SIZE] ;
+  #ifndef CAN_MESSAGE_RAM_ARENA_SIZE
+    uint32_t gMessageRam1 [CAN1_MESSAGE_RAM_SIZE] ;
+  #endif
+
+  #ifdef CAN1_DMA_CHANNEL
+    #if (CAN1_DMA_CHANNEL < 0) || (CAN1_DMA_CHANNEL > 3)
+      #error "CAN1_DMA_CHANNEL should be 0, 1, 2 or 3"
+    #endif
+
+    ACANFD_FeatherM4CAN can1 (ACANFD_FeatherM4CAN_Module::can1, ACANFD_FEATHER_M4_CAN1_MESSAGE_RAM, CAN1_DMA_CHANNEL) ;
+
+    extern "C" void ACANFD_FEATHER_M4_CAN_DMAC_HANDLER (CAN1_DMA_CHANNEL) (void) ; // SHOULD HAVE C LINKAGE
 
-  ACANFD_FeatherM4CAN can1 (ACANFD_FeatherM4CAN_Module::can1, gMessageRam1, CAN1_MESSAGE_RAM_SIZE) ;
+    void ACANFD_FEATHER_M4_CAN_DMAC_HANDLER (CAN1_DMA_CHANNEL) (void) {
+      can1.dmaInterruptServiceRoutine () ;
+    }
+  #else
+    ACANFD_FeatherM4CAN can1 (ACANFD_FeatherM4CAN_Module::can1, ACANFD_FEATHER_M4_CAN1_MESSAGE_RAM) ;
+  #endif
 
   extern "C" void CAN1_Handler (void) ; // SHOULD HAVE C LINKAGE
 
@@ -0,0 +1,253 @@
+//--------------------------------------------------------------------------------------------------
+// Frame formats refer to ISO 11898-1:2015
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_BusStatistics.h>
+
+//--------------------------------------------------------------------------------------------------
+// Default constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_BusStatistics::ACANFD_FeatherM4CAN_BusStatistics (void) :
+mSlots (),
+mTxBufferFrameDuration (),
+mTxBufferPayloadLength (),
+mTxBufferPendingMask (0),
+mArbitrationBitDuration (0),
+mDataBitDuration (0),
+mSlotDuration (125 * 1000),
+mCurrentSlotStartDate (0),
+mTotalReceivedFrameCount (0),
+mTotalTransmittedFrameCount (0),
+mTotalPayloadByteCount (0),
+mCurrentSlotIndex (0),
+mElapsedSlotCount (0),
+mEnabled (false) {
+}
+
+//--------------------------------------------------------------------------------------------------
+// Init
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::init (const ACANFD_FeatherM4CAN_Settings & inSettings,
+                                              const uint32_t inDateMicros) {
+  mEnabled = inSettings.mEnableBusStatistics ;
+  mArbitrationBitDuration = inSettings.arbitrationBitDuration () ;
+  mDataBitDuration = inSettings.dataBitDuration () ;
+  mSlotDuration = inSettings.mBusStatisticsSlotDuration ;
+  if (mSlotDuration < 1000) {
+    mSlotDuration = 1000 ;
+  }else if (mSlotDuration > 10 * 1000 * 1000) { // Busy duration of a slot should fit in 32 bits
+    mSlotDuration = 10 * 1000 * 1000 ;
+  }
+  for (uint32_t i=0 ; i<SLOT_COUNT ; i++) {
+    mSlots [i] = Slot () ;
+  }
+  mTxBufferPendingMask = 0 ;
+  mCurrentSlotStartDate = inDateMicros ;
+  mTotalReceivedFrameCount = 0 ;
+  mTotalTransmittedFrameCount = 0 ;
+  mTotalPayloadByteCount = 0 ;
+  mCurrentSlotIndex = 0 ;
+  mElapsedSlotCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::setBitTimings (const ACANFD_FeatherM4CAN_Settings & inSettings) {
+  mArbitrationBitDuration = inSettings.arbitrationBitDuration () ;
+  mDataBitDuration = inSettings.dataBitDuration () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame bit counts
+//   CAN 2.0B frame: every bit is sent at arbitration bit rate; dynamic stuffing from SOF to CRC.
+//   CANFD frame: dynamic stuffing from SOF to end of data field; the stuff count and the CRC
+//   have fixed stuff bits (one before stuff count, then one every 4 bits). If BRS is set, bits
+//   from ESI to the end of CRC are sent at data bit rate.
+//   Worst case stuff bit count for n stuffed bits is (n - 1) / 4.
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t TRAILER_BIT_COUNT = 1 /* CRC delimiter */ + 1 /* ACK */ + 1 /* ACK delimiter */
+                                        + 7 /* EOF */ + 3 /* IFS */ ;
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_BusStatistics::classicFrameBitCount (const bool inExtended,
+                                                                  const uint32_t inDataBitCount) {
+//--- SOF, ID, RTR, IDE, r0, DLC, data, CRC (standard); SOF, ID, SRR, IDE, ID, RTR, r1, r0, DLC, data, CRC (extended)
+  const uint32_t stuffedBitCount = (inExtended ? 54 : 34) + inDataBitCount ;
+  return stuffedBitCount + (stuffedBitCount - 1) / 4 + TRAILER_BIT_COUNT ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::frameBitCounts (const CANFDMessage & inMessage,
+                                                        uint32_t & outArbitrationBitCount,
+                                                        uint32_t & outDataBitCount) {
+  switch (inMessage.type) {
+  case CANFDMessage::CAN_REMOTE :
+  case CANFDMessage::CAN_DATA :
+    { const uint32_t dataBitCount = (inMessage.type == CANFDMessage::CAN_DATA) ? (8 * inMessage.len) : 0 ;
+      outArbitrationBitCount = classicFrameBitCount (inMessage.ext, dataBitCount) ;
+      outDataBitCount = 0 ;
+    }
+    break ;
+  case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH :
+  case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH :
+    { //--- SOF, ID, RRS, IDE, FDF, res, BRS (standard); SOF, ID, SRR, IDE, ID, RRS, FDF, res, BRS (extended)
+      const uint32_t headerBitCount = inMessage.ext ? 36 : 17 ;
+      const uint32_t headerStuffBitCount = (headerBitCount - 1) / 4 ;
+    //--- ESI, DLC, data
+      const uint32_t controlAndDataBitCount = 1 + 4 + 8 * inMessage.len ;
+      const uint32_t stuffBitCount = (headerBitCount + controlAndDataBitCount - 1) / 4 ;
+    //--- Stuff count (gray code + parity) and CRC, with fixed stuff bits
+      const uint32_t crcBitCount = (inMessage.len > 16) ? 21 : 17 ;
+      const uint32_t crcFieldBitCount = 4 + crcBitCount + 1 + (4 + crcBitCount - 1) / 4 ;
+    //---
+      const uint32_t fastBitCount = controlAndDataBitCount + (stuffBitCount - headerStuffBitCount) + crcFieldBitCount ;
+      const uint32_t slowBitCount = headerBitCount + headerStuffBitCount + TRAILER_BIT_COUNT ;
+      if (inMessage.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) {
+        outArbitrationBitCount = slowBitCount ;
+        outDataBitCount = fastBitCount ;
+      }else{
+        outArbitrationBitCount = slowBitCount + fastBitCount ;
+        outDataBitCount = 0 ;
+      }
+    }
+    break ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_BusStatistics::frameDuration (const CANFDMessage & inMessage,
+                                                           const uint32_t inArbitrationBitDuration,
+                                                           const uint32_t inDataBitDuration) {
+  uint32_t arbitrationBitCount ;
+  uint32_t dataBitCount ;
+  frameBitCounts (inMessage, arbitrationBitCount, dataBitCount) ;
+  return arbitrationBitCount * inArbitrationBitDuration + dataBitCount * inDataBitDuration ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sliding window
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::advanceToDate (const uint32_t inDateMicros) {
+  const uint32_t elapsedDuration = inDateMicros - mCurrentSlotStartDate ;
+  if (elapsedDuration >= mSlotDuration) {
+    const uint32_t elapsedSlotCount = elapsedDuration / mSlotDuration ;
+    const uint32_t clearedSlotCount = (elapsedSlotCount < SLOT_COUNT) ? elapsedSlotCount : SLOT_COUNT ;
+    for (uint32_t i=0 ; i<clearedSlotCount ; i++) {
+      mCurrentSlotIndex = (mCurrentSlotIndex + 1) % SLOT_COUNT ;
+      mSlots [mCurrentSlotIndex] = Slot () ;
+    }
+    const uint32_t newElapsedSlotCount = mElapsedSlotCount + elapsedSlotCount ;
+    mElapsedSlotCount = uint8_t ((newElapsedSlotCount < (SLOT_COUNT - 1)) ? newElapsedSlotCount : (SLOT_COUNT - 1)) ;
+    mCurrentSlotStartDate += elapsedSlotCount * mSlotDuration ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::recordFrame (const uint32_t inDuration,
+                                                     const uint32_t inPayloadLength,
+                                                     const uint32_t inDateMicros) {
+  advanceToDate (inDateMicros) ;
+  Slot & slot = mSlots [mCurrentSlotIndex] ;
+  slot.mBusyDuration += inDuration ;
+  slot.mFrameCount += 1 ;
+  slot.mPayloadByteCount += inPayloadLength ;
+  mTotalPayloadByteCount += inPayloadLength ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::recordReceivedFrame (const CANFDMessage & inMessage,
+                                                             const uint32_t inDateMicros) {
+  const uint32_t payloadLength = (inMessage.type == CANFDMessage::CAN_REMOTE) ? 0 : inMessage.len ;
+  recordFrame (frameDuration (inMessage), payloadLength, inDateMicros) ;
+  mTotalReceivedFrameCount += 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::recordReceivedFrame (const CANMessage & inMessage,
+                                                             const uint32_t inDateMicros) {
+  recordFrame (frameDuration (inMessage), inMessage.rtr ? 0 : inMessage.len, inDateMicros) ;
+  mTotalReceivedFrameCount += 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::notePendingTransmission (const uint32_t inDuration,
+                                                                 const uint32_t inPayloadLength,
+                                                                 const uint32_t inTxBufferIndex) {
+  mTxBufferFrameDuration [inTxBufferIndex] = inDuration ;
+  mTxBufferPayloadLength [inTxBufferIndex] = uint8_t (inPayloadLength) ;
+  mTxBufferPendingMask |= 1U << inTxBufferIndex ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::noteTransmitRequest (const CANFDMessage & inMessage,
+                                                             const uint32_t inTxBufferIndex) {
+  const uint32_t payloadLength = (inMessage.type == CANFDMessage::CAN_REMOTE) ? 0 : inMessage.len ;
+  notePendingTransmission (frameDuration (inMessage), payloadLength, inTxBufferIndex) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::noteTransmitRequest (const CANMessage & inMessage,
+                                                             const uint32_t inTxBufferIndex) {
+  notePendingTransmission (frameDuration (inMessage), inMessage.rtr ? 0 : inMessage.len, inTxBufferIndex) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_BusStatistics::handleTransmissionOccurred (const uint32_t inTXBTO,
+                                                                    const uint32_t inDateMicros) {
+  uint32_t sentMask = inTXBTO & mTxBufferPendingMask ;
+  mTxBufferPendingMask &= ~ sentMask ;
+  while (sentMask != 0) {
+    const uint32_t txBufferIndex = uint32_t (__builtin_ctz (sentMask)) ;
+    sentMask &= sentMask - 1 ;
+    recordFrame (mTxBufferFrameDuration [txBufferIndex], mTxBufferPayloadLength [txBufferIndex], inDateMicros) ;
+    mTotalTransmittedFrameCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Snapshot
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_BusStatistics::Snapshot ACANFD_FeatherM4CAN_BusStatistics::snapshot (const uint32_t inDateMicros) {
+  advanceToDate (inDateMicros) ;
+  Snapshot result ;
+  uint64_t busyDuration = 0 ;
+  uint32_t frameCount = 0 ;
+  uint32_t payloadByteCount = 0 ;
+  for (uint32_t i=0 ; i<SLOT_COUNT ; i++) {
+    busyDuration += mSlots [i].mBusyDuration ;
+    frameCount += mSlots [i].mFrameCount ;
+    payloadByteCount += mSlots [i].mPayloadByteCount ;
+  }
+  result.mWindowDuration = mElapsedSlotCount * mSlotDuration + (inDateMicros - mCurrentSlotStartDate) ;
+  if (result.mWindowDuration > 0) {
+    const uint64_t clockPeriodsPerMicrosecond = ACANFD_FeatherM4CAN_Settings::CAN_ROOT_CLOCK_FREQUENCY / 1000000 ;
+    const uint64_t windowDuration = uint64_t (result.mWindowDuration) * clockPeriodsPerMicrosecond ;
+    const uint64_t busLoad = (busyDuration * 10000) / windowDuration ;
+    result.mBusLoad = uint32_t ((busLoad > 10000) ? 10000 : busLoad) ;
+    result.mFramesPerSecond = uint32_t ((uint64_t (frameCount) * 1000000) / result.mWindowDuration) ;
+    result.mPayloadBytesPerSecond = uint32_t ((uint64_t (payloadByteCount) * 1000000) / result.mWindowDuration) ;
+  }
+  result.mTotalReceivedFrameCount = mTotalReceivedFrameCount ;
+  result.mTotalTransmittedFrameCount = mTotalTransmittedFrameCount ;
+  result.mTotalPayloadByteCount = mTotalPayloadByteCount ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
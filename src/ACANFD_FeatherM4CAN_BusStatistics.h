@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_Settings.h>
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Bus load and throughput statistics.
+// Frame durations are expressed in CAN root clock periods (48 MHz), they are computed from the
+// actual arbitration and data bit timings, with worst case bit stuffing. Bus load, frame rate
+// and payload rate are computed over a sliding window of SLOT_COUNT slots.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_BusStatistics {
+
+  //································································································
+  // Constants
+  //································································································
+
+  public: static const uint32_t SLOT_COUNT = 8 ;
+
+  //································································································
+  // Default constructor
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_BusStatistics (void) ;
+
+  //································································································
+  // Init: captures bit timings, resets statistics
+  //································································································
+
+  public: void init (const ACANFD_FeatherM4CAN_Settings & inSettings, const uint32_t inDateMicros) ;
+
+  public: inline bool isEnabled (void) const { return mEnabled ; }
+
+//--- Bit timing change (automatic bit rate detection): statistics are kept
+  public: void setBitTimings (const ACANFD_FeatherM4CAN_Settings & inSettings) ;
+
+  //································································································
+  // Frame duration
+  //································································································
+
+//--- Bit counts, including worst case stuff bits and 3-bit interframe space
+  public: static void frameBitCounts (const CANFDMessage & inMessage,
+                                      uint32_t & outArbitrationBitCount,
+                                      uint32_t & outDataBitCount) ;
+
+//--- CAN 2.0B frame bit count, data bit count is 0 for a remote frame
+  public: static uint32_t classicFrameBitCount (const bool inExtended, const uint32_t inDataBitCount) ;
+
+//--- In CAN root clock periods
+  public: static uint32_t frameDuration (const CANFDMessage & inMessage,
+                                         const uint32_t inArbitrationBitDuration,
+                                         const uint32_t inDataBitDuration) ;
+
+  public: inline uint32_t frameDuration (const CANFDMessage & inMessage) const {
+    return frameDuration (inMessage, mArbitrationBitDuration, mDataBitDuration) ;
+  }
+
+  public: inline uint32_t frameDuration (const CANMessage & inMessage) const {
+    return classicFrameBitCount (inMessage.ext, inMessage.rtr ? 0 : (8 * inMessage.len)) * mArbitrationBitDuration ;
+  }
+
+  //································································································
+  // Recording (called from interrupt service routine)
+  //································································································
+
+  public: void recordReceivedFrame (const CANFDMessage & inMessage, const uint32_t inDateMicros) ;
+  public: void recordReceivedFrame (const CANMessage & inMessage, const uint32_t inDateMicros) ;
+
+//--- A frame has been written in Tx buffer: its duration is recorded when TXBTO says it has been sent
+  public: void noteTransmitRequest (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) ;
+  public: void noteTransmitRequest (const CANMessage & inMessage, const uint32_t inTxBufferIndex) ;
+
+//--- inTXBTO is the value of TXBTO register (page 1169)
+  public: void handleTransmissionOccurred (const uint32_t inTXBTO, const uint32_t inDateMicros) ;
+
+  //································································································
+  // Snapshot
+  //································································································
+
+  public: class Snapshot {
+    public: uint32_t mWindowDuration = 0 ; // In µs
+    public: uint32_t mBusLoad = 0 ; // In 1/100 %: 0 ... 10,000
+    public: uint32_t mFramesPerSecond = 0 ;
+    public: uint32_t mPayloadBytesPerSecond = 0 ;
+    public: uint32_t mTotalReceivedFrameCount = 0 ;
+    public: uint32_t mTotalTransmittedFrameCount = 0 ;
+    public: uint64_t mTotalPayloadByteCount = 0 ;
+  } ;
+
+  public: Snapshot snapshot (const uint32_t inDateMicros) ;
+
+  //································································································
+  // Private methods
+  //································································································
+
+  private: void advanceToDate (const uint32_t inDateMicros) ;
+  private: void notePendingTransmission (const uint32_t inDuration,
+                                         const uint32_t inPayloadLength,
+                                         const uint32_t inTxBufferIndex) ;
+  private: void recordFrame (const uint32_t inDuration, const uint32_t inPayloadLength, const uint32_t inDateMicros) ;
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: class Slot {
+    public: uint32_t mBusyDuration = 0 ; // In CAN root clock periods
+    public: uint32_t mFrameCount = 0 ;
+    public: uint32_t mPayloadByteCount = 0 ;
+  } ;
+
+  private: Slot mSlots [SLOT_COUNT] ;
+  private: uint32_t mTxBufferFrameDuration [32] ;
+  private: uint8_t mTxBufferPayloadLength [32] ;
+  private: uint32_t mTxBufferPendingMask ;
+  private: uint32_t mArbitrationBitDuration ;
+  private: uint32_t mDataBitDuration ;
+  private: uint32_t mSlotDuration ; // In µs
+  private: uint32_t mCurrentSlotStartDate ; // In µs
+  private: uint32_t mTotalReceivedFrameCount ;
+  private: uint32_t mTotalTransmittedFrameCount ;
+  private: uint64_t mTotalPayloadByteCount ;
+  private: uint8_t mCurrentSlotIndex ;
+  private: uint8_t mElapsedSlotCount ; // 0 ... SLOT_COUNT-1
+  private: bool mEnabled ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_BusStatistics (const ACANFD_FeatherM4CAN_BusStatistics &) = delete ;
+  private: ACANFD_FeatherM4CAN_BusStatistics & operator = (const ACANFD_FeatherM4CAN_BusStatistics &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
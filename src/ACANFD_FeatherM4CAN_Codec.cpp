@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_Codec.h>
+
+//--------------------------------------------------------------------------------------------------
+// Tables
+//--------------------------------------------------------------------------------------------------
+
+const uint8_t ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [16] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+const uint8_t ACANFD_FeatherM4CAN_Codec::DLC_FROM_LENGTH [65] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  9,  9,  9, 10, 10, 10, //  0 ... 15
+  10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 13, 13, 13, // 16 ... 31
+  13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, // 32 ... 47
+  14, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, // 48 ... 63
+  15                                                              // 64
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// Codec selection
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_Codec::Decoder ACANFD_FeatherM4CAN_Codec::decoderForPayload (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) {
+  static const Decoder DECODERS [8] = {
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_12_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_16_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_20_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_24_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_32_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_48_BYTES>,
+    decode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES>
+  } ;
+  return DECODERS [uint32_t (inPayload) & 7] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_Codec::Encoder ACANFD_FeatherM4CAN_Codec::encoderForPayload (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) {
+  static const Encoder ENCODERS [8] = {
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_8_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_12_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_16_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_20_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_24_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_32_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_48_BYTES>,
+    encode <ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES>
+  } ;
+  return ENCODERS [uint32_t (inPayload) & 7] ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_Settings.h>
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Message RAM element codecs (Rx FIFO element: page 1177).
+// Codecs are specialized on element payload: data word count is a compile time constant, data
+// words are copied by an unrolled switch, DLC is encoded and decoded through tables. The driver
+// selects decoders and encoders once, in beginFD.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_Codec {
+
+  //································································································
+  // Tables
+  //································································································
+
+  public: static const uint8_t LENGTH_FROM_DLC [16] ;
+  public: static const uint8_t DLC_FROM_LENGTH [65] ; // Invalid lengths are rounded up
+
+  //································································································
+  // Element and data word counts, as compile time constants
+  //································································································
+
+  public: static constexpr uint32_t elementWordCount (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) {
+    return (inPayload <= ACANFD_FeatherM4CAN_Settings::PAYLOAD_24_BYTES)
+      ? (4 + uint32_t (inPayload))
+      : ((inPayload == ACANFD_FeatherM4CAN_Settings::PAYLOAD_32_BYTES) ? 10
+      : ((inPayload == ACANFD_FeatherM4CAN_Settings::PAYLOAD_48_BYTES) ? 14 : 18)) ;
+  }
+
+  public: static constexpr uint32_t dataWordCount (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) {
+    return elementWordCount (inPayload) - 2 ;
+  }
+
+  //································································································
+  // Data words stored in, or read from, an element of inDataWordCount data words
+  //································································································
+
+  public: static inline uint32_t dataWordCount (const CANFDMessage & inMessage, const uint32_t inDataWordCount) {
+    const uint32_t wc = (inMessage.type == CANFDMessage::CAN_REMOTE) ? 0 : ((uint32_t (inMessage.len) + 3) >> 2) ;
+    return (wc < inDataWordCount) ? wc : inDataWordCount ;
+  }
+
+  //································································································
+  // Unrolled copy, 0 ... 16 words
+  //································································································
+
+  public: static inline void copyWords (uint32_t * outTarget, const uint32_t * inSource, const uint32_t inWordCount) {
+    switch (inWordCount) {
+    case 16 : outTarget [15] = inSource [15] ; // Fall through
+    case 15 : outTarget [14] = inSource [14] ; // Fall through
+    case 14 : outTarget [13] = inSource [13] ; // Fall through
+    case 13 : outTarget [12] = inSource [12] ; // Fall through
+    case 12 : outTarget [11] = inSource [11] ; // Fall through
+    case 11 : outTarget [10] = inSource [10] ; // Fall through
+    case 10 : outTarget  [9] = inSource  [9] ; // Fall through
+    case  9 : outTarget  [8] = inSource  [8] ; // Fall through
+    case  8 : outTarget  [7] = inSource  [7] ; // Fall through
+    case  7 : outTarget  [6] = inSource  [6] ; // Fall through
+    case  6 : outTarget  [5] = inSource  [5] ; // Fall through
+    case  5 : outTarget  [4] = inSource  [4] ; // Fall through
+    case  4 : outTarget  [3] = inSource  [3] ; // Fall through
+    case  3 : outTarget  [2] = inSource  [2] ; // Fall through
+    case  2 : outTarget  [1] = inSource  [1] ; // Fall through
+    case  1 : outTarget  [0] = inSource  [0] ; // Fall through
+    default : break ;
+    }
+  }
+
+  //································································································
+  // Header words (payload independent)
+  //································································································
+
+  public: static inline void decodeHeader (const uint32_t * inElement, CANFDMessage & outMessage) {
+    const uint32_t w0 = inElement [0] ;
+    outMessage.ext = (w0 & (1 << 30)) != 0 ;
+    outMessage.id = outMessage.ext ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+    const uint32_t w1 = inElement [1] ;
+    const uint32_t dlc = (w1 >> 16) & 0xF ;
+    if ((w1 & (1 << 21)) != 0) { // FDF: CANFD frame
+      outMessage.type = ((w1 & (1 << 20)) != 0) // BRS
+        ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH
+        : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
+      outMessage.len = LENGTH_FROM_DLC [dlc] ;
+    }else{ // CAN 2.0B frame: DLC 9 ... 15 means 8 bytes
+      outMessage.type = ((w0 & (1 << 29)) != 0) ? CANFDMessage::CAN_REMOTE : CANFDMessage::CAN_DATA ;
+      outMessage.len = uint8_t ((dlc > 8) ? 8 : dlc) ;
+    }
+  //--- Filter index, 255 if not available (page 1177-1178)
+    outMessage.idx = ((w1 & (1U << 31)) != 0) ? 255 : uint8_t ((w1 >> 24) & 0x7F) ;
+  }
+
+  //································································································
+
+  public: static inline void encodeHeader (const CANFDMessage & inMessage, uint32_t * outElement) {
+    uint32_t w0 = inMessage.ext
+      ? ((inMessage.id & 0x1FFFFFFFU) | (1U << 30))
+      : ((inMessage.id & 0x7FFU) << 18) ;
+    uint32_t w1 = uint32_t (DLC_FROM_LENGTH [(inMessage.len <= 64) ? inMessage.len : 64]) << 16 ;
+    switch (inMessage.type) {
+    case CANFDMessage::CAN_REMOTE :
+      w0 |= 1U << 29 ; // RTR
+      break ;
+    case CANFDMessage::CAN_DATA :
+      break ;
+    case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH :
+      w1 |= 1U << 21 ; // FDF
+      break ;
+    case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH :
+      w1 |= (1U << 21) | (1U << 20) ; // FDF, BRS
+      break ;
+    }
+    outElement [0] = w0 ;
+    outElement [1] = w1 ;
+  }
+
+  //································································································
+  // Data bytes that do not fit in element are received as 0xCC
+  //································································································
+
+  public: static inline void fillMissingData (CANFDMessage & ioMessage, const uint32_t inDataByteCount) {
+    for (uint32_t i=inDataByteCount ; i<ioMessage.len ; i++) {
+      ioMessage.data [i] = 0xCC ;
+    }
+  }
+
+  //································································································
+  // Payload specialized codecs
+  //································································································
+
+  public: typedef void (* Decoder) (const uint32_t * inElement, CANFDMessage & outMessage) ;
+  public: typedef void (* Encoder) (const CANFDMessage & inMessage, uint32_t * outElement) ;
+
+  public: template <ACANFD_FeatherM4CAN_Settings::Payload PAYLOAD>
+  static void decode (const uint32_t * inElement, CANFDMessage & outMessage) {
+    decodeHeader (inElement, outMessage) ;
+    copyWords (outMessage.data32, inElement + 2, dataWordCount (outMessage, dataWordCount (PAYLOAD))) ;
+    if (PAYLOAD != ACANFD_FeatherM4CAN_Settings::PAYLOAD_64_BYTES) {
+      fillMissingData (outMessage, 4 * dataWordCount (PAYLOAD)) ;
+    }
+  }
+
+  public: template <ACANFD_FeatherM4CAN_Settings::Payload PAYLOAD>
+  static void encode (const CANFDMessage & inMessage, uint32_t * outElement) {
+    encodeHeader (inMessage, outElement) ;
+    copyWords (outElement + 2, inMessage.data32, dataWordCount (inMessage, dataWordCount (PAYLOAD))) ;
+  }
+
+  public: static Decoder decoderForPayload (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) ;
+  public: static Encoder encoderForPayload (const ACANFD_FeatherM4CAN_Settings::Payload inPayload) ;
+
+  //································································································
+  // Classic CAN 2.0B codecs: two header words and two data words (any payload)
+  //································································································
+
+  public: static inline void decodeClassic (const uint32_t * inElement, CANMessage & outMessage) {
+    const uint32_t w0 = inElement [0] ;
+    outMessage.ext = (w0 & (1 << 30)) != 0 ;
+    outMessage.rtr = (w0 & (1 << 29)) != 0 ;
+    outMessage.id = outMessage.ext ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+    const uint32_t w1 = inElement [1] ;
+    const uint32_t dlc = (w1 >> 16) & 0xF ;
+    outMessage.len = uint8_t ((dlc > 8) ? 8 : dlc) ; // DLC 9 ... 15 means 8 bytes
+    outMessage.idx = ((w1 & (1U << 31)) != 0) ? 255 : uint8_t ((w1 >> 24) & 0x7F) ;
+    outMessage.data32 [0] = inElement [2] ;
+    outMessage.data32 [1] = inElement [3] ;
+  }
+
+  public: static inline void encodeClassic (const CANMessage & inMessage, uint32_t * outElement) {
+    uint32_t w0 = inMessage.ext
+      ? ((inMessage.id & 0x1FFFFFFFU) | (1U << 30))
+      : ((inMessage.id & 0x7FFU) << 18) ;
+    if (inMessage.rtr) {
+      w0 |= 1U << 29 ;
+    }
+    outElement [0] = w0 ;
+    outElement [1] = uint32_t (inMessage.len) << 16 ;
+    outElement [2] = inMessage.data32 [0] ;
+    outElement [3] = inMessage.data32 [1] ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,462 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_E2E.h>
+#include <ACANFD_FeatherM4CAN_Codec.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+//    CRC TABLES
+//--------------------------------------------------------------------------------------------------
+
+static uint8_t gCRC8Table [256] ;
+static uint16_t gCRC16Table [256] ;
+static uint32_t gCRC32Table [4][256] ; // Slice-by-4: gCRC32Table [k][i] is CRC of i followed by k zero bytes
+static volatile bool gCRCTablesReady = false ;
+
+//--------------------------------------------------------------------------------------------------
+// Computing tables twice (from loop and from an interrupt) writes the same values
+
+static void buildCRCTables (void) {
+  for (uint32_t i=0 ; i<256 ; i++) {
+    uint32_t c8 = i ;
+    uint32_t c16 = i << 8 ;
+    uint32_t c32 = i ;
+    for (uint32_t bit=0 ; bit<8 ; bit++) {
+      c8 = ((c8 & 0x80) != 0) ? ((c8 << 1) ^ 0x1D) : (c8 << 1) ;
+      c16 = ((c16 & 0x8000) != 0) ? ((c16 << 1) ^ 0x1021) : (c16 << 1) ;
+      c32 = ((c32 & 1) != 0) ? ((c32 >> 1) ^ 0xEDB88320U) : (c32 >> 1) ;
+    }
+    gCRC8Table [i] = uint8_t (c8) ;
+    gCRC16Table [i] = uint16_t (c16) ;
+    gCRC32Table [0][i] = c32 ;
+  }
+  for (uint32_t i=0 ; i<256 ; i++) {
+    for (uint32_t k=1 ; k<4 ; k++) {
+      const uint32_t c = gCRC32Table [k-1][i] ;
+      gCRC32Table [k][i] = (c >> 8) ^ gCRC32Table [0][c & 0xFF] ;
+    }
+  }
+  gCRCTablesReady = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CRC KERNELS
+//--------------------------------------------------------------------------------------------------
+
+uint8_t ACANFD_FeatherM4CAN_E2E::crc8 (const uint8_t * inData,
+                                       const uint32_t inLength,
+                                       const uint8_t inInitialValue) {
+  if (!gCRCTablesReady) {
+    buildCRCTables () ;
+  }
+  uint8_t crc = inInitialValue ;
+  for (uint32_t i=0 ; i<inLength ; i++) {
+    crc = gCRC8Table [crc ^ inData [i]] ;
+  }
+  return crc ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint16_t ACANFD_FeatherM4CAN_E2E::crc16 (const uint8_t * inData,
+                                         const uint32_t inLength,
+                                         const uint16_t inInitialValue) {
+  if (!gCRCTablesReady) {
+    buildCRCTables () ;
+  }
+  uint32_t crc = inInitialValue ;
+  for (uint32_t i=0 ; i<inLength ; i++) {
+    crc = (crc << 8) ^ gCRC16Table [((crc >> 8) ^ inData [i]) & 0xFF] ;
+  }
+  return uint16_t (crc) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Reflected CRC: 4 bytes are read as a little endian word (unaligned LDR on Cortex-M4)
+
+uint32_t ACANFD_FeatherM4CAN_E2E::crc32 (const uint8_t * inData,
+                                         const uint32_t inLength,
+                                         const uint32_t inInitialValue) {
+  if (!gCRCTablesReady) {
+    buildCRCTables () ;
+  }
+  uint32_t crc = inInitialValue ;
+  const uint8_t * p = inData ;
+  uint32_t n = inLength ;
+  while (n >= 4) {
+    uint32_t w ;
+    memcpy (&w, p, 4) ;
+    crc ^= w ;
+    crc = gCRC32Table [3][crc & 0xFF] ^ gCRC32Table [2][(crc >> 8) & 0xFF]
+        ^ gCRC32Table [1][(crc >> 16) & 0xFF] ^ gCRC32Table [0][crc >> 24] ;
+    p += 4 ;
+    n -= 4 ;
+  }
+  while (n > 0) {
+    crc = (crc >> 8) ^ gCRC32Table [0][(crc ^ *p) & 0xFF] ;
+    p += 1 ;
+    n -= 1 ;
+  }
+  return crc ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CRC FIELD
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t CRC_SIZE [4] = { 0, 1, 2, 4 } ; // Indexed by CRC
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t readCRC (const uint8_t * inData, const uint32_t inSize) {
+  uint32_t result = 0 ;
+  for (uint32_t i=0 ; i<inSize ; i++) {
+    result |= uint32_t (inData [i]) << (8 * i) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void writeCRC (uint8_t * outData, const uint32_t inSize, const uint32_t inCRC) {
+  for (uint32_t i=0 ; i<inSize ; i++) {
+    outData [i] = uint8_t (inCRC >> (8 * i)) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// CRC of a frame: data identifier, then payload without CRC bytes; final XOR applied
+
+uint32_t ACANFD_FeatherM4CAN_E2E::crc (const Profile & inProfile,
+                                       const uint8_t * inData,
+                                       const uint32_t inLength) {
+  const uint8_t dataID [2] = { uint8_t (inProfile.mDataID), uint8_t (inProfile.mDataID >> 8) } ;
+  const uint32_t head = inProfile.mCRCOffset ;
+  const uint32_t tail = head + CRC_SIZE [inProfile.mCRC] ;
+  uint32_t result = 0 ;
+  switch (inProfile.mCRC) {
+  case CRC8_SAE_J1850 :
+    { uint8_t c = crc8 (dataID, 2) ;
+      c = crc8 (inData, head, c) ;
+      c = crc8 (inData + tail, inLength - tail, c) ;
+      result = uint8_t (c ^ 0xFF) ;
+    }
+    break ;
+  case CRC16_CCITT :
+    { uint16_t c = crc16 (dataID, 2) ;
+      c = crc16 (inData, head, c) ;
+      result = crc16 (inData + tail, inLength - tail, c) ;
+    }
+    break ;
+  case CRC32_IEEE :
+    { uint32_t c = crc32 (dataID, 2) ;
+      c = crc32 (inData, head, c) ;
+      result = ~ crc32 (inData + tail, inLength - tail, c) ;
+    }
+    break ;
+  case NO_CRC :
+    break ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    PROFILE VALIDITY
+//--------------------------------------------------------------------------------------------------
+
+static bool isValidProfile (const ACANFD_FeatherM4CAN_E2E::Profile & inProfile) {
+  bool ok = inProfile.mCRC <= ACANFD_FeatherM4CAN_E2E::CRC32_IEEE ;
+  if (ok) {
+    const uint32_t crcSize = CRC_SIZE [inProfile.mCRC] ;
+    const bool hasCounter = inProfile.mCounterBitCount != 0 ;
+    ok = (inProfile.mCRCOffset + crcSize) <= 64 ;
+    ok &= (inProfile.mCounterBitCount == 0) || (inProfile.mCounterBitCount == 4) || (inProfile.mCounterBitCount == 8) ;
+    ok &= !hasCounter || (inProfile.mCounterOffset < 64) ;
+    ok &= !hasCounter || (inProfile.mMaxDeltaCounter >= 1) ;
+    ok &= !hasCounter || (crcSize == 0)
+       || (inProfile.mCounterOffset < inProfile.mCRCOffset)
+       || (inProfile.mCounterOffset >= (inProfile.mCRCOffset + crcSize)) ;
+    ok &= hasCounter || (crcSize > 0) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_E2E::ACANFD_FeatherM4CAN_E2E (const uint8_t inStandardFilterCount,
+                                                  const uint8_t inExtendedFilterCount,
+                                                  const uint8_t inTransmitProfileCapacity) :
+mStandardChannels (new Channel [inStandardFilterCount]),
+mExtendedChannels (new Channel [inExtendedFilterCount]),
+mTransmitChannels (new Channel [inTransmitProfileCapacity]),
+mStandardChannelCount (inStandardFilterCount),
+mExtendedChannelCount (inExtendedFilterCount),
+mTransmitChannelCapacity (inTransmitProfileCapacity) {
+  if (!gCRCTablesReady) {
+    buildCRCTables () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_E2E::~ ACANFD_FeatherM4CAN_E2E (void) {
+  delete [] mStandardChannels ;
+  delete [] mExtendedChannels ;
+  delete [] mTransmitChannels ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Defining profiles
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_E2E::setStandardReceiveProfile (const uint8_t inFilterIndex,
+                                                         const Profile & inProfile) {
+  const bool ok = (inFilterIndex < mStandardChannelCount) && isValidProfile (inProfile) ;
+  if (ok) {
+    Channel & channel = mStandardChannels [inFilterIndex] ;
+    channel.mProfile = inProfile ;
+    channel.mSynchronized = false ;
+    channel.mEnabled = true ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_E2E::setExtendedReceiveProfile (const uint8_t inFilterIndex,
+                                                         const Profile & inProfile) {
+  const bool ok = (inFilterIndex < mExtendedChannelCount) && isValidProfile (inProfile) ;
+  if (ok) {
+    Channel & channel = mExtendedChannels [inFilterIndex] ;
+    channel.mProfile = inProfile ;
+    channel.mSynchronized = false ;
+    channel.mEnabled = true ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_E2E::addTransmitProfile (const uint32_t inIdentifier,
+                                                  const bool inExtended,
+                                                  const Profile & inProfile) {
+  const bool ok = (mTransmitChannelCount < mTransmitChannelCapacity)
+    && (transmitChannel (inIdentifier, inExtended) == nullptr)
+    && isValidProfile (inProfile) ;
+  if (ok) {
+    Channel & channel = mTransmitChannels [mTransmitChannelCount] ;
+    channel.mProfile = inProfile ;
+    channel.mIdentifier = inIdentifier & (inExtended ? 0x1FFFFFFFU : 0x7FFU) ;
+    channel.mExtended = inExtended ;
+    channel.mEnabled = true ;
+    mTransmitChannelCount += 1 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Transmit profiles are few: linear search
+
+ACANFD_FeatherM4CAN_E2E::Channel * ACANFD_FeatherM4CAN_E2E::transmitChannel (const uint32_t inIdentifier,
+                                                                             const bool inExtended) const {
+  Channel * result = nullptr ;
+  for (uint32_t i=0 ; (i<mTransmitChannelCount) && (result == nullptr) ; i++) {
+    Channel & channel = mTransmitChannels [i] ;
+    if ((channel.mIdentifier == inIdentifier) && (channel.mExtended == inExtended)) {
+      result = & channel ;
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Counts
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_E2E::Counts ACANFD_FeatherM4CAN_E2E::standardReceiveCounts (const uint8_t inFilterIndex) const {
+  return (inFilterIndex < mStandardChannelCount) ? mStandardChannels [inFilterIndex].mCounts : Counts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_E2E::Counts ACANFD_FeatherM4CAN_E2E::extendedReceiveCounts (const uint8_t inFilterIndex) const {
+  return (inFilterIndex < mExtendedChannelCount) ? mExtendedChannels [inFilterIndex].mCounts : Counts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_E2E::Counts ACANFD_FeatherM4CAN_E2E::transmitCounts (const uint32_t inIdentifier,
+                                                                         const bool inExtended) const {
+  const Channel * channel = transmitChannel (inIdentifier, inExtended) ;
+  return (channel != nullptr) ? channel->mCounts : Counts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_E2E::resetCounts (void) {
+  noInterrupts () ;
+    for (uint32_t i=0 ; i<mStandardChannelCount ; i++) {
+      mStandardChannels [i].mCounts = Counts () ;
+    }
+    for (uint32_t i=0 ; i<mExtendedChannelCount ; i++) {
+      mExtendedChannels [i].mCounts = Counts () ;
+    }
+    for (uint32_t i=0 ; i<mTransmitChannelCount ; i++) {
+      mTransmitChannels [i].mCounts = Counts () ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_E2E::resynchronize (void) {
+  noInterrupts () ;
+    for (uint32_t i=0 ; i<mStandardChannelCount ; i++) {
+      mStandardChannels [i].mSynchronized = false ;
+    }
+    for (uint32_t i=0 ; i<mExtendedChannelCount ; i++) {
+      mExtendedChannels [i].mSynchronized = false ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Checking and stamping
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_E2E::check (Channel & ioChannel,
+                                     const uint8_t * inData,
+                                     const uint32_t inLength) {
+  const Profile & profile = ioChannel.mProfile ;
+  const uint32_t crcSize = CRC_SIZE [profile.mCRC] ;
+  const bool hasCounter = profile.mCounterBitCount != 0 ;
+  bool ok = false ;
+  if (((profile.mCRCOffset + crcSize) > inLength) || (hasCounter && (profile.mCounterOffset >= inLength))) {
+    ioChannel.mCounts.mLengthErrorCount += 1 ;
+  }else if ((crcSize > 0) && (readCRC (inData + profile.mCRCOffset, crcSize) != crc (profile, inData, inLength))) {
+    ioChannel.mCounts.mCRCErrorCount += 1 ;
+  }else if (!hasCounter) {
+    ok = true ;
+  }else{
+    const uint32_t mask = (1U << profile.mCounterBitCount) - 1 ;
+    const uint8_t counter = uint8_t (inData [profile.mCounterOffset] & mask) ;
+    const uint32_t delta = (uint32_t (counter) - ioChannel.mCounter) & mask ;
+    if (!ioChannel.mSynchronized) {
+      ioChannel.mSynchronized = true ;
+      ok = true ;
+    }else if (delta == 0) {
+      ioChannel.mCounts.mRepeatedCount += 1 ;
+    }else if (delta > profile.mMaxDeltaCounter) {
+      ioChannel.mCounts.mSequenceErrorCount += 1 ;
+    }else{
+      ok = true ;
+    }
+    if (delta != 0) {
+      ioChannel.mCounter = counter ;
+    }
+  }
+  if (ok) {
+    ioChannel.mCounts.mFrameCount += 1 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_E2E::stamp (Channel & ioChannel,
+                                     uint8_t * ioData,
+                                     const uint32_t inLength) {
+  const Profile & profile = ioChannel.mProfile ;
+  const uint32_t crcSize = CRC_SIZE [profile.mCRC] ;
+  const bool hasCounter = profile.mCounterBitCount != 0 ;
+  if (((profile.mCRCOffset + crcSize) > inLength) || (hasCounter && (profile.mCounterOffset >= inLength))) {
+    ioChannel.mCounts.mLengthErrorCount += 1 ;
+  }else{
+    if (hasCounter) {
+      const uint32_t mask = (1U << profile.mCounterBitCount) - 1 ;
+      ioChannel.mCounter = ioChannel.mSynchronized ? uint8_t ((ioChannel.mCounter + 1) & mask) : 0 ;
+      ioChannel.mSynchronized = true ;
+      uint8_t & counterByte = ioData [profile.mCounterOffset] ;
+      counterByte = uint8_t ((counterByte & ~ mask) | ioChannel.mCounter) ;
+    }
+    if (crcSize > 0) {
+      writeCRC (ioData + profile.mCRCOffset, crcSize, crc (profile, ioData, inLength)) ;
+    }
+    ioChannel.mCounts.mFrameCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame length from Rx / Tx element word 1: DLC, FDF (page 1177); a CAN 2.0B frame has at most
+// 8 data bytes; bytes beyond element data field are missing
+
+static uint32_t elementDataLength (const uint32_t inWord1, const uint32_t inDataWordCount) {
+  uint32_t length = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [(inWord1 >> 16) & 0xF] ;
+  if (((inWord1 & (1U << 21)) == 0) && (length > 8)) {
+    length = 8 ;
+  }
+  if (length > (4 * inDataWordCount)) {
+    length = 4 * inDataWordCount ;
+  }
+  return length ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Non matching frames (ANMF set) are not checked; remote frames have no data, a protected
+// filter rejects them (length error)
+
+bool ACANFD_FeatherM4CAN_E2E::acceptsRxElement (const uint32_t * inElement,
+                                                const uint32_t inDataWordCount) {
+  const uint32_t w0 = inElement [0] ;
+  const uint32_t w1 = inElement [1] ;
+  Channel * channel = nullptr ;
+  if ((w1 & (1U << 31)) == 0) { // ANMF
+    const uint32_t filterIndex = (w1 >> 24) & 0x7F ; // FIDX
+    if ((w0 & (1U << 30)) != 0) { // XTD
+      channel = (filterIndex < mExtendedChannelCount) ? & mExtendedChannels [filterIndex] : nullptr ;
+    }else{
+      channel = (filterIndex < mStandardChannelCount) ? & mStandardChannels [filterIndex] : nullptr ;
+    }
+  }
+  bool accepts = true ;
+  if ((channel != nullptr) && channel->mEnabled) {
+    const bool remote = (w0 & (1U << 29)) != 0 ; // RTR
+    const uint32_t length = remote ? 0 : elementDataLength (w1, inDataWordCount) ;
+    accepts = check (*channel, (const uint8_t *) (inElement + 2), length) ;
+  }
+  return accepts ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_E2E::stampTxElement (uint32_t * ioElement, const uint32_t inDataWordCount) {
+  const uint32_t w0 = ioElement [0] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ; // XTD
+  const bool remote = (w0 & (1U << 29)) != 0 ; // RTR
+  if ((mTransmitChannelCount > 0) && !remote) {
+    const uint32_t identifier = extended ? (w0 & 0x1FFFFFFFU) : ((w0 >> 18) & 0x7FFU) ;
+    Channel * channel = transmitChannel (identifier, extended) ;
+    if (channel != nullptr) {
+      stamp (*channel, (uint8_t *) (ioElement + 2), elementDataLength (ioElement [1], inDataWordCount)) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_E2E::stamp (CANFDMessage & ioMessage) {
+  if ((mTransmitChannelCount > 0) && (ioMessage.type != CANFDMessage::CAN_REMOTE)) {
+    Channel * channel = transmitChannel (ioMessage.id, ioMessage.ext) ;
+    if (channel != nullptr) {
+      stamp (*channel, ioMessage.data, ioMessage.len) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// End-to-end protection of safety frames: a CRC and an alive counter, at fixed byte offsets of
+// the payload. Once set to the driver (setE2E):
+//   - a received frame accepted by a filter that has a receive profile is checked by the receive
+//     interrupt service routine, directly in the hardware Rx FIFO element: a frame with a wrong
+//     CRC, a repeated counter, or a counter that jumps by more than mMaxDeltaCounter is discarded
+//     before it is entered into a driver receive FIFO (it is not routed by gateway, nor handled by
+//     ISO-TP engine); frames accepted by other filters are not checked;
+//   - a sent frame whose identifier has a transmit profile is stamped with the next counter value
+//     and its CRC, when it is written into the hardware Tx buffer (or copied by DMA).
+// The CRC is computed over the data identifier (low byte first), then the payload bytes, except
+// the CRC bytes; CRC16 and CRC32 are stored little endian. The counter is in the low nibble
+// (mCounterBitCount = 4) or the whole byte (mCounterBitCount = 8) at mCounterOffset, it wraps
+// around. The first frame received by a profile is accepted whatever its counter; a frame with a
+// sequence error is rejected, but its counter becomes the reference for the next frame.
+// CRC kernels are table driven; CRC32 processes 4 bytes per step (slice-by-4). Tables (4,864
+// bytes) are computed in RAM on first use (RAM is not subject to flash wait states).
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_E2E {
+
+  //································································································
+  // CRC
+  //································································································
+
+  public: enum CRC : uint8_t {
+    NO_CRC,
+    CRC8_SAE_J1850, // Polynomial 0x1D, initial value 0xFF, final XOR 0xFF
+    CRC16_CCITT,    // Polynomial 0x1021, initial value 0xFFFF, no final XOR
+    CRC32_IEEE      // Polynomial 0x04C11DB7 (reflected), initial value and final XOR 0xFFFFFFFF
+  } ;
+
+  //································································································
+  // Profile
+  //································································································
+
+  public: class Profile {
+    public: CRC mCRC = CRC8_SAE_J1850 ;
+    public: uint8_t mCRCOffset = 0 ; // Byte offset of CRC in payload
+    public: uint8_t mCounterOffset = 1 ; // Byte offset of counter in payload
+    public: uint8_t mCounterBitCount = 4 ; // 0 (no counter), 4 (low nibble) or 8
+    public: uint8_t mMaxDeltaCounter = 1 ; // Accepted counter increment: 1 ... mMaxDeltaCounter
+    public: uint16_t mDataID = 0 ;
+  } ;
+
+  //································································································
+  // Counts
+  //································································································
+
+  public: class Counts {
+    public: uint32_t mFrameCount = 0 ; // Accepted (reception) or stamped (transmission) frames
+    public: uint32_t mCRCErrorCount = 0 ;
+    public: uint32_t mRepeatedCount = 0 ; // Counter did not change
+    public: uint32_t mSequenceErrorCount = 0 ; // Counter jumped by more than mMaxDeltaCounter
+    public: uint32_t mLengthErrorCount = 0 ; // CRC or counter beyond frame length
+
+    public: inline uint32_t rejectedCount (void) const {
+      return mCRCErrorCount + mRepeatedCount + mSequenceErrorCount + mLengthErrorCount ;
+    }
+  } ;
+
+  //································································································
+  // Constructor: receive profiles are indexed by filter index; transmit profiles capacity
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_E2E (const uint8_t inStandardFilterCount,
+                                   const uint8_t inExtendedFilterCount,
+                                   const uint8_t inTransmitProfileCapacity) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_E2E (void) ;
+
+  //································································································
+  // Defining profiles, return false if filter index is out of range, if transmit profile
+  // capacity is exhausted, or if profile is invalid (offsets should be lower than 64, CRC and
+  // counter should not overlap)
+  //································································································
+
+  public: bool setStandardReceiveProfile (const uint8_t inFilterIndex, const Profile & inProfile) ;
+
+  public: bool setExtendedReceiveProfile (const uint8_t inFilterIndex, const Profile & inProfile) ;
+
+  public: bool addTransmitProfile (const uint32_t inIdentifier,
+                                   const bool inExtended,
+                                   const Profile & inProfile) ;
+
+  //································································································
+  // Counts, return zero counts if no profile is defined
+  //································································································
+
+  public: Counts standardReceiveCounts (const uint8_t inFilterIndex) const ;
+
+  public: Counts extendedReceiveCounts (const uint8_t inFilterIndex) const ;
+
+  public: Counts transmitCounts (const uint32_t inIdentifier, const bool inExtended) const ;
+
+  public: void resetCounts (void) ;
+
+  //································································································
+  // Receive profiles are resynchronized by the next received frame
+  //································································································
+
+  public: void resynchronize (void) ;
+
+  //································································································
+  // CRC kernels, inInitialValue is the running CRC (before final XOR); return the running CRC
+  //································································································
+
+  public: static uint8_t crc8 (const uint8_t * inData, const uint32_t inLength, const uint8_t inInitialValue = 0xFF) ;
+
+  public: static uint16_t crc16 (const uint8_t * inData, const uint32_t inLength, const uint16_t inInitialValue = 0xFFFF) ;
+
+  public: static uint32_t crc32 (const uint8_t * inData, const uint32_t inLength, const uint32_t inInitialValue = 0xFFFFFFFF) ;
+
+  //································································································
+  // Called by driver, with interrupts disabled
+  //································································································
+
+//--- inElement is the hardware Rx FIFO element (page 1177), returns false if frame is rejected
+  public: bool acceptsRxElement (const uint32_t * inElement, const uint32_t inDataWordCount) ;
+
+//--- ioElement is the encoded hardware Tx buffer element (page 1182)
+  public: void stampTxElement (uint32_t * ioElement, const uint32_t inDataWordCount) ;
+
+//--- Transmission through DMA: the message is stamped before its data are copied
+  public: void stamp (CANFDMessage & ioMessage) ;
+
+  //································································································
+  // Private
+  //································································································
+
+  private: class Channel {
+    public: Profile mProfile ;
+    public: Counts mCounts ;
+    public: uint32_t mIdentifier = 0 ; // Transmit channels only
+    public: bool mExtended = false ; // Transmit channels only
+    public: bool mEnabled = false ;
+    public: bool mSynchronized = false ;
+    public: uint8_t mCounter = 0 ; // Last received, or last sent
+  } ;
+
+  private: Channel * transmitChannel (const uint32_t inIdentifier, const bool inExtended) const ;
+
+  private: static uint32_t crc (const Profile & inProfile, const uint8_t * inData, const uint32_t inLength) ;
+
+  private: static bool check (Channel & ioChannel, const uint8_t * inData, const uint32_t inLength) ;
+
+  private: static void stamp (Channel & ioChannel, uint8_t * ioData, const uint32_t inLength) ;
+
+  private: Channel * mStandardChannels ;
+  private: Channel * mExtendedChannels ;
+  private: Channel * mTransmitChannels ;
+  private: const uint8_t mStandardChannelCount ;
+  private: const uint8_t mExtendedChannelCount ;
+  private: const uint8_t mTransmitChannelCapacity ;
+  private: uint8_t mTransmitChannelCount = 0 ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_E2E (const ACANFD_FeatherM4CAN_E2E &) = delete ;
+  private: ACANFD_FeatherM4CAN_E2E & operator = (const ACANFD_FeatherM4CAN_E2E &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -6,19 +6,26 @@
 // Default constructor
 //--------------------------------------------------------------------------------------------------
 
-ACANFD_FeatherM4CAN_FIFO::ACANFD_FeatherM4CAN_FIFO (void) :
+template <typename MESSAGE>
+ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::ACANFD_FeatherM4CAN_GenericFIFO (void) :
 mBuffer (NULL),
 mSize (0),
 mReadIndex (0),
 mCount (0),
-mPeakCount (0) {
+mPeakCount (0),
+mHighWaterMark (0),
+mHighWaterCallBack (nullptr),
+mOverflowCount (0),
+mPinnedCount (0),
+mOverflowPolicy (ACANFD_FeatherM4CAN_Settings::DROP_NEWEST) {
 }
 
 //--------------------------------------------------------------------------------------------------
 // Destructor
 //--------------------------------------------------------------------------------------------------
 
-ACANFD_FeatherM4CAN_FIFO:: ~ ACANFD_FeatherM4CAN_FIFO (void) {
+template <typename MESSAGE>
+ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>:: ~ ACANFD_FeatherM4CAN_GenericFIFO (void) {
   delete [] mBuffer ;
 }
 
@@ -26,31 +33,119 @@ ACANFD_FeatherM4CAN_FIFO:: ~ ACANFD_FeatherM4CAN_FIFO (void) {
 // initWithSize
 //--------------------------------------------------------------------------------------------------
 
-void ACANFD_FeatherM4CAN_FIFO::initWithSize (const uint16_t inSize) {
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::initWithSize (const uint16_t inSize) {
   delete [] mBuffer ;
-  mBuffer = new CANFDMessage [inSize] ;
+  mBuffer = new MESSAGE [inSize] ;
   mSize = inSize ;
   mReadIndex = 0 ;
   mCount = 0 ;
   mPeakCount = 0 ;
+  mOverflowCount = 0 ;
+  mPinnedCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// resize
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::resize (const uint16_t inSize) {
+  if (inSize != mSize) {
+    MESSAGE * buffer = new MESSAGE [inSize] ;
+    const uint16_t keptCount = (mCount < inSize) ? mCount : inSize ;
+    for (uint16_t i=0 ; i<keptCount ; i++) {
+      buffer [i] = * slotForRemove (i) ;
+    }
+    mOverflowCount += mCount - keptCount ;
+    delete [] mBuffer ;
+    mBuffer = buffer ;
+    mSize = inSize ;
+    mReadIndex = 0 ;
+    mCount = keptCount ;
+    mPeakCount = keptCount ;
+    mPinnedCount = 0 ;
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
 // append
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN_FIFO::append (const CANFDMessage & inMessage) {
-  const bool ok = mCount < mSize ;
+template <typename MESSAGE>
+bool ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::append (const MESSAGE & inMessage) {
+  bool ok = mCount < mSize ;
   if (ok) {
     uint16_t writeIndex = mReadIndex + mCount ;
     if (writeIndex >= mSize) {
       writeIndex -= mSize ;
     }
     mBuffer [writeIndex] = inMessage ;
+    const uint16_t previousCount = mCount ;
     mCount += 1 ;
     if (mPeakCount < mCount) {
       mPeakCount = mCount ;
     }
+    if ((previousCount < mHighWaterMark) && (mCount >= mHighWaterMark) && (mHighWaterCallBack != nullptr)) {
+      mHighWaterCallBack () ;
+    }
+  }else{
+    mOverflowCount += 1 ;
+    if (mSize > 0) {
+      switch (mOverflowPolicy) {
+      case ACANFD_FeatherM4CAN_Settings::DROP_NEWEST :
+        break ;
+      case ACANFD_FeatherM4CAN_Settings::DROP_OLDEST :
+      //--- FIFO is full: the write index is the read index; a pinned head cannot be dropped
+        ok = mPinnedCount == 0 ;
+        if (ok) {
+          mBuffer [mReadIndex] = inMessage ;
+          mReadIndex += 1 ;
+          if (mReadIndex == mSize) {
+            mReadIndex = 0 ;
+          }
+        }
+        break ;
+      case ACANFD_FeatherM4CAN_Settings::OVERWRITE_SAME_IDENTIFIER :
+        { uint16_t index = mReadIndex + mPinnedCount ;
+          if (index >= mSize) {
+            index -= mSize ;
+          }
+          for (uint16_t i=mPinnedCount ; (i<mCount) && !ok ; i++) {
+            MESSAGE & message = mBuffer [index] ;
+            ok = (message.id == inMessage.id) && (message.ext == inMessage.ext) ;
+            if (ok) {
+              message = inMessage ;
+            }
+            index += 1 ;
+            if (index == mSize) {
+              index = 0 ;
+            }
+          }
+        }
+        break ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// prepend
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+bool ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::prepend (const MESSAGE & inMessage) {
+  const bool ok = mCount < mSize ;
+  if (ok) {
+    mReadIndex = (mReadIndex == 0) ? (mSize - 1) : (mReadIndex - 1) ;
+    mBuffer [mReadIndex] = inMessage ;
+    mCount += 1 ;
+    if (mPeakCount < mCount) {
+      mPeakCount = mCount ;
+    }
+  }else{
+    mOverflowCount += 1 ;
   }
   return ok ;
 }
@@ -59,7 +154,8 @@ bool ACANFD_FeatherM4CAN_FIFO::append (const CANFDMessage & inMessage) {
 // Remove
 //--------------------------------------------------------------------------------------------------
 
-bool ACANFD_FeatherM4CAN_FIFO::remove (CANFDMessage & outMessage) {
+template <typename MESSAGE>
+bool ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::remove (MESSAGE & outMessage) {
   const bool ok = mCount > 0 ;
   if (ok) {
     outMessage = mBuffer [mReadIndex] ;
@@ -72,16 +168,87 @@ bool ACANFD_FeatherM4CAN_FIFO::remove (CANFDMessage & outMessage) {
   return ok ;
 }
 
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::discardHead (void) {
+  mCount -= 1 ;
+  mReadIndex += 1 ;
+  if (mReadIndex == mSize) {
+    mReadIndex = 0 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Direct slot access
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+MESSAGE * ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::slotForAppend (const uint16_t inOffset) {
+  uint32_t writeIndex = uint32_t (mReadIndex) + mCount + inOffset ;
+  if (writeIndex >= mSize) {
+    writeIndex -= mSize ;
+  }
+  return & mBuffer [writeIndex] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::commitAppend (const uint16_t inCount) {
+  const uint16_t previousCount = mCount ;
+  mCount += inCount ;
+  if (mPeakCount < mCount) {
+    mPeakCount = mCount ;
+  }
+  if ((previousCount < mHighWaterMark) && (mCount >= mHighWaterMark) && (mHighWaterCallBack != nullptr)) {
+    mHighWaterCallBack () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+MESSAGE * ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::slotForRemove (const uint16_t inOffset) {
+  uint32_t readIndex = uint32_t (mReadIndex) + inOffset ;
+  if (readIndex >= mSize) {
+    readIndex -= mSize ;
+  }
+  return & mBuffer [readIndex] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::discardPinnedHead (void) {
+  mCount -= mPinnedCount ;
+  mReadIndex += mPinnedCount ;
+  if (mReadIndex >= mSize) {
+    mReadIndex -= mSize ;
+  }
+  mPinnedCount = 0 ;
+}
+
 //--------------------------------------------------------------------------------------------------
 // Free
 //--------------------------------------------------------------------------------------------------
 
-void ACANFD_FeatherM4CAN_FIFO::free (void) {
+template <typename MESSAGE>
+void ACANFD_FeatherM4CAN_GenericFIFO <MESSAGE>::free (void) {
   delete [] mBuffer ; mBuffer = nullptr ;
   mSize = 0 ;
   mReadIndex = 0 ;
   mCount = 0 ;
   mPeakCount = 0 ;
+  mOverflowCount = 0 ;
+  mPinnedCount = 0 ;
 }
 
 //--------------------------------------------------------------------------------------------------
+// Explicit instantiations
+//--------------------------------------------------------------------------------------------------
+
+template class ACANFD_FeatherM4CAN_GenericFIFO <CANFDMessage> ;
+template class ACANFD_FeatherM4CAN_GenericFIFO <CANMessage> ;
+
+//--------------------------------------------------------------------------------------------------
@@ -5,32 +5,40 @@
 //--------------------------------------------------------------------------------------------------
 
 #include <CANFDMessage.h>
+#include <ACANFD_FeatherM4CAN_Settings.h>
 
+//--------------------------------------------------------------------------------------------------
+// MESSAGE is CANFDMessage or CANMessage (explicit instantiations in ACANFD_FeatherM4CAN_FIFO.cpp)
 //--------------------------------------------------------------------------------------------------
 
-class ACANFD_FeatherM4CAN_FIFO {
+template <typename MESSAGE> class ACANFD_FeatherM4CAN_GenericFIFO {
 
   //································································································
   // Default constructor
   //································································································
 
-  public: ACANFD_FeatherM4CAN_FIFO (void) ;
+  public: ACANFD_FeatherM4CAN_GenericFIFO (void) ;
 
   //································································································
   // Destructor
   //································································································
 
-  public: ~ ACANFD_FeatherM4CAN_FIFO (void) ;
+  public: ~ ACANFD_FeatherM4CAN_GenericFIFO (void) ;
 
   //································································································
   // Private properties
   //································································································
 
-  private: CANFDMessage * mBuffer ;
+  private: MESSAGE * mBuffer ;
   private: uint16_t mSize ;
   private: uint16_t mReadIndex ;
   private: uint16_t mCount ;
   private: uint16_t mPeakCount ; // > mSize if overflow did occur
+  private: uint16_t mHighWaterMark ;
+  private: void (* mHighWaterCallBack) (void) ;
+  private: uint32_t mOverflowCount ;
+  private: uint16_t mPinnedCount ; // Head messages that cannot be dropped or overwritten
+  private: ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy mOverflowPolicy ;
 
   //································································································
   // Accessors
@@ -41,6 +49,10 @@ class ACANFD_FeatherM4CAN_FIFO {
   public: inline bool isEmpty (void) const { return mCount == 0 ; }
   public: inline bool isFull (void) const { return mCount == mSize ; }
   public: inline uint16_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint32_t overflowCount (void) const { return mOverflowCount ; }
+  public: inline ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy overflowPolicy (void) const {
+    return mOverflowPolicy ;
+  }
 
   //································································································
   // initWithSize
@@ -49,16 +61,67 @@ class ACANFD_FeatherM4CAN_FIFO {
   public: void initWithSize (const uint16_t inSize) ;
 
   //································································································
-  // append
+  // resize: frames are kept, from the oldest one; when the FIFO shrinks, the newest frames that
+  // do not fit are dropped, and counted as overflows. Head messages are unpinned, peak count is
+  // reset to the kept count.
+  //································································································
+
+  public: void resize (const uint16_t inSize) ;
+
+  //································································································
+  // Overflow handling
   //································································································
 
-  public: bool append (const CANFDMessage & inMessage) ;
+  public: inline void setOverflowPolicy (const ACANFD_FeatherM4CAN_Settings::DriverFIFOOverflowPolicy inPolicy) {
+    mOverflowPolicy = inPolicy ;
+  }
+
+  public: inline void setHighWaterMark (const uint16_t inHighWaterMark, void (* inCallBack) (void)) {
+    mHighWaterMark = inHighWaterMark ;
+    mHighWaterCallBack = inCallBack ;
+  }
+
+  //································································································
+  // append: returns true if inMessage has been enqueued (possibly by dropping or overwriting
+  // an other message, according to overflow policy)
+  //································································································
+
+  public: bool append (const MESSAGE & inMessage) ;
+
+//--- Inserts inMessage before the head message (it becomes the next removed one); returns false,
+//    and counts an overflow, if FIFO is full. Head messages should not be pinned.
+  public: bool prepend (const MESSAGE & inMessage) ;
 
   //································································································
   // Remove
   //································································································
 
-  public: bool remove (CANFDMessage & outMessage) ;
+  public: bool remove (MESSAGE & outMessage) ;
+
+//--- Removes the head message without copying it (FIFO should not be empty)
+  public: void discardHead (void) ;
+
+  //································································································
+  // Direct slot access, for DMA transfers.
+  //   Appending: fill slotForAppend (0), ..., slotForAppend (n-1), then call commitAppend (n);
+  //     requires n <= size () - count ().
+  //   Removing: pin n head messages (they are not dropped nor overwritten by append), read
+  //     slotForRemove (0), ..., slotForRemove (n-1), then call discardPinnedHead.
+  //································································································
+
+  public: inline uint16_t freeCount (void) const { return mSize - mCount ; }
+
+  public: MESSAGE * slotForAppend (const uint16_t inOffset) ;
+
+  public: void commitAppend (const uint16_t inCount) ;
+
+  public: MESSAGE * slotForRemove (const uint16_t inOffset) ;
+
+  public: inline void pinHead (const uint16_t inCount) { mPinnedCount = inCount ; }
+
+  public: inline void unpinHead (void) { mPinnedCount = 0 ; }
+
+  public: void discardPinnedHead (void) ;
 
   //································································································
   // Free
@@ -72,12 +135,23 @@ class ACANFD_FeatherM4CAN_FIFO {
 
   public: inline void resetPeakCount (void) { mPeakCount = mCount ; }
 
+  //································································································
+  // Reset Overflow Count
+  //································································································
+
+  public: inline void resetOverflowCount (void) { mOverflowCount = 0 ; }
+
   //································································································
   // No copy
   //································································································
 
-  private: ACANFD_FeatherM4CAN_FIFO (const ACANFD_FeatherM4CAN_FIFO &) ;
-  private: ACANFD_FeatherM4CAN_FIFO & operator = (const ACANFD_FeatherM4CAN_FIFO &) ;
+  private: ACANFD_FeatherM4CAN_GenericFIFO (const ACANFD_FeatherM4CAN_GenericFIFO &) ;
+  private: ACANFD_FeatherM4CAN_GenericFIFO & operator = (const ACANFD_FeatherM4CAN_GenericFIFO &) ;
 } ;
 
 //--------------------------------------------------------------------------------------------------
+
+typedef ACANFD_FeatherM4CAN_GenericFIFO <CANFDMessage> ACANFD_FeatherM4CAN_FIFO ;
+typedef ACANFD_FeatherM4CAN_GenericFIFO <CANMessage> ACANFD_FeatherM4CAN_ClassicFIFO ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_GatewayRoutes.h>
+
+//--------------------------------------------------------------------------------------------------
+// Identifier of a standard frame is in bits 18-28 of element word 0 (page 1177)
+//--------------------------------------------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_GatewayRoutes::Route standardRoute (const ACANFD_FeatherM4CAN_GatewayRoutes::Action inAction,
+                                                               const uint16_t inIdentifierMask,
+                                                               const uint16_t inIdentifierValue) {
+  ACANFD_FeatherM4CAN_GatewayRoutes::Route route ;
+  route.mAction = inAction ;
+  route.mHeaderMask = uint32_t (inIdentifierMask & 0x7FFU) << 18 ;
+  route.mHeaderValue = uint32_t (inIdentifierValue & inIdentifierMask & 0x7FFU) << 18 ;
+  return route ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static ACANFD_FeatherM4CAN_GatewayRoutes::Route extendedRoute (const ACANFD_FeatherM4CAN_GatewayRoutes::Action inAction,
+                                                               const uint32_t inIdentifierMask,
+                                                               const uint32_t inIdentifierValue) {
+  ACANFD_FeatherM4CAN_GatewayRoutes::Route route ;
+  route.mAction = inAction ;
+  route.mHeaderMask = inIdentifierMask & 0x1FFFFFFFU ;
+  route.mHeaderValue = inIdentifierValue & inIdentifierMask & 0x1FFFFFFFU ;
+  return route ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_GatewayRoutes::ACANFD_FeatherM4CAN_GatewayRoutes (const uint8_t inStandardFilterCount,
+                                                                      const uint8_t inExtendedFilterCount,
+                                                                      const Action inDefaultAction) :
+mStandardRoutes (new Route [inStandardFilterCount]),
+mExtendedRoutes (new Route [inExtendedFilterCount]),
+mNonMatchingStandardRoute (),
+mNonMatchingExtendedRoute (),
+mStandardRouteCount (inStandardFilterCount),
+mExtendedRouteCount (inExtendedFilterCount) {
+  for (uint32_t i=0 ; i<inStandardFilterCount ; i++) {
+    mStandardRoutes [i].mAction = inDefaultAction ;
+  }
+  for (uint32_t i=0 ; i<inExtendedFilterCount ; i++) {
+    mExtendedRoutes [i].mAction = inDefaultAction ;
+  }
+  mNonMatchingStandardRoute.mAction = inDefaultAction ;
+  mNonMatchingExtendedRoute.mAction = inDefaultAction ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_GatewayRoutes::~ ACANFD_FeatherM4CAN_GatewayRoutes (void) {
+  delete [] mStandardRoutes ;
+  delete [] mExtendedRoutes ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Defining routes
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_GatewayRoutes::setStandardRoute (const uint8_t inFilterIndex,
+                                                          const Action inAction,
+                                                          const uint16_t inIdentifierMask,
+                                                          const uint16_t inIdentifierValue) {
+  const bool ok = inFilterIndex < mStandardRouteCount ;
+  if (ok) {
+    mStandardRoutes [inFilterIndex] = standardRoute (inAction, inIdentifierMask, inIdentifierValue) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_GatewayRoutes::setExtendedRoute (const uint8_t inFilterIndex,
+                                                          const Action inAction,
+                                                          const uint32_t inIdentifierMask,
+                                                          const uint32_t inIdentifierValue) {
+  const bool ok = inFilterIndex < mExtendedRouteCount ;
+  if (ok) {
+    mExtendedRoutes [inFilterIndex] = extendedRoute (inAction, inIdentifierMask, inIdentifierValue) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_GatewayRoutes::setNonMatchingStandardRoute (const Action inAction,
+                                                                     const uint16_t inIdentifierMask,
+                                                                     const uint16_t inIdentifierValue) {
+  mNonMatchingStandardRoute = standardRoute (inAction, inIdentifierMask, inIdentifierValue) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_GatewayRoutes::setNonMatchingExtendedRoute (const Action inAction,
+                                                                     const uint32_t inIdentifierMask,
+                                                                     const uint32_t inIdentifierValue) {
+  mNonMatchingExtendedRoute = extendedRoute (inAction, inIdentifierMask, inIdentifierValue) ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------
+// Routing table of a CAN0 <-> CAN1 gateway. A frame received by the source controller is routed
+// by the filter that accepted it: the route of filter index i applies to frames accepted by
+// standard (or extended) filter i; non matching frames have their own routes. Routing a single
+// identifier is done with a single identifier filter.
+// Forwarded frames are copied by the source interrupt service routine, from the source hardware
+// Rx FIFO element to the target hardware Tx FIFO; forwarding does not involve the loop.
+// A forwarded identifier can be rewritten: identifier bits set in mask are replaced by the
+// corresponding bits of value.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_GatewayRoutes {
+
+  //································································································
+  // Route action
+  //································································································
+
+  public: enum Action : uint8_t {
+    RECEIVE, // Frame is entered in source driver receive FIFO (as without gateway)
+    FORWARD, // Frame is sent by target controller
+    FORWARD_AND_RECEIVE,
+    DROP // Frame is discarded
+  } ;
+
+  //································································································
+  // Route
+  //································································································
+
+  public: class Route {
+    public: uint32_t mHeaderMask = 0 ; // Identifier bits of element word 0 that are replaced
+    public: uint32_t mHeaderValue = 0 ;
+    public: Action mAction = RECEIVE ;
+
+    public: inline bool forwards (void) const {
+      return (mAction == FORWARD) || (mAction == FORWARD_AND_RECEIVE) ;
+    }
+
+    public: inline bool receives (void) const {
+      return (mAction == RECEIVE) || (mAction == FORWARD_AND_RECEIVE) ;
+    }
+
+  //--- Word 0 of Tx buffer element from word 0 of Rx FIFO element: ESI bit is cleared (page 1177)
+    public: inline uint32_t forwardedHeader (const uint32_t inRxElementWord0) const {
+      return ((inRxElementWord0 & ~ mHeaderMask) | mHeaderValue) & 0x7FFFFFFFU ;
+    }
+  } ;
+
+  //································································································
+  // Constructor: all routes have the inDefaultAction action
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_GatewayRoutes (const uint8_t inStandardFilterCount,
+                                             const uint8_t inExtendedFilterCount,
+                                             const Action inDefaultAction = RECEIVE) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_GatewayRoutes (void) ;
+
+  //································································································
+  // Defining routes, return false if filter index is out of range
+  //································································································
+
+  public: bool setStandardRoute (const uint8_t inFilterIndex,
+                                 const Action inAction,
+                                 const uint16_t inIdentifierMask = 0,
+                                 const uint16_t inIdentifierValue = 0) ;
+
+  public: bool setExtendedRoute (const uint8_t inFilterIndex,
+                                 const Action inAction,
+                                 const uint32_t inIdentifierMask = 0,
+                                 const uint32_t inIdentifierValue = 0) ;
+
+  public: void setNonMatchingStandardRoute (const Action inAction,
+                                            const uint16_t inIdentifierMask = 0,
+                                            const uint16_t inIdentifierValue = 0) ;
+
+  public: void setNonMatchingExtendedRoute (const Action inAction,
+                                            const uint32_t inIdentifierMask = 0,
+                                            const uint32_t inIdentifierValue = 0) ;
+
+  //································································································
+  // Route of a received frame, from the two header words of its Rx FIFO element (page 1177)
+  //································································································
+
+  public: inline const Route & routeForRxElement (const uint32_t * inElement) const {
+    const uint32_t w1 = inElement [1] ;
+    const bool nonMatching = (w1 & (1U << 31)) != 0 ; // ANMF
+    const uint32_t filterIndex = (w1 >> 24) & 0x7F ; // FIDX
+    if ((inElement [0] & (1U << 30)) != 0) { // XTD
+      return (nonMatching || (filterIndex >= mExtendedRouteCount))
+        ? mNonMatchingExtendedRoute
+        : mExtendedRoutes [filterIndex] ;
+    }else{
+      return (nonMatching || (filterIndex >= mStandardRouteCount))
+        ? mNonMatchingStandardRoute
+        : mStandardRoutes [filterIndex] ;
+    }
+  }
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: Route * mStandardRoutes ;
+  private: Route * mExtendedRoutes ;
+  private: Route mNonMatchingStandardRoute ;
+  private: Route mNonMatchingExtendedRoute ;
+  private: const uint8_t mStandardRouteCount ;
+  private: const uint8_t mExtendedRouteCount ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_GatewayRoutes (const ACANFD_FeatherM4CAN_GatewayRoutes &) = delete ;
+  private: ACANFD_FeatherM4CAN_GatewayRoutes & operator = (const ACANFD_FeatherM4CAN_GatewayRoutes &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
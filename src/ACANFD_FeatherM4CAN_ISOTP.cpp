@@ -0,0 +1,501 @@
+//--------------------------------------------------------------------------------------------------
+// ISO-TP transport layer, frame formats refer to ISO 15765-2:2016
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_ISOTP.h>
+
+//--------------------------------------------------------------------------------------------------
+// Protocol control information (PCI) types, high nibble of first data byte
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t PCI_SINGLE_FRAME      = 0 ;
+static const uint8_t PCI_FIRST_FRAME       = 1 ;
+static const uint8_t PCI_CONSECUTIVE_FRAME = 2 ;
+static const uint8_t PCI_FLOW_CONTROL      = 3 ;
+
+//--------------------------------------------------------------------------------------------------
+// Flow status of flow control frame
+
+static const uint8_t FLOW_STATUS_CONTINUE_TO_SEND = 0 ;
+static const uint8_t FLOW_STATUS_WAIT             = 1 ;
+static const uint8_t FLOW_STATUS_OVERFLOW         = 2 ;
+
+//--------------------------------------------------------------------------------------------------
+// Largest message length of a first frame without escape sequence
+
+static const uint32_t FIRST_FRAME_MAX_SHORT_LENGTH = 4095 ;
+
+//--------------------------------------------------------------------------------------------------
+// STmin, in µs: 0x00 ... 0x7F: 0 ... 127 ms, 0xF1 ... 0xF9: 100 ... 900 µs, reserved values
+// are handled as 127 ms
+
+static uint32_t separationTimeFromSTmin (const uint8_t inSTmin) {
+  uint32_t result = 127 * 1000 ;
+  if (inSTmin <= 0x7F) {
+    result = uint32_t (inSTmin) * 1000 ;
+  }else if ((inSTmin >= 0xF1) && (inSTmin <= 0xF9)) {
+    result = uint32_t (inSTmin - 0xF0) * 100 ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_ISOTP::ACANFD_FeatherM4CAN_ISOTP (ACANFD_FeatherM4CAN & inCAN,
+                                                      const uint8_t inChannelCount) :
+mCAN (inCAN),
+mChannels (new Channel [inChannelCount]),
+mChannelCount (inChannelCount) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_ISOTP::~ ACANFD_FeatherM4CAN_ISOTP (void) {
+  delete [] mChannels ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Configuring a channel
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_ISOTP::configureChannel (const uint8_t inChannel,
+                                                      const ChannelSettings & inSettings,
+                                                      uint8_t * inReceiveBuffer,
+                                                      const uint32_t inReceiveBufferSize) {
+  uint32_t errorCode = 0 ;
+  if (inChannel >= mChannelCount) {
+    errorCode |= kChannelIndexTooLarge ;
+  }
+  const uint32_t frameLength = inSettings.mFrameLength ;
+  if (inSettings.mFrameType == CANFDMessage::CAN_REMOTE) {
+    errorCode |= kInvalidFrameLength ;
+  }else if (inSettings.mFrameType == CANFDMessage::CAN_DATA) {
+    if (frameLength != 8) {
+      errorCode |= kInvalidFrameLength ;
+    }
+  }else if ((frameLength < 8) || (frameLength > 64)
+         || (ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [ACANFD_FeatherM4CAN_Codec::DLC_FROM_LENGTH [frameLength]] != frameLength)) {
+    errorCode |= kInvalidFrameLength ;
+  }
+  const uint32_t identifierMask = inSettings.mExtended ? 0x1FFFFFFF : 0x7FF ;
+  if ((inSettings.mTransmitIdentifier > identifierMask) || (inSettings.mReceiveIdentifier > identifierMask)) {
+    errorCode |= kInvalidIdentifier ;
+  }
+  if (errorCode == 0) {
+    noInterrupts () ;
+      Channel & channel = mChannels [inChannel] ;
+      channel = Channel () ;
+      channel.mSettings = inSettings ;
+      channel.mReceiveBuffer = inReceiveBuffer ;
+      channel.mReceiveBufferSize = inReceiveBufferSize ;
+      channel.mConfigured = true ;
+    interrupts () ;
+  }
+  return errorCode ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Frames
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::initFrame (const Channel & inChannel, CANFDMessage & outFrame) const {
+  outFrame.id = inChannel.mSettings.mTransmitIdentifier ;
+  outFrame.ext = inChannel.mSettings.mExtended ;
+  outFrame.type = inChannel.mSettings.mFrameType ;
+  outFrame.idx = 0 ; // Sent via Tx FIFO
+  outFrame.len = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frames are padded to 8 bytes at least, CANFD frames to the next valid length
+
+void ACANFD_FeatherM4CAN_ISOTP::padFrame (const Channel & inChannel,
+                                          CANFDMessage & ioFrame,
+                                          const uint32_t inLength) {
+  uint32_t frameLength = 8 ;
+  if ((inLength > 8) && (inChannel.mSettings.mFrameLength > 8)) {
+    frameLength = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [ACANFD_FeatherM4CAN_Codec::DLC_FROM_LENGTH [inLength]] ;
+  }
+  for (uint32_t i=inLength ; i<frameLength ; i++) {
+    ioFrame.data [i] = inChannel.mSettings.mPaddingByte ;
+  }
+  ioFrame.len = uint8_t (frameLength) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::sendFlowControlFrame (const Channel & inChannel,
+                                                      const uint8_t inFlowStatus) {
+  CANFDMessage frame ;
+  initFrame (inChannel, frame) ;
+  frame.data [0] = (PCI_FLOW_CONTROL << 4) | inFlowStatus ;
+  frame.data [1] = inChannel.mSettings.mBlockSize ;
+  frame.data [2] = inChannel.mSettings.mSeparationTime ;
+  padFrame (inChannel, frame, 3) ;
+  mCAN.tryToSendReturnStatusFD (frame) ; // If lost, the transmitter times out
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Transmission
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_ISOTP::send (const uint8_t inChannel,
+                                          const uint8_t * inData,
+                                          const uint32_t inLength) {
+  uint32_t sendStatus = 0 ;
+  if ((inChannel >= mChannelCount) || !mChannels [inChannel].mConfigured) {
+    sendStatus = kChannelNotConfigured ;
+  }else if (inLength == 0) {
+    sendStatus = kInvalidMessageLength ;
+  }else{
+    Channel & channel = mChannels [inChannel] ;
+  //--- Reserve channel
+    noInterrupts () ;
+      if (channel.mTransmitState == TRANSMIT_IN_PROGRESS) {
+        sendStatus = kChannelBusy ;
+      }else{
+        channel.mTransmitState = TRANSMIT_IN_PROGRESS ;
+        channel.mFlowState = FLOW_NONE ;
+      }
+    interrupts () ;
+  //--- Single frame, or first frame
+    if (sendStatus == 0) {
+      const uint32_t frameLength = channel.mSettings.mFrameLength ;
+      CANFDMessage frame ;
+      initFrame (channel, frame) ;
+      bool singleFrame = true ;
+      if (inLength <= 7) { // Single frame, 4-bit length
+        frame.data [0] = (PCI_SINGLE_FRAME << 4) | uint8_t (inLength) ;
+        memcpy (& frame.data [1], inData, inLength) ;
+        padFrame (channel, frame, 1 + inLength) ;
+      }else if ((frameLength > 8) && (inLength <= (frameLength - 2))) { // Single frame, escape sequence
+        frame.data [0] = PCI_SINGLE_FRAME << 4 ;
+        frame.data [1] = uint8_t (inLength) ;
+        memcpy (& frame.data [2], inData, inLength) ;
+        padFrame (channel, frame, 2 + inLength) ;
+      }else{ // First frame
+        singleFrame = false ;
+        uint32_t pciLength = 2 ;
+        if (inLength <= FIRST_FRAME_MAX_SHORT_LENGTH) {
+          frame.data [0] = (PCI_FIRST_FRAME << 4) | uint8_t (inLength >> 8) ;
+          frame.data [1] = uint8_t (inLength) ;
+        }else{ // Escape sequence: 32-bit length
+          frame.data [0] = PCI_FIRST_FRAME << 4 ;
+          frame.data [1] = 0 ;
+          frame.data [2] = uint8_t (inLength >> 24) ;
+          frame.data [3] = uint8_t (inLength >> 16) ;
+          frame.data [4] = uint8_t (inLength >> 8) ;
+          frame.data [5] = uint8_t (inLength) ;
+          pciLength = 6 ;
+        }
+        const uint32_t n = frameLength - pciLength ;
+        memcpy (& frame.data [pciLength], inData, n) ;
+        frame.len = uint8_t (frameLength) ;
+        noInterrupts () ;
+          channel.mTransmitData = inData ;
+          channel.mTransmitLength = inLength ;
+          channel.mTransmitIndex = n ;
+          channel.mTransmitSequenceNumber = 1 ;
+          channel.mTransmitDate = millis () ;
+          channel.mFlowState = FLOW_WAIT_FLOW_CONTROL ;
+        interrupts () ;
+      }
+      if (mCAN.tryToSendReturnStatusFD (frame) != 0) {
+        sendStatus = kTransmitBufferFull ;
+        noInterrupts () ;
+          channel.mFlowState = FLOW_NONE ;
+          channel.mTransmitState = TRANSMIT_IDLE ;
+        interrupts () ;
+      }else if (singleFrame) {
+        channel.mTransmitState = TRANSMIT_DONE ;
+      }
+    }
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_ISOTP::TransmitState ACANFD_FeatherM4CAN_ISOTP::transmitState (const uint8_t inChannel) const {
+  return (inChannel < mChannelCount) ? mChannels [inChannel].mTransmitState : TRANSMIT_IDLE ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sends consecutive frames while the driver transmit FIFO is empty (so they go straight to the
+// hardware Tx FIFO), the current block is not complete, and STmin is elapsed. With a non zero
+// STmin, one frame is sent per call.
+// The loop (poll), the line 0 routine (flow control frame) and the line 1 routine (transmission
+// completed) run it for the same channel: each frame is built, sent and accounted with interrupts
+// disabled (PRIMASK is restored), so a flow control frame is only handled between two frames.
+
+void ACANFD_FeatherM4CAN_ISOTP::sendConsecutiveFrames (Channel & ioChannel) {
+  const uint32_t frameLength = ioChannel.mSettings.mFrameLength ;
+  bool loop = true ;
+  while (loop) {
+    const uint32_t primask = __get_PRIMASK () ;
+    __disable_irq () ;
+      loop = (ioChannel.mFlowState == FLOW_SEND_CONSECUTIVE_FRAMES)
+          && (mCAN.transmitFIFOCount () == 0)
+          && ((micros () - ioChannel.mLastConsecutiveFrameDate) >= ioChannel.mReceiverSeparationTime) ;
+      if (loop) {
+        CANFDMessage frame ;
+        initFrame (ioChannel, frame) ;
+        frame.data [0] = (PCI_CONSECUTIVE_FRAME << 4) | ioChannel.mTransmitSequenceNumber ;
+        uint32_t n = ioChannel.mTransmitLength - ioChannel.mTransmitIndex ;
+        if (n > (frameLength - 1)) {
+          n = frameLength - 1 ;
+        }
+        memcpy (& frame.data [1], ioChannel.mTransmitData + ioChannel.mTransmitIndex, n) ;
+        padFrame (ioChannel, frame, 1 + n) ;
+        loop = mCAN.tryToSendReturnStatusFD (frame) == 0 ;
+        if (loop) {
+          ioChannel.mTransmitIndex += n ;
+          ioChannel.mTransmitSequenceNumber = (ioChannel.mTransmitSequenceNumber + 1) & 0xF ;
+          ioChannel.mLastConsecutiveFrameDate = micros () ;
+          if (ioChannel.mTransmitIndex == ioChannel.mTransmitLength) {
+            ioChannel.mFlowState = FLOW_NONE ;
+            ioChannel.mTransmitState = TRANSMIT_DONE ;
+          }else if (ioChannel.mReceiverBlockSize > 0) {
+            ioChannel.mBlockFrameCount += 1 ;
+            if (ioChannel.mBlockFrameCount == ioChannel.mReceiverBlockSize) {
+              ioChannel.mFlowState = FLOW_WAIT_FLOW_CONTROL ;
+              ioChannel.mTransmitDate = millis () ;
+            }
+          }
+          if (ioChannel.mReceiverSeparationTime > 0) {
+            loop = false ;
+          }
+        }
+      }
+    __set_PRIMASK (primask) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::handleFlowControlFrame (Channel & ioChannel, const CANFDMessage & inFrame) {
+  if ((ioChannel.mFlowState == FLOW_WAIT_FLOW_CONTROL) && (inFrame.len >= 3)) {
+    switch (inFrame.data [0] & 0xF) {
+    case FLOW_STATUS_CONTINUE_TO_SEND :
+      ioChannel.mReceiverBlockSize = inFrame.data [1] ;
+      ioChannel.mReceiverSeparationTime = separationTimeFromSTmin (inFrame.data [2]) ;
+      ioChannel.mBlockFrameCount = 0 ;
+      ioChannel.mLastConsecutiveFrameDate = micros () - ioChannel.mReceiverSeparationTime ;
+      ioChannel.mFlowState = FLOW_SEND_CONSECUTIVE_FRAMES ;
+      sendConsecutiveFrames (ioChannel) ;
+      break ;
+    case FLOW_STATUS_WAIT :
+      ioChannel.mTransmitDate = millis () ;
+      break ;
+    case FLOW_STATUS_OVERFLOW :
+      ioChannel.mFlowState = FLOW_NONE ;
+      ioChannel.mTransmitState = TRANSMIT_RECEIVER_OVERFLOW ;
+      break ;
+    default : // Reserved, ignored
+      break ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::handleTransmitCompleted (void) {
+  for (uint32_t i=0 ; i<mChannelCount ; i++) {
+    if (mChannels [i].mFlowState == FLOW_SEND_CONSECUTIVE_FRAMES) {
+      sendConsecutiveFrames (mChannels [i]) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Reception
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_ISOTP::handleRxElement (const uint32_t * inElement, const uint32_t inDataWordCount) {
+  const uint32_t w0 = inElement [0] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  const uint32_t identifier = extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+  bool found = false ;
+  for (uint32_t i=0 ; (i<mChannelCount) && !found ; i++) {
+    Channel & channel = mChannels [i] ;
+    found = channel.mConfigured
+         && (channel.mSettings.mExtended == extended)
+         && (channel.mSettings.mReceiveIdentifier == identifier) ;
+    if (found) {
+      CANFDMessage frame ;
+      ACANFD_FeatherM4CAN_Codec::decodeHeader (inElement, frame) ;
+      ACANFD_FeatherM4CAN_Codec::copyWords (frame.data32, inElement + 2,
+                                            ACANFD_FeatherM4CAN_Codec::dataWordCount (frame, inDataWordCount)) ;
+      ACANFD_FeatherM4CAN_Codec::fillMissingData (frame, 4 * inDataWordCount) ;
+      handleReceivedFrame (channel, frame) ;
+    }
+  }
+  return found ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::handleReceivedFrame (Channel & ioChannel, const CANFDMessage & inFrame) {
+  if ((inFrame.type != CANFDMessage::CAN_REMOTE) && (inFrame.len > 0)) {
+    switch (inFrame.data [0] >> 4) {
+    case PCI_SINGLE_FRAME :
+      { uint32_t length = inFrame.data [0] & 0xF ;
+        uint32_t offset = 1 ;
+        if ((length == 0) && (inFrame.len > 8)) { // Escape sequence
+          length = inFrame.data [1] ;
+          offset = 2 ;
+        }
+        if ((length > 0) && ((offset + length) <= inFrame.len)) {
+          if ((ioChannel.mReceiveState == RECEIVE_DONE) || (length > ioChannel.mReceiveBufferSize)) {
+            ioChannel.mReceiveErrorCount += 1 ;
+          }else{
+            memcpy (ioChannel.mReceiveBuffer, & inFrame.data [offset], length) ;
+            ioChannel.mReceiveLength = length ;
+            ioChannel.mReceiveState = RECEIVE_DONE ;
+          }
+        }
+      }
+      break ;
+    case PCI_FIRST_FRAME :
+      handleFirstFrame (ioChannel, inFrame) ;
+      break ;
+    case PCI_CONSECUTIVE_FRAME :
+      handleConsecutiveFrame (ioChannel, inFrame) ;
+      break ;
+    case PCI_FLOW_CONTROL :
+      handleFlowControlFrame (ioChannel, inFrame) ;
+      break ;
+    default : // Reserved, ignored
+      break ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::handleFirstFrame (Channel & ioChannel, const CANFDMessage & inFrame) {
+  if (inFrame.len >= 8) {
+    uint32_t length = (uint32_t (inFrame.data [0] & 0xF) << 8) | inFrame.data [1] ;
+    uint32_t offset = 2 ;
+    if (length == 0) { // Escape sequence: 32-bit length
+      length = (uint32_t (inFrame.data [2]) << 24) | (uint32_t (inFrame.data [3]) << 16)
+             | (uint32_t (inFrame.data [4]) << 8) | uint32_t (inFrame.data [5]) ;
+      offset = 6 ;
+    }
+    if ((ioChannel.mReceiveState == RECEIVE_DONE) || (length > ioChannel.mReceiveBufferSize)) {
+      ioChannel.mReceiveErrorCount += 1 ;
+      sendFlowControlFrame (ioChannel, FLOW_STATUS_OVERFLOW) ;
+    }else{
+      uint32_t n = inFrame.len - offset ;
+      if (n > length) {
+        n = length ;
+      }
+      memcpy (ioChannel.mReceiveBuffer, & inFrame.data [offset], n) ;
+      ioChannel.mReceiveLength = length ;
+      ioChannel.mReceiveIndex = n ;
+      ioChannel.mReceiveSequenceNumber = 1 ;
+      ioChannel.mReceiveBlockFrameCount = 0 ;
+      ioChannel.mReceiveDate = millis () ;
+      ioChannel.mReceiveState = RECEIVE_IN_PROGRESS ;
+      sendFlowControlFrame (ioChannel, FLOW_STATUS_CONTINUE_TO_SEND) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::handleConsecutiveFrame (Channel & ioChannel, const CANFDMessage & inFrame) {
+  if (ioChannel.mReceiveState == RECEIVE_IN_PROGRESS) {
+    if ((inFrame.data [0] & 0xF) != ioChannel.mReceiveSequenceNumber) { // Sequence error: abort
+      ioChannel.mReceiveErrorCount += 1 ;
+      ioChannel.mReceiveState = RECEIVE_IDLE ;
+    }else{
+      uint32_t n = ioChannel.mReceiveLength - ioChannel.mReceiveIndex ;
+      if (n > uint32_t (inFrame.len - 1)) {
+        n = inFrame.len - 1 ;
+      }
+      memcpy (ioChannel.mReceiveBuffer + ioChannel.mReceiveIndex, & inFrame.data [1], n) ;
+      ioChannel.mReceiveIndex += n ;
+      ioChannel.mReceiveSequenceNumber = (ioChannel.mReceiveSequenceNumber + 1) & 0xF ;
+      ioChannel.mReceiveDate = millis () ;
+      if (ioChannel.mReceiveIndex == ioChannel.mReceiveLength) {
+        ioChannel.mReceiveState = RECEIVE_DONE ;
+      }else if (ioChannel.mSettings.mBlockSize > 0) {
+        ioChannel.mReceiveBlockFrameCount += 1 ;
+        if (ioChannel.mReceiveBlockFrameCount == ioChannel.mSettings.mBlockSize) {
+          ioChannel.mReceiveBlockFrameCount = 0 ;
+          sendFlowControlFrame (ioChannel, FLOW_STATUS_CONTINUE_TO_SEND) ;
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_ISOTP::receive (const uint8_t inChannel, uint32_t & outLength) const {
+  const bool hasMessage = (inChannel < mChannelCount) && (mChannels [inChannel].mReceiveState == RECEIVE_DONE) ;
+  if (hasMessage) {
+    outLength = mChannels [inChannel].mReceiveLength ;
+  }
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::releaseReceiveBuffer (const uint8_t inChannel) {
+  if (inChannel < mChannelCount) {
+    noInterrupts () ;
+      if (mChannels [inChannel].mReceiveState == RECEIVE_DONE) {
+        mChannels [inChannel].mReceiveState = RECEIVE_IDLE ;
+      }
+    interrupts () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_ISOTP::ReceiveState ACANFD_FeatherM4CAN_ISOTP::receiveState (const uint8_t inChannel) const {
+  return (inChannel < mChannelCount) ? mChannels [inChannel].mReceiveState : RECEIVE_IDLE ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_ISOTP::receiveErrorCount (const uint8_t inChannel) const {
+  return (inChannel < mChannelCount) ? mChannels [inChannel].mReceiveErrorCount : 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Poll
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_ISOTP::poll (void) {
+  bool sendConsecutive = false ;
+  noInterrupts () ;
+    const uint32_t now = millis () ;
+    for (uint32_t i=0 ; i<mChannelCount ; i++) {
+      Channel & channel = mChannels [i] ;
+    //--- N_Bs timeout
+      if ((channel.mFlowState == FLOW_WAIT_FLOW_CONTROL) && ((now - channel.mTransmitDate) > channel.mSettings.mTimeout)) {
+        channel.mFlowState = FLOW_NONE ;
+        channel.mTransmitState = TRANSMIT_TIMEOUT ;
+      }
+      sendConsecutive |= channel.mFlowState == FLOW_SEND_CONSECUTIVE_FRAMES ;
+    //--- N_Cr timeout
+      if ((channel.mReceiveState == RECEIVE_IN_PROGRESS) && ((now - channel.mReceiveDate) > channel.mSettings.mTimeout)) {
+        channel.mReceiveErrorCount += 1 ;
+        channel.mReceiveState = RECEIVE_IDLE ;
+      }
+    }
+  interrupts () ;
+//--- Consecutive frames paced by STmin (sendConsecutiveFrames disables interrupts for each frame)
+  if (sendConsecutive) {
+    handleTransmitCompleted () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,207 @@
+//--------------------------------------------------------------------------------------------------
+// ISO-TP transport layer, frame formats refer to ISO 15765-2:2016
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN-from-cpp.h>
+
+//--------------------------------------------------------------------------------------------------
+// An ISO-TP engine handles several channels on one controller; a channel is a pair of transmit
+// and receive identifiers (normal addressing). Once set to the driver (setISOTP), frames with a
+// channel receive identifier are handled by the receive interrupt service routine, they are not
+// entered into driver receive FIFOs: flow control frames are sent, and consecutive frames are
+// sent on flow control reception and on transmission completion, from interrupt context.
+// poll should be called from loop for timeouts, and for consecutive frames paced by a STmin
+// greater than frame duration.
+// CANFD channels use escape sequences: single frames up to 62 bytes, first frames with 32-bit
+// message length; message length is only limited by reception buffer size.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_ISOTP {
+
+  //································································································
+  // Channel settings
+  //································································································
+
+  public: class ChannelSettings {
+  //--- Identifiers (normal addressing)
+    public: uint32_t mTransmitIdentifier = 0 ;
+    public: uint32_t mReceiveIdentifier = 0 ;
+    public: bool mExtended = false ;
+  //--- CAN_DATA for classic ISO-TP (mFrameLength should be 8)
+    public: CANFDMessage::Type mFrameType = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  //--- TX_DL: 8, 12, 16, 20, 24, 32, 48 or 64
+    public: uint8_t mFrameLength = 64 ;
+  //--- Sent in flow control frames: consecutive frame count between flow control frames
+  //    (0: no limit), and STmin (0x00 ... 0x7F: 0 ... 127 ms, 0xF1 ... 0xF9: 100 ... 900 µs)
+    public: uint8_t mBlockSize = 0 ;
+    public: uint8_t mSeparationTime = 0 ;
+  //--- Unused bytes of frames
+    public: uint8_t mPaddingByte = 0xCC ;
+  //--- N_Bs (flow control wait) and N_Cr (consecutive frame wait) timeout, in ms
+    public: uint32_t mTimeout = 1000 ;
+  } ;
+
+  //································································································
+  // Transfer states
+  //································································································
+
+  public: enum TransmitState : uint8_t {
+    TRANSMIT_IDLE,
+    TRANSMIT_IN_PROGRESS,
+    TRANSMIT_DONE,
+    TRANSMIT_TIMEOUT, // No flow control frame
+    TRANSMIT_RECEIVER_OVERFLOW // Receiver flow control frame is OVFLW
+  } ;
+
+  public: enum ReceiveState : uint8_t {
+    RECEIVE_IDLE,
+    RECEIVE_IN_PROGRESS,
+    RECEIVE_DONE // Message is in reception buffer, until releaseReceiveBuffer
+  } ;
+
+  //································································································
+  // Constructor
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_ISOTP (ACANFD_FeatherM4CAN & inCAN, const uint8_t inChannelCount) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_ISOTP (void) ;
+
+  //································································································
+  // Configuring a channel; reception buffer should remain valid while channel is used. Returns 0
+  // if ok, otherwise every bit denotes an error
+  //································································································
+
+  public: static const uint32_t kChannelIndexTooLarge = 1 << 0 ;
+  public: static const uint32_t kInvalidFrameLength   = 1 << 1 ;
+  public: static const uint32_t kInvalidIdentifier    = 1 << 2 ;
+
+  public: uint32_t configureChannel (const uint8_t inChannel,
+                                     const ChannelSettings & inSettings,
+                                     uint8_t * inReceiveBuffer,
+                                     const uint32_t inReceiveBufferSize) ;
+
+  public: inline uint8_t channelCount (void) const { return mChannelCount ; }
+
+  //································································································
+  // Transmitting a message; data is not copied, it should remain valid while transmit state is
+  // TRANSMIT_IN_PROGRESS. Returns 0 if ok, or an error code
+  //································································································
+
+  public: static const uint32_t kChannelNotConfigured  = 1 ;
+  public: static const uint32_t kChannelBusy           = 2 ;
+  public: static const uint32_t kInvalidMessageLength  = 3 ;
+  public: static const uint32_t kTransmitBufferFull    = 4 ;
+
+  public: uint32_t send (const uint8_t inChannel, const uint8_t * inData, const uint32_t inLength) ;
+
+  public: TransmitState transmitState (const uint8_t inChannel) const ;
+
+  //································································································
+  // Receiving a message: returns true if a complete message is in channel reception buffer; the
+  // buffer is not written until releaseReceiveBuffer is called
+  //································································································
+
+  public: bool receive (const uint8_t inChannel, uint32_t & outLength) const ;
+
+  public: void releaseReceiveBuffer (const uint8_t inChannel) ;
+
+  public: ReceiveState receiveState (const uint8_t inChannel) const ;
+
+  //································································································
+  // Reception error count: sequence errors, timeouts, messages too large for reception buffer,
+  // messages lost as the reception buffer was not released
+  //································································································
+
+  public: uint32_t receiveErrorCount (const uint8_t inChannel) const ;
+
+  //································································································
+  // Poll, should be called from loop
+  //································································································
+
+  public: void poll (void) ;
+
+  //································································································
+  // Called from driver interrupt service routine
+  //································································································
+
+//--- Returns true if the element has a channel receive identifier (it is then consumed)
+  public: bool handleRxElement (const uint32_t * inElement, const uint32_t inDataWordCount) ;
+
+  public: void handleTransmitCompleted (void) ;
+
+  //································································································
+  // Private types
+  //································································································
+
+  private: enum FlowState : uint8_t {
+    FLOW_NONE,
+    FLOW_WAIT_FLOW_CONTROL, // Transmitter waits for flow control frame
+    FLOW_SEND_CONSECUTIVE_FRAMES // Transmitter sends block of consecutive frames
+  } ;
+
+  private: class Channel {
+    public: ChannelSettings mSettings ;
+  //--- Transmission
+    public: const uint8_t * mTransmitData = nullptr ;
+    public: uint32_t mTransmitLength = 0 ;
+    public: uint32_t mTransmitIndex = 0 ;
+    public: uint32_t mTransmitDate = 0 ; // In ms, for N_Bs timeout
+    public: uint32_t mLastConsecutiveFrameDate = 0 ; // In µs, for STmin
+    public: uint32_t mReceiverSeparationTime = 0 ; // In µs
+    public: uint8_t mReceiverBlockSize = 0 ;
+    public: uint8_t mBlockFrameCount = 0 ;
+    public: uint8_t mTransmitSequenceNumber = 0 ;
+    public: volatile TransmitState mTransmitState = TRANSMIT_IDLE ;
+    public: volatile FlowState mFlowState = FLOW_NONE ;
+  //--- Reception
+    public: uint8_t * mReceiveBuffer = nullptr ;
+    public: uint32_t mReceiveBufferSize = 0 ;
+    public: uint32_t mReceiveLength = 0 ;
+    public: uint32_t mReceiveIndex = 0 ;
+    public: uint32_t mReceiveDate = 0 ; // In ms, for N_Cr timeout
+    public: volatile uint32_t mReceiveErrorCount = 0 ;
+    public: uint8_t mReceiveSequenceNumber = 0 ;
+    public: uint8_t mReceiveBlockFrameCount = 0 ;
+    public: volatile ReceiveState mReceiveState = RECEIVE_IDLE ;
+    public: bool mConfigured = false ;
+  } ;
+
+  //································································································
+  // Private methods
+  //································································································
+
+  private: void handleReceivedFrame (Channel & ioChannel, const CANFDMessage & inFrame) ;
+  private: void handleFlowControlFrame (Channel & ioChannel, const CANFDMessage & inFrame) ;
+  private: void handleFirstFrame (Channel & ioChannel, const CANFDMessage & inFrame) ;
+  private: void handleConsecutiveFrame (Channel & ioChannel, const CANFDMessage & inFrame) ;
+  private: void sendConsecutiveFrames (Channel & ioChannel) ;
+  private: void sendFlowControlFrame (const Channel & inChannel, const uint8_t inFlowStatus) ;
+  private: void initFrame (const Channel & inChannel, CANFDMessage & outFrame) const ;
+  private: static void padFrame (const Channel & inChannel, CANFDMessage & ioFrame, const uint32_t inLength) ;
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: ACANFD_FeatherM4CAN & mCAN ;
+  private: Channel * mChannels ;
+  private: const uint8_t mChannelCount ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_ISOTP (const ACANFD_FeatherM4CAN_ISOTP &) = delete ;
+  private: ACANFD_FeatherM4CAN_ISOTP & operator = (const ACANFD_FeatherM4CAN_ISOTP &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
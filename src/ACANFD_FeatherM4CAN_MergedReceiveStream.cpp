@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_MergedReceiveStream.h>
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_MergedReceiveStream::ACANFD_FeatherM4CAN_MergedReceiveStream (const uint16_t inCapacity,
+                                                                                  const uint32_t inReorderWindow) :
+mFrames (new Frame [inCapacity]),
+mOrder (new uint16_t [inCapacity]),
+mFreeFrames (new uint16_t [inCapacity]),
+mCapacity (inCapacity),
+mReorderWindow (inReorderWindow),
+mCount (0),
+mReadIndex (0),
+mFreeCount (inCapacity),
+mPeakCount (0),
+mOverflowCount (0),
+mLateFrameCount (0),
+mLastDeliveredDate (0),
+mDelivered (false) {
+  for (uint16_t i=0 ; i<inCapacity ; i++) {
+    mFreeFrames [i] = i ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_MergedReceiveStream:: ~ ACANFD_FeatherM4CAN_MergedReceiveStream (void) {
+  delete [] mFrames ;
+  delete [] mOrder ;
+  delete [] mFreeFrames ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Appending (interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+// Each controller FIFO delivers its frames in date order, so a frame is usually inserted at the
+// end, or a few positions before it (frames of the other controller, not yet delivered). Dates
+// are compared by signed difference, as the micros () counter wraps around.
+
+bool ACANFD_FeatherM4CAN_MergedReceiveStream::append (const CANFDMessage & inMessage,
+                                                      const uint32_t inDate,
+                                                      const uint8_t inController,
+                                                      const uint8_t inFIFOIndex) {
+  const uint32_t primask = __get_PRIMASK () ; // Routines of CAN0 and CAN1 may preempt each other
+  __disable_irq () ;
+    const bool ok = mCount < mCapacity ;
+    if (!ok) {
+      mOverflowCount += 1 ;
+    }else{
+      mFreeCount -= 1 ;
+      const uint16_t frameIndex = mFreeFrames [mFreeCount] ;
+      Frame & frame = mFrames [frameIndex] ;
+      frame.mMessage = inMessage ;
+      frame.mDate = inDate ;
+      frame.mController = inController ;
+      frame.mFIFOIndex = inFIFOIndex ;
+    //--- Insert, after frames with an earlier or equal date
+      uint16_t position = mCount ;
+      while ((position > 0) && (int32_t (mFrames [mOrder [orderIndex (position - 1)]].mDate - inDate) > 0)) {
+        mOrder [orderIndex (position)] = mOrder [orderIndex (position - 1)] ;
+        position -= 1 ;
+      }
+      mOrder [orderIndex (position)] = frameIndex ;
+      mCount += 1 ;
+      if (mPeakCount < mCount) {
+        mPeakCount = mCount ;
+      }
+      if (mDelivered && (int32_t (mLastDeliveredDate - inDate) > 0)) {
+        mLateFrameCount += 1 ;
+      }
+    }
+  __set_PRIMASK (primask) ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Receiving (loop)
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_MergedReceiveStream::receive (Frame & outFrame) {
+  noInterrupts () ;
+    bool ok = mCount > 0 ;
+    if (ok) {
+      const uint16_t frameIndex = mOrder [mReadIndex] ;
+      ok = (mCount == mCapacity) || ((micros () - mFrames [frameIndex].mDate) >= mReorderWindow) ;
+      if (ok) {
+        outFrame = mFrames [frameIndex] ;
+        mReadIndex = orderIndex (1) ;
+        mCount -= 1 ;
+        mFreeFrames [mFreeCount] = frameIndex ;
+        mFreeCount += 1 ;
+        mLastDeliveredDate = outFrame.mDate ;
+        mDelivered = true ;
+      }
+    }
+  interrupts () ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_MergedReceiveStream::available (void) const {
+  noInterrupts () ;
+    const bool ok = (mCount > 0)
+      && ((mCount == mCapacity) || ((micros () - mFrames [mOrder [mReadIndex]].mDate) >= mReorderWindow)) ;
+  interrupts () ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Counters
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_MergedReceiveStream::resetCounts (void) {
+  noInterrupts () ;
+    mPeakCount = mCount ;
+    mOverflowCount = 0 ;
+    mLateFrameCount = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
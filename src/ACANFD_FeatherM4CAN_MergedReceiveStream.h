@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Merged receive stream: frames received by CAN0 and CAN1, in Rx FIFO 0 and Rx FIFO 1, are
+// delivered in global arrival order, each one tagged with its controller and FIFO.
+// Once set to a controller (setMergedReceiveStream), frames it receives are entered into the
+// stream by its receive interrupt service routine, instead of its driver receive FIFOs. A single
+// stream is set to both controllers; as their interrupt priorities may differ, a frame is inserted
+// with interrupts disabled.
+//
+// Receive date is the hardware timestamp of the frame (RXTS field of the Rx FIFO element, page
+// 1177, captured at start of frame), converted by the driver to the micros () time base: both
+// controllers share the same clock. The timestamp counter counts nominal bit times; within a
+// CANFD frame with bit rate switch, data phase bits are also counted as nominal bit times, so the
+// date of a frame received while such a frame was on the bus is early by at most a few µs.
+//
+// Frames are kept sorted by date; a frame is delivered only when it is older than the reorder
+// window, so that a frame received by the other controller, with an earlier date but handled
+// later by its interrupt service routine, can still be inserted before it. The window should be
+// greater than the longest frame duration plus interrupt latency (for example, 1 ms). When the
+// stream is full, its oldest frame is delivered without waiting.
+// A frame whose date is earlier than an already delivered one (the window is too short) is
+// delivered next, and counted as late.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_MergedReceiveStream {
+
+  //································································································
+  // Frame
+  //································································································
+
+  public: class Frame {
+    public: CANFDMessage mMessage ; // mMessage.idx is the filter index (255 for non matching frames)
+    public: uint32_t mDate = 0 ; // In µs, micros () time base
+    public: uint8_t mController = 0 ; // 0: CAN0, 1: CAN1
+    public: uint8_t mFIFOIndex = 0 ; // 0: Rx FIFO 0, 1: Rx FIFO 1
+  } ;
+
+  //································································································
+  // Constructor: inCapacity frames, inReorderWindow in µs
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_MergedReceiveStream (const uint16_t inCapacity,
+                                                   const uint32_t inReorderWindow) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_MergedReceiveStream (void) ;
+
+  //································································································
+  // Receiving (from loop): returns false if no frame can be delivered now
+  //································································································
+
+  public: bool receive (Frame & outFrame) ;
+
+  public: bool available (void) const ;
+
+  //································································································
+  // Reorder window
+  //································································································
+
+  public: inline uint32_t reorderWindow (void) const { return mReorderWindow ; }
+
+  public: inline void setReorderWindow (const uint32_t inReorderWindow) { mReorderWindow = inReorderWindow ; }
+
+  //································································································
+  // Counters
+  //································································································
+
+  public: inline uint16_t capacity (void) const { return mCapacity ; }
+  public: inline uint16_t count (void) const { return mCount ; }
+  public: inline uint16_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint32_t overflowCount (void) const { return mOverflowCount ; } // Lost frames
+  public: inline uint32_t lateFrameCount (void) const { return mLateFrameCount ; }
+
+  public: void resetCounts (void) ;
+
+  //································································································
+  // Called by driver, from interrupt service routine: returns false if stream is full (the frame
+  // is lost)
+  //································································································
+
+  public: bool append (const CANFDMessage & inMessage,
+                       const uint32_t inDate,
+                       const uint8_t inController,
+                       const uint8_t inFIFOIndex) ;
+
+  //································································································
+  // Private
+  //································································································
+
+  private: inline uint16_t orderIndex (const uint16_t inPosition) const {
+    const uint32_t index = uint32_t (mReadIndex) + inPosition ;
+    return uint16_t ((index >= mCapacity) ? (index - mCapacity) : index) ;
+  }
+
+  private: Frame * mFrames ;
+  private: uint16_t * mOrder ; // Ring of frame indexes, sorted by date, from mReadIndex
+  private: uint16_t * mFreeFrames ; // Stack of free frame indexes
+  private: const uint16_t mCapacity ;
+  private: uint32_t mReorderWindow ;
+  private: volatile uint16_t mCount ;
+  private: uint16_t mReadIndex ;
+  private: uint16_t mFreeCount ;
+  private: uint16_t mPeakCount ;
+  private: volatile uint32_t mOverflowCount ;
+  private: volatile uint32_t mLateFrameCount ;
+  private: uint32_t mLastDeliveredDate ;
+  private: bool mDelivered ; // mLastDeliveredDate is valid
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_MergedReceiveStream (const ACANFD_FeatherM4CAN_MergedReceiveStream &) = delete ;
+  private: ACANFD_FeatherM4CAN_MergedReceiveStream & operator = (const ACANFD_FeatherM4CAN_MergedReceiveStream &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,42 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_MessageRamArena.h>
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_MessageRamArena::ACANFD_FeatherM4CAN_MessageRamArena (uint32_t * inWords,
+                                                                          const uint32_t inWordSize) :
+mWords (inWords),
+mWordSize (inWordSize) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Allocation
+//--------------------------------------------------------------------------------------------------
+
+uint32_t * ACANFD_FeatherM4CAN_MessageRamArena::allocate (const uint32_t inWordCount) {
+  uint32_t * result = nullptr ;
+  if (inWordCount <= freeWordCount ()) {
+    result = mWords + mAllocatedWordCount ;
+    mAllocatedWordCount += inWordCount ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Release
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_MessageRamArena::release (uint32_t * inBlock, const uint32_t inWordCount) {
+  const bool isLast = (inBlock != nullptr)
+    && (inWordCount <= mAllocatedWordCount)
+    && (inBlock == (mWords + mAllocatedWordCount - inWordCount)) ;
+  if (isLast) {
+    mAllocatedWordCount -= inWordCount ;
+  }
+  return isLast ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------
+// Message RAM shared by CAN0 and CAN1 (see CAN_MESSAGE_RAM_ARENA_SIZE in ACANFD_FeatherM4CAN.h).
+// Every controller built on the arena takes, in beginFD, exactly the word count its
+// configuration requires (filters, Rx FIFOs, Tx buffers): blocks are allocated one after the
+// other, from the arena start. As start addresses are 16-bit offsets (page 1118), the whole
+// arena should lie in the first 64 kio of SRAM (beginFD checks it).
+// A controller that calls beginFD again keeps its block if it is large enough; otherwise the
+// block is released and a new one allocated, the released words are reused only if the block
+// was the last allocated one.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_MessageRamArena {
+
+  //································································································
+  // Constructor
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_MessageRamArena (uint32_t * inWords, const uint32_t inWordSize) ;
+
+  //································································································
+  // Allocation: returns nullptr if free word count is too small
+  //································································································
+
+  public: uint32_t * allocate (const uint32_t inWordCount) ;
+
+  //································································································
+  // Release: returns false (nothing is done) if inBlock is not the last allocated block
+  //································································································
+
+  public: bool release (uint32_t * inBlock, const uint32_t inWordCount) ;
+
+  //································································································
+  // Accessors
+  //································································································
+
+  public: inline uint32_t * words (void) const { return mWords ; }
+  public: inline uint32_t wordSize (void) const { return mWordSize ; }
+  public: inline uint32_t allocatedWordCount (void) const { return mAllocatedWordCount ; }
+  public: inline uint32_t freeWordCount (void) const { return mWordSize - mAllocatedWordCount ; }
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: uint32_t * const mWords ;
+  private: const uint32_t mWordSize ;
+  private: uint32_t mAllocatedWordCount = 0 ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_MessageRamArena (const ACANFD_FeatherM4CAN_MessageRamArena &) = delete ;
+  private: ACANFD_FeatherM4CAN_MessageRamArena & operator = (const ACANFD_FeatherM4CAN_MessageRamArena &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -43,7 +43,6 @@ static const uint32_t MAX_ARBITRATION_TQ_COUNT = 1 + MAX_ARBITRATION_PS1 + MAX_A
 
 //--------------------------------------------------------------------------------------------------
 
-static const uint32_t CAN_ROOT_CLOCK_FREQUENCY = 48 * 1000 * 1000 ;
 static const uint32_t MAX_BRP = 32 ;
 
 //--------------------------------------------------------------------------------------------------
@@ -145,6 +144,20 @@ uint32_t ACANFD_FeatherM4CAN_Settings::actualDataBitRate (void) const {
 
 //--------------------------------------------------------------------------------------------------
 
+uint32_t ACANFD_FeatherM4CAN_Settings::arbitrationBitDuration (void) const {
+  const uint32_t TQCount = 1 /* Sync Seg */ + mArbitrationPhaseSegment1 + mArbitrationPhaseSegment2 ;
+  return mBitRatePrescaler * TQCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_Settings::dataBitDuration (void) const {
+  const uint32_t TQCount = 1 /* Sync Seg */ + mDataPhaseSegment1 + mDataPhaseSegment2 ;
+  return mBitRatePrescaler * TQCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool ACANFD_FeatherM4CAN_Settings::exactArbitrationBitRate (void) const {
   const uint32_t TQCount = 1 /* Sync Seg */ + mArbitrationPhaseSegment1 + mArbitrationPhaseSegment2 ;
   return CAN_ROOT_CLOCK_FREQUENCY == (mBitRatePrescaler * mDesiredArbitrationBitRate * TQCount) ;
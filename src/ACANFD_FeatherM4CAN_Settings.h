@@ -31,6 +31,41 @@ class ACANFD_FeatherM4CAN_Settings {
     BUS_MONITORING
   } ModuleMode ;
 
+//··································································································
+
+  public: typedef enum : uint8_t {
+    BUS_OFF_RECOVERY_MANUAL, // Call recoverFromBusOff
+    BUS_OFF_RECOVERY_IMMEDIATE, // Recovery sequence starts as soon as bus off is detected
+    BUS_OFF_RECOVERY_WITH_BACKOFF // Recovery sequence starts after a delay, doubled at each consecutive bus off
+  } BusOffRecoveryPolicy ;
+
+//··································································································
+
+  public: typedef enum : uint8_t {
+    DROP_NEWEST, // The appended frame is lost
+    DROP_OLDEST, // The oldest frame is lost, the appended frame is enqueued
+    OVERWRITE_SAME_IDENTIFIER // A queued frame with the same identifier is overwritten, otherwise drop newest
+  } DriverFIFOOverflowPolicy ;
+
+//··································································································
+// Hardware Rx FIFO operation mode, when it is full (RXF0C.F0OM / RXF1C.F1OM, pages 1155, 1159).
+// Overwrite mode is for streams where the newest frames matter more than completeness; combine
+// it with DROP_OLDEST driver receive FIFO overflow policy. In overwrite mode, received frames are
+// copied by CPU (not by DMA): an element is copied and released before it is handled, as the
+// controller can overwrite it.
+
+  public: typedef enum : uint8_t {
+    RX_FIFO_BLOCKING, // The received frame is lost, counted by hardwareRxFIFOxLostCount
+    RX_FIFO_OVERWRITE // The oldest frame is overwritten, counted by hardwareRxFIFOxLostCount
+  } HardwareRxFIFOMode ;
+
+//··································································································
+
+  public: typedef enum : uint8_t {
+    EINT0, // Interrupt line 0
+    EINT1  // Interrupt line 1
+  } InterruptLine ;
+
 //··································································································
 
   public: typedef enum : uint8_t {
@@ -57,6 +92,12 @@ class ACANFD_FeatherM4CAN_Settings {
     return (wordCountForPayload (inPayload) - 2) * 4 ;
   }
 
+//··································································································
+//    CAN root clock (GCLK1, page 1119)
+//··································································································
+
+  public: static const uint32_t CAN_ROOT_CLOCK_FREQUENCY = 48 * 1000 * 1000 ;
+
 //··································································································
 //    Constructor for a given baud rate
 //··································································································
@@ -95,17 +136,35 @@ class ACANFD_FeatherM4CAN_Settings {
 //--- Module Mode
   public : ModuleMode mModuleMode = NORMAL_FD ;
 
+//--- Classic CAN 2.0B only: CANFD operation is disabled (CCCR.FDOE = 0), and driver FIFOs store
+//    CANMessage (16 bytes) instead of CANFDMessage (72 bytes). Use tryToSend and receive0 / receive1.
+//    PAYLOAD_8_BYTES is then sufficient for hardware Rx FIFOs and Tx buffers.
+  public: bool mClassicCAN20BOnly = false ;
+
 //--- Driver receive FIFO Sizes
   public: uint16_t mDriverReceiveFIFO0Size = 10 ;
   public: uint16_t mDriverReceiveFIFO1Size = 0 ;
 
+//--- Driver receive FIFO overflow policies
+  public: DriverFIFOOverflowPolicy mDriverReceiveFIFO0OverflowPolicy = DROP_NEWEST ;
+  public: DriverFIFOOverflowPolicy mDriverReceiveFIFO1OverflowPolicy = DROP_NEWEST ;
+
+//--- Driver receive FIFO high water marks: the call back is called (from interrupt service routine)
+//    when the FIFO count reaches the mark; 0 disables it
+  public: uint16_t mDriverReceiveFIFO0HighWaterMark = 0 ;
+  public: uint16_t mDriverReceiveFIFO1HighWaterMark = 0 ;
+  public: void (*mDriverReceiveFIFO0HighWaterCallBack) (void) = nullptr ;
+  public: void (*mDriverReceiveFIFO1HighWaterCallBack) (void) = nullptr ;
+
 //--- Hardware Rx FIFO 0
   public: uint8_t mHardwareRxFIFO0Size = 64 ; // 0 ... 64
   public: Payload mHardwareRxFIFO0Payload = PAYLOAD_64_BYTES ;
+  public: HardwareRxFIFOMode mHardwareRxFIFO0Mode = RX_FIFO_BLOCKING ;
 
 //--- Hardware Rx FIFO 1
   public: uint8_t mHardwareRxFIFO1Size = 0 ; // 0 ... 64
   public: Payload mHardwareRxFIFO1Payload = PAYLOAD_64_BYTES ;
+  public: HardwareRxFIFOMode mHardwareRxFIFO1Mode = RX_FIFO_BLOCKING ;
 
 //--- Remote frame reception
   public: bool mDiscardReceivedStandardRemoteFrames = false ;
@@ -120,6 +179,11 @@ class ACANFD_FeatherM4CAN_Settings {
 //--- Driver transmit buffer Size
   public: uint16_t mDriverTransmitFIFOSize = 20 ;
 
+//--- Driver transmit buffer overflow policy and high water mark (0 disables it)
+  public: DriverFIFOOverflowPolicy mDriverTransmitFIFOOverflowPolicy = DROP_NEWEST ;
+  public: uint16_t mDriverTransmitFIFOHighWaterMark = 0 ;
+  public: void (*mDriverTransmitFIFOHighWaterCallBack) (void) = nullptr ;
+
 //--- Hardware Transmit Buffers
 //    Required: mHardwareTransmitTxFIFOSize + mHardwareDedicacedTxBufferCount <= 32
   public: uint8_t mHardwareTransmitTxFIFOSize = 24 ; // 2 ... 32
@@ -129,8 +193,35 @@ class ACANFD_FeatherM4CAN_Settings {
 //--- Automatic retransmission
   public: bool mEnableRetransmission = true ;
 
-//--- Transceiver Delay Compensation
+//--- Transceiver Delay Compensation (TDCR register, page 1134): offset (TDCO) and filter window
+//    length (TDCF), in CAN clock periods; dominant edges that would give a secondary sample point
+//    earlier than the filter window length are ignored by delay measurement (0: disabled)
   public: uint8_t mTransceiverDelayCompensation = 5 ; // 0 ... 127
+  public: uint8_t mTransceiverDelayCompensationFilter = 0 ; // 0 ... 127
+
+//--- Bus off recovery
+//    With BUS_OFF_RECOVERY_WITH_BACKOFF, pollBusOffRecovery should be called from loop
+  public: BusOffRecoveryPolicy mBusOffRecoveryPolicy = BUS_OFF_RECOVERY_MANUAL ;
+  public: uint32_t mBusOffRecoveryInitialDelay = 10 ; // In ms
+  public: uint32_t mBusOffRecoveryMaximumDelay = 1000 ; // In ms
+
+//--- Interrupts: each interrupt group is routed to EINT0 or EINT1 (ILS register). Both lines of a
+//    CAN module raise its only NVIC interrupt (CAN0_IRQn or CAN1_IRQn), at mInterruptPriority.
+//    If mInterruptLine1IRQ is an unused peripheral interrupt (for example AC_IRQn), EINT1 groups are
+//    serviced by its handler at mInterruptLine1Priority, that should be lower (a greater value):
+//    the handler should call line1InterruptServiceRoutine. Otherwise, both lines are serviced by
+//    the CAN interrupt service routine. NVIC priorities are 0 (highest) ... 7 (lowest).
+  public: static const int16_t NO_INTERRUPT_LINE_1_IRQ = -1 ;
+  public: InterruptLine mReceptionInterruptLine = EINT0 ; // Rx FIFO 0 / 1 new message, message lost
+  public: InterruptLine mTransmissionInterruptLine = EINT0 ; // Transmission completed
+  public: InterruptLine mErrorInterruptLine = EINT0 ; // Bus off, error passive, warning, protocol errors
+  public: uint8_t mInterruptPriority = 0 ;
+  public: int16_t mInterruptLine1IRQ = NO_INTERRUPT_LINE_1_IRQ ;
+  public: uint8_t mInterruptLine1Priority = 7 ;
+
+//--- Bus load statistics (sliding window of ACANFD_FeatherM4CAN_BusStatistics::SLOT_COUNT slots)
+  public: bool mEnableBusStatistics = false ;
+  public: uint32_t mBusStatisticsSlotDuration = 125 * 1000 ; // In µs, 1000 ... 10,000,000
 
 //··································································································
 // Accessors
@@ -140,6 +231,10 @@ class ACANFD_FeatherM4CAN_Settings {
   public: uint32_t actualArbitrationBitRate (void) const ;
   public: uint32_t actualDataBitRate (void) const ;
 
+//--- Bit durations, in CAN root clock periods
+  public: uint32_t arbitrationBitDuration (void) const ;
+  public: uint32_t dataBitDuration (void) const ;
+
 //--- Exact bitrate ?
   public: bool exactArbitrationBitRate (void) const ;
   public: bool exactDataBitRate (void) const ;
@@ -0,0 +1,281 @@
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Signals packed in CANFDMessage payloads, described as in DBC files: start bit, length, byte
+// order, signedness, factor and offset (physical value = raw value * factor + offset), and
+// multiplexing. Layout is given by template arguments, so that every signal compiles into its own
+// extract / insert kernel: one or two 64-bit payload words are read (data64), shifted and masked
+// with constant values; Motorola signals byte swap the words they span (REV instructions).
+//
+// Bit numbering (as in DBC files):
+//   - INTEL (little endian): start bit is the signal LSB, bit i is bit (i % 8) of data [i / 8];
+//   - MOTOROLA (big endian): start bit is the signal MSB, with the same bit numbering (bit 7 is
+//     the MSB of data [0]); following bits are bit 6 ... bit 0, then bit 15 ... 8 ...
+//
+// A signal with a factor or an offset derives from ACANFD_FeatherM4CAN_Signal and defines them:
+//   class EngineSpeed : public ACANFD_FeatherM4CAN_Signal <24, 16, ACANFD_FeatherM4CAN_ByteOrder::INTEL> {
+//     public: static constexpr float factor (void) { return 0.25f ; }
+//   } ;
+//   const float rpm = ACANFD_FeatherM4CAN_SignalCodec::decode <EngineSpeed> (frame) ;
+//
+// All signals of a frame are decoded (or encoded) in one call by ACANFD_FeatherM4CAN_SignalFrame.
+//--------------------------------------------------------------------------------------------------
+
+enum class ACANFD_FeatherM4CAN_ByteOrder : uint8_t { INTEL, MOTOROLA } ;
+
+//--------------------------------------------------------------------------------------------------
+// Signal layout
+//--------------------------------------------------------------------------------------------------
+
+template <uint16_t START_BIT, uint8_t BIT_LENGTH, ACANFD_FeatherM4CAN_ByteOrder BYTE_ORDER, bool IS_SIGNED = false>
+class ACANFD_FeatherM4CAN_Signal {
+
+  //································································································
+  // Layout constants
+  //································································································
+
+  public: static const uint32_t LENGTH = BIT_LENGTH ;
+  public: static const bool SIGNED = IS_SIGNED ;
+
+//--- Position of the first bit in the payload bit stream: LSB for Intel (counted from data [0]
+//    LSB, bits of data64 [0] first), MSB for Motorola (counted from data [0] MSB)
+  private: static const uint32_t FIRST = (BYTE_ORDER == ACANFD_FeatherM4CAN_ByteOrder::INTEL)
+    ? START_BIT
+    : (START_BIT & ~ 7U) + 7 - (START_BIT & 7) ;
+  private: static const uint32_t WORD = FIRST / 64 ;
+  private: static const uint32_t SHIFT = FIRST % 64 ;
+  private: static const bool CROSSES_WORDS = (SHIFT + LENGTH) > 64 ;
+//--- When crossing words: bits in the first word, bits in the second word
+  private: static const uint32_t FIRST_BITS = 64 - SHIFT ;
+  private: static const uint32_t SECOND_BITS = CROSSES_WORDS ? (LENGTH - FIRST_BITS) : 1 ;
+  private: static const uint32_t NEXT_WORD = CROSSES_WORDS ? (WORD + 1) : WORD ;
+
+  public: static const uint64_t MASK = (LENGTH == 64) ? ~ uint64_t (0) : ((uint64_t (1) << (LENGTH % 64)) - 1) ;
+
+//--- Minimum frame length (in bytes) that contains the signal
+  public: static const uint32_t END_BYTE = (FIRST + LENGTH + 7) / 8 ;
+
+  static_assert ((LENGTH >= 1) && (LENGTH <= 64), "Signal length should be 1 ... 64") ;
+  static_assert ((FIRST + LENGTH) <= 512, "Signal should lie in a 64-byte payload") ;
+
+  //································································································
+  // Scaling, shadowed by derived signal classes
+  //································································································
+
+  public: static constexpr float factor (void) { return 1.0f ; }
+  public: static constexpr float offset (void) { return 0.0f ; }
+
+  //································································································
+  // Presence, shadowed by multiplexed signals
+  //································································································
+
+  public: static inline bool isPresent (const uint64_t * /* inWords */) { return true ; }
+
+  //································································································
+  // Raw value (inWords is CANFDMessage::data64)
+  //································································································
+
+  public: static inline uint64_t extract (const uint64_t * inWords) {
+    uint64_t result ;
+    if (BYTE_ORDER == ACANFD_FeatherM4CAN_ByteOrder::INTEL) {
+      result = inWords [WORD] >> SHIFT ;
+      if (CROSSES_WORDS) {
+        result |= inWords [NEXT_WORD] << (FIRST_BITS % 64) ;
+      }
+    }else if (!CROSSES_WORDS) {
+      result = __builtin_bswap64 (inWords [WORD]) >> ((64 - SHIFT - LENGTH) % 64) ;
+    }else{
+      const uint64_t firstMask = (uint64_t (1) << (FIRST_BITS % 64)) - 1 ;
+      result = (__builtin_bswap64 (inWords [WORD]) & firstMask) << SECOND_BITS ;
+      result |= __builtin_bswap64 (inWords [NEXT_WORD]) >> (64 - SECOND_BITS) ;
+    }
+    return result & MASK ;
+  }
+
+  //································································································
+
+  public: static inline int64_t rawValue (const uint64_t * inWords) {
+    const uint64_t v = extract (inWords) ;
+    const uint64_t signBit = uint64_t (1) << (LENGTH - 1) ;
+    return SIGNED ? int64_t ((v ^ signBit) - signBit) : int64_t (v) ;
+  }
+
+  //································································································
+
+  public: static inline void insert (uint64_t * ioWords, const uint64_t inRawValue) {
+    const uint64_t v = inRawValue & MASK ;
+    if (BYTE_ORDER == ACANFD_FeatherM4CAN_ByteOrder::INTEL) {
+      ioWords [WORD] = (ioWords [WORD] & ~ (MASK << SHIFT)) | (v << SHIFT) ;
+      if (CROSSES_WORDS) {
+        const uint64_t secondMask = (uint64_t (1) << SECOND_BITS) - 1 ;
+        ioWords [NEXT_WORD] = (ioWords [NEXT_WORD] & ~ secondMask) | (v >> (FIRST_BITS % 64)) ;
+      }
+    }else if (!CROSSES_WORDS) {
+      const uint32_t shift = (64 - SHIFT - LENGTH) % 64 ;
+      const uint64_t w = __builtin_bswap64 (ioWords [WORD]) ;
+      ioWords [WORD] = __builtin_bswap64 ((w & ~ (MASK << shift)) | (v << shift)) ;
+    }else{
+      const uint64_t firstMask = (uint64_t (1) << (FIRST_BITS % 64)) - 1 ;
+      const uint64_t w0 = __builtin_bswap64 (ioWords [WORD]) ;
+      ioWords [WORD] = __builtin_bswap64 ((w0 & ~ firstMask) | (v >> SECOND_BITS)) ;
+      const uint64_t w1 = __builtin_bswap64 (ioWords [NEXT_WORD]) ;
+      const uint64_t secondMask = ~ uint64_t (0) >> SECOND_BITS ;
+      ioWords [NEXT_WORD] = __builtin_bswap64 ((w1 & secondMask) | (v << (64 - SECOND_BITS))) ;
+    }
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// Multiplexed signal: present only if MULTIPLEXOR raw value is MULTIPLEXOR_VALUE. SIGNAL gives the
+// layout (and scaling, if the multiplexed signal does not define its own).
+//--------------------------------------------------------------------------------------------------
+
+template <typename MULTIPLEXOR, uint64_t MULTIPLEXOR_VALUE, typename SIGNAL>
+class ACANFD_FeatherM4CAN_MultiplexedSignal : public SIGNAL {
+  public: static const uint32_t END_BYTE = (SIGNAL::END_BYTE > MULTIPLEXOR::END_BYTE) ? SIGNAL::END_BYTE : MULTIPLEXOR::END_BYTE ;
+
+  public: static inline bool isPresent (const uint64_t * inWords) {
+    return MULTIPLEXOR::extract (inWords) == MULTIPLEXOR_VALUE ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// Physical values of a single signal
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_SignalCodec {
+
+  //································································································
+  // Raw value <-> physical value. Raw values of at most 32 bits are converted as 32-bit integers
+  // (single VCVT instruction). Encoding rounds to the nearest raw value, and saturates.
+  //································································································
+
+  public: template <typename SIGNAL> static inline float physical (const int64_t inRawValue) {
+    const bool fitsInt32 = (SIGNAL::LENGTH < 32) || (SIGNAL::SIGNED && (SIGNAL::LENGTH == 32)) ;
+    const float raw = fitsInt32 ? float (int32_t (inRawValue)) : float (inRawValue) ;
+    return raw * SIGNAL::factor () + SIGNAL::offset () ;
+  }
+
+  //································································································
+
+  public: template <typename SIGNAL> static inline uint64_t raw (const float inPhysicalValue) {
+    const int64_t minimum = SIGNAL::SIGNED ? - int64_t (SIGNAL::MASK >> 1) - 1 : 0 ;
+    const uint64_t maximum = SIGNAL::SIGNED ? (SIGNAL::MASK >> 1) : SIGNAL::MASK ;
+    const float x = (inPhysicalValue - SIGNAL::offset ()) * (1.0f / SIGNAL::factor ()) ;
+    uint64_t result ;
+    if (x >= float (maximum)) {
+      result = maximum ;
+    }else if (x <= float (minimum)) {
+      result = uint64_t (minimum) ;
+    }else{
+      const float rounded = (x >= 0.0f) ? (x + 0.5f) : (x - 0.5f) ;
+      const bool fitsInt32 = (SIGNAL::LENGTH < 32) || (SIGNAL::SIGNED && (SIGNAL::LENGTH == 32)) ;
+      result = fitsInt32 ? uint64_t (int64_t (int32_t (rounded))) : uint64_t (int64_t (rounded)) ;
+    }
+    return result ;
+  }
+
+  //································································································
+  // Single signal: decode ignores the frame length, encode does not change it
+  //································································································
+
+  public: template <typename SIGNAL> static inline float decode (const CANFDMessage & inFrame) {
+    return physical <SIGNAL> (SIGNAL::rawValue (inFrame.data64)) ;
+  }
+
+  public: template <typename SIGNAL> static inline void encode (CANFDMessage & ioFrame, const float inValue) {
+    SIGNAL::insert (ioFrame.data64, raw <SIGNAL> (inValue)) ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+// All signals of a frame. decode returns a bit mask of decoded signals (bit i for SIGNALS [i]): a
+// signal is not decoded if it does not lie in the frame length, or if it is a multiplexed signal
+// that is not selected. encode writes the signals that lie in the frame length, and multiplexed
+// signals that are selected by the multiplexor value already in the frame (list the multiplexor
+// before the signals it multiplexes). Values are indexed as SIGNALS.
+//--------------------------------------------------------------------------------------------------
+
+template <uint32_t INDEX, typename... SIGNALS> class ACANFD_FeatherM4CAN_SignalList ;
+
+//--------------------------------------------------------------------------------------------------
+
+template <uint32_t INDEX> class ACANFD_FeatherM4CAN_SignalList <INDEX> {
+  public: static inline uint64_t decode (const uint64_t *, const uint32_t, float *) { return 0 ; }
+  public: static inline void encode (uint64_t *, const uint32_t, const float *) {}
+  public: static inline uint64_t decodeRaw (const uint64_t *, const uint32_t, int64_t *) { return 0 ; }
+  public: static inline void encodeRaw (uint64_t *, const uint32_t, const int64_t *) {}
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+template <uint32_t INDEX, typename SIGNAL, typename... OTHERS>
+class ACANFD_FeatherM4CAN_SignalList <INDEX, SIGNAL, OTHERS...> {
+  private: typedef ACANFD_FeatherM4CAN_SignalList <INDEX + 1, OTHERS...> Next ;
+
+  public: static inline uint64_t decode (const uint64_t * inWords, const uint32_t inLength, float * outValues) {
+    uint64_t decoded = 0 ;
+    if ((SIGNAL::END_BYTE <= inLength) && SIGNAL::isPresent (inWords)) {
+      outValues [INDEX] = ACANFD_FeatherM4CAN_SignalCodec::physical <SIGNAL> (SIGNAL::rawValue (inWords)) ;
+      decoded = uint64_t (1) << INDEX ;
+    }
+    return decoded | Next::decode (inWords, inLength, outValues) ;
+  }
+
+  public: static inline void encode (uint64_t * ioWords, const uint32_t inLength, const float * inValues) {
+    if ((SIGNAL::END_BYTE <= inLength) && SIGNAL::isPresent (ioWords)) {
+      SIGNAL::insert (ioWords, ACANFD_FeatherM4CAN_SignalCodec::raw <SIGNAL> (inValues [INDEX])) ;
+    }
+    Next::encode (ioWords, inLength, inValues) ;
+  }
+
+  public: static inline uint64_t decodeRaw (const uint64_t * inWords, const uint32_t inLength, int64_t * outValues) {
+    uint64_t decoded = 0 ;
+    if ((SIGNAL::END_BYTE <= inLength) && SIGNAL::isPresent (inWords)) {
+      outValues [INDEX] = SIGNAL::rawValue (inWords) ;
+      decoded = uint64_t (1) << INDEX ;
+    }
+    return decoded | Next::decodeRaw (inWords, inLength, outValues) ;
+  }
+
+  public: static inline void encodeRaw (uint64_t * ioWords, const uint32_t inLength, const int64_t * inValues) {
+    if ((SIGNAL::END_BYTE <= inLength) && SIGNAL::isPresent (ioWords)) {
+      SIGNAL::insert (ioWords, uint64_t (inValues [INDEX])) ;
+    }
+    Next::encodeRaw (ioWords, inLength, inValues) ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename... SIGNALS> class ACANFD_FeatherM4CAN_SignalFrame {
+  public: static const uint32_t SIGNAL_COUNT = sizeof... (SIGNALS) ;
+
+  static_assert (SIGNAL_COUNT <= 64, "A signal frame has at most 64 signals") ;
+
+  private: typedef ACANFD_FeatherM4CAN_SignalList <0, SIGNALS...> List ;
+
+  public: static inline uint64_t decode (const CANFDMessage & inFrame, float outValues [SIGNAL_COUNT]) {
+    return List::decode (inFrame.data64, inFrame.len, outValues) ;
+  }
+
+  public: static inline void encode (CANFDMessage & ioFrame, const float inValues [SIGNAL_COUNT]) {
+    List::encode (ioFrame.data64, ioFrame.len, inValues) ;
+  }
+
+  public: static inline uint64_t decodeRaw (const CANFDMessage & inFrame, int64_t outValues [SIGNAL_COUNT]) {
+    return List::decodeRaw (inFrame.data64, inFrame.len, outValues) ;
+  }
+
+  public: static inline void encodeRaw (CANFDMessage & ioFrame, const int64_t inValues [SIGNAL_COUNT]) {
+    List::encodeRaw (ioFrame.data64, ioFrame.len, inValues) ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
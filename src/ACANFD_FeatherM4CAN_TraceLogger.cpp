@@ -0,0 +1,258 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_TraceLogger.h>
+#include <ACANFD_FeatherM4CAN_Codec.h>
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t validBufferSize (const uint32_t inBufferSize) {
+  const uint32_t minimumSize = ACANFD_FeatherM4CAN_TraceLogger::MAX_RECORD_SIZE
+                             + ACANFD_FeatherM4CAN_TraceLogger::MAX_LOST_FRAMES_RECORD_SIZE ;
+  return (inBufferSize < minimumSize) ? minimumSize : inBufferSize ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TraceLogger::ACANFD_FeatherM4CAN_TraceLogger (const uint32_t inBufferSize) :
+mBuffers (),
+mSink (nullptr),
+mBufferSize (validBufferSize (inBufferSize)),
+mActiveBufferLength (0),
+mPendingBufferLength (0),
+mLastRecordDate (0),
+mRecordedFrameCount (0),
+mLostFrameCount (0),
+mUnreportedLostFrameCount (0),
+mActiveBufferIndex (0) {
+  mBuffers [0] = new uint8_t [mBufferSize] ;
+  mBuffers [1] = new uint8_t [mBufferSize] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TraceLogger::~ ACANFD_FeatherM4CAN_TraceLogger (void) {
+  delete [] mBuffers [0] ;
+  delete [] mBuffers [1] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Begin
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceLogger::begin (Print & inSink) {
+  noInterrupts () ;
+    mSink = nullptr ; // Flush does nothing while stream header is written
+    mActiveBufferIndex = 0 ;
+    mActiveBufferLength = 0 ;
+    mPendingBufferLength = 0 ;
+    mRecordedFrameCount = 0 ;
+    mLostFrameCount = 0 ;
+    mUnreportedLostFrameCount = 0 ;
+    mLastRecordDate = micros () ;
+  interrupts () ;
+  const uint8_t header [5] = { 'A', 'C', 'T', 'R', VERSION } ;
+  inSink.write (header, 5) ;
+  mSink = & inSink ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Encoding (interrupts are disabled)
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceLogger::writeVarint (uint32_t inValue) {
+  uint8_t * ptr = mBuffers [mActiveBufferIndex] + mActiveBufferLength ;
+  while (inValue >= 0x80) {
+    *ptr = uint8_t (inValue) | 0x80 ;
+    ptr += 1 ;
+    inValue >>= 7 ;
+  }
+  *ptr = uint8_t (inValue) ;
+  mActiveBufferLength = uint32_t (ptr + 1 - mBuffers [mActiveBufferIndex]) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceLogger::writeRecordHeader (const uint8_t inFlags, const uint32_t inValue) {
+  mBuffers [mActiveBufferIndex] [mActiveBufferLength] = inFlags ;
+  mActiveBufferLength += 1 ;
+  const uint32_t now = micros () ;
+  writeVarint (now - mLastRecordDate) ;
+  mLastRecordDate = now ;
+  writeVarint (inValue) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Makes room for a frame record: if the active buffer cannot hold a frame record, it is handed
+// to flush, if the other buffer is free; otherwise the frame is lost. Lost frames are reported
+// before the next recorded frame.
+
+bool ACANFD_FeatherM4CAN_TraceLogger::reserve (void) {
+  bool ok = (mActiveBufferLength + MAX_RECORD_SIZE + MAX_LOST_FRAMES_RECORD_SIZE) <= mBufferSize ;
+  if (!ok && (mPendingBufferLength == 0)) {
+    mPendingBufferLength = mActiveBufferLength ;
+    mActiveBufferIndex ^= 1 ;
+    mActiveBufferLength = 0 ;
+    ok = true ;
+  }
+  if (!ok) {
+    mLostFrameCount += 1 ;
+    mUnreportedLostFrameCount += 1 ;
+  }else if (mUnreportedLostFrameCount > 0) {
+    writeRecordHeader (LOST_FRAMES_RECORD, mUnreportedLostFrameCount) ;
+    mUnreportedLostFrameCount = 0 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Recording
+//--------------------------------------------------------------------------------------------------
+// The caller may have disabled interrupts (preemptible line 1 interrupt service routine): PRIMASK
+// is restored, not cleared.
+
+bool ACANFD_FeatherM4CAN_TraceLogger::record (const CANFDMessage & inMessage, const uint8_t inController) {
+  const uint32_t length = (inMessage.len <= 64) ? inMessage.len : 64 ;
+  uint8_t flags = inMessage.ext ? FLAG_EXTENDED : 0 ;
+  if (inController != 0) {
+    flags |= FLAG_CAN1 ;
+  }
+  uint32_t dataLength = length ;
+  switch (inMessage.type) {
+  case CANFDMessage::CAN_REMOTE :
+    flags |= FLAG_BRS_RTR | uint8_t ((length <= 8) ? length : 8) ;
+    dataLength = 0 ;
+    break ;
+  case CANFDMessage::CAN_DATA :
+    dataLength = (length <= 8) ? length : 8 ;
+    flags |= uint8_t (dataLength) ;
+    break ;
+  case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH :
+    flags |= FLAG_CANFD | ACANFD_FeatherM4CAN_Codec::DLC_FROM_LENGTH [length] ;
+    dataLength = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [flags & 0xF] ;
+    break ;
+  case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH :
+    flags |= FLAG_CANFD | FLAG_BRS_RTR | ACANFD_FeatherM4CAN_Codec::DLC_FROM_LENGTH [length] ;
+    dataLength = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [flags & 0xF] ;
+    break ;
+  }
+  const uint32_t primask = __get_PRIMASK () ;
+  __disable_irq () ;
+    const bool ok = reserve () ;
+    if (ok) {
+      writeRecordHeader (flags, inMessage.id) ;
+      uint8_t * ptr = mBuffers [mActiveBufferIndex] + mActiveBufferLength ;
+      memcpy (ptr, inMessage.data, length) ;
+      for (uint32_t i=length ; i<dataLength ; i++) { // Invalid CANFD length
+        ptr [i] = 0 ;
+      }
+      mActiveBufferLength += dataLength ;
+      mRecordedFrameCount += 1 ;
+    }
+  __set_PRIMASK (primask) ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_TraceLogger::recordRxElement (const uint32_t * inElement,
+                                                       const uint32_t inDataWordCount,
+                                                       const uint8_t inController) {
+  const uint32_t w0 = inElement [0] ;
+  const uint32_t w1 = inElement [1] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  uint8_t flags = extended ? FLAG_EXTENDED : 0 ;
+  if (inController != 0) {
+    flags |= FLAG_CAN1 ;
+  }
+  uint32_t dlc = (w1 >> 16) & 0xF ;
+  uint32_t dataLength = 0 ;
+  if ((w1 & (1U << 21)) != 0) { // FDF: CANFD frame
+    flags |= FLAG_CANFD ;
+    if ((w1 & (1U << 20)) != 0) { // BRS
+      flags |= FLAG_BRS_RTR ;
+    }
+    dataLength = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [dlc] ;
+  }else{ // CAN 2.0B frame: DLC 9 ... 15 means 8 bytes
+    if (dlc > 8) {
+      dlc = 8 ;
+    }
+    if ((w0 & (1U << 29)) != 0) { // RTR
+      flags |= FLAG_BRS_RTR ;
+    }else{
+      dataLength = dlc ;
+    }
+  }
+  flags |= uint8_t (dlc) ;
+  const uint32_t storedLength = (dataLength <= (4 * inDataWordCount)) ? dataLength : (4 * inDataWordCount) ;
+  const uint32_t primask = __get_PRIMASK () ;
+  __disable_irq () ;
+    const bool ok = reserve () ;
+    if (ok) {
+      writeRecordHeader (flags, extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF)) ;
+      uint8_t * ptr = mBuffers [mActiveBufferIndex] + mActiveBufferLength ;
+      memcpy (ptr, inElement + 2, storedLength) ;
+      for (uint32_t i=storedLength ; i<dataLength ; i++) { // Bytes that do not fit in element
+        ptr [i] = 0xCC ;
+      }
+      mActiveBufferLength += dataLength ;
+      mRecordedFrameCount += 1 ;
+    }
+  __set_PRIMASK (primask) ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Flush
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceLogger::flush (const bool inForce) {
+  if (mSink != nullptr) {
+    writePendingBuffer () ;
+    if (inForce) {
+    //--- Frames lost since the last record are reported now; if the record does not fit, the
+    //    active buffer is handed over first
+      noInterrupts () ;
+        if ((mUnreportedLostFrameCount > 0) && ((mActiveBufferLength + MAX_LOST_FRAMES_RECORD_SIZE) > mBufferSize)) {
+          handOverActiveBuffer () ;
+        }
+        if ((mUnreportedLostFrameCount > 0) && ((mActiveBufferLength + MAX_LOST_FRAMES_RECORD_SIZE) <= mBufferSize)) {
+          writeRecordHeader (LOST_FRAMES_RECORD, mUnreportedLostFrameCount) ;
+          mUnreportedLostFrameCount = 0 ;
+        }
+      interrupts () ;
+      writePendingBuffer () ;
+      noInterrupts () ;
+        handOverActiveBuffer () ;
+      interrupts () ;
+      writePendingBuffer () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Interrupts are disabled
+
+void ACANFD_FeatherM4CAN_TraceLogger::handOverActiveBuffer (void) {
+  if ((mPendingBufferLength == 0) && (mActiveBufferLength > 0)) {
+    mPendingBufferLength = mActiveBufferLength ;
+    mActiveBufferIndex ^= 1 ;
+    mActiveBufferLength = 0 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// The pending buffer is not the active one, and is not written by recording
+
+void ACANFD_FeatherM4CAN_TraceLogger::writePendingBuffer (void) {
+  const uint32_t length = mPendingBufferLength ;
+  if (length > 0) {
+    mSink->write (mBuffers [mActiveBufferIndex ^ 1], length) ;
+    mPendingBufferLength = 0 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Binary trace of received frames. Records are appended to the active buffer, from interrupt
+// service routine; a full buffer is handed to flush (called from loop), that writes it to the
+// sink (any Print: Serial, SD file, ...), while the other buffer is filled.
+// A single logger can be set to both controllers (can0.setTraceLogger, can1.setTraceLogger).
+//
+// Stream format (decoded by extras/ACANFD_TraceDecoder):
+//   Stream header: 'A', 'C', 'T', 'R', version (1)
+//   Frame record:
+//     Flags byte: bits 0-3: DLC, bit 4: extended, bit 5: CANFD frame,
+//                 bit 6: BRS (CANFD frame) or RTR (CAN 2.0B frame), bit 7: controller (can0: 0, can1: 1)
+//     Varint: µs elapsed since previous record (since begin for the first one)
+//     Varint: identifier
+//     Data bytes (none for a remote frame)
+//   Lost frames record (flags byte cannot be a frame flags byte, as a CAN 2.0B frame has a DLC <= 8):
+//     Flags byte: LOST_FRAMES_RECORD
+//     Varint: µs elapsed since previous record
+//     Varint: lost frame count (frames that did not fit in buffers)
+//   Varint: 7 bits per byte, least significant group first, bit 7 set if more bytes follow.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_TraceLogger {
+
+  //································································································
+  // Constants
+  //································································································
+
+  public: static const uint8_t VERSION = 1 ;
+  public: static const uint8_t LOST_FRAMES_RECORD = 0x4F ; // RTR, CAN 2.0B, DLC 15
+
+//--- Frame record flags byte, bits 0-3 are DLC
+  public: static const uint8_t FLAG_EXTENDED = 1 << 4 ;
+  public: static const uint8_t FLAG_CANFD    = 1 << 5 ;
+  public: static const uint8_t FLAG_BRS_RTR  = 1 << 6 ;
+  public: static const uint8_t FLAG_CAN1     = 1 << 7 ;
+
+  public: static const uint32_t MAX_RECORD_SIZE = 1 + 5 + 5 + 64 ;
+  public: static const uint32_t MAX_LOST_FRAMES_RECORD_SIZE = 1 + 5 + 5 ;
+
+  //································································································
+  // Constructor: inBufferSize is the size of each buffer (at least MAX_RECORD_SIZE +
+  // MAX_LOST_FRAMES_RECORD_SIZE)
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_TraceLogger (const uint32_t inBufferSize) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_TraceLogger (void) ;
+
+  //································································································
+  // Begin: writes the stream header, resets buffers and counters
+  //································································································
+
+  public: void begin (Print & inSink) ;
+
+  //································································································
+  // Recording, returns false if the frame is lost (interrupt service routine or loop)
+  //································································································
+
+  public: bool record (const CANFDMessage & inMessage, const uint8_t inController) ;
+
+//--- From Rx FIFO element (page 1177 of DS60001507G), without decoding into a CANFDMessage
+  public: bool recordRxElement (const uint32_t * inElement,
+                                const uint32_t inDataWordCount,
+                                const uint8_t inController) ;
+
+  //································································································
+  // Flush: writes full buffer to sink; if inForce is true, the active buffer is also written,
+  // with a lost frames record for frames lost since the last record (should be called from loop)
+  //································································································
+
+  public: void flush (const bool inForce = false) ;
+
+  //································································································
+  // Counters
+  //································································································
+
+  public: inline uint32_t recordedFrameCount (void) const { return mRecordedFrameCount ; }
+  public: inline uint32_t lostFrameCount (void) const { return mLostFrameCount ; }
+
+  //································································································
+  // Private methods
+  //································································································
+
+  private: bool reserve (void) ;
+  private: void writeVarint (uint32_t inValue) ;
+  private: void writeRecordHeader (const uint8_t inFlags, const uint32_t inValue) ;
+  private: void handOverActiveBuffer (void) ;
+  private: void writePendingBuffer (void) ;
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: uint8_t * mBuffers [2] ;
+  private: Print * mSink ;
+  private: const uint32_t mBufferSize ;
+  private: uint32_t mActiveBufferLength ;
+  private: volatile uint32_t mPendingBufferLength ; // Other buffer, 0 if it is free
+  private: uint32_t mLastRecordDate ; // In µs
+  private: volatile uint32_t mRecordedFrameCount ;
+  private: volatile uint32_t mLostFrameCount ;
+  private: uint32_t mUnreportedLostFrameCount ;
+  private: volatile uint8_t mActiveBufferIndex ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_TraceLogger (const ACANFD_FeatherM4CAN_TraceLogger &) = delete ;
+  private: ACANFD_FeatherM4CAN_TraceLogger & operator = (const ACANFD_FeatherM4CAN_TraceLogger &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,532 @@
+//--------------------------------------------------------------------------------------------------
+// TC registers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_TraceReplay.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t STREAM_HEADER [5] = { 'A', 'C', 'T', 'R', ACANFD_FeatherM4CAN_TraceLogger::VERSION } ;
+
+//--------------------------------------------------------------------------------------------------
+// Timer: frame transmission is requested by spinning when frame date is closer than SPIN_TICKS
+// (compare interrupt is set SPIN_TICKS before); a pending dedicated Tx buffer is polled again
+// after RETRY_TICKS
+
+static const uint32_t SPIN_TICKS = 2 * ACANFD_FeatherM4CAN_TraceReplay::TIMER_TICKS_PER_MICROSECOND ;
+static const uint32_t RETRY_TICKS = 10 * ACANFD_FeatherM4CAN_TraceReplay::TIMER_TICKS_PER_MICROSECOND ;
+static const uint64_t MAX_GAP_TICKS = 40ULL * 1000 * 1000 * ACANFD_FeatherM4CAN_TraceReplay::TIMER_TICKS_PER_MICROSECOND ;
+
+//--------------------------------------------------------------------------------------------------
+
+static Tc * timerModule (const ACANFD_FeatherM4CAN_TraceReplay::Timer inTimer) {
+  switch (inTimer) {
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC0_TC1 : return TC0 ;
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC2_TC3 : return TC2 ;
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC4_TC5 : return TC4 ;
+  }
+  return TC2 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static IRQn_Type timerInterruptNumber (const ACANFD_FeatherM4CAN_TraceReplay::Timer inTimer) {
+  switch (inTimer) {
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC0_TC1 : return TC0_IRQn ;
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC2_TC3 : return TC2_IRQn ;
+  case ACANFD_FeatherM4CAN_TraceReplay::Timer::TC4_TC5 : return TC4_IRQn ;
+  }
+  return TC2_IRQn ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TraceReplay::ACANFD_FeatherM4CAN_TraceReplay (ACANFD_FeatherM4CAN & inCAN,
+                                                                  const uint32_t inQueueSize,
+                                                                  const Timer inTimer) :
+mCAN (inCAN),
+mSettings (),
+mTrace (nullptr),
+mTraceLength (0),
+mTraceIndex (0),
+mStream (nullptr),
+mRecord (),
+mRecordLength (0),
+mHeaderLength (0),
+mSourceEnded (false),
+mRecordedDate (0),
+mScheduleOffset (0),
+mLastScaledDate (0),
+mStartDate (0),
+mFirstFrame (true),
+mQueue (nullptr),
+mQueueSize ((inQueueSize > 0) ? inQueueSize : 1),
+mQueueReadIndex (0),
+mQueueWriteIndex (0),
+mQueueCount (0),
+mPreparedFrame (),
+mNextTxBuffer (0),
+mPrepared (false),
+mDeviations (nullptr),
+mDeviationReadIndex (0),
+mDeviationCount (0),
+mLostDeviationCount (0),
+mDeviationSum (0),
+mMinimumDeviation (0),
+mMaximumDeviation (0),
+mReplayedFrameCount (0),
+mLateFrameCount (0),
+mFilteredFrameCount (0),
+mRecordedLostFrameCount (0),
+mTimer (inTimer),
+mState (IDLE) {
+  mQueue = new ScheduledFrame [mQueueSize] ;
+  mDeviations = new FrameDeviation [mQueueSize] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TraceReplay::~ ACANFD_FeatherM4CAN_TraceReplay (void) {
+  stop () ;
+  delete [] mQueue ;
+  delete [] mDeviations ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Timer (TC 32-bit counter mode, free running)
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::configureTimer (void) {
+  uint32_t gclkId = TC2_GCLK_ID ;
+  switch (mTimer) {
+  case Timer::TC0_TC1 :
+    MCLK->APBAMASK.reg |= MCLK_APBAMASK_TC0 | MCLK_APBAMASK_TC1 ;
+    gclkId = TC0_GCLK_ID ;
+    break ;
+  case Timer::TC2_TC3 :
+    MCLK->APBBMASK.reg |= MCLK_APBBMASK_TC2 | MCLK_APBBMASK_TC3 ;
+    gclkId = TC2_GCLK_ID ;
+    break ;
+  case Timer::TC4_TC5 :
+    MCLK->APBCMASK.reg |= MCLK_APBCMASK_TC4 | MCLK_APBCMASK_TC5 ;
+    gclkId = TC4_GCLK_ID ;
+    break ;
+  }
+  GCLK->PCHCTRL [gclkId].reg = GCLK_PCHCTRL_CHEN | GCLK_PCHCTRL_GEN_GCLK1 ; // 48 MHz
+  Tc * tc = timerModule (mTimer) ;
+  tc->COUNT32.CTRLA.reg = TC_CTRLA_SWRST ;
+  while ((tc->COUNT32.SYNCBUSY.reg & TC_SYNCBUSY_SWRST) != 0) {}
+  tc->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_PRESCALER_DIV1 ;
+  tc->COUNT32.WAVE.reg = TC_WAVE_WAVEGEN_NFRQ ; // Free running, no top value
+  tc->COUNT32.INTENCLR.reg = TC_INTENCLR_MASK ;
+  tc->COUNT32.INTFLAG.reg = TC_INTFLAG_MASK ;
+  tc->COUNT32.INTENSET.reg = TC_INTENSET_MC0 ;
+  NVIC_ClearPendingIRQ (timerInterruptNumber (mTimer)) ;
+  NVIC_EnableIRQ (timerInterruptNumber (mTimer)) ;
+  tc->COUNT32.CTRLA.reg |= TC_CTRLA_ENABLE ;
+  while ((tc->COUNT32.SYNCBUSY.reg & TC_SYNCBUSY_ENABLE) != 0) {}
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_TraceReplay::timerDate (void) const {
+  Tc * tc = timerModule (mTimer) ;
+  tc->COUNT32.CTRLBSET.reg = TC_CTRLBSET_CMD_READSYNC ;
+  while ((tc->COUNT32.SYNCBUSY.reg & (TC_SYNCBUSY_CTRLB | TC_SYNCBUSY_COUNT)) != 0) {}
+  return tc->COUNT32.COUNT.reg ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::setTimerCompare (const uint32_t inDate) {
+  Tc * tc = timerModule (mTimer) ;
+  tc->COUNT32.CC [0].reg = inDate ;
+  while ((tc->COUNT32.SYNCBUSY.reg & TC_SYNCBUSY_CC0) != 0) {}
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Begin, stop
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_TraceReplay::begin (const Settings & inSettings,
+                                                 const uint8_t * inTrace,
+                                                 const uint32_t inLength) {
+  stop () ;
+  mTrace = inTrace ;
+  mTraceLength = inLength ;
+  mStream = nullptr ;
+  return start (inSettings) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_TraceReplay::begin (const Settings & inSettings, Stream & inSource) {
+  stop () ;
+  mTrace = nullptr ;
+  mTraceLength = 0 ;
+  mStream = & inSource ;
+  return start (inSettings) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACANFD_FeatherM4CAN_TraceReplay::start (const Settings & inSettings) {
+  uint32_t errorCode = 0 ;
+  if ((inSettings.mSpeedPercent == 0) || (inSettings.mSpeedPercent > 10000)) {
+    errorCode |= kInvalidSpeed ;
+  }
+  if (inSettings.mTxBufferCount == 0) {
+    errorCode |= kInvalidTxBufferCount ;
+  }
+  const uint32_t lastTxBuffer = uint32_t (inSettings.mFirstTxBuffer) + inSettings.mTxBufferCount - 1 ;
+  if ((inSettings.mFirstTxBuffer == 0) || !mCAN.sendBufferNotFullForIndex (lastTxBuffer)) {
+    errorCode |= kTxBufferIndexTooLarge ; // Also if a dedicated Tx buffer is pending
+  }
+  if (errorCode == 0) {
+    mSettings = inSettings ;
+    mTraceIndex = 0 ;
+    mRecordLength = 0 ;
+    mHeaderLength = 0 ;
+    mSourceEnded = false ;
+    mRecordedDate = 0 ;
+    mScheduleOffset = 0 ;
+    mLastScaledDate = 0 ;
+    mFirstFrame = true ;
+    mQueueReadIndex = 0 ;
+    mQueueWriteIndex = 0 ;
+    mQueueCount = 0 ;
+    mNextTxBuffer = 0 ;
+    mPrepared = false ;
+    mDeviationReadIndex = 0 ;
+    mDeviationCount = 0 ;
+    mLostDeviationCount = 0 ;
+    mDeviationSum = 0 ;
+    mMinimumDeviation = 0 ;
+    mMaximumDeviation = 0 ;
+    mReplayedFrameCount = 0 ;
+    mLateFrameCount = 0 ;
+    mFilteredFrameCount = 0 ;
+    mRecordedLostFrameCount = 0 ;
+    mState = RUNNING ;
+    configureTimer () ;
+  }
+  return errorCode ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::stop (void) {
+  disableTimer () ;
+  mPrepared = false ;
+  if (mState == RUNNING) {
+    mState = IDLE ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::disableTimer (void) {
+  NVIC_DisableIRQ (timerInterruptNumber (mTimer)) ;
+  Tc * tc = timerModule (mTimer) ;
+  tc->COUNT32.INTENCLR.reg = TC_INTENCLR_MASK ;
+  tc->COUNT32.CTRLA.reg &= ~ TC_CTRLA_ENABLE ;
+  while ((tc->COUNT32.SYNCBUSY.reg & TC_SYNCBUSY_ENABLE) != 0) {}
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Decoding
+//--------------------------------------------------------------------------------------------------
+// Returns false if the varint is incomplete
+
+static bool readVarint (const uint8_t * inBuffer,
+                        const uint32_t inLength,
+                        uint32_t & ioIndex,
+                        uint32_t & outValue) {
+  outValue = 0 ;
+  uint32_t shift = 0 ;
+  bool more = true ;
+  while (more && (ioIndex < inLength) && (shift < 35)) {
+    const uint8_t byte = inBuffer [ioIndex] ;
+    ioIndex += 1 ;
+    outValue |= uint32_t (byte & 0x7F) << shift ;
+    shift += 7 ;
+    more = (byte & 0x80) != 0 ;
+  }
+  return !more ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns the record length (0 if the record is incomplete, -1 if it is invalid)
+
+static int32_t parseRecord (const uint8_t * inBuffer,
+                            const uint32_t inLength,
+                            uint8_t & outFlags,
+                            uint32_t & outElapsedMicros,
+                            CANFDMessage & outFrame) {
+  int32_t result = 0 ;
+  uint32_t index = 1 ;
+  uint32_t value = 0 ;
+  if ((inLength > 0) && readVarint (inBuffer, inLength, index, outElapsedMicros) && readVarint (inBuffer, inLength, index, value)) {
+    const uint8_t flags = inBuffer [0] ;
+    outFlags = flags ;
+    const uint32_t dlc = flags & 0xF ;
+    uint32_t dataLength = 0 ;
+    if (flags == ACANFD_FeatherM4CAN_TraceLogger::LOST_FRAMES_RECORD) {
+      outFrame.len = 0 ;
+      outFrame.id = value ; // Lost frame count
+    }else if ((flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CANFD) != 0) {
+      outFrame.type = ((flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
+      dataLength = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [dlc] ;
+    }else if (dlc > 8) {
+      result = -1 ;
+    }else if ((flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_BRS_RTR) != 0) {
+      outFrame.type = CANFDMessage::CAN_REMOTE ;
+    }else{
+      outFrame.type = CANFDMessage::CAN_DATA ;
+      dataLength = dlc ;
+    }
+    if ((result == 0) && (flags != ACANFD_FeatherM4CAN_TraceLogger::LOST_FRAMES_RECORD)) {
+      outFrame.id = value ;
+      outFrame.ext = (flags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_EXTENDED) != 0 ;
+      outFrame.len = uint8_t ((outFrame.type == CANFDMessage::CAN_REMOTE) ? dlc : dataLength) ;
+      if (outFrame.id > (outFrame.ext ? 0x1FFFFFFFU : 0x7FFU)) {
+        result = -1 ;
+      }
+    }
+    if ((result == 0) && ((index + dataLength) <= inLength)) {
+      memcpy (outFrame.data, inBuffer + index, dataLength) ;
+      result = int32_t (index + dataLength) ;
+    }
+  }else if (index > ACANFD_FeatherM4CAN_TraceLogger::MAX_LOST_FRAMES_RECORD_SIZE) {
+    result = -1 ; // Varint too long
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns true if a record has been decoded
+
+bool ACANFD_FeatherM4CAN_TraceReplay::decodeNextRecord (void) {
+  bool decoded = false ;
+  uint8_t flags = 0 ;
+  uint32_t elapsedMicros = 0 ;
+  CANFDMessage frame ;
+  if (mStream != nullptr) { // Record is read in mRecord, until it is complete
+    while (!decoded && (mState == RUNNING) && !mSourceEnded) {
+      if (mStream->available () <= 0) {
+        mSourceEnded = true ;
+      }else if (mHeaderLength < sizeof (STREAM_HEADER)) {
+        if (mStream->read () == STREAM_HEADER [mHeaderLength]) {
+          mHeaderLength += 1 ;
+        }else{
+          mState = FORMAT_ERROR ;
+        }
+      }else{
+        mRecord [mRecordLength] = uint8_t (mStream->read ()) ;
+        mRecordLength += 1 ;
+        const int32_t length = parseRecord (mRecord, mRecordLength, flags, elapsedMicros, frame) ;
+        if ((length < 0) || ((length == 0) && (mRecordLength == sizeof (mRecord)))) {
+          mState = FORMAT_ERROR ;
+        }else if (length > 0) {
+          mRecordLength = 0 ;
+          decoded = true ;
+        }
+      }
+    }
+  }else if (mHeaderLength < sizeof (STREAM_HEADER)) {
+    if ((mTraceLength < sizeof (STREAM_HEADER)) || (memcmp (mTrace, STREAM_HEADER, sizeof (STREAM_HEADER)) != 0)) {
+      mState = FORMAT_ERROR ;
+    }else{
+      mHeaderLength = sizeof (STREAM_HEADER) ;
+      mTraceIndex = sizeof (STREAM_HEADER) ;
+    }
+  }
+  if ((mStream == nullptr) && (mState == RUNNING)) {
+    if (mTraceIndex >= mTraceLength) {
+      mSourceEnded = true ;
+    }else{
+      const int32_t length = parseRecord (mTrace + mTraceIndex, mTraceLength - mTraceIndex, flags, elapsedMicros, frame) ;
+      if (length <= 0) { // A truncated record is invalid
+        mState = FORMAT_ERROR ;
+      }else{
+        mTraceIndex += uint32_t (length) ;
+        decoded = true ;
+      }
+    }
+  }
+  if (decoded) {
+    handleRecord (flags, elapsedMicros, frame) ;
+  }
+  return decoded ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame date: recorded date scaled by speed, gaps longer than MAX_GAP_TICKS are shortened
+
+void ACANFD_FeatherM4CAN_TraceReplay::handleRecord (const uint8_t inFlags,
+                                                    const uint32_t inElapsedMicros,
+                                                    const CANFDMessage & inFrame) {
+  if (!mFirstFrame) { // Elapsed time of first record is from logger begin
+    mRecordedDate += inElapsedMicros ;
+  }
+  if (inFlags == ACANFD_FeatherM4CAN_TraceLogger::LOST_FRAMES_RECORD) {
+    mRecordedLostFrameCount += inFrame.id ;
+  }else{
+    const uint8_t controller = ((inFlags & ACANFD_FeatherM4CAN_TraceLogger::FLAG_CAN1) != 0) ? 1 : 0 ;
+    bool replay = (mSettings.mRecordedController == ALL_CONTROLLERS) || (mSettings.mRecordedController == controller) ;
+    if (replay && mCAN.isClassicCAN20BOnly ()) {
+      replay = (inFrame.type == CANFDMessage::CAN_DATA) || (inFrame.type == CANFDMessage::CAN_REMOTE) ;
+    }
+    if (replay && (mSettings.mFilter != nullptr)) {
+      replay = mSettings.mFilter (inFrame) ;
+    }
+    if (!replay) {
+      mFilteredFrameCount += 1 ;
+    }else{
+      if (mFirstFrame) {
+        mFirstFrame = false ;
+        mRecordedDate = 0 ;
+        mStartDate = timerDate () + mSettings.mStartDelay * TIMER_TICKS_PER_MICROSECOND ;
+      }
+      const uint64_t scaledDate = (mRecordedDate * TIMER_TICKS_PER_MICROSECOND * 100) / mSettings.mSpeedPercent ;
+      if ((scaledDate - mLastScaledDate) > MAX_GAP_TICKS) {
+        mScheduleOffset += scaledDate - mLastScaledDate - MAX_GAP_TICKS ;
+      }
+      mLastScaledDate = scaledDate ;
+      ScheduledFrame & entry = mQueue [mQueueWriteIndex] ;
+      mQueueWriteIndex = (mQueueWriteIndex + 1) % mQueueSize ;
+      entry.mFrame = inFrame ;
+      entry.mDate = mStartDate + uint32_t (scaledDate - mScheduleOffset) ;
+      entry.mScheduledDate = uint32_t (mRecordedDate) ;
+      noInterrupts () ;
+        mQueueCount += 1 ;
+      interrupts () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Poll
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::poll (void) {
+  bool appended = false ;
+  while ((mState == RUNNING) && (mQueueCount < mQueueSize) && decodeNextRecord ()) {
+    appended = true ;
+  }
+//--- Wake up timer interrupt service routine if no frame is prepared
+  if (appended && !mPrepared) {
+    NVIC_SetPendingIRQ (timerInterruptNumber (mTimer)) ;
+  }
+//--- End of replay
+  noInterrupts () ;
+    const bool done = (mState == RUNNING) && mSourceEnded && (mQueueCount == 0) && !mPrepared ;
+    if (done) {
+      mState = DONE ;
+    }
+  interrupts () ;
+  if (done || (mState == FORMAT_ERROR)) {
+    disableTimer () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Timer interrupt service routine
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::timerInterruptServiceRoutine (void) {
+  Tc * tc = timerModule (mTimer) ;
+  tc->COUNT32.INTFLAG.reg = TC_INTFLAG_MC0 ;
+  bool loop = mState == RUNNING ;
+  while (loop) {
+    loop = false ;
+    const uint8_t txBuffer = uint8_t (mSettings.mFirstTxBuffer + mNextTxBuffer) ;
+  //--- Prepared frame: request transmission at its date
+    if (mPrepared) {
+      const uint32_t date = mPreparedFrame.mDate ;
+      if (int32_t (date - timerDate ()) <= int32_t (SPIN_TICKS)) {
+        while (int32_t (date - timerDate ()) > 0) {}
+        mCAN.requestDedicatedTxBuffer (txBuffer) ;
+        const int32_t deviation = int32_t (timerDate () - date) ;
+        mPrepared = false ;
+        mNextTxBuffer = uint8_t ((mNextTxBuffer + 1) % mSettings.mTxBufferCount) ;
+        recordDeviation (mPreparedFrame, deviation) ;
+        loop = true ;
+      }else{
+        setTimerCompare (date - SPIN_TICKS) ;
+        loop = int32_t (date - SPIN_TICKS - timerDate ()) <= 0 ; // Compare date already passed
+      }
+  //--- Prepare next frame into next dedicated Tx buffer
+    }else if (mQueueCount > 0) {
+      const ScheduledFrame & entry = mQueue [mQueueReadIndex] ;
+      if (mCAN.prepareDedicatedTxBuffer (entry.mFrame, txBuffer)) {
+        mPreparedFrame = entry ;
+        mPrepared = true ;
+        mQueueReadIndex = (mQueueReadIndex + 1) % mQueueSize ;
+        mQueueCount -= 1 ;
+        loop = true ;
+      }else{ // Buffer is still pending (busy bus)
+        setTimerCompare (timerDate () + RETRY_TICKS) ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Timing deviation
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TraceReplay::recordDeviation (const ScheduledFrame & inFrame, const int32_t inDeviation) {
+  const int32_t deviation = int32_t ((int64_t (inDeviation) * 1000) / int32_t (TIMER_TICKS_PER_MICROSECOND)) ; // In ns
+  if ((mReplayedFrameCount == 0) || (mMinimumDeviation > deviation)) {
+    mMinimumDeviation = deviation ;
+  }
+  if ((mReplayedFrameCount == 0) || (mMaximumDeviation < deviation)) {
+    mMaximumDeviation = deviation ;
+  }
+  mDeviationSum += deviation ;
+  mReplayedFrameCount += 1 ;
+  if (deviation > int32_t (mSettings.mLateThreshold)) {
+    mLateFrameCount += 1 ;
+  }
+  if (mDeviationCount < mQueueSize) {
+    FrameDeviation & entry = mDeviations [(mDeviationReadIndex + mDeviationCount) % mQueueSize] ;
+    entry.mIdentifier = inFrame.mFrame.id ;
+    entry.mScheduledDate = inFrame.mScheduledDate ;
+    entry.mDeviation = deviation ;
+    entry.mExtended = inFrame.mFrame.ext ;
+    mDeviationCount += 1 ;
+  }else{
+    mLostDeviationCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_TraceReplay::readDeviation (FrameDeviation & outDeviation) {
+  noInterrupts () ;
+    const bool ok = mDeviationCount > 0 ;
+    if (ok) {
+      outDeviation = mDeviations [mDeviationReadIndex] ;
+      mDeviationReadIndex = (mDeviationReadIndex + 1) % mQueueSize ;
+      mDeviationCount -= 1 ;
+    }
+  interrupts () ;
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int32_t ACANFD_FeatherM4CAN_TraceReplay::averageDeviation (void) const {
+  noInterrupts () ;
+    const int64_t sum = mDeviationSum ;
+    const uint32_t count = mReplayedFrameCount ;
+  interrupts () ;
+  return (count > 0) ? int32_t (sum / int32_t (count)) : 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN-from-cpp.h>
+
+//--------------------------------------------------------------------------------------------------
+// Timed replay of a trace recorded by ACANFD_FeatherM4CAN_TraceLogger (same stream format), from a
+// memory buffer or a Stream (SD file, ...).
+// poll (called from loop) decodes records into a queue of dated frames; a 32-bit hardware timer
+// (two TC clocked at 48 MHz by GCLK1) interrupts before each frame date: the frame has already
+// been written into a dedicated Tx buffer, the interrupt service routine only requests its
+// transmission (TXBAR) at the frame date, then prepares the next frame in the next dedicated Tx
+// buffer. Dedicated Tx buffers are used in turn, so that a frame can be prepared while previous
+// ones are still pending on a busy bus.
+// Timing deviation is the transmission request date minus the frame scheduled date; it is
+// available per frame (readDeviation) and as statistics.
+// The timer interrupt handler should be defined in the sketch, for example with TC2_TC3:
+//   void TC2_Handler (void) { gReplay.timerInterruptServiceRoutine () ; }
+// Limitations: frames pending at the same time in dedicated Tx buffers are sent in identifier
+// order (as they would have been by arbitration); gaps longer than 40 s are shortened to 40 s;
+// a Stream source ends when available () returns 0.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_TraceReplay {
+
+  //································································································
+  // Hardware timer: 32-bit counter mode pairs two TC, the first one is used
+  //································································································
+
+  public: enum class Timer : uint8_t { TC0_TC1, TC2_TC3, TC4_TC5 } ;
+
+  public: static const uint32_t TIMER_TICKS_PER_MICROSECOND = 48 ;
+
+  //································································································
+  // Settings
+  //································································································
+
+  public: static const uint8_t ALL_CONTROLLERS = 255 ;
+
+  public: class Settings {
+  //--- 100: recorded timing, 200: twice as fast, 50: half speed (1 ... 10,000)
+    public: uint32_t mSpeedPercent = 100 ;
+  //--- Replays frames recorded from can0 (0), can1 (1) or ALL_CONTROLLERS
+    public: uint8_t mRecordedController = ALL_CONTROLLERS ;
+  //--- Frame filter (called from poll): frame is replayed if it returns true (nullptr: all frames)
+    public: bool (* mFilter) (const CANFDMessage & inFrame) = nullptr ;
+  //--- Dedicated Tx buffers, as CANFDMessage::idx (first one is 1)
+    public: uint8_t mFirstTxBuffer = 1 ;
+    public: uint8_t mTxBufferCount = 2 ;
+  //--- Delay from first decoded frame to its transmission, in µs
+    public: uint32_t mStartDelay = 1000 ;
+  //--- A frame is late if its deviation is greater, in ns
+    public: uint32_t mLateThreshold = 10 * 1000 ;
+  } ;
+
+  //································································································
+  // Replay states
+  //································································································
+
+  public: enum State : uint8_t {
+    IDLE,
+    RUNNING,
+    DONE, // Every frame has been requested
+    FORMAT_ERROR // Invalid stream header or record
+  } ;
+
+  //································································································
+  // Frame timing deviation
+  //································································································
+
+  public: class FrameDeviation {
+    public: uint32_t mIdentifier ;
+    public: uint32_t mScheduledDate ; // In µs from first frame
+    public: int32_t mDeviation ; // In ns, positive if late
+    public: bool mExtended ;
+  } ;
+
+  //································································································
+  // Constructor: inQueueSize is the number of decoded frames waiting for their date (it is also
+  // the size of the frame deviation FIFO)
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_TraceReplay (ACANFD_FeatherM4CAN & inCAN,
+                                           const uint32_t inQueueSize,
+                                           const Timer inTimer = Timer::TC2_TC3) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_TraceReplay (void) ;
+
+  //································································································
+  // Begin: configures the timer and starts replay. The trace buffer or stream should remain
+  // valid while state is RUNNING. Returns 0 if ok, otherwise every bit denotes an error
+  //································································································
+
+  public: static const uint32_t kInvalidSpeed          = 1 << 0 ;
+  public: static const uint32_t kInvalidTxBufferCount  = 1 << 1 ;
+  public: static const uint32_t kTxBufferIndexTooLarge = 1 << 2 ;
+
+  public: uint32_t begin (const Settings & inSettings, const uint8_t * inTrace, const uint32_t inLength) ;
+
+  public: uint32_t begin (const Settings & inSettings, Stream & inSource) ;
+
+  //································································································
+  // Stop: disables the timer; prepared frames are not sent
+  //································································································
+
+  public: void stop (void) ;
+
+  //································································································
+  // Poll, should be called from loop often enough for the queue not to become empty
+  //································································································
+
+  public: void poll (void) ;
+
+  public: inline State state (void) const { return mState ; }
+
+  //································································································
+  // Timing deviation
+  //································································································
+
+  public: bool readDeviation (FrameDeviation & outDeviation) ;
+
+  public: inline uint32_t replayedFrameCount (void) const { return mReplayedFrameCount ; }
+  public: inline uint32_t filteredFrameCount (void) const { return mFilteredFrameCount ; }
+  public: inline uint32_t recordedLostFrameCount (void) const { return mRecordedLostFrameCount ; }
+  public: inline uint32_t lateFrameCount (void) const { return mLateFrameCount ; }
+  public: inline uint32_t lostDeviationCount (void) const { return mLostDeviationCount ; }
+  public: inline int32_t minimumDeviation (void) const { return mMinimumDeviation ; } // In ns
+  public: inline int32_t maximumDeviation (void) const { return mMaximumDeviation ; } // In ns
+  public: int32_t averageDeviation (void) const ; // In ns
+
+  //································································································
+  // Timer interrupt service routine
+  //································································································
+
+  public: void timerInterruptServiceRoutine (void) ;
+
+  //································································································
+  // Private types
+  //································································································
+
+  private: class ScheduledFrame {
+    public: CANFDMessage mFrame ;
+    public: uint32_t mDate ; // Timer date
+    public: uint32_t mScheduledDate ; // In µs from first frame
+  } ;
+
+  //································································································
+  // Private methods
+  //································································································
+
+  private: uint32_t start (const Settings & inSettings) ;
+  private: void configureTimer (void) ;
+  private: void disableTimer (void) ;
+  private: uint32_t timerDate (void) const ;
+  private: void setTimerCompare (const uint32_t inDate) ;
+  private: bool decodeNextRecord (void) ;
+  private: void handleRecord (const uint8_t inFlags, const uint32_t inElapsedMicros, const CANFDMessage & inFrame) ;
+  private: void recordDeviation (const ScheduledFrame & inFrame, const int32_t inDeviation) ;
+
+  //································································································
+  // Private properties
+  //································································································
+
+  private: ACANFD_FeatherM4CAN & mCAN ;
+  private: Settings mSettings ;
+//--- Source
+  private: const uint8_t * mTrace ;
+  private: uint32_t mTraceLength ;
+  private: uint32_t mTraceIndex ;
+  private: Stream * mStream ;
+  private: uint8_t mRecord [ACANFD_FeatherM4CAN_TraceLogger::MAX_RECORD_SIZE] ;
+  private: uint8_t mRecordLength ;
+  private: uint8_t mHeaderLength ;
+  private: bool mSourceEnded ;
+//--- Schedule
+  private: uint64_t mRecordedDate ; // In µs from first frame
+  private: uint64_t mScheduleOffset ; // In timer ticks, gaps shortening
+  private: uint64_t mLastScaledDate ; // In timer ticks
+  private: uint32_t mStartDate ; // Timer date of first frame
+  private: bool mFirstFrame ;
+//--- Queue of frames waiting for their date (written by poll, read by interrupt service routine)
+  private: ScheduledFrame * mQueue ;
+  private: const uint32_t mQueueSize ;
+  private: uint32_t mQueueReadIndex ;
+  private: uint32_t mQueueWriteIndex ;
+  private: volatile uint32_t mQueueCount ;
+//--- Prepared frame
+  private: ScheduledFrame mPreparedFrame ;
+  private: uint8_t mNextTxBuffer ; // Index in mSettings.mTxBufferCount
+  private: volatile bool mPrepared ;
+//--- Deviations (written by interrupt service routine, read by readDeviation)
+  private: FrameDeviation * mDeviations ;
+  private: uint32_t mDeviationReadIndex ;
+  private: volatile uint32_t mDeviationCount ;
+  private: volatile uint32_t mLostDeviationCount ;
+  private: int64_t mDeviationSum ;
+  private: volatile int32_t mMinimumDeviation ;
+  private: volatile int32_t mMaximumDeviation ;
+  private: volatile uint32_t mReplayedFrameCount ;
+  private: volatile uint32_t mLateFrameCount ;
+  private: uint32_t mFilteredFrameCount ;
+  private: uint32_t mRecordedLostFrameCount ;
+//--- Timer
+  private: const Timer mTimer ;
+  private: volatile State mState ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_TraceReplay (const ACANFD_FeatherM4CAN_TraceReplay &) = delete ;
+  private: ACANFD_FeatherM4CAN_TraceReplay & operator = (const ACANFD_FeatherM4CAN_TraceReplay &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,269 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_TrafficStatistics.h>
+#include <ACANFD_FeatherM4CAN_Codec.h>
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t identifierMask (const uint16_t inIdentifierCapacity) {
+  uint32_t capacity = 2 ;
+  while ((capacity < inIdentifierCapacity) && (capacity < 32768)) {
+    capacity <<= 1 ;
+  }
+  return capacity - 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TrafficStatistics::ACANFD_FeatherM4CAN_TrafficStatistics (const uint16_t inIdentifierCapacity,
+                                                                              const uint8_t inStandardFilterCount,
+                                                                              const uint8_t inExtendedFilterCount) :
+mKeys (nullptr),
+mIdentifierCounters (nullptr),
+mStandardFilterCounters (new Counters [inStandardFilterCount]),
+mExtendedFilterCounters (new Counters [inExtendedFilterCount]),
+mNonMatchingCounters (),
+mIdentifierMask (identifierMask (inIdentifierCapacity)),
+mStandardFilterCount (inStandardFilterCount),
+mExtendedFilterCount (inExtendedFilterCount),
+mIdentifierCount (0),
+mUntrackedFrameCount (0),
+mRecordingSuspended (false) {
+  mKeys = new uint32_t [mIdentifierMask + 1] ;
+  mIdentifierCounters = new Counters [mIdentifierMask + 1] ;
+  for (uint32_t i=0 ; i<=mIdentifierMask ; i++) {
+    mKeys [i] = EMPTY_KEY ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TrafficStatistics:: ~ ACANFD_FeatherM4CAN_TrafficStatistics (void) {
+  delete [] mKeys ;
+  delete [] mIdentifierCounters ;
+  delete [] mStandardFilterCounters ;
+  delete [] mExtendedFilterCounters ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Recording (interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TrafficStatistics::recordRxElement (const uint32_t * inElement,
+                                                             const uint32_t inDateMicros) {
+  const uint32_t w0 = inElement [0] ;
+  const uint32_t w1 = inElement [1] ;
+  const bool extended = (w0 & (1U << 30)) != 0 ;
+  const uint32_t key = extended ? ((w0 & 0x1FFFFFFFU) | (1U << 31)) : ((w0 >> 18) & 0x7FFU) ;
+  const uint32_t dlc = (w1 >> 16) & 0xF ;
+  uint32_t byteCount ;
+  if ((w1 & (1U << 21)) != 0) { // FDF: CANFD frame
+    byteCount = ACANFD_FeatherM4CAN_Codec::LENGTH_FROM_DLC [dlc] ;
+  }else if ((w0 & (1U << 29)) != 0) { // RTR: remote frame
+    byteCount = 0 ;
+  }else{ // CAN 2.0B data frame: DLC 9 ... 15 means 8 bytes
+    byteCount = (dlc > 8) ? 8 : dlc ;
+  }
+//--- Filter index, 255 if not available (page 1177-1178)
+  const uint8_t filterIndex = ((w1 & (1U << 31)) != 0) ? 255 : uint8_t ((w1 >> 24) & 0x7F) ;
+  record (key, byteCount, filterIndex, inDateMicros) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TrafficStatistics::record (const CANFDMessage & inMessage,
+                                                    const uint32_t inDateMicros) {
+  const uint32_t key = inMessage.ext ? ((inMessage.id & 0x1FFFFFFFU) | (1U << 31)) : (inMessage.id & 0x7FFU) ;
+  const uint32_t byteCount = (inMessage.type == CANFDMessage::CAN_REMOTE) ? 0 : inMessage.len ;
+  record (key, byteCount, inMessage.idx, inDateMicros) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Linear probing: the probe stops at the entry of the key, or at the first empty entry, that is
+// claimed. It is bounded by MAX_PROBE_LENGTH: when the table is full (or the neighbourhood of the
+// home entry is), a new key costs at most MAX_PROBE_LENGTH key comparisons before it is counted as
+// untracked, instead of a scan of the whole table.
+
+void ACANFD_FeatherM4CAN_TrafficStatistics::record (const uint32_t inKey,
+                                                    const uint32_t inByteCount,
+                                                    const uint8_t inFilterIndex,
+                                                    const uint32_t inDateMicros) {
+  if (!mRecordingSuspended) { // reset is clearing the table
+  //--- Identifier
+    const uint32_t probeCount = probeLength () ;
+    uint32_t index = homeIndex (inKey) ;
+    bool found = false ;
+    for (uint32_t probe=0 ; (probe < probeCount) && !found ; probe++) {
+      if (mKeys [index] == inKey) {
+        found = true ;
+      }else if (mKeys [index] == EMPTY_KEY) {
+        mKeys [index] = inKey ;
+        mIdentifierCount += 1 ;
+        found = true ;
+      }else{
+        index = (index + 1) & mIdentifierMask ;
+      }
+    }
+    if (found) {
+      update (mIdentifierCounters [index], inByteCount, inDateMicros) ;
+    }else{
+      mUntrackedFrameCount += 1 ;
+    }
+  //--- Filter
+    const bool extended = (inKey & (1U << 31)) != 0 ;
+    if (inFilterIndex == 255) {
+      update (mNonMatchingCounters [extended], inByteCount, inDateMicros) ;
+    }else if (extended) {
+      if (inFilterIndex < mExtendedFilterCount) {
+        update (mExtendedFilterCounters [inFilterIndex], inByteCount, inDateMicros) ;
+      }
+    }else if (inFilterIndex < mStandardFilterCount) {
+      update (mStandardFilterCounters [inFilterIndex], inByteCount, inDateMicros) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TrafficStatistics::update (Counters & ioCounters,
+                                                    const uint32_t inByteCount,
+                                                    const uint32_t inDateMicros) {
+  if (ioCounters.mFrameCount == 0) {
+    ioCounters.mFirstDate = inDateMicros ;
+  }else{
+    const uint32_t interval = inDateMicros - ioCounters.mLastDate ;
+    if (ioCounters.mMinInterval > interval) {
+      ioCounters.mMinInterval = interval ;
+    }
+    if (ioCounters.mMaxInterval < interval) {
+      ioCounters.mMaxInterval = interval ;
+    }
+  }
+  ioCounters.mLastDate = inDateMicros ;
+  ioCounters.mFrameCount += 1 ;
+  ioCounters.mByteCount += inByteCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Snapshot (loop)
+//--------------------------------------------------------------------------------------------------
+// Entries are read with PRIMASK saved and restored, so these accessors can also be called with
+// interrupts disabled.
+
+uint16_t ACANFD_FeatherM4CAN_TrafficStatistics::snapshot (IdentifierCounters * outEntries,
+                                                          const uint16_t inCapacity) const {
+  uint16_t n = 0 ;
+  for (uint32_t i=0 ; (i<=mIdentifierMask) && (n < inCapacity) ; i++) {
+    const uint32_t primask = __get_PRIMASK () ;
+    __disable_irq () ;
+      const uint32_t key = mKeys [i] ;
+      if (key != EMPTY_KEY) {
+        IdentifierCounters & entry = outEntries [n] ;
+        static_cast <Counters &> (entry) = mIdentifierCounters [i] ;
+        entry.mIdentifier = key & 0x1FFFFFFFU ;
+        entry.mExtended = (key & (1U << 31)) != 0 ;
+        n += 1 ;
+      }
+    __set_PRIMASK (primask) ;
+  }
+  return n ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACANFD_FeatherM4CAN_TrafficStatistics::identifierCounters (const uint32_t inIdentifier,
+                                                                const bool inExtended,
+                                                                Counters & outCounters) const {
+  const uint32_t key = inExtended ? ((inIdentifier & 0x1FFFFFFFU) | (1U << 31)) : (inIdentifier & 0x7FFU) ;
+  uint32_t index = homeIndex (key) ;
+  bool found = false ;
+  bool end = false ;
+  const uint32_t primask = __get_PRIMASK () ;
+  __disable_irq () ;
+    for (uint32_t probe=0 ; (probe < probeLength ()) && !found && !end ; probe++) {
+      if (mKeys [index] == key) {
+        found = true ;
+        outCounters = mIdentifierCounters [index] ;
+      }else if (mKeys [index] == EMPTY_KEY) {
+        end = true ;
+      }else{
+        index = (index + 1) & mIdentifierMask ;
+      }
+    }
+  __set_PRIMASK (primask) ;
+  return found ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TrafficStatistics::Counters
+ACANFD_FeatherM4CAN_TrafficStatistics::standardFilterCounters (const uint8_t inFilterIndex) const {
+  Counters result ;
+  if (inFilterIndex < mStandardFilterCount) {
+    const uint32_t primask = __get_PRIMASK () ;
+    __disable_irq () ;
+      result = mStandardFilterCounters [inFilterIndex] ;
+    __set_PRIMASK (primask) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TrafficStatistics::Counters
+ACANFD_FeatherM4CAN_TrafficStatistics::extendedFilterCounters (const uint8_t inFilterIndex) const {
+  Counters result ;
+  if (inFilterIndex < mExtendedFilterCount) {
+    const uint32_t primask = __get_PRIMASK () ;
+    __disable_irq () ;
+      result = mExtendedFilterCounters [inFilterIndex] ;
+    __set_PRIMASK (primask) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TrafficStatistics::Counters
+ACANFD_FeatherM4CAN_TrafficStatistics::nonMatchingCounters (const bool inExtended) const {
+  const uint32_t primask = __get_PRIMASK () ;
+  __disable_irq () ;
+    const Counters result = mNonMatchingCounters [inExtended] ;
+  __set_PRIMASK (primask) ;
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Reset
+//--------------------------------------------------------------------------------------------------
+// Clearing the whole table with interrupts disabled would hold off the receive interrupt for a
+// time proportional to the capacity: recording is suspended instead, and the table is cleared with
+// interrupts enabled. A record that had started before the suspension cannot be in progress, as
+// reset is called from loop, at a lower priority than receive interrupt service routines.
+
+void ACANFD_FeatherM4CAN_TrafficStatistics::reset (void) {
+  mRecordingSuspended = true ;
+  __DMB () ; // Suspension is visible before the table is written
+  for (uint32_t i=0 ; i<=mIdentifierMask ; i++) {
+    mKeys [i] = EMPTY_KEY ;
+    mIdentifierCounters [i] = Counters () ;
+  }
+  for (uint32_t i=0 ; i<mStandardFilterCount ; i++) {
+    mStandardFilterCounters [i] = Counters () ;
+  }
+  for (uint32_t i=0 ; i<mExtendedFilterCount ; i++) {
+    mExtendedFilterCounters [i] = Counters () ;
+  }
+  mNonMatchingCounters [0] = Counters () ;
+  mNonMatchingCounters [1] = Counters () ;
+  mIdentifierCount = 0 ;
+  mUntrackedFrameCount = 0 ;
+  __DMB () ; // Table is cleared before recording resumes
+  mRecordingSuspended = false ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,149 @@
+//--------------------------------------------------------------------------------------------------
+// Page numbers refer to DS60001507G data sheet
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Per identifier and per filter traffic statistics of received frames. Once set to a controller
+// (setTrafficStatistics), every received frame is recorded by its receive interrupt service
+// routine (before it is checked by E2E module, handled by ISO-TP engine or routed by gateway):
+//   - in an open addressing hash table (linear probing), keyed by identifier and format; the
+//     capacity is fixed (rounded up to a power of two), and an identifier is stored at most
+//     MAX_PROBE_LENGTH entries after its home entry: a frame with a new identifier that does not
+//     fit is only counted by untrackedFrameCount, so a full table costs a bounded probe;
+//   - in a flat array indexed by filter index (standard and extended filters), frames accepted
+//     by no filter are counted separately.
+// For each entry: frame count, payload byte count, min / max interval between frames, first and
+// last reception dates (in µs, micros () time base).
+// Filter indexes are controller specific: set a distinct object to each controller.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_TrafficStatistics {
+
+  //································································································
+  // Counters
+  //································································································
+
+  public: class Counters {
+    public: uint32_t mFrameCount = 0 ;
+    public: uint32_t mByteCount = 0 ; // Payload bytes
+    public: uint32_t mMinInterval = UINT32_MAX ; // In µs, UINT32_MAX if less than 2 frames
+    public: uint32_t mMaxInterval = 0 ; // In µs
+    public: uint32_t mFirstDate = 0 ; // In µs
+    public: uint32_t mLastDate = 0 ; // In µs
+
+  //--- In µs, 0 if less than 2 frames
+    public: inline uint32_t averageInterval (void) const {
+      return (mFrameCount < 2) ? 0 : ((mLastDate - mFirstDate) / (mFrameCount - 1)) ;
+    }
+  } ;
+
+  public: class IdentifierCounters : public Counters {
+    public: uint32_t mIdentifier = 0 ;
+    public: bool mExtended = false ;
+  } ;
+
+  //································································································
+  // Constructor: inIdentifierCapacity is rounded up to a power of two (2 ... 32,768); filter
+  // counts should be the filter counts given to beginFD
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_TrafficStatistics (const uint16_t inIdentifierCapacity,
+                                                 const uint8_t inStandardFilterCount,
+                                                 const uint8_t inExtendedFilterCount) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_TrafficStatistics (void) ;
+
+  //································································································
+  // Snapshot (from loop): copies at most inCapacity identifier entries into outEntries, returns
+  // the number of copied entries. Each entry is copied with interrupts disabled.
+  //································································································
+
+  public: uint16_t snapshot (IdentifierCounters * outEntries, const uint16_t inCapacity) const ;
+
+//--- Returns false if identifier has not been recorded
+  public: bool identifierCounters (const uint32_t inIdentifier,
+                                   const bool inExtended,
+                                   Counters & outCounters) const ;
+
+//--- Zero counters if filter index is out of range
+  public: Counters standardFilterCounters (const uint8_t inFilterIndex) const ;
+
+  public: Counters extendedFilterCounters (const uint8_t inFilterIndex) const ;
+
+//--- Frames accepted by no filter (non matching frames accepted by global filter configuration)
+  public: Counters nonMatchingCounters (const bool inExtended) const ;
+
+  public: inline uint16_t identifierCapacity (void) const { return uint16_t (mIdentifierMask + 1) ; }
+  public: inline uint16_t identifierCount (void) const { return mIdentifierCount ; }
+  public: inline uint32_t untrackedFrameCount (void) const { return mUntrackedFrameCount ; }
+
+//--- Clears all entries (from loop). Recording is suspended while the table is cleared, interrupts
+//    are not disabled: frames received meanwhile are not counted
+  public: void reset (void) ;
+
+  //································································································
+  // Called by driver, from interrupt service routine
+  //································································································
+
+//--- inElement is the hardware Rx FIFO element (page 1177)
+  public: void recordRxElement (const uint32_t * inElement, const uint32_t inDateMicros) ;
+
+//--- Frame copied by DMA
+  public: void record (const CANFDMessage & inMessage, const uint32_t inDateMicros) ;
+
+  //································································································
+  // Private
+  //································································································
+
+  private: static const uint32_t EMPTY_KEY = UINT32_MAX ; // Not a valid key: extended identifiers are 29-bit
+
+  public: static const uint32_t MAX_PROBE_LENGTH = 16 ;
+
+  private: inline uint32_t probeLength (void) const {
+    return (mIdentifierMask < MAX_PROBE_LENGTH) ? (mIdentifierMask + 1) : MAX_PROBE_LENGTH ;
+  }
+
+  private: void record (const uint32_t inKey,
+                        const uint32_t inByteCount,
+                        const uint8_t inFilterIndex,
+                        const uint32_t inDateMicros) ;
+
+//--- Multiplicative hash (golden ratio), high bits folded into low bits
+  private: inline uint32_t homeIndex (const uint32_t inKey) const {
+    const uint32_t h = inKey * 0x9E3779B1U ;
+    return (h ^ (h >> 16)) & mIdentifierMask ;
+  }
+
+  private: static void update (Counters & ioCounters, const uint32_t inByteCount, const uint32_t inDateMicros) ;
+
+  private: uint32_t * mKeys ; // Identifier, bit 31 set for an extended frame
+  private: Counters * mIdentifierCounters ;
+  private: Counters * mStandardFilterCounters ;
+  private: Counters * mExtendedFilterCounters ;
+  private: Counters mNonMatchingCounters [2] ; // Standard, extended
+  private: const uint32_t mIdentifierMask ; // Capacity - 1
+  private: const uint8_t mStandardFilterCount ;
+  private: const uint8_t mExtendedFilterCount ;
+  private: volatile uint16_t mIdentifierCount ;
+  private: volatile uint32_t mUntrackedFrameCount ;
+  private: volatile bool mRecordingSuspended ; // While reset clears the table
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_TrafficStatistics (const ACANFD_FeatherM4CAN_TrafficStatistics &) = delete ;
+  private: ACANFD_FeatherM4CAN_TrafficStatistics & operator = (const ACANFD_FeatherM4CAN_TrafficStatistics &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------------------
+
+#include <ACANFD_FeatherM4CAN_TransmitRing.h>
+
+//--------------------------------------------------------------------------------------------------
+//    Constructor
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t ringMask (const uint16_t inCapacity) {
+  uint32_t capacity = 2 ;
+  while ((capacity < inCapacity) && (capacity < 32768)) {
+    capacity <<= 1 ;
+  }
+  return capacity - 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TransmitRing::ACANFD_FeatherM4CAN_TransmitRing (const uint16_t inCapacity) :
+mSlots (nullptr),
+mSequences (nullptr),
+mMask (ringMask (inCapacity)),
+mEnqueueIndex (0),
+mDequeueIndex (0),
+mOverflowCount (0) {
+  mSlots = new CANFDMessage [mMask + 1] ;
+  mSequences = new uint32_t [mMask + 1] ;
+  for (uint32_t i=0 ; i<=mMask ; i++) {
+    mSequences [i] = i ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Destructor
+//--------------------------------------------------------------------------------------------------
+
+ACANFD_FeatherM4CAN_TransmitRing:: ~ ACANFD_FeatherM4CAN_TransmitRing (void) {
+  delete [] mSlots ;
+  delete [] mSequences ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Appending (producers)
+//--------------------------------------------------------------------------------------------------
+// The slot at the enqueue index is free if its sequence is the enqueue index. Otherwise, it is
+// still used by the previous round: either published and not yet consumed, or reserved by a
+// preempted producer; in both cases the ring is full. Exception entry and return clear the
+// exclusive monitor, so STREX fails if an other producer did run since LDREX.
+
+bool ACANFD_FeatherM4CAN_TransmitRing::append (const CANFDMessage & inMessage) {
+  uint32_t position = 0 ;
+  bool reserved = false ;
+  bool full = false ;
+  while (!reserved && !full) {
+    position = __LDREXW (&mEnqueueIndex) ;
+    const int32_t difference = int32_t (mSequences [position & mMask] - position) ;
+    if (difference == 0) {
+      reserved = __STREXW (position + 1, &mEnqueueIndex) == 0 ;
+    }else{
+      __CLREX () ;
+      full = difference < 0 ;
+    }
+  }
+  if (full) {
+    bool done = false ;
+    while (!done) {
+      const uint32_t overflowCount = __LDREXW (&mOverflowCount) ;
+      done = __STREXW (overflowCount + 1, &mOverflowCount) == 0 ;
+    }
+  }else{
+  //--- Copy, interrupts enabled
+    mSlots [position & mMask] = inMessage ;
+  //--- Publish: copy should be complete before the consumer sees the sequence
+    __DMB () ;
+    mSequences [position & mMask] = position + 1 ;
+  }
+  return reserved ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Removing (consumer)
+//--------------------------------------------------------------------------------------------------
+
+const CANFDMessage * ACANFD_FeatherM4CAN_TransmitRing::head (void) const {
+  const uint32_t position = mDequeueIndex ;
+  const CANFDMessage * result = nullptr ;
+  if (mSequences [position & mMask] == (position + 1)) {
+    __DMB () ; // Sequence is read before the frame
+    result = & mSlots [position & mMask] ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TransmitRing::discardHead (void) {
+  const uint32_t position = mDequeueIndex ;
+  __DMB () ; // Frame is read before the slot is released
+  mSequences [position & mMask] = position + mMask + 1 ;
+  mDequeueIndex = position + 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    Counters
+//--------------------------------------------------------------------------------------------------
+
+void ACANFD_FeatherM4CAN_TransmitRing::resetOverflowCount (void) {
+  noInterrupts () ;
+    mOverflowCount = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
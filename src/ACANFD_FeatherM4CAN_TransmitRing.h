@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+// Multi-producer transmit ring. Once set to a controller (setTransmitRing), every frame sent to
+// the Tx FIFO (idx is 0) is appended to the ring, instead of being written into message RAM or
+// into the driver transmit FIFO, with interrupts kept enabled:
+//   - a slot is reserved by an exclusive load / store (LDREX / STREX) of the enqueue index; an
+//     interrupt between them makes the store fail, and the reservation is retried;
+//   - the frame is copied into its slot, interrupts enabled: a producer can be preempted by an
+//     other one, from an interrupt service routine of any priority;
+//   - the slot is published by writing its sequence number, then the CAN interrupt is triggered.
+// The CAN interrupt service routine writes published frames into the hardware Tx FIFO, in
+// reservation order: a slot that is still being copied holds back the following ones, until its
+// producer publishes it. So the duration interrupts are disabled by a sender no longer depends on
+// the payload size, and all Tx FIFO writes happen at CAN interrupt priority.
+// Overflow policy is always DROP_NEWEST: a frame that does not fit is rejected (send status is
+// kTransmitBufferOverflow), and counted. A ring is consumed by a single controller.
+//--------------------------------------------------------------------------------------------------
+
+class ACANFD_FeatherM4CAN_TransmitRing {
+
+  //································································································
+  // Constructor: inCapacity is rounded up to a power of two (2 ... 32,768)
+  //································································································
+
+  public: ACANFD_FeatherM4CAN_TransmitRing (const uint16_t inCapacity) ;
+
+  //································································································
+  // Destructor
+  //································································································
+
+  public: ~ ACANFD_FeatherM4CAN_TransmitRing (void) ;
+
+  //································································································
+  // Producers (loop or any interrupt service routine): returns false if the ring is full
+  //································································································
+
+  public: bool append (const CANFDMessage & inMessage) ;
+
+  //································································································
+  // Accessors
+  //································································································
+
+  public: inline uint16_t capacity (void) const { return uint16_t (mMask + 1) ; }
+
+//--- Reserved slots, including the ones that are being copied
+  public: inline uint16_t count (void) const { return uint16_t (mEnqueueIndex - mDequeueIndex) ; }
+
+  public: inline uint32_t overflowCount (void) const { return mOverflowCount ; }
+
+  public: void resetOverflowCount (void) ;
+
+  //································································································
+  // Consumer (driver, from CAN interrupt service routine)
+  //································································································
+
+//--- nullptr if head slot is not published
+  public: const CANFDMessage * head (void) const ;
+
+//--- Releases head slot (it should be published)
+  public: void discardHead (void) ;
+
+  //································································································
+  // Private
+  //································································································
+
+//--- A slot is free for position p if its sequence is p, published if it is p + 1; it is released
+//    for the next round (p + capacity) by the consumer.
+  private: CANFDMessage * mSlots ;
+  private: volatile uint32_t * mSequences ;
+  private: const uint32_t mMask ; // Capacity - 1
+  private: volatile uint32_t mEnqueueIndex ;
+  private: volatile uint32_t mDequeueIndex ;
+  private: volatile uint32_t mOverflowCount ;
+
+  //································································································
+  // No copy
+  //································································································
+
+  private: ACANFD_FeatherM4CAN_TransmitRing (const ACANFD_FeatherM4CAN_TransmitRing &) = delete ;
+  private: ACANFD_FeatherM4CAN_TransmitRing & operator = (const ACANFD_FeatherM4CAN_TransmitRing &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------